@@ -0,0 +1,444 @@
+#include <volk/volk.h>
+
+#include <vector>
+#include <chrono>
+#include <limits>
+#include <algorithm>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cassert>
+#include <cstdint>
+
+#include "../labutils/error.hpp"
+#include "../labutils/vkutil.hpp"
+#include "../labutils/vkbuffer.hpp"
+#include "../labutils/vkobject.hpp"
+#include "../labutils/vkcompute.hpp"
+#include "../labutils/to_string.hpp"
+#include "../labutils/allocator.hpp"
+#include "../labutils/vulkan_context.hpp"
+namespace lut = labutils;
+
+/* Measures how much compute work on VulkanContext::computeQueue overlaps
+ * with work on the graphics queue.
+ *
+ * The graphics queue runs a bandwidth-bound load (large buffer fills and
+ * copies), standing in for rasterization-heavy passes that leave the ALUs
+ * idle. The compute queue runs an ALU-bound shader. Each load is first timed
+ * on its own, then both are submitted concurrently. The overlap is the time
+ * saved relative to running the loads back to back, as a fraction of the
+ * shorter load (100% = the shorter load is completely hidden).
+ *
+ * Finally, a dependent chain (compute writes, graphics copies the results
+ * for readback) exercises the queue family ownership transfer helpers and
+ * validates the output.
+ *
+ * Set LABUTILS_NO_ASYNC_COMPUTE=1 to use the graphics queue for both loads,
+ * as a baseline.
+ *
+ * Usage: bench-async-compute [runs] [compute-iterations]
+ */
+
+namespace
+{
+using Clock_ = std::chrono::steady_clock;
+using Millisecondsd_ = std::chrono::duration<double, std::milli>;
+
+	namespace cfg
+	{
+		// Compiled shader code
+		// See sources in bench-async-compute/shaders/*.
+#		define SHADERDIR_ "assets/bench-async-compute/shaders/"
+		constexpr char const* kBusyShaderPath = SHADERDIR_ "busy.comp.spv";
+#		undef SHADERDIR_
+
+		constexpr std::uint32_t kDefaultRuns = 10;
+		constexpr std::uint32_t kDefaultIterations = 4096;
+
+		// Compute load: one invocation per element (see busy.comp)
+		constexpr std::uint32_t kComputeElements = 1u << 22;
+		constexpr std::uint32_t kComputeGroupSize = 64;
+
+		// Graphics load: fill + copy of two buffers, repeated
+		constexpr VkDeviceSize kCopyBytes = 64 * 1024 * 1024;
+		constexpr std::uint32_t kCopyRepeats = 16;
+
+		// Elements that are read back and checked in the dependent chain
+		constexpr std::uint32_t kValidateElements = 4096;
+	}
+
+	struct BusyParams
+	{
+		std::uint32_t count;
+		std::uint32_t iterations;
+		float seed;
+	};
+
+	struct ComputeLoad
+	{
+		lut::DescriptorSetLayout layout;
+		lut::PipelineLayout pipeLayout;
+		lut::Pipeline pipe;
+		VkDescriptorSet set;
+	};
+
+	lut::DescriptorSetLayout create_busy_descriptor_layout( lut::VulkanContext const& );
+	lut::PipelineLayout create_busy_pipeline_layout( lut::VulkanContext const&, VkDescriptorSetLayout );
+
+	void begin_commands( VkCommandBuffer );
+	void end_commands( VkCommandBuffer );
+
+	void record_compute( VkCommandBuffer, ComputeLoad const&, BusyParams const& );
+	void record_graphics( VkCommandBuffer, VkBuffer aSrc, VkBuffer aDst );
+
+	void wait_and_reset( lut::VulkanContext const&, std::vector<VkFence> const& );
+
+	double median( std::vector<double> );
+}
+
+int main( int aArgc, char* aArgv[] ) try
+{
+	std::uint32_t runs = cfg::kDefaultRuns;
+	std::uint32_t iterations = cfg::kDefaultIterations;
+
+	if( aArgc > 1 ) runs = std::uint32_t(std::strtoul( aArgv[1], nullptr, 10 ));
+	if( aArgc > 2 ) iterations = std::uint32_t(std::strtoul( aArgv[2], nullptr, 10 ));
+
+	if( 0 == runs )
+		throw lut::Error( "Invalid arguments: runs must be non-zero" );
+
+	lut::VulkanContext context = lut::make_vulkan_context();
+	lut::Allocator allocator = lut::create_allocator( context );
+
+	bool const async = lut::has_async_compute( context );
+	std::printf( "Graphics family %u, compute family %u (%s)\n",
+		context.graphicsFamilyIndex,
+		context.computeFamilyIndex,
+		async ? "async compute" : "shared queue"
+	);
+
+	// Command buffers and synchronization
+	lut::CommandPool graphicsPool = lut::create_command_pool( context, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT );
+	lut::CommandPool computePool = lut::create_command_pool( context, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT, context.computeFamilyIndex );
+
+	VkCommandBuffer graphicsCmd = lut::alloc_command_buffer( context, graphicsPool.handle );
+	VkCommandBuffer computeCmd = lut::alloc_command_buffer( context, computePool.handle );
+
+	lut::Fence graphicsDone = lut::create_fence( context );
+	lut::Fence computeDone = lut::create_fence( context );
+
+	lut::Semaphore computeToGraphics = lut::create_semaphore( context );
+
+	// Resources
+	lut::Buffer values = lut::create_buffer(
+		allocator,
+		cfg::kComputeElements * sizeof(float),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VMA_MEMORY_USAGE_GPU_ONLY
+	);
+	lut::Buffer copySrc = lut::create_buffer( allocator, cfg::kCopyBytes, VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY );
+	lut::Buffer copyDst = lut::create_buffer( allocator, cfg::kCopyBytes, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_ONLY );
+
+	lut::Buffer readback = lut::create_buffer(
+		allocator,
+		cfg::kValidateElements * sizeof(float),
+		VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VMA_MEMORY_USAGE_GPU_TO_CPU
+	);
+
+	// Compute pipeline
+	lut::DescriptorPool dpool = lut::create_descriptor_pool( context );
+
+	ComputeLoad load{};
+	load.layout = create_busy_descriptor_layout( context );
+	load.pipeLayout = create_busy_pipeline_layout( context, load.layout.handle );
+	{
+		lut::ShaderModule shader = lut::load_shader_module( context, cfg::kBusyShaderPath );
+		load.pipe = lut::create_compute_pipeline( context, load.pipeLayout.handle, shader.handle );
+	}
+
+	load.set = lut::alloc_desc_set( context, dpool.handle, load.layout.handle );
+	{
+		VkDescriptorBufferInfo bufferInfo{}; {
+			bufferInfo.buffer = values.buffer;
+			bufferInfo.range = VK_WHOLE_SIZE;
+		}
+
+		VkWriteDescriptorSet write{}; {
+			write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			write.dstSet = load.set;
+			write.dstBinding = 0;
+			write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			write.descriptorCount = 1;
+			write.pBufferInfo = &bufferInfo;
+		}
+
+		vkUpdateDescriptorSets( context.device, 1, &write, 0, nullptr );
+	}
+
+	BusyParams const params{ cfg::kComputeElements, iterations, 0.25f };
+
+	// Record the two loads once; they are resubmitted for each run.
+	begin_commands( computeCmd );
+	record_compute( computeCmd, load, params );
+	end_commands( computeCmd );
+
+	begin_commands( graphicsCmd );
+	record_graphics( graphicsCmd, copySrc.buffer, copyDst.buffer );
+	end_commands( graphicsCmd );
+
+	// Warm up (first submissions may include lazy allocations, shader
+	// compilation etc.)
+	lut::submit_commands( context.computeQueue, computeCmd, {}, {}, computeDone.handle );
+	lut::submit_commands( context.graphicsQueue, graphicsCmd, {}, {}, graphicsDone.handle );
+	wait_and_reset( context, { computeDone.handle, graphicsDone.handle } );
+
+	// Measure
+	std::vector<double> graphicsMs, computeMs, concurrentMs;
+	for( std::uint32_t run = 0; run < runs; ++run )
+	{
+		auto const t0 = Clock_::now();
+		lut::submit_commands( context.graphicsQueue, graphicsCmd, {}, {}, graphicsDone.handle );
+		wait_and_reset( context, { graphicsDone.handle } );
+
+		auto const t1 = Clock_::now();
+		lut::submit_commands( context.computeQueue, computeCmd, {}, {}, computeDone.handle );
+		wait_and_reset( context, { computeDone.handle } );
+
+		auto const t2 = Clock_::now();
+		lut::submit_commands( context.computeQueue, computeCmd, {}, {}, computeDone.handle );
+		lut::submit_commands( context.graphicsQueue, graphicsCmd, {}, {}, graphicsDone.handle );
+		wait_and_reset( context, { computeDone.handle, graphicsDone.handle } );
+
+		auto const t3 = Clock_::now();
+
+		graphicsMs.emplace_back( Millisecondsd_( t1 - t0 ).count() );
+		computeMs.emplace_back( Millisecondsd_( t2 - t1 ).count() );
+		concurrentMs.emplace_back( Millisecondsd_( t3 - t2 ).count() );
+	}
+
+	double const graphics = median( graphicsMs );
+	double const compute = median( computeMs );
+	double const concurrent = median( concurrentMs );
+
+	double const serial = graphics + compute;
+	double const overlap = (serial - concurrent) / std::min( graphics, compute );
+
+	std::printf( "Median of %u runs (%u compute iterations):\n", runs, iterations );
+	std::printf( "  graphics load alone : %8.3f ms\n", graphics );
+	std::printf( "  compute load alone  : %8.3f ms\n", compute );
+	std::printf( "  back to back        : %8.3f ms\n", serial );
+	std::printf( "  concurrent          : %8.3f ms (%.1f%% overlap)\n", concurrent, 100.0 * overlap );
+
+	// Dependent chain: compute -> (release/semaphore/acquire) -> graphics.
+	// Zero iterations make the results exactly predictable.
+	BusyParams const chainParams{ cfg::kComputeElements, 0, 0.5f };
+
+	lut::QueueTransfer const transfer{
+		context.computeFamilyIndex, context.graphicsFamilyIndex,
+		VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT
+	};
+
+	vkResetCommandBuffer( computeCmd, 0 );
+	begin_commands( computeCmd );
+	record_compute( computeCmd, load, chainParams );
+	lut::release_buffer( computeCmd, values.buffer, transfer );
+	end_commands( computeCmd );
+
+	vkResetCommandBuffer( graphicsCmd, 0 );
+	begin_commands( graphicsCmd );
+	lut::acquire_buffer( graphicsCmd, values.buffer, transfer );
+	{
+		VkBufferCopy const copy{ 0, 0, cfg::kValidateElements * sizeof(float) };
+		vkCmdCopyBuffer( graphicsCmd, values.buffer, readback.buffer, 1, &copy );
+	}
+	lut::buffer_barrier( graphicsCmd, readback.buffer,
+		VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_HOST_READ_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT
+	);
+	end_commands( graphicsCmd );
+
+	auto const chainStart = Clock_::now();
+	lut::submit_commands( context.computeQueue, computeCmd, {}, { computeToGraphics.handle } );
+	lut::submit_commands( context.graphicsQueue, graphicsCmd, { { computeToGraphics.handle, VK_PIPELINE_STAGE_TRANSFER_BIT } }, {}, graphicsDone.handle );
+	wait_and_reset( context, { graphicsDone.handle } );
+	auto const chainEnd = Clock_::now();
+
+	void* mapped = nullptr;
+	if( auto const res = vmaMapMemory( allocator.allocator, readback.allocation, &mapped ); VK_SUCCESS != res )
+	{
+		throw lut::Error( "Unable to map readback buffer\n"
+			"vmaMapMemory() returned %s", lut::to_string(res).c_str()
+		);
+	}
+
+	vmaInvalidateAllocation( allocator.allocator, readback.allocation, 0, VK_WHOLE_SIZE );
+
+	auto const* results = static_cast<float const*>(mapped);
+
+	std::uint32_t errors = 0;
+	for( std::uint32_t i = 0; i < cfg::kValidateElements; ++i )
+	{
+		float const expected = chainParams.seed + float(i & 1023u) * (1.f / 1024.f);
+		if( std::abs( results[i] - expected ) > 1e-6f )
+			++errors;
+	}
+
+	vmaUnmapMemory( allocator.allocator, readback.allocation );
+
+	std::printf( "Dependent chain (%s): %.3f ms, %u/%u values correct\n",
+		async ? "ownership transfer" : "same family",
+		Millisecondsd_( chainEnd - chainStart ).count(),
+		cfg::kValidateElements - errors,
+		cfg::kValidateElements
+	);
+
+	vkDeviceWaitIdle( context.device );
+
+	return 0 == errors ? 0 : 1;
+}
+catch( std::exception const& eErr )
+{
+	std::fprintf( stderr, "\n" );
+	std::fprintf( stderr, "Error: %s\n", eErr.what() );
+	return 1;
+}
+
+namespace
+{
+	lut::DescriptorSetLayout create_busy_descriptor_layout( lut::VulkanContext const& aContext )
+	{
+		VkDescriptorSetLayoutBinding binding{}; {
+			binding.binding = 0;
+			binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			binding.descriptorCount = 1;
+			binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		}
+
+		VkDescriptorSetLayoutCreateInfo layoutInfo{}; {
+			layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+			layoutInfo.bindingCount = 1;
+			layoutInfo.pBindings = &binding;
+		}
+
+		VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+		if( auto const res = vkCreateDescriptorSetLayout( aContext.device, &layoutInfo, nullptr, &layout ); VK_SUCCESS != res )
+		{
+			throw lut::Error( "Unable to create descriptor set layout\n"
+				"vkCreateDescriptorSetLayout() returned %s", lut::to_string(res).c_str()
+			);
+		}
+
+		return lut::DescriptorSetLayout( aContext.device, layout );
+	}
+
+	lut::PipelineLayout create_busy_pipeline_layout( lut::VulkanContext const& aContext, VkDescriptorSetLayout aLayout )
+	{
+		VkPushConstantRange range{}; {
+			range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+			range.offset = 0;
+			range.size = sizeof(BusyParams);
+		}
+
+		VkPipelineLayoutCreateInfo layoutInfo{}; {
+			layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+			layoutInfo.setLayoutCount = 1;
+			layoutInfo.pSetLayouts = &aLayout;
+			layoutInfo.pushConstantRangeCount = 1;
+			layoutInfo.pPushConstantRanges = &range;
+		}
+
+		VkPipelineLayout layout = VK_NULL_HANDLE;
+		if( auto const res = vkCreatePipelineLayout( aContext.device, &layoutInfo, nullptr, &layout ); VK_SUCCESS != res )
+		{
+			throw lut::Error( "Unable to create pipeline layout\n"
+				"vkCreatePipelineLayout() returned %s", lut::to_string(res).c_str()
+			);
+		}
+
+		return lut::PipelineLayout( aContext.device, layout );
+	}
+
+	void begin_commands( VkCommandBuffer aCmdBuff )
+	{
+		VkCommandBufferBeginInfo beginInfo{}; {
+			beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		}
+
+		if( auto const res = vkBeginCommandBuffer( aCmdBuff, &beginInfo ); VK_SUCCESS != res )
+		{
+			throw lut::Error( "Unable to begin recording command buffer\n"
+				"vkBeginCommandBuffer() returned %s", lut::to_string(res).c_str()
+			);
+		}
+	}
+	void end_commands( VkCommandBuffer aCmdBuff )
+	{
+		if( auto const res = vkEndCommandBuffer( aCmdBuff ); VK_SUCCESS != res )
+		{
+			throw lut::Error( "Unable to end recording command buffer\n"
+				"vkEndCommandBuffer() returned %s", lut::to_string(res).c_str()
+			);
+		}
+	}
+
+	void record_compute( VkCommandBuffer aCmdBuff, ComputeLoad const& aLoad, BusyParams const& aParams )
+	{
+		vkCmdBindPipeline( aCmdBuff, VK_PIPELINE_BIND_POINT_COMPUTE, aLoad.pipe.handle );
+		vkCmdBindDescriptorSets( aCmdBuff, VK_PIPELINE_BIND_POINT_COMPUTE, aLoad.pipeLayout.handle, 0, 1, &aLoad.set, 0, nullptr );
+		vkCmdPushConstants( aCmdBuff, aLoad.pipeLayout.handle, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(BusyParams), &aParams );
+
+		lut::dispatch_1d( aCmdBuff, aParams.count, cfg::kComputeGroupSize );
+	}
+
+	void record_graphics( VkCommandBuffer aCmdBuff, VkBuffer aSrc, VkBuffer aDst )
+	{
+		for( std::uint32_t i = 0; i < cfg::kCopyRepeats; ++i )
+		{
+			vkCmdFillBuffer( aCmdBuff, aSrc, 0, VK_WHOLE_SIZE, i );
+
+			lut::buffer_barrier( aCmdBuff, aSrc,
+				VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+				VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT
+			);
+
+			VkBufferCopy const copy{ 0, 0, cfg::kCopyBytes };
+			vkCmdCopyBuffer( aCmdBuff, aSrc, aDst, 1, &copy );
+
+			// Next fill must wait for the copy to have read the source.
+			lut::buffer_barrier( aCmdBuff, aSrc,
+				VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+				VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT
+			);
+		}
+	}
+
+	void wait_and_reset( lut::VulkanContext const& aContext, std::vector<VkFence> const& aFences )
+	{
+		if( auto const res = vkWaitForFences( aContext.device, std::uint32_t(aFences.size()), aFences.data(), VK_TRUE, std::numeric_limits<std::uint64_t>::max() ); VK_SUCCESS != res )
+		{
+			throw lut::Error( "Unable to wait for fences\n"
+				"vkWaitForFences() returned %s", lut::to_string(res).c_str()
+			);
+		}
+
+		if( auto const res = vkResetFences( aContext.device, std::uint32_t(aFences.size()), aFences.data() ); VK_SUCCESS != res )
+		{
+			throw lut::Error( "Unable to reset fences\n"
+				"vkResetFences() returned %s", lut::to_string(res).c_str()
+			);
+		}
+	}
+
+	double median( std::vector<double> aSamples )
+	{
+		assert( !aSamples.empty() );
+		std::sort( aSamples.begin(), aSamples.end() );
+		return aSamples[aSamples.size()/2];
+	}
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
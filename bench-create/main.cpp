@@ -0,0 +1,555 @@
+#include <volk/volk.h>
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <utility>
+#include <algorithm>
+#include <type_traits>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cassert>
+#include <cstdint>
+
+#include "../labutils/error.hpp"
+#include "../labutils/vkutil.hpp"
+#include "../labutils/vkimage.hpp"
+#include "../labutils/vkobject.hpp"
+#include "../labutils/vkcompute.hpp"
+#include "../labutils/to_string.hpp"
+#include "../labutils/allocator.hpp"
+#include "../labutils/object_cache.hpp"
+#include "../labutils/vulkan_context.hpp"
+namespace lut = labutils;
+
+/* Measures the cost of creating (and destroying) the Vulkan objects that
+ * labutils creates: fences, semaphores, command pools and buffers,
+ * descriptor pools and sets, shader modules, samplers, image views and
+ * pipelines.
+ *
+ * Where labutils offers a cache, or Vulkan does (VkPipelineCache), both the
+ * uncached and the cached path are measured:
+ *  - shader modules: load_shader_module() (file I/O + creation) vs.
+ *    creation from SPIR-V that is already in memory
+ *  - samplers/image views: create_*() vs. SamplerCache/ImageViewCache hits
+ *  - pipelines: no VkPipelineCache vs. a warm VkPipelineCache. Note that
+ *    many drivers additionally keep an internal cache, so the "none" numbers
+ *    may already benefit from earlier iterations.
+ *
+ * Each case creates `count` objects, then destroys them; this is repeated
+ * and the median per-object times are reported.
+ *
+ * Usage: bench-create [count] [repeats]
+ */
+
+namespace
+{
+using Clock_ = std::chrono::steady_clock;
+using Microsecondsd_ = std::chrono::duration<double, std::micro>;
+
+	namespace cfg
+	{
+		// Compiled shader code. These are the shaders of exercise2 and of
+		// bench-async-compute; see their respective sources.
+		constexpr char const* kVertShaderPath = "assets/exercise2/shaders/triangle.vert.spv";
+		constexpr char const* kFragShaderPath = "assets/exercise2/shaders/triangle.frag.spv";
+		constexpr char const* kCompShaderPath = "assets/bench-async-compute/shaders/busy.comp.spv";
+
+		constexpr std::uint32_t kDefaultCount = 1000;
+		constexpr std::uint32_t kDefaultRepeats = 5;
+
+		// Pipelines are much more expensive than the other objects
+		constexpr std::uint32_t kPipelineDivisor = 10;
+
+		// Limit of labutils::create_descriptor_pool()'s default pool
+		constexpr std::uint32_t kMaxSetsPerPool = 1024;
+
+		constexpr VkFormat kColorFormat = VK_FORMAT_R8G8B8A8_SRGB;
+	}
+
+	struct Result
+	{
+		double createUs;
+		double destroyUs;
+	};
+
+	struct Reset_
+	{
+		template< typename tObject >
+		void operator() (tObject& aObject) const { aObject = tObject{}; }
+	};
+
+	// Creates aCount objects with aCreate(i), then destroys them with
+	// aDestroy(object). Returns the median per-object times over aRepeats.
+	template< typename tCreate, typename tDestroy = Reset_ >
+	Result measure( std::uint32_t aCount, std::uint32_t aRepeats, tCreate&& aCreate, tDestroy&& aDestroy = {} );
+
+	void print_result( char const* aObject, char const* aVariant, std::uint32_t aCount, Result const& );
+
+	std::vector<std::uint32_t> load_spirv( char const* aPath );
+	lut::ShaderModule create_shader_module( lut::VulkanContext const&, std::vector<std::uint32_t> const& );
+
+	lut::DescriptorSetLayout create_sampler_layout( lut::VulkanContext const& );
+	lut::DescriptorSetLayout create_storage_layout( lut::VulkanContext const& );
+	lut::PipelineLayout create_pipeline_layout( lut::VulkanContext const&, VkDescriptorSetLayout, VkShaderStageFlags aPushStages, std::uint32_t aPushSize );
+
+	lut::RenderPass create_render_pass( lut::VulkanContext const& );
+	lut::Pipeline create_graphics_pipeline( lut::VulkanContext const&, VkRenderPass, VkPipelineLayout, VkShaderModule aVert, VkShaderModule aFrag, VkPipelineCache );
+
+	using PipelineCache_ = lut::UniqueHandle< VkPipelineCache, VkDevice, vkDestroyPipelineCache >;
+	PipelineCache_ create_pipeline_cache( lut::VulkanContext const& );
+}
+
+int main( int aArgc, char* aArgv[] ) try
+{
+	std::uint32_t count = cfg::kDefaultCount;
+	std::uint32_t repeats = cfg::kDefaultRepeats;
+
+	if( aArgc > 1 ) count = std::uint32_t(std::strtoul( aArgv[1], nullptr, 10 ));
+	if( aArgc > 2 ) repeats = std::uint32_t(std::strtoul( aArgv[2], nullptr, 10 ));
+
+	if( 0 == count || 0 == repeats )
+		throw lut::Error( "Invalid arguments: count and repeats must be non-zero" );
+
+	lut::VulkanContext context = lut::make_vulkan_context();
+	lut::Allocator allocator = lut::create_allocator( context );
+
+	std::uint32_t const pipelineCount = std::max<std::uint32_t>( 1, count / cfg::kPipelineDivisor );
+	std::uint32_t const setCount = std::min( count, cfg::kMaxSetsPerPool );
+
+	std::printf( "%-20s %-12s %8s %14s %14s\n", "object", "variant", "count", "create us/obj", "destroy us/obj" );
+
+	// Synchronization
+	print_result( "fence", "-", count, measure( count, repeats, [&] (std::uint32_t) {
+		return lut::create_fence( context );
+	} ) );
+	print_result( "fence", "signaled", count, measure( count, repeats, [&] (std::uint32_t) {
+		return lut::create_fence( context, VK_FENCE_CREATE_SIGNALED_BIT );
+	} ) );
+	print_result( "semaphore", "-", count, measure( count, repeats, [&] (std::uint32_t) {
+		return lut::create_semaphore( context );
+	} ) );
+
+	// Commands
+	print_result( "command_pool", "-", count, measure( count, repeats, [&] (std::uint32_t) {
+		return lut::create_command_pool( context );
+	} ) );
+	{
+		lut::CommandPool pool = lut::create_command_pool( context );
+
+		auto const res = measure( count, repeats, [&] (std::uint32_t) {
+			return lut::alloc_command_buffer( context, pool.handle );
+		}, [&] (VkCommandBuffer& aBuffer) {
+			vkFreeCommandBuffers( context.device, pool.handle, 1, &aBuffer );
+		} );
+		print_result( "command_buffer", "-", count, res );
+	}
+
+	// Descriptors
+	print_result( "descriptor_pool", "-", count, measure( count, repeats, [&] (std::uint32_t) {
+		return lut::create_descriptor_pool( context );
+	} ) );
+	{
+		lut::DescriptorSetLayout layout = create_sampler_layout( context );
+		lut::DescriptorPool pool = lut::create_descriptor_pool( context );
+
+		// Sets are not freed individually (the pool does not have
+		// FREE_DESCRIPTOR_SET); resetting the pool releases them all.
+		std::uint32_t allocated = 0;
+		auto const res = measure( setCount, repeats, [&] (std::uint32_t) {
+			++allocated;
+			return lut::alloc_desc_set( context, pool.handle, layout.handle );
+		}, [&] (VkDescriptorSet&) {
+			if( 0 == --allocated )
+				vkResetDescriptorPool( context.device, pool.handle, 0 );
+		} );
+		print_result( "descriptor_set", "-", setCount, res );
+	}
+
+	// Shader modules
+	auto const vertCode = load_spirv( cfg::kVertShaderPath );
+	auto const fragCode = load_spirv( cfg::kFragShaderPath );
+	auto const compCode = load_spirv( cfg::kCompShaderPath );
+
+	print_result( "shader_module", "file", count, measure( count, repeats, [&] (std::uint32_t) {
+		return lut::load_shader_module( context, cfg::kFragShaderPath );
+	} ) );
+	print_result( "shader_module", "preloaded", count, measure( count, repeats, [&] (std::uint32_t) {
+		return create_shader_module( context, fragCode );
+	} ) );
+
+	// Samplers
+	print_result( "sampler", "none", count, measure( count, repeats, [&] (std::uint32_t) {
+		return lut::create_default_sampler( context );
+	} ) );
+	{
+		lut::SamplerCache cache( context );
+		cache.release( cache.acquire_default() ); // warm
+
+		print_result( "sampler", "cache", count, measure( count, repeats, [&] (std::uint32_t) {
+			return cache.acquire_default();
+		}, [&] (VkSampler& aSampler) {
+			cache.release( aSampler );
+		} ) );
+	}
+
+	// Image views
+	{
+		lut::Image image = lut::create_image_texture2d( allocator, 256, 256, cfg::kColorFormat );
+
+		print_result( "image_view", "none", count, measure( count, repeats, [&] (std::uint32_t) {
+			return lut::create_image_view_texture2d( context, image.image, cfg::kColorFormat );
+		} ) );
+
+		lut::ImageViewCache cache( context );
+		cache.release( cache.acquire_texture2d( image.image, cfg::kColorFormat ) ); // warm
+
+		print_result( "image_view", "cache", count, measure( count, repeats, [&] (std::uint32_t) {
+			return cache.acquire_texture2d( image.image, cfg::kColorFormat );
+		}, [&] (VkImageView& aView) {
+			cache.release( aView );
+		} ) );
+
+		cache.evict( image.image );
+	}
+
+	// Pipelines
+	{
+		lut::ShaderModule comp = create_shader_module( context, compCode );
+		lut::DescriptorSetLayout setLayout = create_storage_layout( context );
+		lut::PipelineLayout layout = create_pipeline_layout( context, setLayout.handle, VK_SHADER_STAGE_COMPUTE_BIT, 3 * sizeof(std::uint32_t) );
+
+		print_result( "pipeline_layout", "-", count, measure( count, repeats, [&] (std::uint32_t) {
+			return create_pipeline_layout( context, setLayout.handle, VK_SHADER_STAGE_COMPUTE_BIT, 3 * sizeof(std::uint32_t) );
+		} ) );
+
+		print_result( "compute_pipeline", "none", pipelineCount, measure( pipelineCount, repeats, [&] (std::uint32_t) {
+			return lut::create_compute_pipeline( context, layout.handle, comp.handle );
+		} ) );
+
+		PipelineCache_ cache = create_pipeline_cache( context );
+		lut::create_compute_pipeline( context, layout.handle, comp.handle, nullptr, "main", cache.handle ); // warm
+
+		print_result( "compute_pipeline", "cache", pipelineCount, measure( pipelineCount, repeats, [&] (std::uint32_t) {
+			return lut::create_compute_pipeline( context, layout.handle, comp.handle, nullptr, "main", cache.handle );
+		} ) );
+	}
+	{
+		lut::ShaderModule vert = create_shader_module( context, vertCode );
+		lut::ShaderModule frag = create_shader_module( context, fragCode );
+		lut::RenderPass pass = create_render_pass( context );
+		lut::PipelineLayout layout = create_pipeline_layout( context, VK_NULL_HANDLE, VK_SHADER_STAGE_VERTEX_BIT, 4 * sizeof(float) );
+
+		print_result( "graphics_pipeline", "none", pipelineCount, measure( pipelineCount, repeats, [&] (std::uint32_t) {
+			return create_graphics_pipeline( context, pass.handle, layout.handle, vert.handle, frag.handle, VK_NULL_HANDLE );
+		} ) );
+
+		PipelineCache_ cache = create_pipeline_cache( context );
+		create_graphics_pipeline( context, pass.handle, layout.handle, vert.handle, frag.handle, cache.handle ); // warm
+
+		print_result( "graphics_pipeline", "cache", pipelineCount, measure( pipelineCount, repeats, [&] (std::uint32_t) {
+			return create_graphics_pipeline( context, pass.handle, layout.handle, vert.handle, frag.handle, cache.handle );
+		} ) );
+	}
+
+	return 0;
+}
+catch( std::exception const& eErr )
+{
+	std::fprintf( stderr, "\n" );
+	std::fprintf( stderr, "Error: %s\n", eErr.what() );
+	return 1;
+}
+
+namespace
+{
+	template< typename tCreate, typename tDestroy >
+	Result measure( std::uint32_t aCount, std::uint32_t aRepeats, tCreate&& aCreate, tDestroy&& aDestroy )
+	{
+		using Object_ = std::decay_t<decltype(aCreate( 0u ))>;
+
+		std::vector<double> createUs, destroyUs;
+
+		std::vector<Object_> objects;
+		objects.reserve( aCount );
+
+		for( std::uint32_t repeat = 0; repeat < aRepeats; ++repeat )
+		{
+			auto const t0 = Clock_::now();
+			for( std::uint32_t i = 0; i < aCount; ++i )
+				objects.emplace_back( aCreate( i ) );
+
+			auto const t1 = Clock_::now();
+			for( auto& object : objects )
+				aDestroy( object );
+
+			auto const t2 = Clock_::now();
+			objects.clear();
+
+			createUs.emplace_back( Microsecondsd_( t1 - t0 ).count() / aCount );
+			destroyUs.emplace_back( Microsecondsd_( t2 - t1 ).count() / aCount );
+		}
+
+		std::sort( createUs.begin(), createUs.end() );
+		std::sort( destroyUs.begin(), destroyUs.end() );
+
+		return Result{ createUs[createUs.size()/2], destroyUs[destroyUs.size()/2] };
+	}
+
+	void print_result( char const* aObject, char const* aVariant, std::uint32_t aCount, Result const& aResult )
+	{
+		std::printf( "%-20s %-12s %8u %14.3f %14.3f\n", aObject, aVariant, aCount, aResult.createUs, aResult.destroyUs );
+		std::fflush( stdout );
+	}
+
+	std::vector<std::uint32_t> load_spirv( char const* aPath )
+	{
+		std::FILE* fin = std::fopen( aPath, "rb" );
+		if( !fin )
+			throw lut::Error( "Cannot open '%s' for reading", aPath );
+
+		std::fseek( fin, 0, SEEK_END );
+		auto const bytes = std::size_t(std::ftell( fin ));
+		std::fseek( fin, 0, SEEK_SET );
+
+		std::vector<std::uint32_t> ret( bytes / 4 );
+		auto const read = std::fread( ret.data(), 4, ret.size(), fin );
+		std::fclose( fin );
+
+		if( read != ret.size() || 0 != bytes % 4 )
+			throw lut::Error( "Error reading '%s'", aPath );
+
+		return ret;
+	}
+
+	lut::ShaderModule create_shader_module( lut::VulkanContext const& aContext, std::vector<std::uint32_t> const& aCode )
+	{
+		VkShaderModuleCreateInfo moduleInfo{}; {
+			moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+			moduleInfo.codeSize = aCode.size() * sizeof(std::uint32_t);
+			moduleInfo.pCode = aCode.data();
+		}
+
+		VkShaderModule module = VK_NULL_HANDLE;
+		if( auto const res = vkCreateShaderModule( aContext.device, &moduleInfo, nullptr, &module ); VK_SUCCESS != res )
+		{
+			throw lut::Error( "Unable to create shader module\n"
+				"vkCreateShaderModule() returned %s", lut::to_string(res).c_str()
+			);
+		}
+
+		return lut::ShaderModule( aContext.device, module );
+	}
+
+	lut::DescriptorSetLayout create_layout_( lut::VulkanContext const& aContext, VkDescriptorType aType, VkShaderStageFlags aStages )
+	{
+		VkDescriptorSetLayoutBinding binding{}; {
+			binding.binding = 0;
+			binding.descriptorType = aType;
+			binding.descriptorCount = 1;
+			binding.stageFlags = aStages;
+		}
+
+		VkDescriptorSetLayoutCreateInfo layoutInfo{}; {
+			layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+			layoutInfo.bindingCount = 1;
+			layoutInfo.pBindings = &binding;
+		}
+
+		VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+		if( auto const res = vkCreateDescriptorSetLayout( aContext.device, &layoutInfo, nullptr, &layout ); VK_SUCCESS != res )
+		{
+			throw lut::Error( "Unable to create descriptor set layout\n"
+				"vkCreateDescriptorSetLayout() returned %s", lut::to_string(res).c_str()
+			);
+		}
+
+		return lut::DescriptorSetLayout( aContext.device, layout );
+	}
+
+	lut::DescriptorSetLayout create_sampler_layout( lut::VulkanContext const& aContext )
+	{
+		return create_layout_( aContext, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT );
+	}
+	lut::DescriptorSetLayout create_storage_layout( lut::VulkanContext const& aContext )
+	{
+		return create_layout_( aContext, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT );
+	}
+
+	lut::PipelineLayout create_pipeline_layout( lut::VulkanContext const& aContext, VkDescriptorSetLayout aSetLayout, VkShaderStageFlags aPushStages, std::uint32_t aPushSize )
+	{
+		VkPushConstantRange range{}; {
+			range.stageFlags = aPushStages;
+			range.offset = 0;
+			range.size = aPushSize;
+		}
+
+		VkPipelineLayoutCreateInfo layoutInfo{}; {
+			layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+			layoutInfo.setLayoutCount = VK_NULL_HANDLE != aSetLayout ? 1 : 0;
+			layoutInfo.pSetLayouts = &aSetLayout;
+			layoutInfo.pushConstantRangeCount = 1;
+			layoutInfo.pPushConstantRanges = &range;
+		}
+
+		VkPipelineLayout layout = VK_NULL_HANDLE;
+		if( auto const res = vkCreatePipelineLayout( aContext.device, &layoutInfo, nullptr, &layout ); VK_SUCCESS != res )
+		{
+			throw lut::Error( "Unable to create pipeline layout\n"
+				"vkCreatePipelineLayout() returned %s", lut::to_string(res).c_str()
+			);
+		}
+
+		return lut::PipelineLayout( aContext.device, layout );
+	}
+
+	lut::RenderPass create_render_pass( lut::VulkanContext const& aContext )
+	{
+		VkAttachmentDescription attachment{}; {
+			attachment.format = cfg::kColorFormat;
+			attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+			attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+			attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+			attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			attachment.finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		}
+
+		VkAttachmentReference colorRef{ 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+
+		VkSubpassDescription subpass{}; {
+			subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+			subpass.colorAttachmentCount = 1;
+			subpass.pColorAttachments = &colorRef;
+		}
+
+		VkRenderPassCreateInfo passInfo{}; {
+			passInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+			passInfo.attachmentCount = 1;
+			passInfo.pAttachments = &attachment;
+			passInfo.subpassCount = 1;
+			passInfo.pSubpasses = &subpass;
+		}
+
+		VkRenderPass pass = VK_NULL_HANDLE;
+		if( auto const res = vkCreateRenderPass( aContext.device, &passInfo, nullptr, &pass ); VK_SUCCESS != res )
+		{
+			throw lut::Error( "Unable to create render pass\n"
+				"vkCreateRenderPass() returned %s", lut::to_string(res).c_str()
+			);
+		}
+
+		return lut::RenderPass( aContext.device, pass );
+	}
+
+	lut::Pipeline create_graphics_pipeline( lut::VulkanContext const& aContext, VkRenderPass aPass, VkPipelineLayout aLayout, VkShaderModule aVert, VkShaderModule aFrag, VkPipelineCache aCache )
+	{
+		VkPipelineShaderStageCreateInfo stages[2]{}; {
+			stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+			stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+			stages[0].module = aVert;
+			stages[0].pName = "main";
+
+			stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+			stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+			stages[1].module = aFrag;
+			stages[1].pName = "main";
+		}
+
+		VkPipelineVertexInputStateCreateInfo inputInfo{}; {
+			inputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+		}
+
+		VkPipelineInputAssemblyStateCreateInfo assemblyInfo{}; {
+			assemblyInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+			assemblyInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+		}
+
+		VkPipelineViewportStateCreateInfo viewportInfo{}; {
+			viewportInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+			viewportInfo.viewportCount = 1;
+			viewportInfo.scissorCount = 1;
+		}
+
+		VkPipelineRasterizationStateCreateInfo rasterInfo{}; {
+			rasterInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+			rasterInfo.polygonMode = VK_POLYGON_MODE_FILL;
+			rasterInfo.cullMode = VK_CULL_MODE_BACK_BIT;
+			rasterInfo.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+			rasterInfo.lineWidth = 1.f;
+		}
+
+		VkPipelineMultisampleStateCreateInfo samplingInfo{}; {
+			samplingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+			samplingInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+		}
+
+		VkPipelineColorBlendAttachmentState blendStates[1]{}; {
+			blendStates[0].colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+		}
+
+		VkPipelineColorBlendStateCreateInfo blendInfo{}; {
+			blendInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+			blendInfo.attachmentCount = 1;
+			blendInfo.pAttachments = blendStates;
+		}
+
+		VkDynamicState const dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+
+		VkPipelineDynamicStateCreateInfo dynamicInfo{}; {
+			dynamicInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+			dynamicInfo.dynamicStateCount = 2;
+			dynamicInfo.pDynamicStates = dynamicStates;
+		}
+
+		VkGraphicsPipelineCreateInfo pipeInfo{}; {
+			pipeInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+
+			pipeInfo.stageCount = 2;
+			pipeInfo.pStages = stages;
+
+			pipeInfo.pVertexInputState = &inputInfo;
+			pipeInfo.pInputAssemblyState = &assemblyInfo;
+			pipeInfo.pViewportState = &viewportInfo;
+			pipeInfo.pRasterizationState = &rasterInfo;
+			pipeInfo.pMultisampleState = &samplingInfo;
+			pipeInfo.pColorBlendState = &blendInfo;
+			pipeInfo.pDynamicState = &dynamicInfo;
+
+			pipeInfo.layout = aLayout;
+			pipeInfo.renderPass = aPass;
+			pipeInfo.subpass = 0;
+		}
+
+		VkPipeline pipe = VK_NULL_HANDLE;
+		if( auto const res = vkCreateGraphicsPipelines( aContext.device, aCache, 1, &pipeInfo, nullptr, &pipe ); VK_SUCCESS != res )
+		{
+			throw lut::Error( "Unable to create graphics pipeline\n"
+				"vkCreateGraphicsPipelines() returned %s", lut::to_string(res).c_str()
+			);
+		}
+
+		return lut::Pipeline( aContext.device, pipe );
+	}
+
+	PipelineCache_ create_pipeline_cache( lut::VulkanContext const& aContext )
+	{
+		VkPipelineCacheCreateInfo cacheInfo{}; {
+			cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+		}
+
+		VkPipelineCache cache = VK_NULL_HANDLE;
+		if( auto const res = vkCreatePipelineCache( aContext.device, &cacheInfo, nullptr, &cache ); VK_SUCCESS != res )
+		{
+			throw lut::Error( "Unable to create pipeline cache\n"
+				"vkCreatePipelineCache() returned %s", lut::to_string(res).c_str()
+			);
+		}
+
+		return PipelineCache_( aContext.device, cache );
+	}
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
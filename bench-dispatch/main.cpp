@@ -0,0 +1,196 @@
+#include <volk/volk.h>
+
+#include <vector>
+#include <chrono>
+#include <algorithm>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cassert>
+#include <cstdint>
+
+#include "../labutils/error.hpp"
+#include "../labutils/vkutil.hpp"
+#include "../labutils/vkobject.hpp"
+#include "../labutils/to_string.hpp"
+#include "../labutils/vulkan_context.hpp"
+namespace lut = labutils;
+
+/* Measures the per-call CPU overhead of recording commands, comparing the
+ * loader's dispatch trampolines (what the labutils contexts used before
+ * device-level functions were loaded) against direct calls into the driver,
+ * both via the volk globals (volkLoadDevice()) and via a per-context
+ * VolkDeviceTable.
+ *
+ * Usage: bench-dispatch [calls-per-batch] [batches]
+ */
+
+namespace
+{
+using Clock_ = std::chrono::steady_clock;
+
+	namespace cfg
+	{
+		constexpr std::uint32_t kDefaultCallsPerBatch = 100000;
+		constexpr std::uint32_t kDefaultBatches = 25;
+	}
+
+	// Set of functions that are called during recording. These are all
+	// cheap state-setting commands, so the measurement is dominated by the
+	// dispatch overhead and the driver's minimal bookkeeping.
+	struct CmdFunctions
+	{
+		PFN_vkCmdSetViewport setViewport;
+		PFN_vkCmdSetScissor setScissor;
+		PFN_vkCmdSetLineWidth setLineWidth;
+	};
+
+	struct Result
+	{
+		double minNsPerCall;
+		double medianNsPerCall;
+	};
+
+	Result measure( lut::VulkanContext const&, VkCommandPool, VkCommandBuffer, CmdFunctions const&, std::uint32_t aCallsPerBatch, std::uint32_t aBatches );
+}
+
+int main( int aArgc, char* aArgv[] ) try
+{
+	std::uint32_t callsPerBatch = cfg::kDefaultCallsPerBatch;
+	std::uint32_t batches = cfg::kDefaultBatches;
+
+	if( aArgc > 1 ) callsPerBatch = std::uint32_t(std::strtoul( aArgv[1], nullptr, 10 ));
+	if( aArgc > 2 ) batches = std::uint32_t(std::strtoul( aArgv[2], nullptr, 10 ));
+
+	if( 0 == callsPerBatch || 0 == batches )
+		throw lut::Error( "Invalid arguments: calls-per-batch and batches must be non-zero" );
+
+	lut::VulkanContext context = lut::make_vulkan_context();
+
+	lut::CommandPool cpool = lut::create_command_pool( context );
+	VkCommandBuffer cbuffer = lut::alloc_command_buffer( context, cpool.handle );
+
+	// Loader trampolines: requesting a device-level function through the
+	// instance returns the loader's dispatching entry point.
+	CmdFunctions trampoline{};
+	trampoline.setViewport = reinterpret_cast<PFN_vkCmdSetViewport>(vkGetInstanceProcAddr( context.instance, "vkCmdSetViewport" ));
+	trampoline.setScissor = reinterpret_cast<PFN_vkCmdSetScissor>(vkGetInstanceProcAddr( context.instance, "vkCmdSetScissor" ));
+	trampoline.setLineWidth = reinterpret_cast<PFN_vkCmdSetLineWidth>(vkGetInstanceProcAddr( context.instance, "vkCmdSetLineWidth" ));
+
+	// Global volk functions. With a single device, make_vulkan_context() has
+	// pointed these at the driver via volkLoadDevice().
+	CmdFunctions global{};
+	global.setViewport = vkCmdSetViewport;
+	global.setScissor = vkCmdSetScissor;
+	global.setLineWidth = vkCmdSetLineWidth;
+
+	// Per-context device table.
+	CmdFunctions table{};
+	table.setViewport = context.deviceTable.vkCmdSetViewport;
+	table.setScissor = context.deviceTable.vkCmdSetScissor;
+	table.setLineWidth = context.deviceTable.vkCmdSetLineWidth;
+
+	assert( trampoline.setViewport && global.setViewport && table.setViewport );
+
+	std::printf( "Recording %u batches of %u calls\n", batches, callsPerBatch );
+	std::printf( "Globals loaded for device: %s\n", volkGetLoadedDevice() == context.device ? "yes" : "no (trampolines)" );
+
+	struct Variant
+	{
+		char const* name;
+		CmdFunctions const* fns;
+	} const variants[] = {
+		{ "loader-trampoline", &trampoline },
+		{ "volk-global", &global },
+		{ "device-table", &table }
+	};
+
+	// Warm up once, so that the first variant doesn't pay for any lazy
+	// allocations in the command pool.
+	measure( context, cpool.handle, cbuffer, table, callsPerBatch, 1 );
+
+	Result baseline{};
+	for( auto const& variant : variants )
+	{
+		auto const res = measure( context, cpool.handle, cbuffer, *variant.fns, callsPerBatch, batches );
+		if( variant.fns == &trampoline )
+			baseline = res;
+
+		std::printf( "  %-18s : min %7.2f ns/call, median %7.2f ns/call (%5.1f%% of trampoline)\n",
+			variant.name,
+			res.minNsPerCall,
+			res.medianNsPerCall,
+			100.0 * res.medianNsPerCall / baseline.medianNsPerCall
+		);
+	}
+
+	return 0;
+}
+catch( std::exception const& eErr )
+{
+	std::fprintf( stderr, "\n" );
+	std::fprintf( stderr, "Error: %s\n", eErr.what() );
+	return 1;
+}
+
+namespace
+{
+Result measure( lut::VulkanContext const& aContext, VkCommandPool aPool, VkCommandBuffer aCmdBuff, CmdFunctions const& aFns, std::uint32_t aCallsPerBatch, std::uint32_t aBatches )
+{
+	VkViewport const viewport{ 0.f, 0.f, 1280.f, 720.f, 0.f, 1.f };
+	VkRect2D const scissor{ VkOffset2D{ 0, 0 }, VkExtent2D{ 1280, 720 } };
+
+	std::vector<double> samples;
+	samples.reserve( aBatches );
+
+	for( std::uint32_t batch = 0; batch < aBatches; ++batch )
+	{
+		if( auto const res = vkResetCommandPool( aContext.device, aPool, 0 ); res != VK_SUCCESS )
+		{
+			throw lut::Error("Unable to Reset Command Pool\n"
+				"vkResetCommandPool() Returned %s", lut::to_string(res).c_str());
+		}
+
+		VkCommandBufferBeginInfo beginInfo{}; {
+			beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+			beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		}
+
+		if( auto const res = vkBeginCommandBuffer( aCmdBuff, &beginInfo ); res != VK_SUCCESS )
+		{
+			throw lut::Error("Unable to Begin Recording Command Buffer\n"
+				"vkBeginCommandBuffer() Returned %s", lut::to_string(res).c_str());
+		}
+
+		// Each iteration issues three calls.
+		std::uint32_t const iterations = (aCallsPerBatch + 2) / 3;
+
+		auto const start = Clock_::now();
+		for( std::uint32_t i = 0; i < iterations; ++i )
+		{
+			aFns.setViewport( aCmdBuff, 0, 1, &viewport );
+			aFns.setScissor( aCmdBuff, 0, 1, &scissor );
+			aFns.setLineWidth( aCmdBuff, 1.f );
+		}
+		auto const end = Clock_::now();
+
+		if( auto const res = vkEndCommandBuffer( aCmdBuff ); res != VK_SUCCESS )
+		{
+			throw lut::Error("Unable to End Recording Command Buffer\n"
+				"vkEndCommandBuffer() Returned %s", lut::to_string(res).c_str());
+		}
+
+		auto const ns = std::chrono::duration<double, std::nano>( end - start ).count();
+		samples.emplace_back( ns / (iterations * 3.0) );
+	}
+
+	std::sort( samples.begin(), samples.end() );
+
+	Result ret{};
+	ret.minNsPerCall = samples.front();
+	ret.medianNsPerCall = samples[samples.size()/2];
+	return ret;
+}
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
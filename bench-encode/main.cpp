@@ -0,0 +1,233 @@
+#include <vector>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <algorithm>
+#include <functional>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+
+#include <stb_image.h>
+#include <stb_image_write.h>
+
+#include "../labutils/error.hpp"
+#include "../labutils/image_encode.hpp"
+namespace lut = labutils;
+
+/* Compares encode throughput and output size of the labutils image encoders
+ * (and stb_image_write's PNG encoder, which the exercises used previously).
+ *
+ * Usage: bench-encode [iterations] [image.png ...]
+ *
+ * Without input images, a synthetic 1280x720 RGBA image similar to the
+ * exercise2 output is used, as well as the exercise4 asphalt texture (a much
+ * noisier image).
+ */
+
+namespace
+{
+using Clock_ = std::chrono::steady_clock;
+
+	namespace cfg
+	{
+		constexpr std::uint32_t kDefaultIterations = 5;
+
+		constexpr char const* kDefaultTexture = "assets/exercise4/asphalt.png";
+
+		constexpr std::uint32_t kSyntheticWidth = 1280;
+		constexpr std::uint32_t kSyntheticHeight = 720;
+
+		// Encoded files are written here (and overwritten by each run).
+		constexpr char const* kOutputPath = "bench-encode.out";
+	}
+
+	struct TestImage
+	{
+		std::string name;
+		std::uint32_t width, height, channels;
+		std::vector<std::uint8_t> pixels;
+	};
+
+	struct Encoder
+	{
+		std::string name;
+		std::function<void (TestImage const&)> encode;
+	};
+
+	TestImage make_synthetic_image();
+	TestImage load_image( char const* );
+
+	long file_size( char const* );
+}
+
+int main( int aArgc, char* aArgv[] ) try
+{
+	std::uint32_t iterations = cfg::kDefaultIterations;
+	if( aArgc > 1 )
+		iterations = std::max( 1ul, std::strtoul( aArgv[1], nullptr, 10 ) );
+
+	std::vector<TestImage> images;
+	if( aArgc > 2 )
+	{
+		for( int i = 2; i < aArgc; ++i )
+			images.emplace_back( load_image( aArgv[i] ) );
+	}
+	else
+	{
+		images.emplace_back( make_synthetic_image() );
+		images.emplace_back( load_image( cfg::kDefaultTexture ) );
+	}
+
+	std::uint32_t const hwThreads = std::max( 1u, std::thread::hardware_concurrency() );
+
+	std::vector<Encoder> encoders;
+	encoders.emplace_back( Encoder{ "stb-png", [] (TestImage const& aImg) {
+		if( !stbi_write_png( cfg::kOutputPath, int(aImg.width), int(aImg.height), int(aImg.channels), aImg.pixels.data(), int(aImg.width * aImg.channels) ) )
+			throw lut::Error( "stbi_write_png() failed" );
+	} } );
+	encoders.emplace_back( Encoder{ "png-1t", [] (TestImage const& aImg) {
+		lut::write_image_png( cfg::kOutputPath, aImg.width, aImg.height, aImg.channels, aImg.pixels.data(), aImg.width * aImg.channels, 1 );
+	} } );
+	encoders.emplace_back( Encoder{ "png-" + std::to_string(hwThreads) + "t", [hwThreads] (TestImage const& aImg) {
+		lut::write_image_png( cfg::kOutputPath, aImg.width, aImg.height, aImg.channels, aImg.pixels.data(), aImg.width * aImg.channels, hwThreads );
+	} } );
+
+	for( auto const format : { lut::EImageFormat::qoi, lut::EImageFormat::pam, lut::EImageFormat::ppm, lut::EImageFormat::raw } )
+	{
+		encoders.emplace_back( Encoder{ lut::image_format_name( format ), [format] (TestImage const& aImg) {
+			lut::write_image( format, cfg::kOutputPath, aImg.width, aImg.height, aImg.channels, aImg.pixels.data(), aImg.width * aImg.channels );
+		} } );
+	}
+
+	for( auto const& image : images )
+	{
+		double const inputMB = image.pixels.size() / (1024.0 * 1024.0);
+
+		std::printf( "%s: %ux%u, %u channels (%.2f MiB)\n", image.name.c_str(), image.width, image.height, image.channels, inputMB );
+		std::printf( "  %-10s %12s %12s %14s %8s\n", "encoder", "best ms", "median ms", "MiB/s", "ratio" );
+
+		for( auto const& encoder : encoders )
+		{
+			std::vector<double> samples;
+			for( std::uint32_t i = 0; i < iterations; ++i )
+			{
+				auto const start = Clock_::now();
+				encoder.encode( image );
+				auto const end = Clock_::now();
+
+				samples.emplace_back( std::chrono::duration<double, std::milli>( end - start ).count() );
+			}
+
+			std::sort( samples.begin(), samples.end() );
+
+			auto const best = samples.front();
+			auto const median = samples[samples.size()/2];
+			auto const size = file_size( cfg::kOutputPath );
+
+			std::printf( "  %-10s %12.2f %12.2f %14.1f %7.1f%%\n",
+				encoder.name.c_str(),
+				best,
+				median,
+				inputMB / (median * 1e-3),
+				100.0 * double(size) / double(image.pixels.size())
+			);
+		}
+	}
+
+	std::remove( cfg::kOutputPath );
+	return 0;
+}
+catch( std::exception const& eErr )
+{
+	std::fprintf( stderr, "\n" );
+	std::fprintf( stderr, "Error: %s\n", eErr.what() );
+	return 1;
+}
+
+namespace
+{
+TestImage make_synthetic_image()
+{
+	// Flat background with a few colour-interpolated triangles; roughly what
+	// the exercise2 triangle renderer produces.
+	TestImage ret{ "synthetic", cfg::kSyntheticWidth, cfg::kSyntheticHeight, 4, {} };
+	ret.pixels.resize( std::size_t(ret.width) * ret.height * 4 );
+
+	struct Vertex { float x, y; float rgb[3]; };
+	struct Triangle { Vertex v[3]; };
+
+	Triangle const triangles[] = {
+		{ { { 0.50f, 0.10f, { 1.f, 0.f, 0.f } }, { 0.15f, 0.90f, { 0.f, 1.f, 0.f } }, { 0.85f, 0.90f, { 0.f, 0.f, 1.f } } } },
+		{ { { 0.55f, 0.05f, { 0.f, 1.f, 1.f } }, { 0.75f, 0.45f, { 1.f, 0.f, 1.f } }, { 0.95f, 0.50f, { 1.f, 1.f, 1.f } } } }
+	};
+
+	for( std::uint32_t y = 0; y < ret.height; ++y )
+	{
+		for( std::uint32_t x = 0; x < ret.width; ++x )
+		{
+			float const px = (x + 0.5f) / ret.width, py = (y + 0.5f) / ret.height;
+
+			float rgb[3] = { 0.1f, 0.1f, 0.1f };
+			for( auto const& tri : triangles )
+			{
+				auto const& a = tri.v[0];
+				auto const& b = tri.v[1];
+				auto const& c = tri.v[2];
+
+				float const area = (b.x-a.x)*(c.y-a.y) - (c.x-a.x)*(b.y-a.y);
+				float const w0 = ((b.x-px)*(c.y-py) - (c.x-px)*(b.y-py)) / area;
+				float const w1 = ((c.x-px)*(a.y-py) - (a.x-px)*(c.y-py)) / area;
+				float const w2 = 1.f - w0 - w1;
+
+				if( w0 >= 0.f && w1 >= 0.f && w2 >= 0.f )
+				{
+					for( int k = 0; k < 3; ++k )
+						rgb[k] = w0 * a.rgb[k] + w1 * b.rgb[k] + w2 * c.rgb[k];
+				}
+			}
+
+			auto* out = ret.pixels.data() + (std::size_t(y) * ret.width + x) * 4;
+			for( int k = 0; k < 3; ++k )
+			{
+				// Approximate sRGB encoding, as with the SRGB render target
+				out[k] = std::uint8_t(std::lround( 255.f * std::pow( std::clamp( rgb[k], 0.f, 1.f ), 1.f/2.2f ) ));
+			}
+			out[3] = 255;
+		}
+	}
+
+	return ret;
+}
+
+TestImage load_image( char const* aPath )
+{
+	int width, height, channels;
+	stbi_uc* data = stbi_load( aPath, &width, &height, &channels, 0 );
+	if( !data )
+		throw lut::Error( "%s: unable to load image: %s", aPath, stbi_failure_reason() );
+
+	TestImage ret{ aPath, std::uint32_t(width), std::uint32_t(height), std::uint32_t(channels), {} };
+	ret.pixels.assign( data, data + std::size_t(width) * height * channels );
+
+	stbi_image_free( data );
+	return ret;
+}
+
+long file_size( char const* aPath )
+{
+	std::FILE* file = std::fopen( aPath, "rb" );
+	if( !file )
+		throw lut::Error( "Unable to open '%s'", aPath );
+
+	std::fseek( file, 0, SEEK_END );
+	long const size = std::ftell( file );
+	std::fclose( file );
+
+	return size;
+}
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
@@ -0,0 +1,299 @@
+#include <memory>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <string>
+#include <algorithm>
+#include <functional>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+
+#if !defined(GLM_FORCE_RADIANS)
+#	define GLM_FORCE_RADIANS
+#endif
+#include <glm/glm.hpp>
+
+#include "../exercise4/renderables.hpp"
+
+/* Measures iteration over the exercise4 RenderableStore.
+ *
+ * Usage: bench-entities [renderables] [iterations]
+ *
+ * The "draw" walk is what the renderer does for each object, minus the
+ * Vulkan calls: look up the material and mesh, count state changes, fetch
+ * the world transform and test the world-space bounding sphere against a
+ * view frustum. It is compared against the same walk over individually heap
+ * allocated objects (one allocation per object, with a name and other cold
+ * data next to the hot fields), which is how objects were previously
+ * threaded through the renderer one at a time.
+ */
+
+namespace
+{
+using Clock_ = std::chrono::steady_clock;
+
+	namespace cfg
+	{
+		constexpr std::uint32_t kDefaultRenderables = 1u << 20;
+		constexpr std::uint32_t kDefaultIterations = 10;
+
+		constexpr std::uint32_t kPipelineCount = 2;
+		constexpr std::uint32_t kMaterialCount = 64;
+		constexpr std::uint32_t kMeshCount = 256;
+	}
+
+	// Object representation with one allocation per object
+	struct HeapObject
+	{
+		std::string name;
+		MeshRef mesh;
+		Material material;
+		glm::mat4 cachedWorld; // cold; not used by the walk
+		SceneGraph::NodeId transform;
+		Bounds bounds;
+	};
+
+	struct WalkResult
+	{
+		std::size_t visible;
+		std::size_t stateChanges;
+		std::uint64_t vertices;
+	};
+
+	struct Frustum
+	{
+		glm::vec4 planes[6];
+	};
+
+	Frustum make_frustum();
+
+	inline
+	bool is_visible( Frustum const& aFrustum, glm::mat4 const& aWorld, Bounds const& aBounds ) noexcept
+	{
+		glm::vec3 const center = glm::vec3( aWorld * glm::vec4( 0.5f * (aBounds.min + aBounds.max), 1.f ) );
+		float const radius = 0.5f * glm::length( aBounds.max - aBounds.min );
+
+		for( auto const& plane : aFrustum.planes )
+		{
+			if( glm::dot( glm::vec3(plane), center ) + plane.w < -radius )
+				return false;
+		}
+		return true;
+	}
+
+	WalkResult walk_store( RenderableStore const&, std::vector<glm::mat4> const&, Frustum const& );
+	WalkResult walk_heap( std::vector<std::unique_ptr<HeapObject>> const&, std::vector<glm::mat4> const&, Frustum const& );
+
+	double median_ms( std::uint32_t aIterations, std::function<void ()> const& );
+}
+
+int main( int aArgc, char* aArgv[] ) try
+{
+	std::uint32_t count = cfg::kDefaultRenderables;
+	if( aArgc > 1 )
+		count = std::max( 1u, std::uint32_t(std::strtoul( aArgv[1], nullptr, 10 )) );
+
+	std::uint32_t iterations = cfg::kDefaultIterations;
+	if( aArgc > 2 )
+		iterations = std::max( 1ul, std::strtoul( aArgv[2], nullptr, 10 ) );
+
+	std::mt19937 rng( 1234 );
+	std::uniform_int_distribution<std::uint32_t> pipelineDist( 0, cfg::kPipelineCount-1 );
+	std::uniform_int_distribution<std::uint32_t> materialDist( 1, cfg::kMaterialCount );
+	std::uniform_int_distribution<std::uint32_t> meshDist( 1, cfg::kMeshCount );
+	std::uniform_real_distribution<float> posDist( -100.f, 100.f );
+
+	// Fake handles; never passed to Vulkan.
+	auto fake_handle = [] (auto aDummy, std::uintptr_t aValue) {
+		// C-style cast: handles are pointers or 64-bit integers depending on
+		// the platform.
+		return (decltype(aDummy))( aValue * 64 );
+	};
+
+	std::vector<glm::mat4> world( count );
+	for( auto& mat : world )
+	{
+		mat = glm::mat4( 1.f );
+		mat[3] = glm::vec4( posDist(rng), posDist(rng), posDist(rng), 1.f );
+	}
+
+	// Build both representations from the same objects. Heap objects are
+	// allocated in a shuffled order, as they would be after a while of
+	// adding and removing objects.
+	RenderableStore store;
+	store.reserve( count );
+
+	std::vector<std::unique_ptr<HeapObject>> heap( count );
+
+	std::vector<std::uint32_t> allocOrder( count );
+	for( std::uint32_t i = 0; i < count; ++i )
+		allocOrder[i] = i;
+	std::shuffle( allocOrder.begin(), allocOrder.end(), rng );
+
+	std::vector<MeshRef> meshes( count );
+	std::vector<Material> materials( count );
+	for( std::uint32_t i = 0; i < count; ++i )
+	{
+		auto const mesh = meshDist( rng );
+		meshes[i] = MeshRef{ fake_handle( VkBuffer{}, mesh ), fake_handle( VkBuffer{}, mesh + cfg::kMeshCount ), 3 * mesh };
+		materials[i] = Material{ pipelineDist( rng ), fake_handle( VkDescriptorSet{}, materialDist( rng ) ) };
+	}
+
+	Bounds const unitBounds{ glm::vec3( -1.f ), glm::vec3( 1.f ) };
+	for( auto const i : allocOrder )
+	{
+		heap[i] = std::make_unique<HeapObject>();
+		heap[i]->name = "object-" + std::to_string( i );
+		heap[i]->mesh = meshes[i];
+		heap[i]->material = materials[i];
+		heap[i]->cachedWorld = world[i];
+		heap[i]->transform = i;
+		heap[i]->bounds = unitBounds;
+	}
+
+	for( std::uint32_t i = 0; i < count; ++i )
+		store.create( meshes[i], materials[i], i, unitBounds );
+
+	Frustum const frustum = make_frustum();
+
+	std::printf( "%u renderables\n", count );
+	std::printf( "  %-22s %12s %12s %12s\n", "walk", "median ms", "visible", "changes" );
+
+	WalkResult result{};
+	auto report = [&] (char const* aName, double aMs) {
+		std::printf( "  %-22s %12.3f %12zu %12zu\n", aName, aMs, result.visible, result.stateChanges );
+	};
+
+	report( "heap-objects", median_ms( iterations, [&] { result = walk_heap( heap, world, frustum ); } ) );
+	report( "store-unsorted", median_ms( iterations, [&] { result = walk_store( store, world, frustum ); } ) );
+
+	auto const sortStart = Clock_::now();
+	store.sort_by_material();
+	auto const sortEnd = Clock_::now();
+
+	report( "store-sorted", median_ms( iterations, [&] { result = walk_store( store, world, frustum ); } ) );
+
+	std::printf( "  sort_by_material(): %.3f ms\n", std::chrono::duration<double, std::milli>( sortEnd - sortStart ).count() );
+
+	// Churn: destroy and recreate 1% of the entities
+	std::uint32_t const churn = std::max( 1u, count / 100 );
+	std::uniform_int_distribution<Entity> entityDist( 0, count-1 );
+
+	auto const churnStart = Clock_::now();
+	for( std::uint32_t i = 0; i < churn; ++i )
+	{
+		auto const entity = entityDist( rng );
+		if( !store.contains( entity ) )
+			continue;
+
+		auto const index = store.index_of( entity );
+		auto const mesh = store.meshes()[index];
+		auto const material = store.materials()[index];
+		auto const transform = store.transforms()[index];
+
+		store.destroy( entity );
+		store.create( mesh, material, transform, unitBounds );
+	}
+	auto const churnEnd = Clock_::now();
+
+	std::printf( "  destroy+create x%u: %.3f ms\n", churn, std::chrono::duration<double, std::milli>( churnEnd - churnStart ).count() );
+
+	return 0;
+}
+catch( std::exception const& eErr )
+{
+	std::fprintf( stderr, "\n" );
+	std::fprintf( stderr, "Error: %s\n", eErr.what() );
+	return 1;
+}
+
+namespace
+{
+Frustum make_frustum()
+{
+	// Axis aligned box frustum covering about a quarter of the scene;
+	// normals point inwards.
+	Frustum ret{}; {
+		ret.planes[0] = glm::vec4(  1.f,  0.f,  0.f, 50.f );
+		ret.planes[1] = glm::vec4( -1.f,  0.f,  0.f, 50.f );
+		ret.planes[2] = glm::vec4(  0.f,  1.f,  0.f, 50.f );
+		ret.planes[3] = glm::vec4(  0.f, -1.f,  0.f, 50.f );
+		ret.planes[4] = glm::vec4(  0.f,  0.f,  1.f, 100.f );
+		ret.planes[5] = glm::vec4(  0.f,  0.f, -1.f, 100.f );
+	}
+	return ret;
+}
+
+WalkResult walk_store( RenderableStore const& aStore, std::vector<glm::mat4> const& aWorld, Frustum const& aFrustum )
+{
+	WalkResult ret{};
+
+	auto const* meshes = aStore.meshes();
+	auto const* materials = aStore.materials();
+	auto const* transforms = aStore.transforms();
+	auto const* bounds = aStore.bounds();
+
+	Material bound{ ~0u, VK_NULL_HANDLE };
+	for( std::size_t i = 0; i < aStore.size(); ++i )
+	{
+		if( !is_visible( aFrustum, aWorld[transforms[i]], bounds[i] ) )
+			continue;
+
+		auto const& material = materials[i];
+		if( material.pipeline != bound.pipeline || material.descriptors != bound.descriptors )
+		{
+			bound = material;
+			++ret.stateChanges;
+		}
+
+		ret.vertices += meshes[i].vertexCount;
+		++ret.visible;
+	}
+
+	return ret;
+}
+
+WalkResult walk_heap( std::vector<std::unique_ptr<HeapObject>> const& aObjects, std::vector<glm::mat4> const& aWorld, Frustum const& aFrustum )
+{
+	WalkResult ret{};
+
+	Material bound{ ~0u, VK_NULL_HANDLE };
+	for( auto const& object : aObjects )
+	{
+		if( !is_visible( aFrustum, aWorld[object->transform], object->bounds ) )
+			continue;
+
+		auto const& material = object->material;
+		if( material.pipeline != bound.pipeline || material.descriptors != bound.descriptors )
+		{
+			bound = material;
+			++ret.stateChanges;
+		}
+
+		ret.vertices += object->mesh.vertexCount;
+		++ret.visible;
+	}
+
+	return ret;
+}
+
+double median_ms( std::uint32_t aIterations, std::function<void ()> const& aFunc )
+{
+	std::vector<double> samples;
+	for( std::uint32_t i = 0; i < aIterations; ++i )
+	{
+		auto const start = Clock_::now();
+		aFunc();
+		auto const end = Clock_::now();
+
+		samples.emplace_back( std::chrono::duration<double, std::milli>( end - start ).count() );
+	}
+
+	std::sort( samples.begin(), samples.end() );
+	return samples[samples.size()/2];
+}
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
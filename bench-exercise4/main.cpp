@@ -0,0 +1,665 @@
+#include <volk/volk.h>
+
+#include <tuple>
+#include <limits>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <numeric>
+#include <algorithm>
+#include <stdexcept>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if !defined(GLM_FORCE_RADIANS)
+#	define GLM_FORCE_RADIANS
+#endif
+#include <glm/glm.hpp>
+#include <glm/gtx/transform.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "../labutils/to_string.hpp"
+#include "../labutils/vulkan_context.hpp"
+
+#include "../labutils/error.hpp"
+#include "../labutils/vkutil.hpp"
+#include "../labutils/vkimage.hpp"
+#include "../labutils/vkobject.hpp"
+#include "../labutils/vkbuffer.hpp"
+#include "../labutils/allocator.hpp"
+#include "../labutils/job_system.hpp"
+#include "../labutils/object_cache.hpp"
+#include "../labutils/texture_streamer.hpp"
+namespace lut = labutils;
+
+#include "../exercise4/renderer.hpp"
+
+/* Headless benchmark for the exercise4 scene.
+ *
+ * Renders the exercise4 scene (textured floor + alpha-blended sprite) into an
+ * offscreen target for a fixed number of frames, with the camera following a
+ * scripted path. Scene setup and command recording are exercise4's own (see
+ * exercise4/renderer.hpp), including texture streaming, the scene graph and
+ * vertex pulling where the device supports them. Like exercise2, this only
+ * uses a VulkanContext, so it does not require a window or a display. It runs
+ * on software implementations such as lavapipe (e.g., select it with
+ * VK_ICD_FILENAMES).
+ *
+ * Usage: bench-exercise4 [--frames N] [--warmup N] [--width W] [--height H] [--out file.json]
+ *
+ * The warmup is extended until the textures are fully streamed in, for at
+ * most kMaxStreamingWarmupFrames frames. Results are written as JSON (to
+ * stdout, unless --out is given).
+ */
+
+namespace
+{
+using Clock_ = std::chrono::steady_clock;
+using Millisecondsd_ = std::chrono::duration<double, std::milli>;
+
+	namespace cfg
+	{
+		// Offscreen target
+		constexpr VkFormat kColorFormat = VK_FORMAT_R8G8B8A8_SRGB;
+
+		constexpr std::uint32_t kDefaultWidth = 1280;
+		constexpr std::uint32_t kDefaultHeight = 720;
+
+		// Run length
+		constexpr std::uint32_t kDefaultFrames = 600;
+		constexpr std::uint32_t kDefaultWarmupFrames = 30;
+
+		constexpr std::uint32_t kMaxStreamingWarmupFrames = 600;
+
+		constexpr std::uint32_t kFramesInFlight = 2;
+
+		// The scripted camera advances by a fixed amount per frame, such that
+		// every run renders exactly the same sequence of images.
+		constexpr float kScriptTimeStep = 1.f / 60.f;
+	}
+
+	struct Options
+	{
+		std::uint32_t width = cfg::kDefaultWidth;
+		std::uint32_t height = cfg::kDefaultHeight;
+
+		std::uint32_t frames = cfg::kDefaultFrames;
+		std::uint32_t warmupFrames = cfg::kDefaultWarmupFrames;
+
+		char const* output = nullptr;
+	};
+
+	struct FrameResources
+	{
+		VkCommandBuffer cbuffer = VK_NULL_HANDLE;
+		lut::Fence fence;
+
+		bool pending = false; // GPU timestamps not yet collected
+		bool measured = false; // submitted after the warmup
+	};
+
+	Options parse_options( int, char* [] );
+
+	// Helpers:
+	std::tuple<lut::Image, lut::ImageView> create_target_image( lut::VulkanContext const&, lut::Allocator const&, VkExtent2D, VkFormat, VkImageUsageFlags, VkImageAspectFlags );
+	lut::Framebuffer create_framebuffer( lut::VulkanContext const&, VkRenderPass, VkExtent2D, VkImageView aColorView, VkImageView aDepthView );
+
+	lut::QueryPool create_timestamp_pool( lut::VulkanContext const&, std::uint32_t aQueryCount );
+
+	glm::mat4 scripted_camera( float aTime );
+
+	void submit_commands(
+		lut::VulkanContext const&,
+		VkCommandBuffer,
+		VkFence
+	);
+
+	struct Percentiles
+	{
+		double mean, min, p50, p90, p95, p99, max;
+	};
+
+	Percentiles compute_percentiles( std::vector<double> );
+	void write_percentiles( std::FILE*, char const* aName, Percentiles const&, bool aLast = false );
+
+	// Writes aValue as a quoted JSON string
+	void write_json_string_( std::FILE*, std::string const& aValue );
+}
+
+int main( int aArgc, char* aArgv[] ) try
+{
+	auto const options = parse_options( aArgc, aArgv );
+	VkExtent2D const extent{ options.width, options.height };
+
+	// Create Vulkan context; no window is required.
+	lut::VulkanContext context = lut::make_vulkan_context();
+
+	VkPhysicalDeviceProperties props{};
+	vkGetPhysicalDeviceProperties( context.physicalDevice, &props );
+
+	// Check timestamp support on the graphics queue
+	bool haveTimestamps = false;
+	{
+		std::uint32_t numQueues = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties( context.physicalDevice, &numQueues, nullptr );
+
+		std::vector<VkQueueFamilyProperties> families( numQueues );
+		vkGetPhysicalDeviceQueueFamilyProperties( context.physicalDevice, &numQueues, families.data() );
+
+		haveTimestamps = families[context.graphicsFamilyIndex].timestampValidBits > 0 && props.limits.timestampPeriod > 0.f;
+	}
+
+	if( !haveTimestamps )
+		std::fprintf( stderr, "Warning: device does not support timestamps; GPU times will not be reported\n" );
+
+	// Create VMA allocator
+	lut::Allocator allocator = lut::create_allocator( context );
+
+	lut::JobSystem jobs;
+
+	// Intialize resources. The device features decide between the same
+	// paths as in exercise4.
+	bool const dynamicRendering = context.haveDynamicRendering;
+	bool const textureFeedback = supports_texture_feedback( context );
+	bool const vertexPulling = context.haveBufferDeviceAddress;
+
+	lut::RenderPass renderPass;
+	if( !dynamicRendering )
+		renderPass = create_render_pass( context, cfg::kColorFormat, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL );
+
+	lut::SamplerCache samplerCache( context );
+	VkSampler const defaultSampler = samplerCache.acquire_default();
+
+	lut::TextureStreamer textures( context, allocator, jobs, defaultSampler, cfg::kFramesInFlight, textureFeedback );
+
+	lut::DescriptorSetLayout sceneLayout = create_scene_descriptor_layout( context );
+
+	lut::PipelineLayout pipeLayout = create_pipeline_layout( context, sceneLayout.handle, textures.descriptor_layout() );
+	lut::Pipeline pipe = create_pipeline( context, extent, cfg::kColorFormat, renderPass.handle, pipeLayout.handle, textureFeedback, vertexPulling );
+	lut::Pipeline alphaPipe = create_alpha_pipeline( context, extent, cfg::kColorFormat, renderPass.handle, pipeLayout.handle, textureFeedback, vertexPulling );
+
+	auto [colorImage, colorView] = create_target_image( context, allocator, extent, cfg::kColorFormat, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_IMAGE_ASPECT_COLOR_BIT );
+	lut::TransientAttachments depthBuffer = create_depth_buffer( context, allocator, extent );
+
+	lut::Framebuffer framebuffer;
+	if( !dynamicRendering )
+		framebuffer = create_framebuffer( context, renderPass.handle, extent, colorView.handle, depthBuffer.views[0].handle );
+
+	RenderTarget const target{
+		renderPass.handle,
+		framebuffer.handle,
+		colorImage.image,
+		colorView.handle,
+		VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+		depthBuffer.images[0],
+		depthBuffer.views[0].handle
+	};
+
+	PipelineTable const pipelines = {
+		pipe.handle,
+		alphaPipe.handle
+	};
+
+	lut::CommandPool cpool = lut::create_command_pool( context, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT );
+
+	std::vector<FrameResources> frames( cfg::kFramesInFlight );
+	for( auto& frame : frames )
+	{
+		frame.cbuffer = lut::alloc_command_buffer( context, cpool.handle );
+		frame.fence = lut::create_fence( context, VK_FENCE_CREATE_SIGNALED_BIT );
+	}
+
+	lut::QueryPool timestamps;
+	if( haveTimestamps )
+		timestamps = create_timestamp_pool( context, 2 * cfg::kFramesInFlight );
+
+	// Load data
+	Scene scene = create_scene( context, allocator, textures, sceneLayout.handle, cfg::kFramesInFlight );
+
+	// Benchmark loop
+	std::vector<double> cpuFrameMs, cpuRecordMs, gpuFrameMs;
+	cpuFrameMs.reserve( options.frames );
+	cpuRecordMs.reserve( options.frames );
+	gpuFrameMs.reserve( options.frames );
+
+	DrawStats drawStats{};
+
+	auto collect_gpu_time = [&] (std::uint32_t aSlot) {
+		auto& frame = frames[aSlot];
+		if( !frame.pending )
+			return;
+
+		frame.pending = false;
+
+		std::uint64_t ticks[2]{};
+		if( auto const res = vkGetQueryPoolResults( context.device, timestamps.handle, 2*aSlot, 2, sizeof(ticks), ticks, sizeof(std::uint64_t), VK_QUERY_RESULT_64_BIT ); VK_SUCCESS != res )
+		{
+			throw lut::Error( "Unable to get timestamp results\n"
+				"vkGetQueryPoolResults() returned %s", lut::to_string(res).c_str()
+			);
+		}
+
+		if( frame.measured )
+			gpuFrameMs.emplace_back( double(ticks[1] - ticks[0]) * props.limits.timestampPeriod * 1e-6 );
+	};
+
+	auto measureStart = Clock_::now();
+
+	bool measuring = false;
+	std::uint32_t warmupFrames = 0;
+	std::uint32_t measuredFrames = 0;
+
+	std::uint32_t frameNumber = 0;
+	for( ; measuredFrames < options.frames; ++frameNumber )
+	{
+		if( !measuring && frameNumber >= options.warmupFrames )
+		{
+			if( !textures.streaming() || frameNumber >= options.warmupFrames + cfg::kMaxStreamingWarmupFrames )
+			{
+				measuring = true;
+				warmupFrames = frameNumber;
+				measureStart = Clock_::now();
+			}
+		}
+
+		auto const frameStart = Clock_::now();
+
+		std::uint32_t const slot = frameNumber % cfg::kFramesInFlight;
+		auto& frame = frames[slot];
+
+		// Wait for the slot's previous use to finish
+		if( auto const res = vkWaitForFences( context.device, 1, &frame.fence.handle, VK_TRUE, std::numeric_limits<std::uint64_t>::max() ); res != VK_SUCCESS )
+		{
+			throw lut::Error("Unable to Wait for Command Buffer Fence %u\n"
+				"vkWaitForFences() Returned %s", slot, lut::to_string(res).c_str());
+		}
+
+		if( haveTimestamps )
+			collect_gpu_time( slot );
+
+		if( auto const res = vkResetFences( context.device, 1, &frame.fence.handle ); res != VK_SUCCESS )
+		{
+			throw lut::Error("Unable to Reset Command Buffer Fence %u\n"
+				"vkResetFences() Returned %s", slot, lut::to_string(res).c_str());
+		}
+
+		// Update and record
+		auto const recordStart = Clock_::now();
+
+		glsl::SceneUniform sceneUniforms{};
+		update_scene_uniforms( sceneUniforms, extent.width, extent.height, scripted_camera( frameNumber * cfg::kScriptTimeStep ) );
+
+		auto const transformUpload = prepare_scene( allocator, scene, slot );
+
+		drawStats = record_commands(
+			frame.cbuffer,
+			target,
+			extent,
+			scene,
+			sceneUniforms,
+			transformUpload,
+			textures,
+			slot,
+			pipeLayout.handle,
+			pipelines,
+			vertexPulling,
+			timestamps.handle,
+			2*slot
+		);
+
+		submit_commands( context, frame.cbuffer, frame.fence.handle );
+
+		auto const frameEnd = Clock_::now();
+
+		frame.pending = haveTimestamps;
+		frame.measured = measuring;
+
+		if( measuring )
+		{
+			cpuFrameMs.emplace_back( std::chrono::duration_cast<Millisecondsd_>( frameEnd - frameStart ).count() );
+			cpuRecordMs.emplace_back( std::chrono::duration_cast<Millisecondsd_>( frameEnd - recordStart ).count() );
+			++measuredFrames;
+		}
+	}
+
+	// Drain outstanding frames
+	vkDeviceWaitIdle( context.device );
+
+	auto const benchEnd = Clock_::now();
+
+	if( haveTimestamps )
+	{
+		for( std::uint32_t i = 0; i < cfg::kFramesInFlight; ++i )
+		{
+			// Collect in submission order
+			collect_gpu_time( (frameNumber + i) % cfg::kFramesInFlight );
+		}
+	}
+
+	auto const textureStats = textures.stats();
+
+	// Memory statistics
+	VmaBudget budgets[VK_MAX_MEMORY_HEAPS]{};
+	vmaGetHeapBudgets( allocator.allocator, budgets );
+
+	VmaTotalStatistics memStats{};
+	vmaCalculateStatistics( allocator.allocator, &memStats );
+
+	VkPhysicalDeviceMemoryProperties memProps{};
+	vkGetPhysicalDeviceMemoryProperties( context.physicalDevice, &memProps );
+
+	// Output results
+	std::FILE* out = stdout;
+	if( options.output )
+	{
+		out = std::fopen( options.output, "w" );
+		if( !out )
+			throw lut::Error( "Unable to open '%s' for writing", options.output );
+	}
+
+	auto const measuredSeconds = std::chrono::duration<double>( benchEnd - measureStart ).count();
+
+	std::fprintf( out, "{\n" );
+	std::fprintf( out, "  \"device\": {\n" );
+	std::fprintf( out, "    \"name\": " );
+	write_json_string_( out, props.deviceName );
+	std::fprintf( out, ",\n    \"type\": " );
+	write_json_string_( out, lut::to_string(props.deviceType) );
+	std::fprintf( out, ",\n    \"apiVersion\": \"%d.%d.%d\",\n", VK_API_VERSION_MAJOR(props.apiVersion), VK_API_VERSION_MINOR(props.apiVersion), VK_API_VERSION_PATCH(props.apiVersion) );
+	std::fprintf( out, "    \"driverVersion\": " );
+	write_json_string_( out, lut::driver_version(props.vendorID, props.driverVersion) );
+	std::fprintf( out, "\n" );
+	std::fprintf( out, "  },\n" );
+	std::fprintf( out, "  \"config\": { \"width\": %u, \"height\": %u, \"frames\": %u, \"warmupFrames\": %u, \"framesInFlight\": %u },\n", options.width, options.height, options.frames, warmupFrames, cfg::kFramesInFlight );
+	std::fprintf( out, "  \"features\": { \"dynamicRendering\": %s, \"textureFeedback\": %s, \"vertexPulling\": %s },\n",
+		dynamicRendering ? "true" : "false", textureFeedback ? "true" : "false", vertexPulling ? "true" : "false" );
+	std::fprintf( out, "  \"wallTimeSeconds\": %.6f,\n", measuredSeconds );
+	std::fprintf( out, "  \"averageFps\": %.3f,\n", options.frames / measuredSeconds );
+
+	write_percentiles( out, "cpuFrameMs", compute_percentiles( cpuFrameMs ) );
+	write_percentiles( out, "cpuRecordSubmitMs", compute_percentiles( cpuRecordMs ) );
+	if( haveTimestamps )
+		write_percentiles( out, "gpuFrameMs", compute_percentiles( gpuFrameMs ) );
+	else
+		std::fprintf( out, "  \"gpuFrameMs\": null,\n" );
+
+	std::fprintf( out, "  \"drawStats\": { \"drawCalls\": %u, \"vertices\": %u, \"pipelineBinds\": %u, \"descriptorSetBinds\": %u, \"vertexBufferBinds\": %u },\n",
+		drawStats.drawCalls, drawStats.vertices, drawStats.pipelineBinds, drawStats.descriptorSetBinds, drawStats.vertexBufferBinds );
+
+	std::fprintf( out, "  \"textures\": { \"bytesUploaded\": %llu, \"texturesStreaming\": %u, \"allocatedBytes\": %llu, \"fullChainBytes\": %llu },\n",
+		(unsigned long long)textureStats.bytesUploaded,
+		textureStats.texturesStreaming,
+		(unsigned long long)textureStats.allocatedBytes,
+		(unsigned long long)textureStats.fullChainBytes
+	);
+
+	std::fprintf( out, "  \"memory\": {\n" );
+	std::fprintf( out, "    \"allocationCount\": %u,\n", memStats.total.statistics.allocationCount );
+	std::fprintf( out, "    \"allocationBytes\": %llu,\n", (unsigned long long)memStats.total.statistics.allocationBytes );
+	std::fprintf( out, "    \"blockCount\": %u,\n", memStats.total.statistics.blockCount );
+	std::fprintf( out, "    \"blockBytes\": %llu,\n", (unsigned long long)memStats.total.statistics.blockBytes );
+	std::fprintf( out, "    \"heaps\": [\n" );
+	for( std::uint32_t i = 0; i < memProps.memoryHeapCount; ++i )
+	{
+		std::fprintf( out, "      { \"size\": %llu, \"flags\": ", (unsigned long long)memProps.memoryHeaps[i].size );
+		write_json_string_( out, lut::memory_heap_flags(memProps.memoryHeaps[i].flags) );
+		std::fprintf( out, ", \"usage\": %llu, \"budget\": %llu }%s\n",
+			(unsigned long long)budgets[i].usage,
+			(unsigned long long)budgets[i].budget,
+			i+1 == memProps.memoryHeapCount ? "" : ","
+		);
+	}
+	std::fprintf( out, "    ]\n" );
+	std::fprintf( out, "  }\n" );
+	std::fprintf( out, "}\n" );
+
+	if( out != stdout )
+		std::fclose( out );
+
+	return 0;
+}
+catch( std::exception const& eErr )
+{
+	std::fprintf( stderr, "\n" );
+	std::fprintf( stderr, "Error: %s\n", eErr.what() );
+	return 1;
+}
+
+namespace
+{
+Options parse_options( int aArgc, char* aArgv[] )
+{
+	Options ret{};
+
+	for( int i = 1; i < aArgc; ++i )
+	{
+		auto const has_value = [&] (char const* aFlag) {
+			if( 0 != std::strcmp( aArgv[i], aFlag ) )
+				return false;
+			if( i+1 >= aArgc )
+				throw lut::Error( "Option '%s' requires a value", aFlag );
+			return true;
+		};
+
+		if( has_value( "--frames" ) )
+			ret.frames = std::uint32_t(std::strtoul( aArgv[++i], nullptr, 10 ));
+		else if( has_value( "--warmup" ) )
+			ret.warmupFrames = std::uint32_t(std::strtoul( aArgv[++i], nullptr, 10 ));
+		else if( has_value( "--width" ) )
+			ret.width = std::uint32_t(std::strtoul( aArgv[++i], nullptr, 10 ));
+		else if( has_value( "--height" ) )
+			ret.height = std::uint32_t(std::strtoul( aArgv[++i], nullptr, 10 ));
+		else if( has_value( "--out" ) )
+			ret.output = aArgv[++i];
+		else
+			throw lut::Error( "Unknown option '%s'\n"
+				"Usage: %s [--frames N] [--warmup N] [--width W] [--height H] [--out file.json]", aArgv[i], aArgv[0] );
+	}
+
+	if( 0 == ret.frames || 0 == ret.width || 0 == ret.height )
+		throw lut::Error( "Frame count and image size must be non-zero" );
+
+	return ret;
+}
+
+glm::mat4 scripted_camera( float aTime )
+{
+	// Orbit around the sprite, slowly bobbing up and down, and periodically
+	// moving in close to the floor (to exercise texture minification and
+	// magnification alike).
+	float const angle = 0.35f * aTime;
+	float const radius = 3.f + 1.5f * std::sin( 0.21f * aTime );
+	float const height = 0.6f + 0.45f * std::sin( 0.53f * aTime );
+
+	glm::vec3 const target( 0.f, 0.3f, -2.f );
+	glm::vec3 const eye = target + glm::vec3( radius * std::sin( angle ), height, radius * std::cos( angle ) );
+
+	return glm::inverse( glm::lookAt( eye, target, glm::vec3( 0.f, 1.f, 0.f ) ) );
+}
+
+Percentiles compute_percentiles( std::vector<double> aSamples )
+{
+	Percentiles ret{};
+	if( aSamples.empty() )
+		return ret;
+
+	std::sort( aSamples.begin(), aSamples.end() );
+
+	auto const at = [&] (double aPercentile) {
+		auto const index = std::size_t(std::ceil( aPercentile * aSamples.size() ));
+		return aSamples[std::min( index == 0 ? 0 : index-1, aSamples.size()-1 )];
+	};
+
+	ret.mean = std::accumulate( aSamples.begin(), aSamples.end(), 0.0 ) / aSamples.size();
+	ret.min = aSamples.front();
+	ret.p50 = at( 0.50 );
+	ret.p90 = at( 0.90 );
+	ret.p95 = at( 0.95 );
+	ret.p99 = at( 0.99 );
+	ret.max = aSamples.back();
+	return ret;
+}
+
+void write_percentiles( std::FILE* aOut, char const* aName, Percentiles const& aPct, bool aLast )
+{
+	std::fprintf( aOut, "  \"%s\": { \"mean\": %.4f, \"min\": %.4f, \"p50\": %.4f, \"p90\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f }%s\n",
+		aName, aPct.mean, aPct.min, aPct.p50, aPct.p90, aPct.p95, aPct.p99, aPct.max, aLast ? "" : ","
+	);
+}
+
+void write_json_string_( std::FILE* aOut, std::string const& aValue )
+{
+	std::fputc( '"', aOut );
+	for( char const ch : aValue )
+	{
+		if( '"' == ch || '\\' == ch )
+			std::fprintf( aOut, "\\%c", ch );
+		else if( '\n' == ch )
+			std::fprintf( aOut, "\\n" );
+		else if( static_cast<unsigned char>(ch) < 0x20 )
+			std::fprintf( aOut, "\\u%04x", ch );
+		else
+			std::fputc( ch, aOut );
+	}
+	std::fputc( '"', aOut );
+}
+}
+
+namespace
+{
+std::tuple<lut::Image, lut::ImageView> create_target_image( lut::VulkanContext const& aContext, lut::Allocator const& aAllocator, VkExtent2D aExtent, VkFormat aFormat, VkImageUsageFlags aUsage, VkImageAspectFlags aAspect )
+{
+	VkImageCreateInfo imageInfo{}; {
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.format = aFormat;
+
+		imageInfo.extent.width = aExtent.width;
+		imageInfo.extent.height = aExtent.height;
+		imageInfo.extent.depth = 1;
+
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.usage = aUsage;
+
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	}
+
+	VmaAllocationCreateInfo allocationInfo{}; {
+		allocationInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+	}
+
+	VkImage image = VK_NULL_HANDLE;
+	VmaAllocation allocation = VK_NULL_HANDLE;
+	if (auto const res = vmaCreateImage(aAllocator.allocator, &imageInfo, &allocationInfo, &image, &allocation, nullptr); res != VK_SUCCESS)
+	{
+		throw lut::Error("Unable to Allocate Target Image\n"
+			"vmaCreateImage() Returned %s", lut::to_string(res).c_str());
+	}
+
+	lut::Image targetImage( aAllocator.allocator, image, allocation );
+
+	VkImageViewCreateInfo imageViewInfo{}; {
+		imageViewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+
+		imageViewInfo.image = targetImage.image;
+		imageViewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+
+		imageViewInfo.format = aFormat;
+		imageViewInfo.components = VkComponentMapping{};
+		imageViewInfo.subresourceRange = VkImageSubresourceRange{
+			aAspect,
+			0, 1,
+			0, 1
+		};
+	}
+
+	VkImageView imageView = VK_NULL_HANDLE;
+	if (auto const res = vkCreateImageView(aContext.device, &imageViewInfo, nullptr, &imageView); res != VK_SUCCESS)
+	{
+		throw lut::Error("Unable to Create Image View\n"
+			"vkCreateImageView() Returned %s", lut::to_string(res).c_str());
+	}
+
+	return { std::move(targetImage), lut::ImageView(aContext.device, imageView) };
+}
+
+lut::Framebuffer create_framebuffer( lut::VulkanContext const& aContext, VkRenderPass aRenderPass, VkExtent2D aExtent, VkImageView aColorView, VkImageView aDepthView )
+{
+	VkImageView attachments[2] = {
+		aColorView,
+		aDepthView
+	};
+
+	VkFramebufferCreateInfo framebufferInfo{}; {
+		framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+
+		framebufferInfo.renderPass = aRenderPass;
+
+		framebufferInfo.attachmentCount = sizeof(attachments) / sizeof(attachments[0]);
+		framebufferInfo.pAttachments = attachments;
+
+		framebufferInfo.width = aExtent.width;
+		framebufferInfo.height = aExtent.height;
+
+		framebufferInfo.layers = 1;
+	}
+
+	VkFramebuffer framebuffer = VK_NULL_HANDLE;
+	if (auto const res = vkCreateFramebuffer(aContext.device, &framebufferInfo, nullptr, &framebuffer); res != VK_SUCCESS)
+	{
+		throw lut::Error("Unable to Create Framebuffer\n"
+			"vkCreateFramebuffer() Returned %s", lut::to_string(res).c_str());
+	}
+
+	return lut::Framebuffer(aContext.device, framebuffer);
+}
+
+lut::QueryPool create_timestamp_pool( lut::VulkanContext const& aContext, std::uint32_t aQueryCount )
+{
+	VkQueryPoolCreateInfo poolInfo{}; {
+		poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+
+		poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		poolInfo.queryCount = aQueryCount;
+	}
+
+	VkQueryPool pool = VK_NULL_HANDLE;
+	if (auto const res = vkCreateQueryPool(aContext.device, &poolInfo, nullptr, &pool); res != VK_SUCCESS)
+	{
+		throw lut::Error("Unable to Create Query Pool\n"
+			"vkCreateQueryPool() Returned %s", lut::to_string(res).c_str());
+	}
+
+	return lut::QueryPool(aContext.device, pool);
+}
+
+void submit_commands( lut::VulkanContext const& aContext, VkCommandBuffer aCmdBuff, VkFence aFence )
+{
+	VkSubmitInfo submitInfo{}; {
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &aCmdBuff;
+	}
+
+	if (auto const res = vkQueueSubmit(aContext.graphicsQueue, 1, &submitInfo, aFence); res != VK_SUCCESS)
+	{
+		throw lut::Error("Unable to Submit Command Buffer to Queue\n"
+			"vkQueueSubmit() Returned %s", lut::to_string(res).c_str());
+	}
+}
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
@@ -0,0 +1,266 @@
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <functional>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+
+#if !defined(GLM_FORCE_RADIANS)
+#	define GLM_FORCE_RADIANS
+#endif
+#include <glm/glm.hpp>
+
+#include "../labutils/job_system.hpp"
+namespace lut = labutils;
+
+/* Measures how the labutils JobSystem scales with the number of threads.
+ *
+ * Usage: bench-jobs [max threads] [iterations]
+ *
+ * For each thread count from 1 to max threads (default: number of hardware
+ * threads), a JobSystem with that many threads in total (the main thread
+ * plus workers) runs:
+ *  - cull:  parallel_for() with automatic grain size over bounding spheres,
+ *           testing each against a frustum (as a culling pass would)
+ *  - tiny:  many empty jobs spawned from the main thread (per-job overhead)
+ *  - tree:  recursive fork-join, where jobs spawn and wait for child jobs
+ *           (exercises stealing of nested work)
+ *  - deps:  stages of jobs chained with run_after()
+ *
+ * Reported are median times and the speedup relative to one thread.
+ */
+
+namespace
+{
+using Clock_ = std::chrono::steady_clock;
+
+	namespace cfg
+	{
+		constexpr std::uint32_t kDefaultIterations = 5;
+
+		constexpr std::size_t kSphereCount = std::size_t(1) << 21;
+		constexpr std::uint32_t kTinyJobCount = 100000;
+
+		constexpr std::uint32_t kTreeDepth = 12;
+		constexpr std::uint32_t kTreeLeafWork = 2000;
+
+		constexpr std::uint32_t kStageCount = 32;
+		constexpr std::uint32_t kJobsPerStage = 64;
+		constexpr std::uint32_t kStageJobWork = 2000;
+	}
+
+	struct Frustum
+	{
+		glm::vec4 planes[6];
+	};
+
+	Frustum make_frustum();
+
+	// Busy work that the compiler can't remove
+	std::uint32_t spin_work( std::uint32_t aSeed, std::uint32_t aIterations ) noexcept;
+
+	double run_cull( lut::JobSystem&, std::vector<glm::vec4> const&, Frustum const&, std::vector<std::uint8_t>& );
+	double run_tiny( lut::JobSystem& );
+	double run_tree( lut::JobSystem& );
+	double run_deps( lut::JobSystem& );
+
+	double median_ms( std::uint32_t aIterations, std::function<void ()> const& );
+}
+
+int main( int aArgc, char* aArgv[] ) try
+{
+	std::uint32_t maxThreads = std::max( 1u, std::thread::hardware_concurrency() );
+	if( aArgc > 1 )
+		maxThreads = std::max( 1ul, std::strtoul( aArgv[1], nullptr, 10 ) );
+
+	std::uint32_t iterations = cfg::kDefaultIterations;
+	if( aArgc > 2 )
+		iterations = std::max( 1ul, std::strtoul( aArgv[2], nullptr, 10 ) );
+
+	// Spheres: xyz = center, w = radius
+	std::mt19937 rng( 1234 );
+	std::uniform_real_distribution<float> posDist( -100.f, 100.f );
+	std::uniform_real_distribution<float> radiusDist( 0.1f, 2.f );
+
+	std::vector<glm::vec4> spheres( cfg::kSphereCount );
+	for( auto& sphere : spheres )
+		sphere = glm::vec4( posDist(rng), posDist(rng), posDist(rng), radiusDist(rng) );
+
+	std::vector<std::uint8_t> visible( spheres.size() );
+	Frustum const frustum = make_frustum();
+
+	std::printf( "%u hardware threads\n", std::thread::hardware_concurrency() );
+	std::printf( "  %-8s %-6s %12s %10s\n", "threads", "test", "median ms", "speedup" );
+
+	double baseline[4] = {};
+	for( std::uint32_t threads = 1; threads <= maxThreads; ++threads )
+	{
+		lut::JobSystem jobs( threads - 1 );
+
+		double const results[4] = {
+			median_ms( iterations, [&] { run_cull( jobs, spheres, frustum, visible ); } ),
+			median_ms( iterations, [&] { run_tiny( jobs ); } ),
+			median_ms( iterations, [&] { run_tree( jobs ); } ),
+			median_ms( iterations, [&] { run_deps( jobs ); } )
+		};
+		char const* const names[4] = { "cull", "tiny", "tree", "deps" };
+
+		for( std::size_t i = 0; i < 4; ++i )
+		{
+			if( 1 == threads )
+				baseline[i] = results[i];
+
+			std::printf( "  %-8u %-6s %12.3f %9.2fx\n", threads, names[i], results[i], baseline[i] / results[i] );
+		}
+	}
+
+	std::printf( "  tiny: %.0f ns per job with one thread\n", baseline[1] * 1e6 / cfg::kTinyJobCount );
+
+	return 0;
+}
+catch( std::exception const& eErr )
+{
+	std::fprintf( stderr, "\n" );
+	std::fprintf( stderr, "Error: %s\n", eErr.what() );
+	return 1;
+}
+
+namespace
+{
+Frustum make_frustum()
+{
+	// Axis aligned box frustum covering about a quarter of the scene;
+	// normals point inwards.
+	Frustum ret{}; {
+		ret.planes[0] = glm::vec4(  1.f,  0.f,  0.f, 50.f );
+		ret.planes[1] = glm::vec4( -1.f,  0.f,  0.f, 50.f );
+		ret.planes[2] = glm::vec4(  0.f,  1.f,  0.f, 50.f );
+		ret.planes[3] = glm::vec4(  0.f, -1.f,  0.f, 50.f );
+		ret.planes[4] = glm::vec4(  0.f,  0.f,  1.f, 100.f );
+		ret.planes[5] = glm::vec4(  0.f,  0.f, -1.f, 100.f );
+	}
+	return ret;
+}
+
+std::uint32_t spin_work( std::uint32_t aSeed, std::uint32_t aIterations ) noexcept
+{
+	std::uint32_t x = aSeed | 1u;
+	for( std::uint32_t i = 0; i < aIterations; ++i )
+	{
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+	}
+	return x;
+}
+
+double run_cull( lut::JobSystem& aJobs, std::vector<glm::vec4> const& aSpheres, Frustum const& aFrustum, std::vector<std::uint8_t>& aVisible )
+{
+	std::atomic<std::size_t> visibleCount{ 0 };
+
+	lut::parallel_for( aJobs, aSpheres.size(), [&] (std::size_t aFirst, std::size_t aLast) {
+		std::size_t count = 0;
+		for( std::size_t i = aFirst; i < aLast; ++i )
+		{
+			glm::vec3 const center = glm::vec3( aSpheres[i] );
+			float const radius = aSpheres[i].w;
+
+			bool inside = true;
+			for( auto const& plane : aFrustum.planes )
+				inside = inside && glm::dot( glm::vec3(plane), center ) + plane.w >= -radius;
+
+			aVisible[i] = inside;
+			count += inside;
+		}
+
+		visibleCount.fetch_add( count, std::memory_order_relaxed );
+	} );
+
+	return double(visibleCount.load());
+}
+
+double run_tiny( lut::JobSystem& aJobs )
+{
+	lut::JobCounter counter;
+	for( std::uint32_t i = 0; i < cfg::kTinyJobCount; ++i )
+		aJobs.run( counter, [] {} );
+
+	aJobs.wait( counter );
+	return 0.0;
+}
+
+void tree_node_( lut::JobSystem& aJobs, std::uint32_t aDepth, std::atomic<std::uint32_t>& aResult )
+{
+	if( 0 == aDepth )
+	{
+		aResult.fetch_add( spin_work( aDepth, cfg::kTreeLeafWork ) & 1u, std::memory_order_relaxed );
+		return;
+	}
+
+	lut::JobCounter children;
+	aJobs.run( children, [&aJobs, aDepth, &aResult] { tree_node_( aJobs, aDepth-1, aResult ); } );
+	aJobs.run( children, [&aJobs, aDepth, &aResult] { tree_node_( aJobs, aDepth-1, aResult ); } );
+	aJobs.wait( children );
+}
+
+double run_tree( lut::JobSystem& aJobs )
+{
+	std::atomic<std::uint32_t> result{ 0 };
+	tree_node_( aJobs, cfg::kTreeDepth, result );
+	return double(result.load());
+}
+
+double run_deps( lut::JobSystem& aJobs )
+{
+	std::atomic<std::uint32_t> result{ 0 };
+
+	// Each stage only starts once the previous one has completed
+	std::vector<lut::JobCounter> stages( cfg::kStageCount );
+	for( std::uint32_t stage = 0; stage < cfg::kStageCount; ++stage )
+	{
+		for( std::uint32_t i = 0; i < cfg::kJobsPerStage; ++i )
+		{
+			auto job = [&result, i] {
+				result.fetch_add( spin_work( i, cfg::kStageJobWork ) & 1u, std::memory_order_relaxed );
+			};
+
+			if( 0 == stage )
+				aJobs.run( stages[stage], job );
+			else
+				aJobs.run_after( stages[stage-1], stages[stage], job );
+		}
+	}
+
+	aJobs.wait( stages.back() );
+
+	// Earlier stages completed before the last one started; wait() only
+	// collects their errors.
+	for( auto& stage : stages )
+		aJobs.wait( stage );
+
+	return double(result.load());
+}
+
+double median_ms( std::uint32_t aIterations, std::function<void ()> const& aFunc )
+{
+	std::vector<double> samples;
+	for( std::uint32_t i = 0; i < aIterations; ++i )
+	{
+		auto const start = Clock_::now();
+		aFunc();
+		auto const end = Clock_::now();
+
+		samples.emplace_back( std::chrono::duration<double, std::milli>( end - start ).count() );
+	}
+
+	std::sort( samples.begin(), samples.end() );
+	return samples[samples.size()/2];
+}
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
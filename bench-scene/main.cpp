@@ -0,0 +1,168 @@
+#include <vector>
+#include <chrono>
+#include <random>
+#include <string>
+#include <algorithm>
+#include <functional>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+
+#if !defined(GLM_FORCE_RADIANS)
+#	define GLM_FORCE_RADIANS
+#endif
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "../exercise4/scene_graph.hpp"
+
+/* Measures SceneGraph::update() for large hierarchies.
+ *
+ * Usage: bench-scene [nodes] [iterations]
+ *
+ * The hierarchy is a forest of kRootCount trees where each inner node has
+ * kFanout children, stored breadth-first (about seven levels for 1M nodes).
+ * Each scenario modifies a set of nodes and then times the update,
+ * including dirty-flag propagation. The reported MiB is the size of the
+ * world transform range that would be uploaded to the GPU.
+ */
+
+namespace
+{
+using Clock_ = std::chrono::steady_clock;
+
+	namespace cfg
+	{
+		constexpr std::uint32_t kDefaultNodes = 1u << 20;
+		constexpr std::uint32_t kDefaultIterations = 10;
+
+		constexpr std::uint32_t kRootCount = 64;
+		constexpr std::uint32_t kFanout = 8;
+	}
+
+	struct Scenario
+	{
+		std::string name;
+
+		// Modifies the graph before each timed update
+		std::function<void (SceneGraph&, std::mt19937&)> modify;
+	};
+
+	SceneGraph make_graph( std::uint32_t aNodes, std::mt19937& );
+	glm::mat4 random_local( std::mt19937& );
+}
+
+int main( int aArgc, char* aArgv[] ) try
+{
+	std::uint32_t nodes = cfg::kDefaultNodes;
+	if( aArgc > 1 )
+		nodes = std::max( cfg::kRootCount, std::uint32_t(std::strtoul( aArgv[1], nullptr, 10 )) );
+
+	std::uint32_t iterations = cfg::kDefaultIterations;
+	if( aArgc > 2 )
+		iterations = std::max( 1ul, std::strtoul( aArgv[2], nullptr, 10 ) );
+
+	std::mt19937 rng( 1234 );
+
+	auto const buildStart = Clock_::now();
+	SceneGraph graph = make_graph( nodes, rng );
+	auto const buildEnd = Clock_::now();
+
+	std::printf( "%u nodes, built in %.2f ms\n", nodes, std::chrono::duration<double, std::milli>( buildEnd - buildStart ).count() );
+
+	auto touch_random = [] (std::uint32_t aCount) {
+		return [aCount] (SceneGraph& aGraph, std::mt19937& aRng) {
+			std::uniform_int_distribution<SceneGraph::NodeId> node( 0, SceneGraph::NodeId(aGraph.size()-1) );
+			for( std::uint32_t i = 0; i < aCount; ++i )
+			{
+				auto const id = node( aRng );
+				aGraph.set_local( id, aGraph.local( id ) );
+			}
+		};
+	};
+
+	std::vector<Scenario> scenarios;
+	scenarios.emplace_back( Scenario{ "none", [] (SceneGraph&, std::mt19937&) {} } );
+	scenarios.emplace_back( Scenario{ "all-roots", [] (SceneGraph& aGraph, std::mt19937&) {
+		for( SceneGraph::NodeId i = 0; i < cfg::kRootCount; ++i )
+			aGraph.set_local( i, aGraph.local( i ) );
+	} } );
+	scenarios.emplace_back( Scenario{ "last-node", [] (SceneGraph& aGraph, std::mt19937&) {
+		auto const id = SceneGraph::NodeId(aGraph.size()-1);
+		aGraph.set_local( id, aGraph.local( id ) );
+	} } );
+	scenarios.emplace_back( Scenario{ "random-1", touch_random( 1 ) } );
+	scenarios.emplace_back( Scenario{ "random-0.1%", touch_random( nodes / 1000 ) } );
+	scenarios.emplace_back( Scenario{ "random-1%", touch_random( nodes / 100 ) } );
+	scenarios.emplace_back( Scenario{ "random-10%", touch_random( nodes / 10 ) } );
+
+	std::printf( "  %-12s %12s %12s %12s %10s\n", "scenario", "best ms", "median ms", "updated", "MiB" );
+
+	for( auto const& scenario : scenarios )
+	{
+		std::vector<double> samples;
+		std::size_t updated = 0;
+		SceneGraph::DirtyRange range{ 0, 0 };
+
+		for( std::uint32_t i = 0; i < iterations; ++i )
+		{
+			scenario.modify( graph, rng );
+
+			auto const start = Clock_::now();
+			range = graph.update();
+			auto const end = Clock_::now();
+
+			updated = graph.last_update_count();
+			samples.emplace_back( std::chrono::duration<double, std::milli>( end - start ).count() );
+		}
+
+		std::sort( samples.begin(), samples.end() );
+
+		std::printf( "  %-12s %12.3f %12.3f %12zu %10.2f\n",
+			scenario.name.c_str(),
+			samples.front(),
+			samples[samples.size()/2],
+			updated,
+			(range.end - range.first) * sizeof(glm::mat4) / (1024.0 * 1024.0)
+		);
+	}
+
+	return 0;
+}
+catch( std::exception const& eErr )
+{
+	std::fprintf( stderr, "\n" );
+	std::fprintf( stderr, "Error: %s\n", eErr.what() );
+	return 1;
+}
+
+namespace
+{
+SceneGraph make_graph( std::uint32_t aNodes, std::mt19937& aRng )
+{
+	SceneGraph ret;
+	ret.reserve( aNodes );
+
+	for( std::uint32_t i = 0; i < cfg::kRootCount; ++i )
+		ret.add_node( SceneGraph::kNoParent, random_local( aRng ) );
+
+	for( std::uint32_t i = cfg::kRootCount; i < aNodes; ++i )
+		ret.add_node( (i - cfg::kRootCount) / cfg::kFanout, random_local( aRng ) );
+
+	// Initial update resolves all nodes
+	ret.update();
+	return ret;
+}
+
+glm::mat4 random_local( std::mt19937& aRng )
+{
+	std::uniform_real_distribution<float> offset( -1.f, 1.f );
+	std::uniform_real_distribution<float> angle( 0.f, 6.2831853f );
+
+	glm::mat4 ret = glm::translate( glm::mat4(1.f), glm::vec3( offset(aRng), offset(aRng), offset(aRng) ) );
+	return glm::rotate( ret, angle(aRng), glm::vec3( 0.f, 1.f, 0.f ) );
+}
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
@@ -0,0 +1,937 @@
+#include <volk/volk.h>
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <limits>
+#include <optional>
+#include <algorithm>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+
+#include "../labutils/error.hpp"
+#include "../labutils/vkutil.hpp"
+#include "../labutils/vkimage.hpp"
+#include "../labutils/vkbuffer.hpp"
+#include "../labutils/vkobject.hpp"
+#include "../labutils/vkcompute.hpp"
+#include "../labutils/to_string.hpp"
+#include "../labutils/allocator.hpp"
+#include "../labutils/vulkan_context.hpp"
+namespace lut = labutils;
+
+/* Measures the throughput and latency of the transfer paths used by
+ * labutils:
+ *
+ *  - copy_buffer: vkCmdCopyBuffer between buffers in different memory
+ *    (host-visible -> device-local uploads, device-local -> device-local,
+ *    device-local -> host-cached readback)
+ *  - copy_buffer_to_image: vkCmdCopyBufferToImage from a host-visible
+ *    staging buffer into a device-local RGBA8 image
+ *  - blit_image: vkCmdBlitImage between two device-local RGBA8 images
+ *  - update_buffer: vkCmdUpdateBuffer into a device-local buffer (inline
+ *    data; limited to small sizes)
+ *  - mapped_write/mapped_read: memcpy() to/from mapped memory, for each
+ *    host-visible memory type
+ *
+ * GPU paths are measured in two modes. "single" submits one operation per
+ * submission and reports the CPU-side latency (vkQueueSubmit() to fence
+ * signalled) and the GPU time (timestamps). "batched" records many
+ * operations into a single submission and reports the throughput. Batched
+ * buffer operations target disjoint ranges without barriers in between, as
+ * a streaming upload would; batched image operations reuse the same image
+ * and are separated by barriers.
+ *
+ * Results are written as JSON (to stdout, or to the file given with
+ * --json); progress goes to stderr.
+ *
+ * Usage: bench-transfer [--min-size bytes] [--max-size bytes] [--runs n] [--json path]
+ *
+ * --min-size must be a multiple of 4.
+ */
+
+namespace
+{
+using Clock_ = std::chrono::steady_clock;
+using Microsecondsd_ = std::chrono::duration<double, std::micro>;
+
+	namespace cfg
+	{
+		// Sizes are powers of four from kMinSize to kMaxSize
+		constexpr std::uint64_t kDefaultMinSize = 256;
+		constexpr std::uint64_t kDefaultMaxSize = std::uint64_t(1) << 30;
+
+		constexpr std::uint32_t kDefaultRuns = 10;
+
+		// Large sizes are only measured a few times
+		constexpr std::uint64_t kLargeSize = 64 * 1024 * 1024;
+		constexpr std::uint32_t kLargeRuns = 3;
+
+		// Batched mode: operations per submission such that each submission
+		// moves about kBatchBytes, limited to kMaxBatch operations.
+		constexpr std::uint64_t kBatchBytes = 64 * 1024 * 1024;
+		constexpr std::uint32_t kMaxBatch = 256;
+
+		// vkCmdUpdateBuffer() copies the data into the command buffer, at
+		// most 64 kiB per call.
+		constexpr std::uint64_t kMaxUpdateSize = 4 * 1024 * 1024;
+		constexpr std::uint64_t kUpdateChunk = 65536;
+
+		constexpr VkFormat kImageFormat = VK_FORMAT_R8G8B8A8_UNORM;
+	}
+
+	struct Options
+	{
+		std::uint64_t minSize = cfg::kDefaultMinSize;
+		std::uint64_t maxSize = cfg::kDefaultMaxSize;
+		std::uint32_t runs = cfg::kDefaultRuns;
+		char const* jsonPath = nullptr;
+	};
+
+	struct Result
+	{
+		std::string path, src, dst, mode;
+
+		std::uint64_t bytes;    // per operation
+		std::uint32_t batch;    // operations per submission
+		std::uint32_t runs;     // submissions measured
+
+		double latencyUs;       // median CPU time per submission
+		double gpuUs;           // median GPU time per submission (NaN: n/a)
+		double gibPerSecond;    // bytes * batch / time (GPU time if available)
+
+		std::string error;      // non-empty if the case could not run
+	};
+
+	// Memory locations. Each maps to a specific memory type, so that the
+	// results are not affected by the allocator's heuristics.
+	enum class ELocation
+	{
+		deviceLocal,
+		hostVisible,
+		hostCached
+	};
+
+	char const* to_name( ELocation );
+
+	struct Bench
+	{
+		lut::VulkanContext const* context;
+		lut::Allocator const* allocator;
+
+		VkPhysicalDeviceMemoryProperties memory;
+		VkPhysicalDeviceProperties props;
+		bool timestamps;
+
+		lut::CommandPool pool;
+		VkCommandBuffer cmd;
+		lut::Fence fence;
+		lut::QueryPool queries;
+
+		std::uint32_t locationType[3];
+	};
+
+	Options parse_options( int, char* [] );
+
+	std::optional<std::uint32_t> find_memory_type( VkPhysicalDeviceMemoryProperties const&, VkMemoryPropertyFlags aRequired, VkMemoryPropertyFlags aAvoid );
+	std::string memory_flags_string( VkMemoryPropertyFlags );
+
+	lut::Buffer create_buffer_in( Bench const&, VkDeviceSize, VkBufferUsageFlags, std::uint32_t aMemoryType );
+	lut::Image create_image( Bench const&, VkExtent2D, VkImageUsageFlags );
+
+	lut::QueryPool create_query_pool( lut::VulkanContext const& );
+
+	// Records aRecord( cmd ) between two timestamps, submits, and waits. Runs
+	// aRuns times and fills in the timing fields of aResult.
+	template< typename tRecord >
+	void measure_gpu( Bench&, std::uint32_t aRuns, Result&, tRecord&& aRecord );
+
+	void bench_copy_buffer( Bench&, Options const&, ELocation aSrc, ELocation aDst, std::vector<Result>& );
+	void bench_copy_buffer_to_image( Bench&, Options const&, std::vector<Result>& );
+	void bench_blit_image( Bench&, Options const&, std::vector<Result>& );
+	void bench_update_buffer( Bench&, Options const&, std::vector<Result>& );
+	void bench_mapped( Bench&, Options const&, std::vector<Result>& );
+
+	void write_json( std::FILE*, Bench const&, std::vector<Result> const& );
+
+	std::uint32_t runs_for( Options const&, std::uint64_t aBytes );
+	std::uint32_t batch_for( std::uint64_t aBytes );
+	VkExtent2D image_extent_for( std::uint64_t aBytes );
+
+	double median( std::vector<double> );
+}
+
+int main( int aArgc, char* aArgv[] ) try
+{
+	Options const opts = parse_options( aArgc, aArgv );
+
+	lut::VulkanContext context = lut::make_vulkan_context();
+	lut::Allocator allocator = lut::create_allocator( context );
+
+	Bench bench{};
+	bench.context = &context;
+	bench.allocator = &allocator;
+
+	vkGetPhysicalDeviceMemoryProperties( context.physicalDevice, &bench.memory );
+	vkGetPhysicalDeviceProperties( context.physicalDevice, &bench.props );
+
+	{
+		std::uint32_t numFamilies = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties( context.physicalDevice, &numFamilies, nullptr );
+
+		std::vector<VkQueueFamilyProperties> families( numFamilies );
+		vkGetPhysicalDeviceQueueFamilyProperties( context.physicalDevice, &numFamilies, families.data() );
+
+		bench.timestamps = families[context.graphicsFamilyIndex].timestampValidBits > 0;
+	}
+
+	// Memory types for each location; fall back to less specific types on
+	// devices where the preferred combination does not exist (e.g., on
+	// integrated GPUs, where all memory is DEVICE_LOCAL).
+	auto const pick = [&] (VkMemoryPropertyFlags aRequired, VkMemoryPropertyFlags aAvoid, char const* aName) {
+		if( auto const type = find_memory_type( bench.memory, aRequired, aAvoid ) )
+			return *type;
+		if( auto const type = find_memory_type( bench.memory, aRequired, 0 ) )
+			return *type;
+
+		throw lut::Error( "No memory type for %s", aName );
+	};
+
+	bench.locationType[int(ELocation::deviceLocal)] = pick( VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, "device-local" );
+	bench.locationType[int(ELocation::hostVisible)] = pick( VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT, "host-visible" );
+
+	if( auto const type = find_memory_type( bench.memory, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT ) )
+		bench.locationType[int(ELocation::hostCached)] = *type;
+	else
+		bench.locationType[int(ELocation::hostCached)] = pick( VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, 0, "host-cached" );
+
+	bench.pool = lut::create_command_pool( context, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT );
+	bench.cmd = lut::alloc_command_buffer( context, bench.pool.handle );
+	bench.fence = lut::create_fence( context );
+	bench.queries = create_query_pool( context );
+
+	std::fprintf( stderr, "Timestamps: %s\n", bench.timestamps ? "yes" : "no (GPU times unavailable; using CPU times)" );
+
+	std::vector<Result> results;
+
+	bench_copy_buffer( bench, opts, ELocation::hostVisible, ELocation::deviceLocal, results );
+	bench_copy_buffer( bench, opts, ELocation::deviceLocal, ELocation::deviceLocal, results );
+	bench_copy_buffer( bench, opts, ELocation::deviceLocal, ELocation::hostCached, results );
+	bench_copy_buffer_to_image( bench, opts, results );
+	bench_blit_image( bench, opts, results );
+	bench_update_buffer( bench, opts, results );
+	bench_mapped( bench, opts, results );
+
+	std::FILE* out = stdout;
+	if( opts.jsonPath )
+	{
+		out = std::fopen( opts.jsonPath, "w" );
+		if( !out )
+			throw lut::Error( "Unable to open '%s' for writing", opts.jsonPath );
+	}
+
+	write_json( out, bench, results );
+
+	if( out != stdout )
+	{
+		std::fclose( out );
+		std::fprintf( stderr, "Wrote %zu results to '%s'\n", results.size(), opts.jsonPath );
+	}
+
+	return 0;
+}
+catch( std::exception const& eErr )
+{
+	std::fprintf( stderr, "\n" );
+	std::fprintf( stderr, "Error: %s\n", eErr.what() );
+	return 1;
+}
+
+namespace
+{
+	Options parse_options( int aArgc, char* aArgv[] )
+	{
+		Options ret;
+
+		for( int i = 1; i < aArgc; ++i )
+		{
+			auto const has_value = [&] (char const* aName) {
+				if( i+1 >= aArgc )
+					throw lut::Error( "%s requires a value", aName );
+				return aArgv[++i];
+			};
+
+			if( 0 == std::strcmp( "--min-size", aArgv[i] ) )
+				ret.minSize = std::strtoull( has_value( "--min-size" ), nullptr, 10 );
+			else if( 0 == std::strcmp( "--max-size", aArgv[i] ) )
+				ret.maxSize = std::strtoull( has_value( "--max-size" ), nullptr, 10 );
+			else if( 0 == std::strcmp( "--runs", aArgv[i] ) )
+				ret.runs = std::uint32_t(std::strtoul( has_value( "--runs" ), nullptr, 10 ));
+			else if( 0 == std::strcmp( "--json", aArgv[i] ) )
+				ret.jsonPath = has_value( "--json" );
+			else
+				throw lut::Error( "Unknown argument '%s'", aArgv[i] );
+		}
+
+		if( ret.minSize < 4 || ret.minSize > ret.maxSize || 0 == ret.runs )
+			throw lut::Error( "Invalid arguments: need 4 <= min-size <= max-size and runs > 0" );
+
+		// Sizes are min-size times powers of four; vkCmdUpdateBuffer()
+		// requires multiples of four bytes.
+		if( 0 != ret.minSize % 4 )
+			throw lut::Error( "Invalid arguments: min-size must be a multiple of 4" );
+
+		return ret;
+	}
+
+	char const* to_name( ELocation aLocation )
+	{
+		switch( aLocation )
+		{
+			case ELocation::deviceLocal: return "device-local";
+			case ELocation::hostVisible: return "host-visible";
+			case ELocation::hostCached: return "host-cached";
+		}
+
+		return "unknown";
+	}
+
+	std::optional<std::uint32_t> find_memory_type( VkPhysicalDeviceMemoryProperties const& aMemory, VkMemoryPropertyFlags aRequired, VkMemoryPropertyFlags aAvoid )
+	{
+		for( std::uint32_t i = 0; i < aMemory.memoryTypeCount; ++i )
+		{
+			auto const flags = aMemory.memoryTypes[i].propertyFlags;
+			if( aRequired == (aRequired & flags) && 0 == (aAvoid & flags) )
+				return i;
+		}
+
+		return {};
+	}
+
+	std::string memory_flags_string( VkMemoryPropertyFlags aFlags )
+	{
+		struct Flag
+		{
+			VkMemoryPropertyFlagBits bit;
+			char const* name;
+		} const flags[] = {
+			{ VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, "DEVICE_LOCAL" },
+			{ VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, "HOST_VISIBLE" },
+			{ VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, "HOST_COHERENT" },
+			{ VK_MEMORY_PROPERTY_HOST_CACHED_BIT, "HOST_CACHED" },
+			{ VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT, "LAZILY_ALLOCATED" },
+			{ VK_MEMORY_PROPERTY_PROTECTED_BIT, "PROTECTED" }
+		};
+
+		std::string ret;
+		for( auto const& flag : flags )
+		{
+			if( !(flag.bit & aFlags) )
+				continue;
+
+			if( !ret.empty() )
+				ret += '|';
+			ret += flag.name;
+		}
+
+		return ret;
+	}
+
+	lut::Buffer create_buffer_in( Bench const& aBench, VkDeviceSize aSize, VkBufferUsageFlags aUsage, std::uint32_t aMemoryType )
+	{
+		VkBufferCreateInfo bufferInfo{}; {
+			bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+
+			bufferInfo.size = aSize;
+			bufferInfo.usage = aUsage;
+		}
+
+		VmaAllocationCreateInfo allocInfo{}; {
+			allocInfo.memoryTypeBits = 1u << aMemoryType;
+		}
+
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VmaAllocation allocation = VK_NULL_HANDLE;
+
+		if( auto const res = vmaCreateBuffer( aBench.allocator->allocator, &bufferInfo, &allocInfo, &buffer, &allocation, nullptr ); VK_SUCCESS != res )
+		{
+			throw lut::Error( "Unable to allocate %llu byte buffer in memory type %u\n"
+				"vmaCreateBuffer() returned %s", static_cast<unsigned long long>(aSize), aMemoryType, lut::to_string(res).c_str()
+			);
+		}
+
+		return lut::Buffer( aBench.allocator->allocator, buffer, allocation );
+	}
+
+	lut::Image create_image( Bench const& aBench, VkExtent2D aExtent, VkImageUsageFlags aUsage )
+	{
+		VkImageCreateInfo imageInfo{}; {
+			imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+
+			imageInfo.imageType = VK_IMAGE_TYPE_2D;
+			imageInfo.format = cfg::kImageFormat;
+			imageInfo.extent = VkExtent3D{ aExtent.width, aExtent.height, 1 };
+
+			imageInfo.mipLevels = 1;
+			imageInfo.arrayLayers = 1;
+
+			imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+			imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+			imageInfo.usage = aUsage;
+
+			imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+			imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		}
+
+		VmaAllocationCreateInfo allocInfo{}; {
+			allocInfo.memoryTypeBits = 1u << aBench.locationType[int(ELocation::deviceLocal)];
+		}
+
+		VkImage image = VK_NULL_HANDLE;
+		VmaAllocation allocation = VK_NULL_HANDLE;
+
+		if( auto const res = vmaCreateImage( aBench.allocator->allocator, &imageInfo, &allocInfo, &image, &allocation, nullptr ); VK_SUCCESS != res )
+		{
+			throw lut::Error( "Unable to allocate %ux%u image\n"
+				"vmaCreateImage() returned %s", aExtent.width, aExtent.height, lut::to_string(res).c_str()
+			);
+		}
+
+		return lut::Image( aBench.allocator->allocator, image, allocation );
+	}
+
+	lut::QueryPool create_query_pool( lut::VulkanContext const& aContext )
+	{
+		VkQueryPoolCreateInfo poolInfo{}; {
+			poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+			poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+			poolInfo.queryCount = 2;
+		}
+
+		VkQueryPool pool = VK_NULL_HANDLE;
+		if( auto const res = vkCreateQueryPool( aContext.device, &poolInfo, nullptr, &pool ); VK_SUCCESS != res )
+		{
+			throw lut::Error( "Unable to create query pool\n"
+				"vkCreateQueryPool() returned %s", lut::to_string(res).c_str()
+			);
+		}
+
+		return lut::QueryPool( aContext.device, pool );
+	}
+}
+
+namespace
+{
+	template< typename tRecord >
+	void measure_gpu( Bench& aBench, std::uint32_t aRuns, Result& aResult, tRecord&& aRecord )
+	{
+		auto const& context = *aBench.context;
+
+		std::vector<double> cpuUs, gpuUs;
+		for( std::uint32_t run = 0; run < aRuns; ++run )
+		{
+			vkResetCommandBuffer( aBench.cmd, 0 );
+
+			VkCommandBufferBeginInfo beginInfo{}; {
+				beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+				beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+			}
+
+			if( auto const res = vkBeginCommandBuffer( aBench.cmd, &beginInfo ); VK_SUCCESS != res )
+			{
+				throw lut::Error( "Unable to begin recording command buffer\n"
+					"vkBeginCommandBuffer() returned %s", lut::to_string(res).c_str()
+				);
+			}
+
+			if( aBench.timestamps )
+			{
+				vkCmdResetQueryPool( aBench.cmd, aBench.queries.handle, 0, 2 );
+				vkCmdWriteTimestamp( aBench.cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, aBench.queries.handle, 0 );
+			}
+
+			aRecord( aBench.cmd );
+
+			if( aBench.timestamps )
+				vkCmdWriteTimestamp( aBench.cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, aBench.queries.handle, 1 );
+
+			if( auto const res = vkEndCommandBuffer( aBench.cmd ); VK_SUCCESS != res )
+			{
+				throw lut::Error( "Unable to end recording command buffer\n"
+					"vkEndCommandBuffer() returned %s", lut::to_string(res).c_str()
+				);
+			}
+
+			auto const start = Clock_::now();
+
+			lut::submit_commands( context.graphicsQueue, aBench.cmd, {}, {}, aBench.fence.handle );
+			if( auto const res = vkWaitForFences( context.device, 1, &aBench.fence.handle, VK_TRUE, std::numeric_limits<std::uint64_t>::max() ); VK_SUCCESS != res )
+			{
+				throw lut::Error( "Unable to wait for fence\n"
+					"vkWaitForFences() returned %s", lut::to_string(res).c_str()
+				);
+			}
+
+			auto const end = Clock_::now();
+
+			vkResetFences( context.device, 1, &aBench.fence.handle );
+
+			cpuUs.emplace_back( Microsecondsd_( end - start ).count() );
+
+			if( aBench.timestamps )
+			{
+				std::uint64_t stamps[2]{};
+				if( auto const res = vkGetQueryPoolResults( context.device, aBench.queries.handle, 0, 2, sizeof(stamps), stamps, sizeof(std::uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT ); VK_SUCCESS != res )
+				{
+					throw lut::Error( "Unable to get timestamps\n"
+						"vkGetQueryPoolResults() returned %s", lut::to_string(res).c_str()
+					);
+				}
+
+				gpuUs.emplace_back( double(stamps[1] - stamps[0]) * aBench.props.limits.timestampPeriod * 1e-3 );
+			}
+		}
+
+		aResult.runs = aRuns;
+		aResult.latencyUs = median( cpuUs );
+		aResult.gpuUs = gpuUs.empty() ? std::nan("") : median( gpuUs );
+
+		double const seconds = 1e-6 * (gpuUs.empty() ? aResult.latencyUs : aResult.gpuUs);
+		aResult.gibPerSecond = double(aResult.bytes) * aResult.batch / seconds / (1024.0 * 1024.0 * 1024.0);
+	}
+
+	// Runs aCase for each size and both modes, turning lut::Errors (e.g.,
+	// out of memory for the largest sizes) into failed results.
+	template< typename tCase >
+	void for_each_size( Options const& aOpts, std::uint64_t aMaxSize, Result const& aTemplate, std::vector<Result>& aResults, tCase&& aCase )
+	{
+		for( std::uint64_t size = aOpts.minSize; size <= std::min( aOpts.maxSize, aMaxSize ); size *= 4 )
+		{
+			for( bool const batched : { false, true } )
+			{
+				Result result = aTemplate;
+				result.mode = batched ? "batched" : "single";
+				result.bytes = size;
+				result.batch = batched ? batch_for( size ) : 1;
+				result.runs = 0;
+				result.latencyUs = result.gpuUs = result.gibPerSecond = std::nan("");
+
+				std::fprintf( stderr, "%s %s->%s %llu bytes (%s)... ", result.path.c_str(), result.src.c_str(), result.dst.c_str(), static_cast<unsigned long long>(size), result.mode.c_str() );
+
+				try
+				{
+					aCase( result );
+					std::fprintf( stderr, "%.2f GiB/s\n", result.gibPerSecond );
+				}
+				catch( lut::Error const& eErr )
+				{
+					result.error = eErr.what();
+					std::fprintf( stderr, "skipped\n" );
+				}
+
+				aResults.emplace_back( std::move(result) );
+			}
+		}
+	}
+
+	void bench_copy_buffer( Bench& aBench, Options const& aOpts, ELocation aSrc, ELocation aDst, std::vector<Result>& aResults )
+	{
+		Result tmpl{};
+		tmpl.path = "copy_buffer";
+		tmpl.src = to_name( aSrc );
+		tmpl.dst = to_name( aDst );
+
+		for_each_size( aOpts, std::numeric_limits<std::uint64_t>::max(), tmpl, aResults, [&] (Result& aResult) {
+			VkDeviceSize const total = aResult.bytes * aResult.batch;
+
+			lut::Buffer src = create_buffer_in( aBench, total, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, aBench.locationType[int(aSrc)] );
+			lut::Buffer dst = create_buffer_in( aBench, total, VK_BUFFER_USAGE_TRANSFER_DST_BIT, aBench.locationType[int(aDst)] );
+
+			std::vector<VkBufferCopy> copies( aResult.batch );
+			for( std::uint32_t i = 0; i < aResult.batch; ++i )
+				copies[i] = VkBufferCopy{ i * aResult.bytes, i * aResult.bytes, aResult.bytes };
+
+			measure_gpu( aBench, runs_for( aOpts, total ), aResult, [&] (VkCommandBuffer aCmd) {
+				// Separate commands, as uploads of separate resources would be
+				for( auto const& copy : copies )
+					vkCmdCopyBuffer( aCmd, src.buffer, dst.buffer, 1, &copy );
+			} );
+		} );
+	}
+
+	void bench_copy_buffer_to_image( Bench& aBench, Options const& aOpts, std::vector<Result>& aResults )
+	{
+		Result tmpl{};
+		tmpl.path = "copy_buffer_to_image";
+		tmpl.src = to_name( ELocation::hostVisible );
+		tmpl.dst = to_name( ELocation::deviceLocal );
+
+		for_each_size( aOpts, std::numeric_limits<std::uint64_t>::max(), tmpl, aResults, [&] (Result& aResult) {
+			auto const extent = image_extent_for( aResult.bytes );
+			if( extent.width > aBench.props.limits.maxImageDimension2D || extent.height > aBench.props.limits.maxImageDimension2D )
+				throw lut::Error( "%ux%u exceeds maxImageDimension2D", extent.width, extent.height );
+
+			aResult.bytes = std::uint64_t(extent.width) * extent.height * 4;
+
+			lut::Buffer src = create_buffer_in( aBench, aResult.bytes, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, aBench.locationType[int(ELocation::hostVisible)] );
+			lut::Image dst = create_image( aBench, extent, VK_IMAGE_USAGE_TRANSFER_DST_BIT );
+
+			VkBufferImageCopy copy{}; {
+				copy.imageSubresource = VkImageSubresourceLayers{ VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+				copy.imageExtent = VkExtent3D{ extent.width, extent.height, 1 };
+			}
+
+			measure_gpu( aBench, runs_for( aOpts, aResult.bytes * aResult.batch ), aResult, [&] (VkCommandBuffer aCmd) {
+				lut::image_barrier( aCmd, dst.image,
+					0, VK_ACCESS_TRANSFER_WRITE_BIT,
+					VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+					VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT
+				);
+
+				for( std::uint32_t i = 0; i < aResult.batch; ++i )
+				{
+					if( i > 0 )
+					{
+						lut::image_barrier( aCmd, dst.image,
+							VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+							VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+							VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT
+						);
+					}
+
+					vkCmdCopyBufferToImage( aCmd, src.buffer, dst.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy );
+				}
+			} );
+		} );
+	}
+
+	void bench_blit_image( Bench& aBench, Options const& aOpts, std::vector<Result>& aResults )
+	{
+		Result tmpl{};
+		tmpl.path = "blit_image";
+		tmpl.src = to_name( ELocation::deviceLocal );
+		tmpl.dst = to_name( ELocation::deviceLocal );
+
+		for_each_size( aOpts, std::numeric_limits<std::uint64_t>::max(), tmpl, aResults, [&] (Result& aResult) {
+			auto const extent = image_extent_for( aResult.bytes );
+			if( extent.width > aBench.props.limits.maxImageDimension2D || extent.height > aBench.props.limits.maxImageDimension2D )
+				throw lut::Error( "%ux%u exceeds maxImageDimension2D", extent.width, extent.height );
+
+			aResult.bytes = std::uint64_t(extent.width) * extent.height * 4;
+
+			lut::Image src = create_image( aBench, extent, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT );
+			lut::Image dst = create_image( aBench, extent, VK_IMAGE_USAGE_TRANSFER_DST_BIT );
+
+			VkImageBlit blit{}; {
+				blit.srcSubresource = VkImageSubresourceLayers{ VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+				blit.srcOffsets[1] = VkOffset3D{ std::int32_t(extent.width), std::int32_t(extent.height), 1 };
+				blit.dstSubresource = VkImageSubresourceLayers{ VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+				blit.dstOffsets[1] = VkOffset3D{ std::int32_t(extent.width), std::int32_t(extent.height), 1 };
+			}
+
+			measure_gpu( aBench, runs_for( aOpts, aResult.bytes * aResult.batch ), aResult, [&] (VkCommandBuffer aCmd) {
+				// The source contents are irrelevant, but it needs a valid
+				// layout.
+				lut::image_barrier( aCmd, src.image,
+					0, VK_ACCESS_TRANSFER_READ_BIT,
+					VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+					VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT
+				);
+				lut::image_barrier( aCmd, dst.image,
+					0, VK_ACCESS_TRANSFER_WRITE_BIT,
+					VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+					VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT
+				);
+
+				for( std::uint32_t i = 0; i < aResult.batch; ++i )
+				{
+					if( i > 0 )
+					{
+						lut::image_barrier( aCmd, dst.image,
+							VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+							VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+							VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT
+						);
+					}
+
+					vkCmdBlitImage( aCmd, src.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, dst.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_NEAREST );
+				}
+			} );
+		} );
+	}
+
+	void bench_update_buffer( Bench& aBench, Options const& aOpts, std::vector<Result>& aResults )
+	{
+		Result tmpl{};
+		tmpl.path = "update_buffer";
+		tmpl.src = "command-buffer";
+		tmpl.dst = to_name( ELocation::deviceLocal );
+
+		std::vector<std::uint8_t> data( std::size_t(std::min( aOpts.maxSize, cfg::kMaxUpdateSize )), 0x5a );
+
+		for_each_size( aOpts, cfg::kMaxUpdateSize, tmpl, aResults, [&] (Result& aResult) {
+			// Batches are limited such that the command buffer holds at most
+			// kMaxUpdateSize bytes of inline data.
+			aResult.batch = std::max<std::uint32_t>( 1, std::min<std::uint32_t>( aResult.batch, std::uint32_t(cfg::kMaxUpdateSize / aResult.bytes) ) );
+
+			VkDeviceSize const total = aResult.bytes * aResult.batch;
+			lut::Buffer dst = create_buffer_in( aBench, total, VK_BUFFER_USAGE_TRANSFER_DST_BIT, aBench.locationType[int(ELocation::deviceLocal)] );
+
+			measure_gpu( aBench, runs_for( aOpts, total ), aResult, [&] (VkCommandBuffer aCmd) {
+				for( std::uint32_t i = 0; i < aResult.batch; ++i )
+				{
+					for( std::uint64_t offset = 0; offset < aResult.bytes; offset += cfg::kUpdateChunk )
+					{
+						auto const chunk = std::min( cfg::kUpdateChunk, aResult.bytes - offset );
+						vkCmdUpdateBuffer( aCmd, dst.buffer, i * aResult.bytes + offset, chunk, data.data() + offset );
+					}
+				}
+			} );
+		} );
+	}
+
+	void bench_mapped( Bench& aBench, Options const& aOpts, std::vector<Result>& aResults )
+	{
+		auto const& context = *aBench.context;
+
+		std::vector<std::uint8_t> host;
+
+		for( std::uint32_t type = 0; type < aBench.memory.memoryTypeCount; ++type )
+		{
+			auto const flags = aBench.memory.memoryTypes[type].propertyFlags;
+			if( !(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT & flags) )
+				continue;
+
+			auto const& heap = aBench.memory.memoryHeaps[aBench.memory.memoryTypes[type].heapIndex];
+			bool const coherent = VK_MEMORY_PROPERTY_HOST_COHERENT_BIT & flags;
+
+			for( bool const write : { true, false } )
+			{
+				Result tmpl{};
+				tmpl.path = write ? "mapped_write" : "mapped_read";
+				tmpl.src = write ? "host" : "type" + std::to_string( type ) + ":" + memory_flags_string( flags );
+				tmpl.dst = write ? "type" + std::to_string( type ) + ":" + memory_flags_string( flags ) : "host";
+
+				for( std::uint64_t size = aOpts.minSize; size <= aOpts.maxSize; size *= 4 )
+				{
+					Result result = tmpl;
+					result.mode = "single";
+					result.bytes = size;
+					result.batch = 1;
+					result.runs = 0;
+					result.latencyUs = result.gibPerSecond = std::nan("");
+					result.gpuUs = std::nan("");
+
+					std::fprintf( stderr, "%s %s->%s %llu bytes... ", result.path.c_str(), result.src.c_str(), result.dst.c_str(), static_cast<unsigned long long>(size) );
+
+					if( size > heap.size / 2 )
+					{
+						result.error = "size exceeds half of the memory heap";
+						std::fprintf( stderr, "skipped\n" );
+						aResults.emplace_back( std::move(result) );
+						continue;
+					}
+
+					VkMemoryAllocateInfo allocInfo{}; {
+						allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+						allocInfo.allocationSize = size;
+						allocInfo.memoryTypeIndex = type;
+					}
+
+					VkDeviceMemory memory = VK_NULL_HANDLE;
+					if( auto const res = vkAllocateMemory( context.device, &allocInfo, nullptr, &memory ); VK_SUCCESS != res )
+					{
+						result.error = "vkAllocateMemory() returned " + lut::to_string( res );
+						std::fprintf( stderr, "skipped\n" );
+						aResults.emplace_back( std::move(result) );
+						continue;
+					}
+
+					void* mapped = nullptr;
+					if( auto const res = vkMapMemory( context.device, memory, 0, VK_WHOLE_SIZE, 0, &mapped ); VK_SUCCESS != res )
+					{
+						vkFreeMemory( context.device, memory, nullptr );
+						throw lut::Error( "Unable to map memory type %u\n"
+							"vkMapMemory() returned %s", type, lut::to_string(res).c_str()
+						);
+					}
+
+					if( host.size() < size )
+						host.resize( std::size_t(size), 0xa5 );
+
+					VkMappedMemoryRange const range{ VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE, nullptr, memory, 0, VK_WHOLE_SIZE };
+
+					std::uint32_t const runs = runs_for( aOpts, size );
+
+					std::vector<double> cpuUs;
+					for( std::uint32_t run = 0; run < runs; ++run )
+					{
+						// Non-coherent memory needs an explicit flush (writes) or
+						// invalidate (reads), which is part of the cost.
+						auto const start = Clock_::now();
+						if( write )
+						{
+							std::memcpy( mapped, host.data(), std::size_t(size) );
+							if( !coherent )
+								vkFlushMappedMemoryRanges( context.device, 1, &range );
+						}
+						else
+						{
+							if( !coherent )
+								vkInvalidateMappedMemoryRanges( context.device, 1, &range );
+							std::memcpy( host.data(), mapped, std::size_t(size) );
+						}
+						auto const end = Clock_::now();
+
+						cpuUs.emplace_back( Microsecondsd_( end - start ).count() );
+					}
+
+					vkUnmapMemory( context.device, memory );
+					vkFreeMemory( context.device, memory, nullptr );
+
+					result.runs = runs;
+					result.latencyUs = median( cpuUs );
+					result.gibPerSecond = double(size) / (1e-6 * result.latencyUs) / (1024.0 * 1024.0 * 1024.0);
+
+					std::fprintf( stderr, "%.2f GiB/s\n", result.gibPerSecond );
+					aResults.emplace_back( std::move(result) );
+				}
+			}
+		}
+	}
+}
+
+namespace
+{
+	void write_json_number_( std::FILE* aOut, double aValue )
+	{
+		if( std::isfinite( aValue ) )
+			std::fprintf( aOut, "%.6g", aValue );
+		else
+			std::fprintf( aOut, "null" );
+	}
+
+	void write_json_string_( std::FILE* aOut, std::string const& aValue )
+	{
+		std::fputc( '"', aOut );
+		for( char const ch : aValue )
+		{
+			if( '"' == ch || '\\' == ch )
+				std::fprintf( aOut, "\\%c", ch );
+			else if( '\n' == ch )
+				std::fprintf( aOut, "\\n" );
+			else if( static_cast<unsigned char>(ch) < 0x20 )
+				std::fprintf( aOut, "\\u%04x", ch );
+			else
+				std::fputc( ch, aOut );
+		}
+		std::fputc( '"', aOut );
+	}
+
+	void write_json( std::FILE* aOut, Bench const& aBench, std::vector<Result> const& aResults )
+	{
+		std::fprintf( aOut, "{\n" );
+
+		std::fprintf( aOut, "  \"device\": " );
+		write_json_string_( aOut, aBench.props.deviceName );
+		std::fprintf( aOut, ",\n  \"driverVersion\": %u,\n", aBench.props.driverVersion );
+		std::fprintf( aOut, "  \"timestamps\": %s,\n", aBench.timestamps ? "true" : "false" );
+
+		std::fprintf( aOut, "  \"memoryTypes\": [\n" );
+		for( std::uint32_t i = 0; i < aBench.memory.memoryTypeCount; ++i )
+		{
+			auto const& type = aBench.memory.memoryTypes[i];
+			std::fprintf( aOut, "    { \"index\": %u, \"heap\": %u, \"heapBytes\": %llu, \"flags\": ",
+				i,
+				type.heapIndex,
+				static_cast<unsigned long long>(aBench.memory.memoryHeaps[type.heapIndex].size)
+			);
+			write_json_string_( aOut, memory_flags_string( type.propertyFlags ) );
+			std::fprintf( aOut, " }%s\n", i+1 < aBench.memory.memoryTypeCount ? "," : "" );
+		}
+		std::fprintf( aOut, "  ],\n" );
+
+		std::fprintf( aOut, "  \"locations\": { \"device-local\": %u, \"host-visible\": %u, \"host-cached\": %u },\n",
+			aBench.locationType[int(ELocation::deviceLocal)],
+			aBench.locationType[int(ELocation::hostVisible)],
+			aBench.locationType[int(ELocation::hostCached)]
+		);
+
+		std::fprintf( aOut, "  \"results\": [\n" );
+		for( std::size_t i = 0; i < aResults.size(); ++i )
+		{
+			auto const& res = aResults[i];
+
+			std::fprintf( aOut, "    { \"path\": " );
+			write_json_string_( aOut, res.path );
+			std::fprintf( aOut, ", \"src\": " );
+			write_json_string_( aOut, res.src );
+			std::fprintf( aOut, ", \"dst\": " );
+			write_json_string_( aOut, res.dst );
+			std::fprintf( aOut, ", \"mode\": " );
+			write_json_string_( aOut, res.mode );
+
+			std::fprintf( aOut, ", \"bytes\": %llu, \"batch\": %u, \"runs\": %u",
+				static_cast<unsigned long long>(res.bytes),
+				res.batch,
+				res.runs
+			);
+
+			std::fprintf( aOut, ", \"latency_us\": " );
+			write_json_number_( aOut, res.latencyUs );
+			std::fprintf( aOut, ", \"gpu_us\": " );
+			write_json_number_( aOut, res.gpuUs );
+			std::fprintf( aOut, ", \"gib_per_s\": " );
+			write_json_number_( aOut, res.gibPerSecond );
+
+			if( !res.error.empty() )
+			{
+				std::fprintf( aOut, ", \"error\": " );
+				write_json_string_( aOut, res.error );
+			}
+
+			std::fprintf( aOut, " }%s\n", i+1 < aResults.size() ? "," : "" );
+		}
+		std::fprintf( aOut, "  ]\n" );
+
+		std::fprintf( aOut, "}\n" );
+	}
+}
+
+namespace
+{
+	std::uint32_t runs_for( Options const& aOpts, std::uint64_t aBytes )
+	{
+		return aBytes >= cfg::kLargeSize ? std::min( aOpts.runs, cfg::kLargeRuns ) : aOpts.runs;
+	}
+
+	std::uint32_t batch_for( std::uint64_t aBytes )
+	{
+		auto const batch = cfg::kBatchBytes / aBytes;
+		return std::uint32_t(std::clamp<std::uint64_t>( batch, 1, cfg::kMaxBatch ));
+	}
+
+	VkExtent2D image_extent_for( std::uint64_t aBytes )
+	{
+		// Roughly square RGBA8 image with at least aBytes bytes
+		auto const texels = std::max<std::uint64_t>( 1, (aBytes + 3) / 4 );
+		auto const width = std::uint64_t(std::ceil( std::sqrt( double(texels) ) ));
+		auto const height = (texels + width - 1) / width;
+
+		return VkExtent2D{ std::uint32_t(width), std::uint32_t(height) };
+	}
+
+	double median( std::vector<double> aSamples )
+	{
+		assert( !aSamples.empty() );
+		std::sort( aSamples.begin(), aSamples.end() );
+		return aSamples[aSamples.size()/2];
+	}
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
@@ -0,0 +1,196 @@
+#include <volk/volk.h>
+
+#include <vector>
+#include <chrono>
+#include <string>
+#include <algorithm>
+#include <functional>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+
+#include "../labutils/error.hpp"
+#include "../labutils/mipmap.hpp"
+#include "../labutils/vkutil.hpp"
+#include "../labutils/vkimage.hpp"
+#include "../labutils/vkobject.hpp"
+#include "../labutils/allocator.hpp"
+#include "../labutils/vulkan_context.hpp"
+namespace lut = labutils;
+
+/* Compares the two texture upload paths of upload_image_texture2d():
+ *
+ *  - staged: staging buffer, vkCmdCopyBufferToImage() and vkCmdBlitImage()
+ *    for the mip chain, one submission, and a fence wait
+ *  - host: mip chain generated on the CPU, written with
+ *    vkCopyMemoryToImageEXT() (VK_EXT_host_image_copy); no staging memory,
+ *    command buffers or submissions
+ *
+ * Each measurement covers a whole upload of an already decoded image, from
+ * the call to the returned image (including image creation). "mips" is the
+ * CPU mip generation alone, which is part of the host path. The host path is
+ * skipped if the device doesn't support it (or LABUTILS_NO_HOST_IMAGE_COPY
+ * is set).
+ *
+ * Usage: bench-upload [iterations] [image.png ...]
+ *
+ * Without input images, synthetic square images of kSyntheticSizes are used,
+ * as well as the exercise4 asphalt texture.
+ */
+
+namespace
+{
+using Clock_ = std::chrono::steady_clock;
+
+	namespace cfg
+	{
+		constexpr std::uint32_t kDefaultIterations = 10;
+
+		constexpr char const* kDefaultTexture = "assets/exercise4/asphalt.png";
+
+		constexpr std::uint32_t kSyntheticSizes[] = { 256, 1024, 2048, 4096 };
+	}
+
+	struct TestImage
+	{
+		std::string name;
+		lut::ImageData data;
+	};
+
+	struct Path
+	{
+		std::string name;
+		std::function<void (lut::ImageData const&)> run;
+	};
+
+	TestImage make_synthetic_image( std::uint32_t aSize );
+}
+
+int main( int aArgc, char* aArgv[] ) try
+{
+	std::uint32_t iterations = cfg::kDefaultIterations;
+	if( aArgc > 1 )
+		iterations = std::max( 1ul, std::strtoul( aArgv[1], nullptr, 10 ) );
+
+	std::vector<TestImage> images;
+	if( aArgc > 2 )
+	{
+		for( int i = 2; i < aArgc; ++i )
+			images.emplace_back( TestImage{ aArgv[i], lut::decode_image_rgba8( aArgv[i] ) } );
+	}
+	else
+	{
+		for( auto const size : cfg::kSyntheticSizes )
+			images.emplace_back( make_synthetic_image( size ) );
+
+		images.emplace_back( TestImage{ cfg::kDefaultTexture, lut::decode_image_rgba8( cfg::kDefaultTexture ) } );
+	}
+
+	lut::VulkanContext context = lut::make_vulkan_context();
+	lut::Allocator allocator = lut::create_allocator( context );
+
+	lut::CommandPool pool = lut::create_command_pool( context, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT );
+
+	bool const haveHost = lut::supports_host_image_upload( context );
+	if( !haveHost )
+		std::fprintf( stderr, "Host image copy: not supported, only measuring the staged path\n" );
+
+	// Images are destroyed outside of the timed region
+	lut::Image result;
+
+	std::vector<Path> paths;
+	paths.emplace_back( Path{ "staged", [&] (lut::ImageData const& aData) {
+		result = lut::upload_image_texture2d_staged( aData, context, pool.handle, allocator );
+	} } );
+	if( haveHost )
+	{
+		paths.emplace_back( Path{ "host", [&] (lut::ImageData const& aData) {
+			result = lut::upload_image_texture2d_host( aData, context, allocator );
+		} } );
+	}
+	paths.emplace_back( Path{ "mips", [] (lut::ImageData const& aData) {
+		auto const chain = lut::generate_mip_chain_rgba8( aData, true );
+		(void)chain;
+	} } );
+
+	for( auto const& image : images )
+	{
+		double const inputMB = double(image.data.width) * image.data.height * 4 / (1024.0 * 1024.0);
+
+		std::printf( "%s: %ux%u (%.2f MiB)\n", image.name.c_str(), image.data.width, image.data.height, inputMB );
+		std::printf( "  %-8s %12s %12s %12s\n", "path", "best ms", "median ms", "MiB/s" );
+
+		for( auto const& path : paths )
+		{
+			// One untimed run to warm up allocator pools and caches
+			path.run( image.data );
+			result = lut::Image();
+
+			std::vector<double> samples;
+			for( std::uint32_t i = 0; i < iterations; ++i )
+			{
+				auto const start = Clock_::now();
+				path.run( image.data );
+				auto const end = Clock_::now();
+
+				result = lut::Image();
+				samples.emplace_back( std::chrono::duration<double, std::milli>( end - start ).count() );
+			}
+
+			std::sort( samples.begin(), samples.end() );
+
+			auto const best = samples.front();
+			auto const median = samples[samples.size()/2];
+
+			std::printf( "  %-8s %12.3f %12.3f %12.1f\n",
+				path.name.c_str(),
+				best,
+				median,
+				inputMB / (median * 1e-3)
+			);
+		}
+	}
+
+	return 0;
+}
+catch( std::exception const& eErr )
+{
+	std::fprintf( stderr, "\n" );
+	std::fprintf( stderr, "Error: %s\n", eErr.what() );
+	return 1;
+}
+
+namespace
+{
+TestImage make_synthetic_image( std::uint32_t aSize )
+{
+	// Smooth gradients with a checkerboard, so that the mip levels differ
+	auto* texels = static_cast<std::uint8_t*>(std::malloc( std::size_t(aSize) * aSize * 4 ));
+	if( !texels )
+		throw lut::Error( "Unable to allocate %ux%u test image", aSize, aSize );
+
+	for( std::uint32_t y = 0; y < aSize; ++y )
+	{
+		for( std::uint32_t x = 0; x < aSize; ++x )
+		{
+			auto* out = texels + (std::size_t(y) * aSize + x) * 4;
+			bool const check = ((x >> 4) ^ (y >> 4)) & 1;
+
+			out[0] = std::uint8_t(x * 255 / aSize);
+			out[1] = std::uint8_t(y * 255 / aSize);
+			out[2] = check ? 255 : 32;
+			out[3] = 255;
+		}
+	}
+
+	TestImage ret;
+	ret.name = "synthetic-" + std::to_string(aSize);
+	ret.data.width = aSize;
+	ret.data.height = aSize;
+	ret.data.texels = decltype(ret.data.texels)( texels, &std::free );
+	return ret;
+}
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
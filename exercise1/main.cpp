@@ -12,7 +12,9 @@
 #include <cstdint>
 #include <cstring>
 
+#include "../labutils/error.hpp"
 #include "../labutils/to_string.hpp"
+#include "../labutils/device_profile.hpp"
 namespace lut = labutils;
 
 namespace
@@ -282,13 +284,10 @@ float score_device(VkPhysicalDevice device)
 		return -1.0f;
 	}
 
-	float deviceScore = 0.0f;
-	if (deviceProps.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU)
-		deviceScore += 500.0f;
-	else if (deviceProps.deviceType == VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU)
-		deviceScore += 100.0f;
+	auto const profile = lut::profile_device(device);
+	lut::print_device_profile(stdout, profile);
 
-	return deviceScore;
+	return lut::score_device_profile(profile);
 }
 VkPhysicalDevice select_device(VkInstance instance)
 {
@@ -314,6 +313,17 @@ VkPhysicalDevice select_device(VkInstance instance)
 		return VK_NULL_HANDLE;
 	}
 
+	try
+	{
+		if (auto const index = lut::find_device_override(devices))
+			return score_device(devices[*index]) >= 0.f ? devices[*index] : VK_NULL_HANDLE;
+	}
+	catch (lut::Error const& eErr)
+	{
+		std::fprintf(stderr, "Error: %s\n", eErr.what());
+		return VK_NULL_HANDLE;
+	}
+
 	for(auto const device : devices)
 	{
 		auto const score = score_device(device);
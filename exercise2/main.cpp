@@ -1,22 +1,33 @@
 #include <volk/volk.h>
 
+#include <deque>
+#include <mutex>
 #include <tuple>
+#include <chrono>
 #include <limits>
+#include <string>
+#include <thread>
 #include <vector>
+#include <optional>
+#include <algorithm>
+#include <exception>
+#include <functional>
 #include <stdexcept>
+#include <condition_variable>
 
 #include <cstdio>
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
+#include <cstdlib>
 #include <cstring>
 
-#include <stb_image_write.h>
-
 #include "../labutils/error.hpp"
 #include "../labutils/vkutil.hpp"
 #include "../labutils/vkobject.hpp"
 #include "../labutils/to_string.hpp"
+#include "../labutils/vkcompute.hpp"
+#include "../labutils/image_encode.hpp"
 #include "../labutils/vulkan_context.hpp"
 namespace lut = labutils;
 
@@ -49,36 +60,215 @@ namespace cfg
 	constexpr std::uint32_t kImageHeight = 720;
 	constexpr std::uint32_t kImageSize = kImageWidth * kImageHeight * 4; // RGBA
 
-	// Output image path
-	constexpr char const* kImageOutput = "output.png";
+	// Output image path; the extension depends on the output format. When
+	// rendering multiple images, the batch pattern is used instead.
+	constexpr char const* kImageOutput = "output.%s";
+	constexpr char const* kBatchImageOutput = "output-%04u.%s";
+
+	constexpr labutils::EImageFormat kDefaultOutputFormat = labutils::EImageFormat::png;
+
+	// Output image path for tiled rendering. Tiles are streamed into a binary
+	// PPM file, which (unlike PNG) can be written out of order.
+	constexpr char const* kTiledImageOutput = "output.ppm";
+
+	// Number of images that are in flight by default. Each image in flight
+	// has its own render target and download buffer.
+	constexpr std::uint32_t kDefaultFramesInFlight = 3;
 
 	// Compiled shader code for the graphics pipeline
 	// See sources in exercise2/shaders/*. 
 #	define SHADERDIR_ "assets/exercise2/shaders/"
 	constexpr char const* kVertShaderPath = SHADERDIR_ "triangle.vert.spv";
 	constexpr char const* kFragShaderPath = SHADERDIR_ "triangle.frag.spv";
+
+	constexpr char const* kPostprocessShaderPath = SHADERDIR_ "postprocess.comp.spv";
 #	undef SHADERDIR_
+
+	// Work group size of the post-processing compute shader
+	constexpr std::uint32_t kPostprocessGroupSize = 8;
 }
 
+using Clock_ = std::chrono::steady_clock;
+
+// Push constants for the post-processing compute shader; see
+// shaders/postprocess.comp
+enum class EPackMode : std::uint32_t
+{
+	rgba8 = 0,
+	rgb565 = 1,
+	r8 = 2
+};
+
+struct PostParams
+{
+	std::int32_t srcOffset[2];
+	std::int32_t srcExtent[2];
+	std::int32_t dstExtent[2];
+	std::uint32_t dstRowWords;
+	EPackMode packMode;
+	std::uint32_t encodeSRGB;
+};
+
+struct PostPass
+{
+	VkPipeline pipe;
+	VkPipelineLayout layout;
+	VkDescriptorSet descriptors;
+	PostParams params;
+};
+
+struct Options
+{
+	// Either:
+	//  - render a number of images (default: one), or
+	//  - render a single large image in tiles ("--tiled"). 
+	// In both cases, several images/tiles may be in flight at the same time.
+	std::uint32_t imageCount = 1;
+	std::uint32_t framesInFlight = cfg::kDefaultFramesInFlight;
+
+	bool tiled = false;
+	std::uint32_t tiledWidth = 0, tiledHeight = 0;
+
+	// Output format for (untiled) images
+	lut::EImageFormat format = cfg::kDefaultOutputFormat;
+
+	// Post-processing (untiled only), enabled by any of the --crop, --scale,
+	// --pack and --linear options.
+	bool postprocess = false;
+	PostParams post{};
+};
+
+// Layout of an image in the download buffer
+struct OutputLayout
+{
+	std::uint32_t width, height;
+	std::uint32_t channels; // bytes per pixel
+	std::size_t stride;
+	std::size_t size;
+};
+
+Options parse_options( int, char* [] );
+OutputLayout compute_output_layout( Options const& );
+
+// Per-image-in-flight resources
+struct FrameSlot
+{
+	Image image;
+	lut::ImageView imageView;
+	lut::Framebuffer framebuffer;
+
+	Buffer download;
+	std::byte const* data = nullptr; // persistently mapped
+	bool coherent = false;
+
+	VkDescriptorSet postDescriptors = VK_NULL_HANDLE;
+
+	VkCommandBuffer cbuffer = VK_NULL_HANDLE;
+	lut::Fence fence;
+
+	// Set while the slot is waiting to be (or is being) encoded. Protected
+	// by the EncodeQueue's mutex.
+	bool busy = false;
+};
+
+// Push constants; see shaders/triangle.vert
+struct TileTransform
+{
+	float scale[2];
+	float offset[2];
+};
+
+TileTransform make_tile_transform( std::uint32_t aImageWidth, std::uint32_t aImageHeight, std::uint32_t aTileX, std::uint32_t aTileY );
+
+// Binary PPM file whose pixels are written in arbitrary rectangles. Each
+// row of a rectangle is written directly at its final position in the file.
+// Safe to use from multiple threads.
+class StreamingPPM
+{
+	public:
+		StreamingPPM( char const* aPath, std::uint32_t aWidth, std::uint32_t aHeight );
+		~StreamingPPM();
+
+		StreamingPPM( StreamingPPM const& ) = delete;
+		StreamingPPM& operator= (StreamingPPM const&) = delete;
+
+	public:
+		// Writes a rectangle of RGBA8 pixels (alpha is dropped)
+		void write_rgba( std::uint32_t aX, std::uint32_t aY, std::uint32_t aWidth, std::uint32_t aHeight, std::byte const* aPixels, std::size_t aStride );
+
+	private:
+		std::FILE* mFile = nullptr;
+		std::mutex mMutex;
+
+		std::uint32_t mWidth, mHeight;
+		std::uint64_t mDataOffset;
+};
+
+// Queue of images that are waiting for the GPU and then for encoding.
+class EncodeQueue
+{
+	public:
+		using Encoder = std::function<void (FrameSlot const&)>;
+
+		struct Job
+		{
+			FrameSlot* slot;
+			Encoder encode;
+		};
+
+	public:
+		void push( FrameSlot&, Encoder );
+		std::optional<Job> pop();
+
+		void done( FrameSlot& );
+		void wait_idle( FrameSlot const& );
+
+		void close();
+
+		void set_error( std::exception_ptr );
+		void rethrow_error();
+
+	private:
+		std::mutex mMutex;
+		std::condition_variable mJobCV;
+		std::condition_variable mDoneCV;
+
+		std::deque<Job> mJobs;
+		bool mClosed = false;
+
+		std::exception_ptr mError;
+};
+
+void encode_worker( lut::VulkanContext const&, EncodeQueue& );
+
 // Helpers:
-lut::RenderPass create_render_pass( lut::VulkanContext const& );
+lut::RenderPass create_render_pass( lut::VulkanContext const&, bool aPostprocess );
 
 lut::PipelineLayout create_triangle_pipeline_layout( lut::VulkanContext const& );
 lut::Pipeline create_triangle_pipeline( lut::VulkanContext const&, VkRenderPass, VkPipelineLayout );
 
 
-std::tuple<Image,lut::ImageView> create_framebuffer_image( lut::VulkanContext const& );
+std::tuple<Image,lut::ImageView> create_framebuffer_image( lut::VulkanContext const&, VkImageUsageFlags aReadbackUsage );
 lut::Framebuffer create_framebuffer( lut::VulkanContext const&, VkRenderPass, VkImageView );
 
-Buffer create_download_buffer( lut::VulkanContext const& );
+std::tuple<Buffer,bool> create_download_buffer( lut::VulkanContext const&, VkDeviceSize, VkBufferUsageFlags );
+
+lut::DescriptorSetLayout create_postprocess_descriptor_layout( lut::VulkanContext const& );
+lut::PipelineLayout create_postprocess_pipeline_layout( lut::VulkanContext const&, VkDescriptorSetLayout );
+lut::Pipeline create_postprocess_pipeline( lut::VulkanContext const&, VkPipelineLayout );
+VkDescriptorSet create_postprocess_descriptors( lut::VulkanContext const&, VkDescriptorPool, VkDescriptorSetLayout, VkImageView, VkSampler, VkBuffer );
 
 void record_commands( 
 	VkCommandBuffer,
 	VkRenderPass,
 	VkFramebuffer,
 	VkPipeline,
+	VkPipelineLayout,
+	TileTransform const&,
 	VkImage,
-	VkBuffer
+	VkBuffer,
+	PostPass const*,
+	std::uint32_t aImageIndex
 );
 void submit_commands(
 	lut::VulkanContext const&,
@@ -87,10 +277,24 @@ void submit_commands(
 );
 
 std::uint32_t find_memory_type( lut::VulkanContext const&, std::uint32_t aMemoryTypeBits, VkMemoryPropertyFlags );
+std::uint32_t find_memory_type( lut::VulkanContext const&, std::uint32_t aMemoryTypeBits, VkMemoryPropertyFlags aRequired, VkMemoryPropertyFlags aPreferred );
 }
 
-int main() try
+int main( int aArgc, char* aArgv[] ) try
 {
+	auto const options = parse_options( aArgc, aArgv );
+
+	std::uint32_t imageCount = options.imageCount;
+	std::uint32_t const framesInFlight = options.framesInFlight;
+
+	bool const tiled = options.tiled;
+	std::uint32_t const tiledWidth = options.tiledWidth, tiledHeight = options.tiledHeight;
+
+	lut::EImageFormat const format = options.format;
+
+	// Layout of the data in the download buffers
+	auto const output = compute_output_layout( options );
+
 	// Create the Vulkan instance, set up the validation, select a physical
 	// device and instantiate a logical device from the selected device.
 	// Request a single GRAPHICS queue for now, and fetch this from the created
@@ -103,76 +307,201 @@ int main() try
 	
 	// To render an image, we need a number of Vulkan resources. The following
 	// creates these:
-	lut::RenderPass renderPass = create_render_pass( context );
+	lut::RenderPass renderPass = create_render_pass( context, options.postprocess );
 
 	lut::PipelineLayout pipeLayout = create_triangle_pipeline_layout( context );
 	lut::Pipeline pipe = create_triangle_pipeline( context, renderPass.handle, pipeLayout.handle );
 
-	auto [fbImage, fbImageView] = create_framebuffer_image( context );
-	lut::Framebuffer framebuffer = create_framebuffer( context, renderPass.handle, fbImageView.handle );
+	// Optional post-processing with a compute shader. The compute shader
+	// reads the rendered image and writes its result directly into the
+	// download buffer.
+	lut::DescriptorSetLayout postLayout;
+	lut::PipelineLayout postPipeLayout;
+	lut::Pipeline postPipe;
+	lut::DescriptorPool postPool;
+	lut::Sampler postSampler;
 
-	Buffer dlBuffer = create_download_buffer( context );
+	if( options.postprocess )
+	{
+		postLayout = create_postprocess_descriptor_layout( context );
+		postPipeLayout = create_postprocess_pipeline_layout( context, postLayout.handle );
+		postPipe = create_postprocess_pipeline( context, postPipeLayout.handle );
 
-	lut::CommandPool cpool = lut::create_command_pool( context );
-	VkCommandBuffer cbuffer = lut::alloc_command_buffer( context, cpool.handle );
+		postPool = lut::create_descriptor_pool( context, 2 * framesInFlight, framesInFlight );
+		postSampler = lut::create_default_sampler( context );
+	}
 
-	lut::Fence fence = lut::create_fence( context );
+	lut::CommandPool cpool = lut::create_command_pool( context, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT );
 
-	// Now that we have set up the necessary resources, we can use our Vulkan
-	// device to render the image. This happens in two steps:
-	//  
-	// 1. Record rendering commands in to the command buffer that we've 
-	//    created for this purpose.
-	// 2. Submit the command buffer to the Vulkan device / GPU for processing.
-
-	record_commands(
-		cbuffer,
-		renderPass.handle,
-		framebuffer.handle,
-		pipe.handle,
-		fbImage.image,
-		dlBuffer.buffer
-	);
+	// Each frame in flight has its own render target, download buffer,
+	// command buffer and fence. This allows the GPU to render the next image
+	// while previous images are being read back and encoded.
+	std::vector<FrameSlot> slots( framesInFlight );
+	for( auto& slot : slots )
+	{
+		std::tie(slot.image, slot.imageView) = create_framebuffer_image( context, options.postprocess ? VK_IMAGE_USAGE_SAMPLED_BIT : VK_IMAGE_USAGE_TRANSFER_SRC_BIT );
+		slot.framebuffer = create_framebuffer( context, renderPass.handle, slot.imageView.handle );
 
-	submit_commands(
-		context,
-		cbuffer,
-		fence.handle
-	);
+		std::tie(slot.download, slot.coherent) = create_download_buffer( context, output.size, options.postprocess ? VK_BUFFER_USAGE_STORAGE_BUFFER_BIT : VK_BUFFER_USAGE_TRANSFER_DST_BIT );
 
-	// Commands are executed asynchronously. Before we can access the result,
-	// we need to wait for the processing to finish. The fence that we passed
-	// to VkQueueSubmit() will become signalled when the command buffer has
-	// finished processing -- we will wait for that to occur with
-	// vkWaitForFences().
+		if( options.postprocess )
+			slot.postDescriptors = create_postprocess_descriptors( context, postPool.handle, postLayout.handle, slot.imageView.handle, postSampler.handle, slot.download.buffer );
 
-	// Wait for commands to finish executing
-	constexpr std::uint64_t kMaxWait = std::numeric_limits<std::uint64_t>::max();
+		// Download buffers remain mapped for their whole lifetime. Workers
+		// encode directly from the mapped memory, without an extra copy.
+		void* dataPtr = nullptr;
+		if (auto const res = vkMapMemory(context.device, slot.download.memory, 0, VK_WHOLE_SIZE, 0, &dataPtr); res != VK_SUCCESS)
+		{
+			throw lut::Error("Mapping Memory\n"
+				"vkMapMemory() Returned %s", lut::to_string(res).c_str());
+		}
+
+		assert(dataPtr);
+		slot.data = static_cast<std::byte const*>(dataPtr);
+
+		slot.cbuffer = lut::alloc_command_buffer( context, cpool.handle );
+		slot.fence = lut::create_fence( context );
+	}
 
-	if (auto const res = vkWaitForFences(context.device, 1, &fence.handle, VK_TRUE, kMaxWait); res != VK_SUCCESS)
+	// Worker threads wait for the GPU to finish an image, and then encode it
+	// to disk. The main thread only records and submits commands.
+	std::uint32_t const hwThreads = std::max( 1u, std::thread::hardware_concurrency() );
+	std::uint32_t const workerCount = std::min( framesInFlight, hwThreads );
+
+	// The PNG encoder can use multiple threads per image. Share the hardware
+	// threads between the workers.
+	std::uint32_t const encodeThreads = std::max( 1u, hwThreads / workerCount );
+
+	EncodeQueue queue;
+
+	std::vector<std::thread> workers;
+	for( std::uint32_t i = 0; i < workerCount; ++i )
+		workers.emplace_back( [&context, &queue] { encode_worker( context, queue ); } );
+
+	// In tiled mode, the render target is used for one tile at a time. Tiles
+	// are streamed to the output file as they complete, so neither the host
+	// nor the device ever hold the full image.
+	std::uint32_t const tilesX = tiled ? (tiledWidth + cfg::kImageWidth - 1) / cfg::kImageWidth : 1;
+	std::uint32_t const tilesY = tiled ? (tiledHeight + cfg::kImageHeight - 1) / cfg::kImageHeight : 1;
+
+	std::optional<StreamingPPM> tiledOutput;
+	if( tiled )
 	{
-		throw lut::Error("Waiting for Fence\n"
-			"vkWaitForFences() returned %s", lut::to_string(res).c_str());
+		tiledOutput.emplace( cfg::kTiledImageOutput, tiledWidth, tiledHeight );
+		imageCount = tilesX * tilesY;
 	}
 
-	// Access image and write it to disk.
-	void* dataPtr = nullptr;
-	if (auto const res = vkMapMemory(context.device, dlBuffer.memory, 0, cfg::kImageSize, 0, &dataPtr); res != VK_SUCCESS)
+	auto const startTime = Clock_::now();
+
+	// Now that we have set up the necessary resources, we can use our Vulkan
+	// device to render the images. For each image (or tile):
+	//  
+	// 1. Wait until the slot's previous image has been encoded.
+	// 2. Record rendering commands in to the slot's command buffer.
+	// 3. Submit the command buffer to the Vulkan device / GPU for processing.
+	// 4. Hand the slot to a worker, which waits for the slot's fence.
+	try
 	{
-		throw lut::Error("Mapping Memory\n"
-			"vkMapMemory() Returned %s", lut::to_string(res).c_str());
+		for( std::uint32_t i = 0; i < imageCount; ++i )
+		{
+			auto& slot = slots[i % framesInFlight];
+
+			queue.wait_idle( slot );
+
+			if (auto const res = vkResetFences(context.device, 1, &slot.fence.handle); res != VK_SUCCESS)
+			{
+				throw lut::Error("Unable to Reset Fence\n"
+					"vkResetFences() Returned %s", lut::to_string(res).c_str());
+			}
+
+			// Tile placement (the whole image is a single tile when not in
+			// tiled mode).
+			std::uint32_t const tileX = (i % tilesX) * cfg::kImageWidth;
+			std::uint32_t const tileY = (i / tilesX) * cfg::kImageHeight;
+
+			TileTransform tile{ { 1.f, 1.f }, { 0.f, 0.f } };
+			if( tiled )
+				tile = make_tile_transform( tiledWidth, tiledHeight, tileX, tileY );
+
+			PostPass const post{ postPipe.handle, postPipeLayout.handle, slot.postDescriptors, options.post };
+
+			record_commands(
+				slot.cbuffer,
+				renderPass.handle,
+				slot.framebuffer.handle,
+				pipe.handle,
+				pipeLayout.handle,
+				tile,
+				slot.image.image,
+				slot.download.buffer,
+				options.postprocess ? &post : nullptr,
+				tiled ? 0 : i
+			);
+
+			submit_commands(
+				context,
+				slot.cbuffer,
+				slot.fence.handle
+			);
+
+			if( tiled )
+			{
+				// Edge tiles may extend past the image; only write the valid
+				// part.
+				std::uint32_t const width = std::min( cfg::kImageWidth, tiledWidth - tileX );
+				std::uint32_t const height = std::min( cfg::kImageHeight, tiledHeight - tileY );
+
+				queue.push( slot, [&out = *tiledOutput, tileX, tileY, width, height] (FrameSlot const& aSlot) {
+					out.write_rgba( tileX, tileY, width, height, aSlot.data, cfg::kImageWidth * 4 );
+				} );
+			}
+			else
+			{
+				char path[64];
+				if( 1 == imageCount )
+					std::snprintf( path, sizeof(path), cfg::kImageOutput, lut::file_extension( format ) );
+				else
+					std::snprintf( path, sizeof(path), cfg::kBatchImageOutput, i, lut::file_extension( format ) );
+
+				// Encode directly from the mapped download buffer
+				queue.push( slot, [path = std::string(path), format, output, encodeThreads] (FrameSlot const& aSlot) {
+					lut::write_image( format, path.c_str(), output.width, output.height, output.channels, aSlot.data, output.stride, encodeThreads );
+				} );
+			}
+		}
+	}
+	catch( ... )
+	{
+		// Make sure that the workers are stopped before the resources that
+		// they might use are destroyed.
+		queue.close();
+		for( auto& worker : workers )
+			worker.join();
+
+		vkDeviceWaitIdle( context.device );
+		throw;
 	}
 
-	assert(dataPtr);
+	queue.close();
+	for( auto& worker : workers )
+		worker.join();
 
-	std::vector<std::byte> buffer(cfg::kImageSize);
-	std::memcpy(buffer.data(), dataPtr, cfg::kImageSize);
+	auto const endTime = Clock_::now();
 
-	vkUnmapMemory(context.device, dlBuffer.memory);
+	queue.rethrow_error();
 
-	if (!stbi_write_png(cfg::kImageOutput, cfg::kImageWidth, cfg::kImageHeight, 4, buffer.data(), cfg::kImageWidth * 4))
+	auto const seconds = std::chrono::duration<double>( endTime - startTime ).count();
+	if( tiled )
 	{
-		throw lut::Error("Unable to Write Image: stbi_write_png() Returned Error");
+		std::printf( "Rendered %ux%u image in %u tiles in %.3f s (%.2f tiles/s; %u in flight, %u workers)\n",
+			tiledWidth, tiledHeight, imageCount, seconds, imageCount / seconds, framesInFlight, workerCount );
+	}
+	else
+	{
+		std::printf( "Rendered and encoded %u images in %.3f s (%.2f images/s; %u in flight, %u workers)\n",
+			imageCount, seconds, imageCount / seconds, framesInFlight, workerCount );
+		std::printf( "Downloaded %ux%u, %u bytes/pixel (%.2f MiB per image)\n",
+			output.width, output.height, output.channels, output.size / (1024.0*1024.0) );
 	}
 
 	// Cleanup
@@ -190,7 +519,7 @@ catch( std::exception const& eErr )
 
 namespace
 {
-lut::RenderPass create_render_pass( lut::VulkanContext const& aContext )
+lut::RenderPass create_render_pass( lut::VulkanContext const& aContext, bool aPostprocess )
 {
 	VkAttachmentDescription attachments[1]{}; {
 		attachments[0].format = cfg::kImageFormat;
@@ -198,7 +527,9 @@ lut::RenderPass create_render_pass( lut::VulkanContext const& aContext )
 		attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
 		attachments[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
 		attachments[0].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		attachments[0].finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		// The image is either copied to the download buffer directly, or
+		// read by the post-processing compute shader.
+		attachments[0].finalLayout = aPostprocess ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
 	}
 	
 	VkAttachmentReference subpassAttachments[1]{}; {
@@ -219,8 +550,8 @@ lut::RenderPass create_render_pass( lut::VulkanContext const& aContext )
 		dependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
 		
 		dependencies[0].dstSubpass = VK_SUBPASS_EXTERNAL;
-		dependencies[0].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-		dependencies[0].dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		dependencies[0].dstAccessMask = aPostprocess ? VK_ACCESS_SHADER_READ_BIT : VK_ACCESS_TRANSFER_READ_BIT;
+		dependencies[0].dstStageMask = aPostprocess ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT : VK_PIPELINE_STAGE_TRANSFER_BIT;
 	}
 
 	VkRenderPassCreateInfo renderPassInfo{}; {
@@ -248,14 +579,20 @@ lut::RenderPass create_render_pass( lut::VulkanContext const& aContext )
 
 lut::PipelineLayout create_triangle_pipeline_layout( lut::VulkanContext const& aContext )
 {
+	VkPushConstantRange pushConstantRange{}; {
+		pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+		pushConstantRange.offset = 0;
+		pushConstantRange.size = sizeof(TileTransform);
+	}
+
 	VkPipelineLayoutCreateInfo pipelineLayoutInfo{}; {
 		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
 
 		pipelineLayoutInfo.setLayoutCount = 0;
 		pipelineLayoutInfo.pSetLayouts = nullptr;
 
-		pipelineLayoutInfo.pushConstantRangeCount = 0;
-		pipelineLayoutInfo.pPushConstantRanges = nullptr;
+		pipelineLayoutInfo.pushConstantRangeCount = 1;
+		pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
 	}
 
 	VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
@@ -384,7 +721,7 @@ lut::Pipeline create_triangle_pipeline( lut::VulkanContext const& aContext, VkRe
 	return lut::Pipeline(aContext.device, graphicsPipeline);
 }
 
-std::tuple<Image, lut::ImageView> create_framebuffer_image( lut::VulkanContext const& aContext )
+std::tuple<Image, lut::ImageView> create_framebuffer_image( lut::VulkanContext const& aContext, VkImageUsageFlags aReadbackUsage )
 {
 	VkImageCreateInfo imageInfo{}; {
 		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -397,7 +734,7 @@ std::tuple<Image, lut::ImageView> create_framebuffer_image( lut::VulkanContext c
 		imageInfo.arrayLayers = 1;
 		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
 		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-		imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | aReadbackUsage;
 		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 	}
@@ -497,14 +834,14 @@ lut::Framebuffer create_framebuffer( lut::VulkanContext const& aContext, VkRende
 	return lut::Framebuffer(aContext.device, framebuffer);
 }
 
-Buffer create_download_buffer( lut::VulkanContext const& aContext )
+std::tuple<Buffer,bool> create_download_buffer( lut::VulkanContext const& aContext, VkDeviceSize aSize, VkBufferUsageFlags aUsage )
 {
 	VkBufferCreateInfo downloadBufferInfo{}; {
 		downloadBufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
 
-		downloadBufferInfo.size = cfg::kImageSize;
+		downloadBufferInfo.size = aSize;
 
-		downloadBufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		downloadBufferInfo.usage = aUsage;
 		downloadBufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 	}
 
@@ -518,11 +855,21 @@ Buffer create_download_buffer( lut::VulkanContext const& aContext )
 	VkMemoryRequirements memoryRequirements{};
 	vkGetBufferMemoryRequirements(aContext.device, downloadBuffer.buffer, &memoryRequirements);
 
+	// The CPU reads the whole image back from this buffer. Prefer cached
+	// memory, where reads are much faster than from uncached/write-combined
+	// memory. Cached memory is not necessarily coherent.
+	auto const memoryType = find_memory_type(aContext, memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+
+	VkPhysicalDeviceMemoryProperties memoryProperties{};
+	vkGetPhysicalDeviceMemoryProperties(aContext.physicalDevice, &memoryProperties);
+
+	bool const coherent = memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
 	VkMemoryAllocateInfo memoryAllocateInfo{}; {
 		memoryAllocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
 
 		memoryAllocateInfo.allocationSize = memoryRequirements.size;
-		memoryAllocateInfo.memoryTypeIndex = find_memory_type(aContext, memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+		memoryAllocateInfo.memoryTypeIndex = memoryType;
 	}
 
 	if (auto const res = vkAllocateMemory(aContext.device, &memoryAllocateInfo, nullptr, &downloadBuffer.memory); res != VK_SUCCESS)
@@ -533,10 +880,115 @@ Buffer create_download_buffer( lut::VulkanContext const& aContext )
 
 	vkBindBufferMemory(aContext.device, downloadBuffer.buffer, downloadBuffer.memory, 0);
 	
-	return downloadBuffer;
+	return { std::move(downloadBuffer), coherent };
+}
+
+lut::DescriptorSetLayout create_postprocess_descriptor_layout( lut::VulkanContext const& aContext )
+{
+	VkDescriptorSetLayoutBinding layoutBindings[2]{}; {
+		layoutBindings[0].binding = 0;
+
+		layoutBindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		layoutBindings[0].descriptorCount = 1;
+		layoutBindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+		layoutBindings[1].binding = 1;
+
+		layoutBindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		layoutBindings[1].descriptorCount = 1;
+		layoutBindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+	VkDescriptorSetLayoutCreateInfo layoutInfo{}; {
+		layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+
+		layoutInfo.bindingCount = sizeof(layoutBindings) / sizeof(layoutBindings[0]);
+		layoutInfo.pBindings = layoutBindings;
+	}
+
+	VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+	if (auto const res = vkCreateDescriptorSetLayout(aContext.device, &layoutInfo, nullptr, &layout);
+		res != VK_SUCCESS)
+	{
+		throw lut::Error("Unable to Create Descriptor Set Layout\n"
+			"vkCreateDescriptorSetLayout() Returned %s", lut::to_string(res).c_str());
+	}
+
+	return lut::DescriptorSetLayout(aContext.device, layout);
+}
+lut::PipelineLayout create_postprocess_pipeline_layout( lut::VulkanContext const& aContext, VkDescriptorSetLayout aLayout )
+{
+	VkPushConstantRange pushConstantRange{}; {
+		pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		pushConstantRange.offset = 0;
+		pushConstantRange.size = sizeof(PostParams);
+	}
+
+	VkPipelineLayoutCreateInfo layoutInfo{}; {
+		layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+
+		layoutInfo.setLayoutCount = 1;
+		layoutInfo.pSetLayouts = &aLayout;
+		layoutInfo.pushConstantRangeCount = 1;
+		layoutInfo.pPushConstantRanges = &pushConstantRange;
+	}
+
+	VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+	if (auto const res = vkCreatePipelineLayout(aContext.device, &layoutInfo, nullptr, &pipelineLayout);
+		res != VK_SUCCESS)
+	{
+		throw lut::Error("Unable to Create Pipeline Layout\n"
+			"vkCreatePipelineLayout() returned %s", lut::to_string(res).c_str());
+	}
+
+	return lut::PipelineLayout(aContext.device, pipelineLayout);
+}
+lut::Pipeline create_postprocess_pipeline( lut::VulkanContext const& aContext, VkPipelineLayout aPipelineLayout )
+{
+	lut::ShaderModule compShader = lut::load_shader_module(aContext, cfg::kPostprocessShaderPath);
+
+	return lut::create_compute_pipeline(aContext, aPipelineLayout, compShader.handle);
+}
+VkDescriptorSet create_postprocess_descriptors( lut::VulkanContext const& aContext, VkDescriptorPool aPool, VkDescriptorSetLayout aLayout, VkImageView aSource, VkSampler aSampler, VkBuffer aOutput )
+{
+	VkDescriptorSet ret = lut::alloc_desc_set(aContext, aPool, aLayout);
+
+	VkDescriptorImageInfo sourceInfo{}; {
+		sourceInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		sourceInfo.imageView = aSource;
+		sourceInfo.sampler = aSampler;
+	}
+	VkDescriptorBufferInfo outputInfo{}; {
+		outputInfo.buffer = aOutput;
+		outputInfo.range = VK_WHOLE_SIZE;
+	}
+
+	VkWriteDescriptorSet writeDescriptorSets[2]{}; {
+		writeDescriptorSets[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+
+		writeDescriptorSets[0].dstSet = ret;
+		writeDescriptorSets[0].dstBinding = 0;
+
+		writeDescriptorSets[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		writeDescriptorSets[0].descriptorCount = 1;
+		writeDescriptorSets[0].pImageInfo = &sourceInfo;
+
+		writeDescriptorSets[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+
+		writeDescriptorSets[1].dstSet = ret;
+		writeDescriptorSets[1].dstBinding = 1;
+
+		writeDescriptorSets[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		writeDescriptorSets[1].descriptorCount = 1;
+		writeDescriptorSets[1].pBufferInfo = &outputInfo;
+	}
+
+	constexpr auto numDescriptorSets = sizeof(writeDescriptorSets) / sizeof(writeDescriptorSets[0]);
+	vkUpdateDescriptorSets(aContext.device, numDescriptorSets, writeDescriptorSets, 0, nullptr);
+
+	return ret;
 }
 
-void record_commands( VkCommandBuffer aCmdBuff, VkRenderPass aRenderPass, VkFramebuffer aFramebuffer, VkPipeline aGraphicsPipe, VkImage aFbImage, VkBuffer aDownloadBuffer )
+void record_commands( VkCommandBuffer aCmdBuff, VkRenderPass aRenderPass, VkFramebuffer aFramebuffer, VkPipeline aGraphicsPipe, VkPipelineLayout aPipeLayout, TileTransform const& aTile, VkImage aFbImage, VkBuffer aDownloadBuffer, PostPass const* aPost, std::uint32_t aImageIndex )
 {
 	// Begin Recording Commands
 	VkCommandBufferBeginInfo commandBufferBeginInfo{}; {
@@ -553,8 +1005,12 @@ void record_commands( VkCommandBuffer aCmdBuff, VkRenderPass aRenderPass, VkFram
 	}
 
 	// Begin the Render Pass
+	// The background colour varies slightly with the image index, such that
+	// the images in a batch can be told apart.
+	float const tint = 0.1f + 0.05f * float(aImageIndex % 8);
+
 	VkClearValue clearValues[1]{}; {
-		clearValues[0].color.float32[0] = 0.1f;
+		clearValues[0].color.float32[0] = tint;
 		clearValues[0].color.float32[1] = 0.1f;
 		clearValues[0].color.float32[2] = 0.1f;
 		clearValues[0].color.float32[3] = 1.0f;
@@ -578,6 +1034,8 @@ void record_commands( VkCommandBuffer aCmdBuff, VkRenderPass aRenderPass, VkFram
 	// Begin Drawing with our Graphics Pipeline
 	vkCmdBindPipeline(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aGraphicsPipe);
 
+	vkCmdPushConstants(aCmdBuff, aPipeLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(TileTransform), &aTile);
+
 	// Draw a Triangle
 	//vkCmdDraw(aCmdBuff, 3, 1, 0, 0);
 	//vkCmdDraw(aCmdBuff, 3, 1, 3, 1);
@@ -586,6 +1044,37 @@ void record_commands( VkCommandBuffer aCmdBuff, VkRenderPass aRenderPass, VkFram
 	// End the Render Pass
 	vkCmdEndRenderPass(aCmdBuff);
 
+	if( aPost )
+	{
+		// Post-process the image with the compute shader, which writes its
+		// results directly into the download buffer.
+		vkCmdBindPipeline( aCmdBuff, VK_PIPELINE_BIND_POINT_COMPUTE, aPost->pipe );
+		vkCmdBindDescriptorSets( aCmdBuff, VK_PIPELINE_BIND_POINT_COMPUTE, aPost->layout, 0, 1, &aPost->descriptors, 0, nullptr );
+		vkCmdPushConstants( aCmdBuff, aPost->layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PostParams), &aPost->params );
+
+		VkExtent2D const items{ aPost->params.dstRowWords, std::uint32_t(aPost->params.dstExtent[1]) };
+		lut::dispatch_2d( aCmdBuff, items, cfg::kPostprocessGroupSize, cfg::kPostprocessGroupSize );
+
+		// Make the results available to the host
+		lut::buffer_barrier(
+			aCmdBuff,
+			aDownloadBuffer,
+			VK_ACCESS_SHADER_WRITE_BIT,
+			VK_ACCESS_HOST_READ_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_HOST_BIT
+		);
+
+		// End Command Recording
+		if (auto const res = vkEndCommandBuffer(aCmdBuff); res != VK_SUCCESS)
+		{
+			throw lut::Error("Unable to End Recording Command Buffer\n"
+				"vkEndCommandBuffer() Returned %s", lut::to_string(res).c_str());
+		}
+
+		return;
+	}
+
 	// Copy Image to our Download Buffer
 	VkImageSubresourceLayers imageSubresourceLayers{}; {
 		imageSubresourceLayers.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
@@ -607,6 +1096,16 @@ void record_commands( VkCommandBuffer aCmdBuff, VkRenderPass aRenderPass, VkFram
 
 	vkCmdCopyImageToBuffer(aCmdBuff, aFbImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, aDownloadBuffer, 1, &imageCopy);
 
+	// Make the copied data available to the host
+	lut::buffer_barrier(
+		aCmdBuff,
+		aDownloadBuffer,
+		VK_ACCESS_TRANSFER_WRITE_BIT,
+		VK_ACCESS_HOST_READ_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_PIPELINE_STAGE_HOST_BIT
+	);
+
 	// End Command Recording
 	if (auto const res = vkEndCommandBuffer(aCmdBuff); res != VK_SUCCESS)
 	{
@@ -651,6 +1150,374 @@ std::uint32_t find_memory_type( lut::VulkanContext const& aContext, std::uint32_
 	throw lut::Error("Unable to find Suitable Memory Type (Allowed Memory Types = 0x%x, Required Properties = %s)",
 		aMemoryTypeBits, lut::memory_property_flags(aProps).c_str());
 }
+std::uint32_t find_memory_type( lut::VulkanContext const& aContext, std::uint32_t aMemoryTypeBits, VkMemoryPropertyFlags aRequired, VkMemoryPropertyFlags aPreferred )
+{
+	VkPhysicalDeviceMemoryProperties memoryProperties{};
+	vkGetPhysicalDeviceMemoryProperties(aContext.physicalDevice, &memoryProperties);
+
+	VkMemoryPropertyFlags const both = aRequired | aPreferred;
+	for (std::uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+	{
+		auto const& memoryType = memoryProperties.memoryTypes[i];
+
+		if (both == (both & memoryType.propertyFlags) && (aMemoryTypeBits & (1u << i)))
+		{
+			return i;
+		}
+	}
+
+	return find_memory_type(aContext, aMemoryTypeBits, aRequired);
+}
+}
+
+namespace
+{
+Options parse_options( int aArgc, char* aArgv[] )
+{
+	Options ret;
+
+	auto const usage = [&] {
+		return lut::Error( "Usage: %s [options] [image-count] [frames-in-flight]\n"
+			"       %s [--format F] --tiled <width> <height> [frames-in-flight]\n"
+			"Options:\n"
+			"  --format raw|ppm|pam|qoi|png   output format (default: %s)\n"
+			"  --crop <x> <y> <w> <h>         only download the given region\n"
+			"  --scale <n>                    downscale by n (box filter)\n"
+			"  --pack rgba8|rgb565|r8         output pixel format (rgb565 implies raw)\n"
+			"  --linear                       do not re-encode to sRGB\n"
+			"The crop/scale/pack/linear options post-process the image on the GPU\n"
+			"before download. All values must be non-zero.",
+			aArgv[0], aArgv[0], lut::image_format_name( cfg::kDefaultOutputFormat )
+		);
+	};
+	auto const uint_arg = [&] (int aIndex) {
+		if( aIndex >= aArgc )
+			throw usage();
+		return std::uint32_t(std::strtoul( aArgv[aIndex], nullptr, 10 ));
+	};
+
+	std::uint32_t cropX = 0, cropY = 0, cropW = cfg::kImageWidth, cropH = cfg::kImageHeight;
+	std::uint32_t scale = 1;
+	EPackMode pack = EPackMode::rgba8;
+	bool linear = false;
+	bool formatGiven = false;
+
+	int argi = 1;
+	for( ; argi < aArgc && 0 == std::strncmp( aArgv[argi], "--", 2 ); )
+	{
+		char const* const arg = aArgv[argi];
+		if( 0 == std::strcmp( arg, "--format" ) && argi+1 < aArgc )
+		{
+			ret.format = lut::parse_image_format( aArgv[argi+1] );
+			formatGiven = true;
+			argi += 2;
+		}
+		else if( 0 == std::strcmp( arg, "--tiled" ) )
+		{
+			ret.tiled = true;
+			ret.tiledWidth = uint_arg( argi+1 );
+			ret.tiledHeight = uint_arg( argi+2 );
+			argi += 3;
+		}
+		else if( 0 == std::strcmp( arg, "--crop" ) )
+		{
+			cropX = uint_arg( argi+1 );
+			cropY = uint_arg( argi+2 );
+			cropW = uint_arg( argi+3 );
+			cropH = uint_arg( argi+4 );
+			ret.postprocess = true;
+			argi += 5;
+		}
+		else if( 0 == std::strcmp( arg, "--scale" ) )
+		{
+			scale = uint_arg( argi+1 );
+			ret.postprocess = true;
+			argi += 2;
+		}
+		else if( 0 == std::strcmp( arg, "--pack" ) && argi+1 < aArgc )
+		{
+			char const* const mode = aArgv[argi+1];
+			if( 0 == std::strcmp( mode, "rgba8" ) ) pack = EPackMode::rgba8;
+			else if( 0 == std::strcmp( mode, "rgb565" ) ) pack = EPackMode::rgb565;
+			else if( 0 == std::strcmp( mode, "r8" ) ) pack = EPackMode::r8;
+			else throw lut::Error( "Unknown pixel packing '%s' (expected rgba8, rgb565 or r8)", mode );
+
+			ret.postprocess = true;
+			argi += 2;
+		}
+		else if( 0 == std::strcmp( arg, "--linear" ) )
+		{
+			linear = true;
+			ret.postprocess = true;
+			argi += 1;
+		}
+		else
+			throw usage();
+	}
+
+	if( !ret.tiled )
+	{
+		if( aArgc > argi ) ret.imageCount = uint_arg( argi );
+		argi += 1;
+	}
+
+	if( aArgc > argi ) ret.framesInFlight = uint_arg( argi );
+
+	if( 0 == ret.imageCount || 0 == ret.framesInFlight || (ret.tiled && (0 == ret.tiledWidth || 0 == ret.tiledHeight)) )
+		throw usage();
+	if( 0 == scale || 0 == cropW || 0 == cropH )
+		throw usage();
+
+	if( ret.tiled && ret.postprocess )
+		throw lut::Error( "Post-processing (--crop, --scale, --pack, --linear) is not supported with --tiled" );
+
+	if( cropX + cropW > cfg::kImageWidth || cropY + cropH > cfg::kImageHeight )
+	{
+		throw lut::Error( "Crop region %ux%u+%u+%u exceeds the %ux%u image",
+			cropW, cropH, cropX, cropY, cfg::kImageWidth, cfg::kImageHeight );
+	}
+
+	// None of the image formats store RGB565 pixels.
+	if( EPackMode::rgb565 == pack && lut::EImageFormat::raw != ret.format )
+	{
+		if( formatGiven )
+			std::fprintf( stderr, "Note: --pack rgb565 writes raw images (ignoring --format %s)\n", lut::image_format_name( ret.format ) );
+
+		ret.format = lut::EImageFormat::raw;
+	}
+
+	if( ret.postprocess )
+	{
+		std::uint32_t const dstW = std::max( 1u, cropW / scale );
+		std::uint32_t const dstH = std::max( 1u, cropH / scale );
+
+		std::uint32_t const pixelsPerWord = EPackMode::rgba8 == pack ? 1 : (EPackMode::rgb565 == pack ? 2 : 4);
+
+		ret.post.srcOffset[0] = std::int32_t(cropX);
+		ret.post.srcOffset[1] = std::int32_t(cropY);
+		ret.post.srcExtent[0] = std::int32_t(cropW);
+		ret.post.srcExtent[1] = std::int32_t(cropH);
+		ret.post.dstExtent[0] = std::int32_t(dstW);
+		ret.post.dstExtent[1] = std::int32_t(dstH);
+		ret.post.dstRowWords = (dstW + pixelsPerWord - 1) / pixelsPerWord;
+		ret.post.packMode = pack;
+		ret.post.encodeSRGB = linear ? 0 : 1;
+	}
+
+	return ret;
+}
+
+OutputLayout compute_output_layout( Options const& aOptions )
+{
+	if( !aOptions.postprocess )
+	{
+		return OutputLayout{
+			cfg::kImageWidth, cfg::kImageHeight, 4,
+			cfg::kImageWidth * 4,
+			cfg::kImageSize
+		};
+	}
+
+	auto const& post = aOptions.post;
+	std::uint32_t const channels = EPackMode::rgba8 == post.packMode ? 4 : (EPackMode::rgb565 == post.packMode ? 2 : 1);
+
+	// Rows are padded to whole 32-bit words
+	std::size_t const stride = std::size_t(post.dstRowWords) * 4;
+	return OutputLayout{
+		std::uint32_t(post.dstExtent[0]), std::uint32_t(post.dstExtent[1]), channels,
+		stride,
+		stride * std::uint32_t(post.dstExtent[1])
+	};
+}
+}
+
+namespace
+{
+TileTransform make_tile_transform( std::uint32_t aImageWidth, std::uint32_t aImageHeight, std::uint32_t aTileX, std::uint32_t aTileY )
+{
+	// Full-image NDC x maps to pixel (x+1)/2 * W. Relative to a tile at
+	// pixel tx with width tw, that is tile NDC x * W/tw + (W-2tx)/tw - 1.
+	float const tw = float(cfg::kImageWidth), th = float(cfg::kImageHeight);
+	float const w = float(aImageWidth), h = float(aImageHeight);
+
+	TileTransform ret{}; {
+		ret.scale[0] = w / tw;
+		ret.scale[1] = h / th;
+
+		ret.offset[0] = (w - 2.f * float(aTileX)) / tw - 1.f;
+		ret.offset[1] = (h - 2.f * float(aTileY)) / th - 1.f;
+	}
+	return ret;
+}
+
+StreamingPPM::StreamingPPM( char const* aPath, std::uint32_t aWidth, std::uint32_t aHeight )
+	: mWidth( aWidth )
+	, mHeight( aHeight )
+{
+	mFile = std::fopen( aPath, "wb" );
+	if( !mFile )
+		throw lut::Error( "Unable to open '%s' for writing", aPath );
+
+	int const headerSize = std::fprintf( mFile, "P6\n%u %u\n255\n", aWidth, aHeight );
+	if( headerSize < 0 )
+	{
+		std::fclose( mFile );
+		throw lut::Error( "Unable to write PPM header to '%s'", aPath );
+	}
+
+	mDataOffset = std::uint64_t(headerSize);
+}
+
+StreamingPPM::~StreamingPPM()
+{
+	if( mFile )
+		std::fclose( mFile );
+}
+
+void StreamingPPM::write_rgba( std::uint32_t aX, std::uint32_t aY, std::uint32_t aWidth, std::uint32_t aHeight, std::byte const* aPixels, std::size_t aStride )
+{
+	assert( aX + aWidth <= mWidth && aY + aHeight <= mHeight );
+
+	std::vector<std::byte> row( std::size_t(aWidth) * 3 );
+
+	for( std::uint32_t y = 0; y < aHeight; ++y )
+	{
+		auto const* src = aPixels + y * aStride;
+		for( std::uint32_t x = 0; x < aWidth; ++x )
+		{
+			row[x*3+0] = src[x*4+0];
+			row[x*3+1] = src[x*4+1];
+			row[x*3+2] = src[x*4+2];
+		}
+
+		std::uint64_t const offset = mDataOffset + ((std::uint64_t(aY) + y) * mWidth + aX) * 3;
+
+		std::lock_guard lock( mMutex );
+
+#		if defined(_WIN32)
+		int const seekRes = _fseeki64( mFile, std::int64_t(offset), SEEK_SET );
+#		else
+		int const seekRes = fseeko( mFile, off_t(offset), SEEK_SET );
+#		endif
+
+		if( 0 != seekRes || row.size() != std::fwrite( row.data(), 1, row.size(), mFile ) )
+			throw lut::Error( "Unable to write rows to PPM file (at offset %llu)", (unsigned long long)offset );
+	}
+}
+
+void EncodeQueue::push( FrameSlot& aSlot, Encoder aEncoder )
+{
+	{
+		std::lock_guard lock( mMutex );
+		aSlot.busy = true;
+		mJobs.emplace_back( Job{ &aSlot, std::move(aEncoder) } );
+	}
+
+	mJobCV.notify_one();
+}
+std::optional<EncodeQueue::Job> EncodeQueue::pop()
+{
+	std::unique_lock lock( mMutex );
+	mJobCV.wait( lock, [this] { return mClosed || !mJobs.empty(); } );
+
+	if( mJobs.empty() )
+		return {};
+
+	auto job = std::move(mJobs.front());
+	mJobs.pop_front();
+	return job;
+}
+
+void EncodeQueue::done( FrameSlot& aSlot )
+{
+	{
+		std::lock_guard lock( mMutex );
+		aSlot.busy = false;
+	}
+
+	mDoneCV.notify_all();
+}
+void EncodeQueue::wait_idle( FrameSlot const& aSlot )
+{
+	std::unique_lock lock( mMutex );
+	mDoneCV.wait( lock, [&] { return !aSlot.busy || mError; } );
+
+	if( mError )
+		std::rethrow_exception( mError );
+}
+
+void EncodeQueue::close()
+{
+	{
+		std::lock_guard lock( mMutex );
+		mClosed = true;
+	}
+
+	mJobCV.notify_all();
+}
+
+void EncodeQueue::set_error( std::exception_ptr aError )
+{
+	{
+		std::lock_guard lock( mMutex );
+		if( !mError )
+			mError = aError;
+	}
+
+	mDoneCV.notify_all();
+}
+void EncodeQueue::rethrow_error()
+{
+	std::lock_guard lock( mMutex );
+	if( mError )
+		std::rethrow_exception( mError );
+}
+
+void encode_worker( lut::VulkanContext const& aContext, EncodeQueue& aQueue )
+{
+	while( auto job = aQueue.pop() )
+	{
+		try
+		{
+			auto& slot = *job->slot;
+
+			// Wait for commands to finish executing
+			constexpr std::uint64_t kMaxWait = std::numeric_limits<std::uint64_t>::max();
+
+			if (auto const res = vkWaitForFences(aContext.device, 1, &slot.fence.handle, VK_TRUE, kMaxWait); res != VK_SUCCESS)
+			{
+				throw lut::Error("Waiting for Fence\n"
+					"vkWaitForFences() returned %s", lut::to_string(res).c_str());
+			}
+
+			if( !slot.coherent )
+			{
+				VkMappedMemoryRange range{}; {
+					range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+					range.memory = slot.download.memory;
+					range.offset = 0;
+					range.size = VK_WHOLE_SIZE;
+				}
+
+				if (auto const res = vkInvalidateMappedMemoryRanges(aContext.device, 1, &range); res != VK_SUCCESS)
+				{
+					throw lut::Error("Invalidating Mapped Memory\n"
+						"vkInvalidateMappedMemoryRanges() returned %s", lut::to_string(res).c_str());
+				}
+			}
+
+			// Access image and write it to disk.
+			job->encode( slot );
+
+			aQueue.done( slot );
+		}
+		catch( ... )
+		{
+			aQueue.set_error( std::current_exception() );
+			aQueue.done( *job->slot );
+		}
+	}
+}
 }
 
 //EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab: 
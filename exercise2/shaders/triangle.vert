@@ -2,6 +2,15 @@
 
 layout(location = 0) out vec3 vertexColour;
 
+// Maps the full image's normalized device coordinates to the tile that is
+// currently being rendered. Identity (scale 1, offset 0) for untiled
+// rendering.
+layout(push_constant) uniform TileTransform
+{
+    vec2 scale;
+    vec2 offset;
+} uTile;
+
 const vec2 kVertexPositions[6] = vec2[6](
     vec2( 0.0f, -0.8f),
     vec2(-0.7f,  0.8f),
@@ -23,7 +32,7 @@ const vec3 kVertexColours[6] = vec3[6](
 void main()
 {
     const vec2 xy = kVertexPositions[gl_VertexIndex];
-    gl_Position = vec4(xy, 0.5f, 1.0f);
+    gl_Position = vec4(xy * uTile.scale + uTile.offset, 0.5f, 1.0f);
 
     vertexColour = kVertexColours[gl_VertexIndex];
 }
@@ -19,6 +19,7 @@
 #include "../labutils/vkobject.hpp"
 #include "../labutils/to_string.hpp"
 #include "../labutils/vulkan_window.hpp"
+#include "../labutils/redraw_scheduler.hpp"
 namespace lut = labutils;
 
 namespace
@@ -48,10 +49,21 @@ namespace
 		std::vector<lut::Framebuffer>&
 	);
 
+	// Where a frame is rendered to. With dynamic rendering, `renderPass` and
+	// `framebuffer` are VK_NULL_HANDLE, and the swap chain image view is used
+	// directly.
+	struct RenderTarget
+	{
+		VkRenderPass renderPass;
+		VkFramebuffer framebuffer;
+
+		VkImage image;
+		VkImageView view;
+	};
+
 	void record_commands( 
 		VkCommandBuffer,
-		VkRenderPass,
-		VkFramebuffer,
+		RenderTarget const&,
 		VkPipeline,
 		VkExtent2D const&
 	);
@@ -69,17 +81,25 @@ int main() try
 	// Create our Vulkan Window
 	lut::VulkanWindow window = lut::make_vulkan_window();
 
-	// Configure the GLFW window
-	glfwSetKeyCallback( window.window, &glfw_callback_key_press );
+	// Configure the GLFW window (there is none in headless mode)
+	if( window.window )
+		glfwSetKeyCallback( window.window, &glfw_callback_key_press );
 
 	// Intialize resources
-	lut::RenderPass renderPass = create_render_pass( window );
+	// With dynamic rendering, there is no render pass (and no framebuffers);
+	// the pipeline instead declares the format of its color attachment.
+	bool const dynamicRendering = window.haveDynamicRendering;
+
+	lut::RenderPass renderPass;
+	if( !dynamicRendering )
+		renderPass = create_render_pass( window );
 
 	lut::PipelineLayout pipeLayout = create_triangle_pipeline_layout( window );
 	lut::Pipeline pipe = create_triangle_pipeline( window, renderPass.handle, pipeLayout.handle );
 
 	std::vector<lut::Framebuffer> framebuffers;
-	create_swapchain_framebuffers( window, renderPass.handle, framebuffers );
+	if( !dynamicRendering )
+		create_swapchain_framebuffers( window, renderPass.handle, framebuffers );
 
 
 	lut::CommandPool cpool = lut::create_command_pool( window, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT );
@@ -87,7 +107,7 @@ int main() try
 	std::vector<VkCommandBuffer> cbuffers;
 	std::vector<lut::Fence> cbfences;
 	
-	for( std::size_t i = 0; i < framebuffers.size(); ++i )
+	for( std::size_t i = 0; i < window.swapImages.size(); ++i )
 	{
 		cbuffers.emplace_back( lut::alloc_command_buffer( window, cpool.handle ) );
 		cbfences.emplace_back( lut::create_fence( window, VK_FENCE_CREATE_SIGNALED_BIT ) );
@@ -99,7 +119,9 @@ int main() try
 	// Application main loop
 	bool recreateSwapchain = false;
 
-	while( !glfwWindowShouldClose( window.window ) )
+	lut::RedrawScheduler redraw( window );
+
+	while( !lut::window_should_close( window ) )
 	{
 		// Let GLFW process events.
 		// glfwPollEvents() checks for events, processes them. If there are no
@@ -109,7 +131,10 @@ int main() try
 		// render as fast as possible, whereas the latter is useful for
 		// input-driven applications, where redrawing is only needed in
 		// reaction to user input (or similar).
-		glfwPollEvents(); // or: glfwWaitEvents()
+		// The RedrawScheduler does the former by default, and the latter
+		// (with a timeout) in on-demand mode, see LABUTILS_ON_DEMAND.
+		if( !redraw.wait_for_frame() && !recreateSwapchain )
+			continue;
 
 		// Recreate swap chain?
 		if( recreateSwapchain )
@@ -118,16 +143,28 @@ int main() try
 
 			auto const changes = lut::recreate_swapchain(window);
 
-			if (changes.changedFormat)
-				renderPass = create_render_pass(window);
-
-			framebuffers.clear();
-			create_swapchain_framebuffers(window, renderPass.handle, framebuffers);
-
-			if (changes.changedSize)
-				pipe = create_triangle_pipeline(window, renderPass.handle, pipeLayout.handle);
+			if (dynamicRendering)
+			{
+				// The pipeline bakes in the viewport and the color format
+				if (changes.changedSize || changes.changedFormat)
+					pipe = create_triangle_pipeline(window, VK_NULL_HANDLE, pipeLayout.handle);
+			}
+			else
+			{
+				if (changes.changedFormat)
+					renderPass = create_render_pass(window);
+
+				framebuffers.clear();
+				create_swapchain_framebuffers(window, renderPass.handle, framebuffers);
+
+				if (changes.changedSize)
+					pipe = create_triangle_pipeline(window, renderPass.handle, pipeLayout.handle);
+			}
 			
 			recreateSwapchain = false;
+
+			// The new swap chain images have no contents yet
+			redraw.invalidate();
 			continue;
 		}
 
@@ -167,12 +204,18 @@ int main() try
 		}
 		
 		assert(std::size_t(imageIndex) < cbuffers.size());
-		assert(std::size_t(imageIndex) < framebuffers.size());
+		assert(dynamicRendering || std::size_t(imageIndex) < framebuffers.size());
+
+		RenderTarget const target{
+			renderPass.handle,
+			dynamicRendering ? VK_NULL_HANDLE : framebuffers[imageIndex].handle,
+			window.swapImages[imageIndex],
+			window.swapViews[imageIndex]
+		};
 
 		record_commands(
 			cbuffers[imageIndex],
-			renderPass.handle,
-			framebuffers[imageIndex].handle,
+			target,
 			pipe.handle,
 			window.swapchainExtent
 		);
@@ -198,6 +241,8 @@ int main() try
 		}
 
 		auto const presentRes = vkQueuePresentKHR(window.presentQueue, &presentInfo);
+		redraw.frame_rendered();
+
 		if (presentRes == VK_SUBOPTIMAL_KHR || presentRes == VK_ERROR_OUT_OF_DATE_KHR)
 		{
 			recreateSwapchain = true;
@@ -213,6 +258,8 @@ int main() try
 	// to ensure that all Vulkan commands have finished before that.
 	vkDeviceWaitIdle( window.device );
 
+	lut::print_redraw_counters( redraw );
+
 	return 0;
 }
 catch( std::exception const& eErr )
@@ -405,6 +452,18 @@ lut::Pipeline create_triangle_pipeline( lut::VulkanWindow const& aWindow, VkRend
 		graphicsPipelineInfo.renderPass = aRenderPass;
 		graphicsPipelineInfo.subpass = 0;
 	}
+
+	// Without a render pass (dynamic rendering), the attachment formats are
+	// specified directly.
+	VkPipelineRenderingCreateInfo renderingInfo{}; {
+		renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+
+		renderingInfo.colorAttachmentCount = 1;
+		renderingInfo.pColorAttachmentFormats = &aWindow.swapchainFormat;
+	}
+
+	if (VK_NULL_HANDLE == aRenderPass)
+		graphicsPipelineInfo.pNext = &renderingInfo;
 	
 	VkPipeline graphicsPipeline = VK_NULL_HANDLE;
 	if (auto const res = vkCreateGraphicsPipelines(aWindow.device, VK_NULL_HANDLE, 1, &graphicsPipelineInfo, nullptr, &graphicsPipeline); res != VK_SUCCESS)
@@ -453,7 +512,7 @@ void create_swapchain_framebuffers( lut::VulkanWindow const& aWindow, VkRenderPa
 	assert( aWindow.swapViews.size() == aFramebuffers.size() );
 }
 
-void record_commands( VkCommandBuffer aCmdBuff, VkRenderPass aRenderPass, VkFramebuffer aFramebuffer, VkPipeline aGraphicsPipe, VkExtent2D const& aImageExtent )
+void record_commands( VkCommandBuffer aCmdBuff, RenderTarget const& aTarget, VkPipeline aGraphicsPipe, VkExtent2D const& aImageExtent )
 {
 	// Begin Recording Commands
 	VkCommandBufferBeginInfo commandBufferBeginInfo{}; {
@@ -476,21 +535,59 @@ void record_commands( VkCommandBuffer aCmdBuff, VkRenderPass aRenderPass, VkFram
 		clearValues[0].color.float32[2] = 0.1f;
 		clearValues[0].color.float32[3] = 1.0f;
 	}
-	
-	VkRenderPassBeginInfo renderPassInfo{}; {
-		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
 
-		renderPassInfo.renderPass = aRenderPass;
-		renderPassInfo.framebuffer = aFramebuffer;
+	if (VK_NULL_HANDLE == aTarget.renderPass)
+	{
+		// Dynamic rendering: there is no render pass to perform the layout
+		// transitions, so do these explicitly.
+		lut::image_barrier(
+			aCmdBuff, aTarget.image,
+			0, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+			VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
+		);
+
+		VkRenderingAttachmentInfo colorAttachment{}; {
+			colorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+
+			colorAttachment.imageView = aTarget.view;
+			colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
-		renderPassInfo.renderArea.offset = VkOffset2D{0, 0};
-		renderPassInfo.renderArea.extent = aImageExtent;
+			colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+			colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+			colorAttachment.clearValue = clearValues[0];
+		}
+
+		VkRenderingInfo renderingInfo{}; {
+			renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+
+			renderingInfo.renderArea.offset = VkOffset2D{0, 0};
+			renderingInfo.renderArea.extent = aImageExtent;
+			renderingInfo.layerCount = 1;
+
+			renderingInfo.colorAttachmentCount = 1;
+			renderingInfo.pColorAttachments = &colorAttachment;
+		}
 
-		renderPassInfo.clearValueCount = 1;
-		renderPassInfo.pClearValues = clearValues;
+		vkCmdBeginRendering(aCmdBuff, &renderingInfo);
 	}
+	else
+	{
+		VkRenderPassBeginInfo renderPassInfo{}; {
+			renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+
+			renderPassInfo.renderPass = aTarget.renderPass;
+			renderPassInfo.framebuffer = aTarget.framebuffer;
+
+			renderPassInfo.renderArea.offset = VkOffset2D{0, 0};
+			renderPassInfo.renderArea.extent = aImageExtent;
+
+			renderPassInfo.clearValueCount = 1;
+			renderPassInfo.pClearValues = clearValues;
+		}
 
-	vkCmdBeginRenderPass(aCmdBuff, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+		vkCmdBeginRenderPass(aCmdBuff, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+	}
 
 	// Begin Drawing with our Graphics Pipeline
 	vkCmdBindPipeline(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aGraphicsPipe);
@@ -501,7 +598,19 @@ void record_commands( VkCommandBuffer aCmdBuff, VkRenderPass aRenderPass, VkFram
 	vkCmdDraw(aCmdBuff, 6, 2, 0, 0);
 
 	// End the Render Pass
-	vkCmdEndRenderPass(aCmdBuff);
+	if (VK_NULL_HANDLE == aTarget.renderPass)
+	{
+		vkCmdEndRendering(aCmdBuff);
+
+		lut::image_barrier(
+			aCmdBuff, aTarget.image,
+			VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, 0,
+			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT
+		);
+	}
+	else
+		vkCmdEndRenderPass(aCmdBuff);
 
 	// End Command Recording
 	if (auto const res = vkEndCommandBuffer(aCmdBuff); res != VK_SUCCESS)
@@ -1,10 +1,14 @@
 #include <volk/volk.h>
 
 #include <tuple>
+#include <atomic>
+#include <algorithm>
 #include <limits>
+#include <thread>
 #include <vector>
 #include <stdexcept>
 #include <chrono>
+#include <exception>
 
 #include <cstdio>
 #include <cassert>
@@ -23,9 +27,11 @@
 #include <glm/glm.hpp>
 #include <glm/gtx/transform.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
 
 #include "../labutils/to_string.hpp"
 #include "../labutils/vulkan_window.hpp"
+#include "../labutils/redraw_scheduler.hpp"
 
 #include "../labutils/angle.hpp"
 using namespace labutils::literals;
@@ -36,9 +42,16 @@ using namespace labutils::literals;
 #include "../labutils/vkobject.hpp"
 #include "../labutils/vkbuffer.hpp"
 #include "../labutils/allocator.hpp" 
+#include "../labutils/object_cache.hpp"
+#include "../labutils/transient_attachments.hpp"
+#include "../labutils/triple_buffer.hpp"
+#include "../labutils/spsc_queue.hpp"
+#include "../labutils/job_system.hpp"
+#include "../labutils/texture_streamer.hpp"
+#include "../labutils/residency_manager.hpp"
 namespace lut = labutils;
 
-#include "vertex_data.hpp"
+#include "renderer.hpp"
 
 namespace
 {
@@ -47,45 +60,25 @@ using Secondsf_ = std::chrono::duration<float, std::ratio<1>>;
 
 	namespace cfg
 	{
-		// Compiled shader code for the graphics pipeline
-		// See sources in exercise4/shaders/*. 
-#		define ASSETDIR_ "assets/exercise4/"
-		constexpr char const* kFloorTexture = ASSETDIR_ "asphalt.png";
-		constexpr char const* kSpriteTexture = ASSETDIR_ "explosion.png";
-
-#		define SHADERDIR_ ASSETDIR_ "shaders/"
-		constexpr char const* kVertShaderPath = SHADERDIR_ "shaderTex.vert.spv";
-		constexpr char const* kFragShaderPath = SHADERDIR_ "shaderTex.frag.spv";
-
-		constexpr char const* kAlphaFragShaderPath = SHADERDIR_ "shaderTexAlpha.frag.spv";
-#		undef SHADERDIR_
-#		undef ASSETDIR_
-
-
-
-		// General rule: with a standard 24 bit or 32 bit float depth buffer,
-		// you can support a 1:1000 ratio between the near and far plane with
-		// minimal depth fighting. Larger ratios will introduce more depth
-		// fighting problems; smaller ratios will increase the depth buffer's
-		// resolution but will also limit the view distance.
-		constexpr float kCameraNear  = 0.1f;
-		constexpr float kCameraFar   = 100.f;
-
-		constexpr auto kCameraFov    = 60.0_degf;
-
-		constexpr VkFormat kDepthFormat = VK_FORMAT_D32_SFLOAT;
-
 		constexpr float kCameraBaseSpeed = 1.7f;
 		constexpr float kCameraFastMult = 5.0f;
 		constexpr float kCameraSlowMult = 0.05f;
 
 		constexpr float kCameraMouseSensitivity = 0.01f;
+
+		// The simulation runs on its own thread at a fixed rate, independent
+		// of the frame rate. If it falls more than kSimulationMaxLag steps
+		// behind, it skips ahead instead of trying to catch up.
+		constexpr auto kSimulationStep = std::chrono::microseconds(1000000 / 120);
+		constexpr std::uint32_t kSimulationMaxLag = 8;
 	}
 
 	// GLFW callbacks
 	void glfw_callback_key_press( GLFWwindow*, int, int, int, int );
 	void glfw_callback_button(GLFWwindow*, int, int, int);
 	void glfw_callback_motion(GLFWwindow*, double, double);
+	void glfw_callback_framebuffer_size( GLFWwindow*, int, int );
+	void glfw_callback_iconify( GLFWwindow*, int );
 
 	enum class EInputState
 	{
@@ -118,34 +111,128 @@ using Secondsf_ = std::chrono::duration<float, std::ratio<1>>;
 
 	void update_user_state(UserState&, float aElapsedTime);
 
-	// Uniform data
-	namespace glsl
+	// Window events. GLFW delivers them on the main thread; the callbacks
+	// forward them to the render thread, which applies them to its
+	// UserState. Events carry the time at which the main thread received
+	// them, for measuring input latency.
+	enum class EInputEvent
 	{
-	struct SceneUniform
+		key,    // code = GLFW key, action = GLFW action
+		button, // code = GLFW mouse button, action = GLFW action
+		motion, // x, y = cursor position
+		resize  // x, y = framebuffer size
+	};
+
+	struct InputEvent
 	{
-		glm::mat4 camera;
-		glm::mat4 projection;
-		glm::mat4 projCam;
+		EInputEvent type;
+		int code;
+		int action;
+		double x, y;
+		Clock_::time_point time;
 	};
 
-	static_assert(sizeof(SceneUniform) <= 65536,
-		"SceneUniform must be Less than 65536 Bytes for vkCmdUpdateBuffer()");
-	static_assert(sizeof(SceneUniform) % 4 == 0,
-		"SceneUniform Size must be a Multiple of 4 Bytes");
-	}
+	using InputQueue = lut::SpscQueue<InputEvent, 4096>;
 
-	// Helpers:
-	lut::RenderPass create_render_pass( lut::VulkanWindow const& );
+	// GLFW window user pointer. Main thread only, except for the queue's
+	// consumer side.
+	struct EventForwarder
+	{
+		InputQueue queue;
+		lut::RedrawScheduler* redraw = nullptr;
+
+		bool mousing = false;
+		std::uint64_t dropped = 0; // events lost to a full queue
+	};
 
-	lut::DescriptorSetLayout create_scene_descriptor_layout( lut::VulkanWindow const& );
-	lut::DescriptorSetLayout create_object_descriptor_layout( lut::VulkanWindow const& );
+	void forward_event( EventForwarder&, InputEvent const& );
+	void apply_input_event( UserState&, InputEvent const& );
 
-	lut::PipelineLayout create_pipeline_layout( lut::VulkanContext const&, VkDescriptorSetLayout, VkDescriptorSetLayout );
-	lut::Pipeline create_pipeline( lut::VulkanWindow const&, VkRenderPass, VkPipelineLayout );
-	lut::Pipeline create_alpha_pipeline(lut::VulkanWindow const&, VkRenderPass, VkPipelineLayout);
+	// Simulation thread. Each tick consumes the latest input published by
+	// the render thread, advances the UserState by a fixed step and publishes
+	// a snapshot of the result. Both directions go through lock-free triple
+	// buffers, so neither thread ever waits for the other.
+	struct InputSnapshot
+	{
+		bool inputMap[std::size_t(EInputState::max)];
+
+		float mouseX;
+		float mouseY;
+
+		// Receive time of the oldest input event whose effect has not been
+		// presented yet; default-constructed if there is none.
+		Clock_::time_point time;
+	};
 
-	std::tuple<lut::Image, lut::ImageView> create_depth_buffer( lut::VulkanWindow const&, lut::Allocator const& );
+	struct SimSnapshot
+	{
+		std::uint64_t tick;
+		Clock_::time_point time; // when the tick was published
+
+		// InputSnapshot::time of the most recent input the simulation
+		// consumed
+		Clock_::time_point inputTime;
+
+		// State before and after the tick; rendering interpolates between
+		// the two.
+		glm::mat4 previousCamera2world;
+		glm::mat4 camera2world;
+	};
+
+	class SimulationThread
+	{
+		public:
+			// The simulation invalidates the scheduler whenever the camera
+			// moves.
+			SimulationThread( UserState const&, lut::RedrawScheduler& );
+			~SimulationThread();
 
+			SimulationThread( SimulationThread const& ) = delete;
+			SimulationThread& operator= (SimulationThread const&) = delete;
+
+			// Render thread only.
+			void submit_input( UserState const&, Clock_::time_point aInputTime );
+			SimSnapshot const& latest();
+
+		private:
+			void run_();
+
+		private:
+			UserState mState; // simulation thread only
+			lut::RedrawScheduler& mRedraw;
+
+			lut::TripleBuffer<InputSnapshot> mInput;
+			lut::TripleBuffer<SimSnapshot> mOutput;
+
+			std::atomic<bool> mStop{ false };
+			std::thread mThread;
+	};
+
+	glm::mat4 interpolate_camera( SimSnapshot const&, Clock_::time_point aNow );
+
+	// End-to-end input latency: from the main thread receiving an input
+	// event to the present of the first frame that reflects it.
+	struct LatencyStats
+	{
+		std::uint64_t count = 0;
+		double totalMs = 0.0;
+		double maxMs = 0.0;
+	};
+
+	void add_latency_sample( LatencyStats&, Clock_::duration );
+	void print_latency_stats( LatencyStats const& );
+
+	// Creates all resources and runs the frame loop until the window should
+	// close or aQuit is set. Does not call GLFW, so it may run on a thread
+	// other than the main thread.
+	void run_renderer(
+		lut::VulkanWindow&,
+		lut::RedrawScheduler&,
+		EventForwarder&,
+		std::atomic<bool> const& aQuit
+	);
+
+	// Helpers:
 	void create_swapchain_framebuffers( 
 		lut::VulkanWindow const&, 
 		VkRenderPass,
@@ -153,33 +240,6 @@ using Secondsf_ = std::chrono::duration<float, std::ratio<1>>;
 		VkImageView aDepthView
 	);
 
-	void update_scene_uniforms(
-		glsl::SceneUniform&,
-		std::uint32_t aFramebufferWidth,
-		std::uint32_t aFramebufferHeight,
-		UserState const&
-	);
-
-	void record_commands( 
-		VkCommandBuffer,
-		VkRenderPass,
-		VkFramebuffer,
-		VkPipeline,
-		VkExtent2D const&,
-		VkBuffer aPositionBuffer,
-		VkBuffer aTextureCoordBuffer,
-		std::uint32_t aVertexCount,
-		VkBuffer aSceneUBO,
-		glsl::SceneUniform const& aSceneUniform,
-		VkPipelineLayout aGraphicsLayout,
-		VkDescriptorSet aSceneDescriptors,
-		VkDescriptorSet aObjectDescriptors,
-		VkBuffer aSpritePositionBuffer,
-		VkBuffer aSpriteTextureBuffer,
-		std::uint32_t aSpriteVertexCount,
-		VkDescriptorSet aSpriteObjDescriptors,
-		VkPipeline aAlphaPipeline
-	);
 	void submit_commands(
 		lut::VulkanWindow const&,
 		VkCommandBuffer,
@@ -202,189 +262,244 @@ int main() try
 	// Create Vulkan Window
 	auto window = lut::make_vulkan_window();
 
-	UserState userState{};
-	glfwSetWindowUserPointer(window.window, &userState);
-
-	// Configure the GLFW window
-	glfwSetKeyCallback( window.window, &glfw_callback_key_press );
-	glfwSetMouseButtonCallback(window.window, &glfw_callback_button);
-	glfwSetCursorPosCallback(window.window, &glfw_callback_motion);
+	// The frame loop runs on a separate render thread, and the main thread
+	// only processes window events (which GLFW requires to happen on the
+	// main thread). Moving or resizing the window blocks the event loop on
+	// some platforms; this no longer stalls rendering.
+	lut::RedrawScheduler redraw( window, lut::ERedrawEvents::external );
 
-	// Create VMA allocator
-	lut::Allocator allocator = lut::create_allocator( window );
+	EventForwarder events;
+	events.redraw = &redraw;
 
-	// Intialize resources
-	lut::RenderPass renderPass = create_render_pass( window );
+	// Configure the GLFW window (there is none in headless mode)
+	if( window.window )
+	{
+		glfwSetWindowUserPointer(window.window, &events);
 
-	lut::DescriptorSetLayout sceneLayout = create_scene_descriptor_layout(window);
-	lut::DescriptorSetLayout objectLayout = create_object_descriptor_layout(window);
+		glfwSetKeyCallback( window.window, &glfw_callback_key_press );
+		glfwSetMouseButtonCallback(window.window, &glfw_callback_button);
+		glfwSetCursorPosCallback(window.window, &glfw_callback_motion);
+		glfwSetFramebufferSizeCallback( window.window, &glfw_callback_framebuffer_size );
+		glfwSetWindowIconifyCallback( window.window, &glfw_callback_iconify );
+	}
 
-	lut::PipelineLayout pipeLayout = create_pipeline_layout( window, sceneLayout.handle, objectLayout.handle );
-	lut::Pipeline pipe = create_pipeline( window, renderPass.handle, pipeLayout.handle );
-	lut::Pipeline alphaPipeline = create_alpha_pipeline(window, renderPass.handle, pipeLayout.handle);
+	std::atomic<bool> quit{ false };
+	std::atomic<bool> renderDone{ false };
+	std::exception_ptr renderError;
 
-	auto [depthBuffer, depthBufferView] = create_depth_buffer(window, allocator);
+	std::thread renderThread( [&] {
+		try
+		{
+			run_renderer( window, redraw, events, quit );
+		}
+		catch( ... )
+		{
+			renderError = std::current_exception();
+		}
 
-	std::vector<lut::Framebuffer> framebuffers;
-	create_swapchain_framebuffers( window, renderPass.handle, framebuffers, depthBufferView.handle );
+		renderDone.store( true );
 
-	lut::CommandPool cpool = lut::create_command_pool( window, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT );
+		// Wake up the main thread if it is waiting for events
+		if( window.window )
+			glfwPostEmptyEvent();
+	} );
 
-	std::vector<VkCommandBuffer> cbuffers;
-	std::vector<lut::Fence> cbfences;
-	
-	for( std::size_t i = 0; i < framebuffers.size(); ++i )
+	if( window.window )
 	{
-		cbuffers.emplace_back( lut::alloc_command_buffer( window, cpool.handle ) );
-		cbfences.emplace_back( lut::create_fence( window, VK_FENCE_CREATE_SIGNALED_BIT ) );
+		while( !renderDone.load() && !glfwWindowShouldClose( window.window ) )
+			glfwWaitEvents();
+
+		quit.store( true );
+		redraw.invalidate(); // in case the render thread is sleeping
 	}
 
-	lut::Semaphore imageAvailable = lut::create_semaphore( window );
-	lut::Semaphore renderFinished = lut::create_semaphore( window );
+	renderThread.join();
 
-	// Load data
-	TexturedMesh planeMesh = create_plane_mesh( window, allocator );
-	TexturedMesh spriteMesh = create_sprite_mesh(window, allocator);
-
-	lut::Buffer sceneUBO = lut::create_buffer(
-		allocator,
-		sizeof(glsl::SceneUniform),
-		VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-		VMA_MEMORY_USAGE_GPU_ONLY
-	);
+	if( renderError )
+		std::rethrow_exception( renderError );
 
-	lut::DescriptorPool descriptorPool = lut::create_descriptor_pool(window);
+	if( events.dropped )
+		std::printf( "Input events dropped: %llu\n", static_cast<unsigned long long>(events.dropped) );
 
-	VkDescriptorSet sceneDescriptors = lut::alloc_desc_set(window, descriptorPool.handle, sceneLayout.handle);
-	{
-		VkDescriptorBufferInfo sceneUBOInfo{}; {
-			sceneUBOInfo.buffer = sceneUBO.buffer;
-			sceneUBOInfo.range = VK_WHOLE_SIZE;
-		}
-
-		VkWriteDescriptorSet writeDescriptorSets[1]{}; {
-			writeDescriptorSets[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	return 0;
+}
+catch( std::exception const& eErr )
+{
+	std::fprintf( stderr, "\n" );
+	std::fprintf( stderr, "Error: %s\n", eErr.what() );
+	return 1;
+}
 
-			writeDescriptorSets[0].dstSet = sceneDescriptors;
-			writeDescriptorSets[0].dstBinding = 0;
+namespace
+{
+void run_renderer( lut::VulkanWindow& aWindow, lut::RedrawScheduler& aRedraw, EventForwarder& aEvents, std::atomic<bool> const& aQuit )
+{
+	// Create VMA allocator
+	lut::Allocator allocator = lut::create_allocator( aWindow );
 
-			writeDescriptorSets[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-			writeDescriptorSets[0].descriptorCount = 1;
-			writeDescriptorSets[0].pBufferInfo = &sceneUBOInfo;
-		}
+	// Worker threads for loading. The render thread participates while it
+	// waits for jobs.
+	lut::JobSystem jobs;
 
-		constexpr auto numDescriptorSets = sizeof(writeDescriptorSets) / sizeof(writeDescriptorSets[0]);
-		vkUpdateDescriptorSets(window.device, numDescriptorSets, writeDescriptorSets, 0, nullptr);
-	}
+	auto const startTime = Clock_::now();
+	bool firstFrame = true;
 
-	lut::Image floorTexture;
-	lut::Image spriteTexture;
-	{
-		lut::CommandPool loadCmdPool = lut::create_command_pool(window, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+	// Intialize resources
+	// With dynamic rendering, there is no render pass and there are no
+	// framebuffers. Pipelines instead declare their attachment formats.
+	bool const dynamicRendering = aWindow.haveDynamicRendering;
 
-		floorTexture = lut::load_image_texture2d(cfg::kFloorTexture, window, loadCmdPool.handle, allocator);
-		spriteTexture = lut::load_image_texture2d(cfg::kSpriteTexture, window, loadCmdPool.handle, allocator);
-	}
-	lut::ImageView floorView = lut::create_image_view_texture2d(window, floorTexture.image, VK_FORMAT_R8G8B8A8_SRGB);
-	lut::ImageView spriteView = lut::create_image_view_texture2d(window, spriteTexture.image, VK_FORMAT_R8G8B8A8_SRGB);
+	lut::RenderPass renderPass;
+	if( !dynamicRendering )
+		renderPass = create_render_pass( aWindow, aWindow.swapchainFormat, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR );
 
-	lut::Sampler defaultSampler = lut::create_default_sampler(window);
-	
-	VkDescriptorSet floorDescriptors = lut::alloc_desc_set(window, descriptorPool.handle, objectLayout.handle);
-	{
-		VkDescriptorImageInfo textureInfo{}; {
-			textureInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-			textureInfo.imageView = floorView.handle;
+	// Samplers are interned; objects with the same state share a single
+	// Vulkan handle.
+	lut::SamplerCache samplerCache(aWindow);
+	VkSampler const defaultSampler = samplerCache.acquire_default();
 
-			textureInfo.sampler = defaultSampler.handle;
-		}
+	// Textures are decoded in the background and streamed in over the
+	// first frames, smallest mip levels first. Until then, objects show a
+	// placeholder colour. If fragment shaders can write to storage
+	// buffers, they report the mip levels they need, and only those are
+	// kept resident. The streamer owns the per-object descriptor sets.
+	bool const textureFeedback = supports_texture_feedback( aWindow );
 
-		VkWriteDescriptorSet descriptorSets[1]{}; {
-			descriptorSets[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	std::fprintf( stderr, "Texture feedback: %s\n", textureFeedback ? "enabled" : "disabled" );
 
-			descriptorSets[0].dstSet = floorDescriptors;
-			descriptorSets[0].dstBinding = 0;
+	// Under memory pressure, least recently drawn textures are demoted to
+	// coarser mip levels (see LABUTILS_MEMORY_BUDGET_MB)
+	lut::ResidencyManager residency( allocator );
 
-			descriptorSets[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-			descriptorSets[0].descriptorCount = 1;
+	std::uint32_t const frameSlots = std::uint32_t(aWindow.swapImages.size());
+	lut::TextureStreamer textures( aWindow, allocator, jobs, defaultSampler, frameSlots, textureFeedback, &residency );
 
-			descriptorSets[0].pImageInfo = &textureInfo;
-		}
+	lut::DescriptorSetLayout sceneLayout = create_scene_descriptor_layout(aWindow);
 
-		constexpr auto numSets = sizeof(descriptorSets) / sizeof(descriptorSets[0]);
-		vkUpdateDescriptorSets(window.device, numSets, descriptorSets, 0, nullptr);
-	}
-	VkDescriptorSet spriteDescriptors = lut::alloc_desc_set(window, descriptorPool.handle, objectLayout.handle);
-	{
-		VkDescriptorImageInfo textureInfo{}; {
-			textureInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-			textureInfo.imageView = spriteView.handle;
+	// With buffer device addresses, vertex shaders read the vertex data
+	// themselves. Meshes of any layout then share a pipeline, and draws
+	// don't bind vertex buffers.
+	bool const vertexPulling = aWindow.haveBufferDeviceAddress;
 
-			textureInfo.sampler = defaultSampler.handle;
-		}
+	std::fprintf( stderr, "Vertex pulling: %s\n", vertexPulling ? "enabled" : "disabled" );
 
-		VkWriteDescriptorSet descriptorSets[1]{}; {
-			descriptorSets[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	lut::PipelineLayout pipeLayout = create_pipeline_layout( aWindow, sceneLayout.handle, textures.descriptor_layout() );
+	lut::Pipeline pipe = create_pipeline( aWindow, aWindow.swapchainExtent, aWindow.swapchainFormat, renderPass.handle, pipeLayout.handle, textureFeedback, vertexPulling );
+	lut::Pipeline alphaPipeline = create_alpha_pipeline( aWindow, aWindow.swapchainExtent, aWindow.swapchainFormat, renderPass.handle, pipeLayout.handle, textureFeedback, vertexPulling );
 
-			descriptorSets[0].dstSet = spriteDescriptors;
-			descriptorSets[0].dstBinding = 0;
+	lut::TransientAttachments depthBuffer = create_depth_buffer( aWindow, allocator, aWindow.swapchainExtent );
 
-			descriptorSets[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-			descriptorSets[0].descriptorCount = 1;
+	std::vector<lut::Framebuffer> framebuffers;
+	if( !dynamicRendering )
+		create_swapchain_framebuffers( aWindow, renderPass.handle, framebuffers, depthBuffer.views[0].handle );
 
-			descriptorSets[0].pImageInfo = &textureInfo;
-		}
+	lut::CommandPool cpool = lut::create_command_pool( aWindow, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT );
 
-		constexpr auto numSets = sizeof(descriptorSets) / sizeof(descriptorSets[0]);
-		vkUpdateDescriptorSets(window.device, numSets, descriptorSets, 0, nullptr);
-	}
+	std::vector<VkCommandBuffer> cbuffers;
+	std::vector<lut::Fence> cbfences;
 	
+	for( std::size_t i = 0; i < aWindow.swapImages.size(); ++i )
+	{
+		cbuffers.emplace_back( lut::alloc_command_buffer( aWindow, cpool.handle ) );
+		cbfences.emplace_back( lut::create_fence( aWindow, VK_FENCE_CREATE_SIGNALED_BIT ) );
+	}
+
+	lut::Semaphore imageAvailable = lut::create_semaphore( aWindow );
+	lut::Semaphore renderFinished = lut::create_semaphore( aWindow );
+
+	// Load data
+	Scene scene = create_scene( aWindow, allocator, textures, sceneLayout.handle, frameSlots );
+
 	// Application main loop
 	bool recreateSwapchain = false;
+	VkExtent2D framebufferExtent = aWindow.swapchainExtent;
 
-	auto previousClock = Clock_::now();
-	while( !glfwWindowShouldClose( window.window ) )
+	UserState userState{};
+	SimulationThread simulation( userState, aRedraw );
+
+	// Oldest input event that has not been presented yet
+	bool inputPending = false;
+	Clock_::time_point inputTime{};
+	Clock_::time_point lastMeasuredInput{};
+
+	LatencyStats latency;
+
+	while( !aQuit.load( std::memory_order_relaxed ) && !lut::window_should_close( aWindow ) )
 	{
-		// Let GLFW process events.
-		// glfwPollEvents() checks for events, processes them. If there are no
-		// events, it will return immediately. Alternatively, glfwWaitEvents()
-		// will wait for any event to occur, process it, and only return at
-		// that point. The former is useful for applications where you want to
-		// render as fast as possible, whereas the latter is useful for
-		// input-driven applications, where redrawing is only needed in
-		// reaction to user input (or similar).
-		glfwPollEvents();
+		// Window events are processed by the main thread. The scheduler
+		// renders continuously by default, and only when invalidated in
+		// on-demand mode (see LABUTILS_ON_DEMAND); the event callbacks
+		// invalidate it as needed.
+		bool const needFrame = aRedraw.wait_for_frame();
+
+		InputEvent event;
+		while( aEvents.queue.try_pop( event ) )
+		{
+			if( EInputEvent::resize == event.type )
+			{
+				framebufferExtent = VkExtent2D{ std::uint32_t(event.x), std::uint32_t(event.y) };
+				recreateSwapchain = true;
+				continue;
+			}
+
+			apply_input_event( userState, event );
+
+			if( !inputPending )
+			{
+				inputPending = true;
+				inputTime = event.time;
+			}
+		}
+
+		// Input goes to the simulation even if no frame is rendered; the
+		// simulation invalidates the window if the camera moves.
+		simulation.submit_input( userState, inputPending ? inputTime : Clock_::time_point{} );
+
+		if( !needFrame && !recreateSwapchain )
+			continue;
 
 		// Recreate swap chain?
 		if( recreateSwapchain )
 		{
-			vkDeviceWaitIdle(window.device);
+			vkDeviceWaitIdle(aWindow.device);
+
+			auto const changes = lut::recreate_swapchain(aWindow, framebufferExtent);
 
-			auto const changes = lut::recreate_swapchain(window);
+			if (changes.changedFormat && !dynamicRendering)
+			{
+				renderPass = create_render_pass(aWindow, aWindow.swapchainFormat, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+			}
 
-			if (changes.changedFormat)
+			// With dynamic rendering, the pipelines also bake in the color
+			// format.
+			if (changes.changedSize || (changes.changedFormat && dynamicRendering))
 			{
-				renderPass = create_render_pass(window);
+				pipe = create_pipeline(aWindow, aWindow.swapchainExtent, aWindow.swapchainFormat, renderPass.handle, pipeLayout.handle, textureFeedback, vertexPulling);
+				alphaPipeline = create_alpha_pipeline(aWindow, aWindow.swapchainExtent, aWindow.swapchainFormat, renderPass.handle, pipeLayout.handle, textureFeedback, vertexPulling);
 			}
 
 			if (changes.changedSize)
 			{
-				pipe = create_pipeline(window, renderPass.handle, pipeLayout.handle);
-				alphaPipeline = create_alpha_pipeline(window, renderPass.handle, pipeLayout.handle);
-				std::tie(depthBuffer, depthBufferView) = create_depth_buffer(window, allocator);
+				depthBuffer = create_depth_buffer(aWindow, allocator, aWindow.swapchainExtent);
 			}
 
-			framebuffers.clear();
-			create_swapchain_framebuffers(window, renderPass.handle, framebuffers, depthBufferView.handle);
+			if (!dynamicRendering)
+			{
+				framebuffers.clear();
+				create_swapchain_framebuffers(aWindow, renderPass.handle, framebuffers, depthBuffer.views[0].handle);
+			}
 			
 			recreateSwapchain = false;
+
+			// The new swap chain images have no contents yet
+			aRedraw.invalidate();
 			continue;
 		}
 
 		std::uint32_t imageIndex = 0;
 		auto const aquireRes = vkAcquireNextImageKHR(
-			window.device,
-			window.swapchain,
+			aWindow.device,
+			aWindow.swapchain,
 			std::numeric_limits<std::uint64_t>::max(),
 			imageAvailable.handle,
 			VK_NULL_HANDLE,
@@ -404,51 +519,66 @@ int main() try
 
 		assert(std::size_t(imageIndex) < cbfences.size());
 
-		if (auto const res = vkWaitForFences(window.device, 1, &cbfences[imageIndex].handle, VK_TRUE, std::numeric_limits<std::uint64_t>::max()); res != VK_SUCCESS)
+		if (auto const res = vkWaitForFences(aWindow.device, 1, &cbfences[imageIndex].handle, VK_TRUE, std::numeric_limits<std::uint64_t>::max()); res != VK_SUCCESS)
 		{
 			throw lut::Error("Unable to Wait for Command Buffer Fence %u\n"
 				"vkWaitForFences() Returned %s", imageIndex, lut::to_string(res).c_str());
 		}
 
-		if (auto const res = vkResetFences(window.device, 1, &cbfences[imageIndex].handle); res != VK_SUCCESS)
+		if (auto const res = vkResetFences(aWindow.device, 1, &cbfences[imageIndex].handle); res != VK_SUCCESS)
 		{
 			throw lut::Error("Unable to Reset Command Buffer Fence %u\n"
 				"vkResetFences() Returned %s", imageIndex, lut::to_string(res).c_str());
 		}
 		
 		assert(std::size_t(imageIndex) < cbuffers.size());
-		assert(std::size_t(imageIndex) < framebuffers.size());
+		assert(dynamicRendering || std::size_t(imageIndex) < framebuffers.size());
 
-		auto const now = Clock_::now();
-		auto const deltaTime = std::chrono::duration_cast<Secondsf_>(now - previousClock).count();
-		previousClock = now;
+		auto const& snapshot = simulation.latest();
+		auto const camera2world = interpolate_camera(snapshot, Clock_::now());
 
-		update_user_state(userState, deltaTime);
+		// Keep rendering until the interpolation reaches the latest state
+		if (snapshot.previousCamera2world != snapshot.camera2world)
+			aRedraw.animate_until(snapshot.time + cfg::kSimulationStep);
 
 		glsl::SceneUniform sceneUniforms{};
-		update_scene_uniforms(sceneUniforms, window.swapchainExtent.width, window.swapchainExtent.height, userState);
+		update_scene_uniforms(sceneUniforms, aWindow.swapchainExtent.width, aWindow.swapchainExtent.height, camera2world);
 
-		record_commands(
-			cbuffers[imageIndex],
+		auto const transformUpload = prepare_scene( allocator, scene, imageIndex );
+
+		RenderTarget const target{
 			renderPass.handle,
-			framebuffers[imageIndex].handle,
+			dynamicRendering ? VK_NULL_HANDLE : framebuffers[imageIndex].handle,
+			aWindow.swapImages[imageIndex],
+			aWindow.swapViews[imageIndex],
+			VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+			depthBuffer.images[0],
+			depthBuffer.views[0].handle
+		};
+
+		// Demotions take effect in record_uploads()
+		residency.enforce();
+
+		PipelineTable const pipelines = {
 			pipe.handle,
-			window.swapchainExtent,
-			planeMesh.positions.buffer, planeMesh.textureCoords.buffer,
-			planeMesh.vertexCount,
-			sceneUBO.buffer,
+			alphaPipeline.handle
+		};
+
+		record_commands(
+			cbuffers[imageIndex],
+			target,
+			aWindow.swapchainExtent,
+			scene,
 			sceneUniforms,
+			transformUpload,
+			textures,
+			imageIndex,
 			pipeLayout.handle,
-			sceneDescriptors,
-			floorDescriptors,
-			spriteMesh.positions.buffer,
-			spriteMesh.textureCoords.buffer,
-			spriteMesh.vertexCount,
-			spriteDescriptors,
-			alphaPipeline.handle
+			pipelines,
+			vertexPulling
 		);
 		submit_commands(
-			window,
+			aWindow,
 			cbuffers[imageIndex],
 			cbfences[imageIndex].handle,
 			imageAvailable.handle,
@@ -462,13 +592,34 @@ int main() try
 			presentInfo.pWaitSemaphores = &renderFinished.handle;
 
 			presentInfo.swapchainCount = 1;
-			presentInfo.pSwapchains = &window.swapchain;
+			presentInfo.pSwapchains = &aWindow.swapchain;
 
 			presentInfo.pImageIndices = &imageIndex;
 			presentInfo.pResults = nullptr;
 		}
 
-		auto const presentRes = vkQueuePresentKHR(window.presentQueue, &presentInfo);
+		auto const presentRes = vkQueuePresentKHR(aWindow.presentQueue, &presentInfo);
+		aRedraw.frame_rendered();
+
+		// The first frame using a tick that consumed new input completes
+		// that input's latency measurement.
+		if( inputPending && snapshot.inputTime == inputTime && inputTime != lastMeasuredInput )
+		{
+			add_latency_sample( latency, Clock_::now() - inputTime );
+			lastMeasuredInput = inputTime;
+			inputPending = false;
+		}
+
+		if( firstFrame )
+		{
+			std::printf( "First frame after %.1f ms\n", std::chrono::duration<double, std::milli>( Clock_::now() - startTime ).count() );
+			firstFrame = false;
+		}
+
+		// Keep rendering while textures are streamed in
+		if( textures.streaming() )
+			aRedraw.invalidate();
+
 		if (presentRes == VK_SUBOPTIMAL_KHR || presentRes == VK_ERROR_OUT_OF_DATE_KHR)
 		{
 			recreateSwapchain = true;
@@ -482,19 +633,14 @@ int main() try
 
 	// Cleanup takes place automatically in the destructors, but we sill need
 	// to ensure that all Vulkan commands have finished before that.
-	vkDeviceWaitIdle( window.device );
+	vkDeviceWaitIdle( aWindow.device );
 
-	return 0;
-}
-catch( std::exception const& eErr )
-{
-	std::fprintf( stderr, "\n" );
-	std::fprintf( stderr, "Error: %s\n", eErr.what() );
-	return 1;
+	lut::print_redraw_counters( aRedraw );
+	print_latency_stats( latency );
+	lut::print_texture_stream_stats( textures );
+	lut::print_residency_stats( residency );
 }
 
-namespace
-{
 void glfw_callback_key_press( GLFWwindow* aWindow, int aKey, int /*aScanCode*/, int aAction, int /*aModifierFlags*/ )
 {
 	if( GLFW_KEY_ESCAPE == aKey && GLFW_PRESS == aAction )
@@ -502,66 +648,134 @@ void glfw_callback_key_press( GLFWwindow* aWindow, int aKey, int /*aScanCode*/,
 		glfwSetWindowShouldClose( aWindow, GLFW_TRUE );
 	}
 
-	auto userState = static_cast<UserState*>(glfwGetWindowUserPointer(aWindow));
-	assert(userState);
+	// Repeats don't change the input state
+	if( GLFW_REPEAT == aAction )
+		return;
 
-	bool const isReleased = (GLFW_RELEASE == aAction);
+	auto events = static_cast<EventForwarder*>(glfwGetWindowUserPointer(aWindow));
+	assert(events);
 
-	switch (aKey)
-	{
-	case GLFW_KEY_W:
-		userState->inputMap[std::size_t(EInputState::forward)] = !isReleased;
-		break;
-	case GLFW_KEY_S:
-		userState->inputMap[std::size_t(EInputState::backward)] = !isReleased;
-		break;
-	case GLFW_KEY_A:
-		userState->inputMap[std::size_t(EInputState::leftward)] = !isReleased;
-		break;
-	case GLFW_KEY_D:
-		userState->inputMap[std::size_t(EInputState::rightward)] = !isReleased;
-		break;
-	case GLFW_KEY_E:
-		userState->inputMap[std::size_t(EInputState::upward)] = !isReleased;
-		break;
-	case GLFW_KEY_Q:
-		userState->inputMap[std::size_t(EInputState::downward)] = !isReleased;
-		break;
-	
-	case GLFW_KEY_LEFT_SHIFT: [[fallthrough]];
-	case GLFW_KEY_RIGHT_SHIFT:
-		userState->inputMap[std::size_t(EInputState::fast)] = !isReleased;
-		break;
-
-	case GLFW_KEY_LEFT_CONTROL: [[fallthrough]];
-	case GLFW_KEY_RIGHT_CONTROL:
-		userState->inputMap[std::size_t(EInputState::slow)] = !isReleased;
-		break;
-	}
+	forward_event( *events, InputEvent{ EInputEvent::key, aKey, aAction, 0.0, 0.0, Clock_::now() } );
 }
 void glfw_callback_button(GLFWwindow* aWindow, int aButton, int aAction, int)
 {
-	auto userState = static_cast<UserState*>(glfwGetWindowUserPointer(aWindow));
-	assert(userState);
+	auto events = static_cast<EventForwarder*>(glfwGetWindowUserPointer(aWindow));
+	assert(events);
 
+	// The cursor mode can only be changed on the main thread. The render
+	// thread tracks the same flag in its UserState.
 	if (GLFW_MOUSE_BUTTON_RIGHT == aButton && GLFW_PRESS == aAction)
 	{
-		auto& flag = userState->inputMap[std::size_t(EInputState::mousing)];
-
-		flag = !flag;
-		if (flag)
+		events->mousing = !events->mousing;
+		if (events->mousing)
 			glfwSetInputMode(aWindow, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 		else
 			glfwSetInputMode(aWindow, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
 	}
+
+	forward_event( *events, InputEvent{ EInputEvent::button, aButton, aAction, 0.0, 0.0, Clock_::now() } );
 }
 void glfw_callback_motion(GLFWwindow* aWindow, double aXPos, double aYPos)
 {
-	auto userState = static_cast<UserState*>(glfwGetWindowUserPointer(aWindow));
-	assert(userState);
+	auto events = static_cast<EventForwarder*>(glfwGetWindowUserPointer(aWindow));
+	assert(events);
+
+	forward_event( *events, InputEvent{ EInputEvent::motion, 0, 0, aXPos, aYPos, Clock_::now() } );
+}
+void glfw_callback_framebuffer_size( GLFWwindow* aWindow, int aWidth, int aHeight )
+{
+	auto events = static_cast<EventForwarder*>(glfwGetWindowUserPointer(aWindow));
+	assert(events);
+
+	// Minimized windows report a zero size; the swap chain is recreated
+	// once the window is restored.
+	if( 0 == aWidth || 0 == aHeight )
+		return;
+
+	forward_event( *events, InputEvent{ EInputEvent::resize, 0, 0, double(aWidth), double(aHeight), Clock_::now() } );
+}
+void glfw_callback_iconify( GLFWwindow* aWindow, int aIconified )
+{
+	auto events = static_cast<EventForwarder*>(glfwGetWindowUserPointer(aWindow));
+	assert(events && events->redraw);
+
+	events->redraw->set_minimized( GLFW_TRUE == aIconified );
+}
+
+void forward_event( EventForwarder& aEvents, InputEvent const& aEvent )
+{
+	assert( aEvents.redraw );
 
-	userState->mouseX = aXPos;
-	userState->mouseY = aYPos;
+	if( !aEvents.queue.try_push( aEvent ) )
+	{
+		++aEvents.dropped;
+		return;
+	}
+
+	// Cursor motion only affects the camera while mousing. Other motion
+	// events are picked up with the next frame.
+	if( EInputEvent::motion != aEvent.type || aEvents.mousing )
+		aEvents.redraw->invalidate();
+}
+
+void apply_input_event( UserState& aUserState, InputEvent const& aEvent )
+{
+	switch( aEvent.type )
+	{
+	case EInputEvent::key:
+	{
+		bool const isReleased = (GLFW_RELEASE == aEvent.action);
+
+		switch (aEvent.code)
+		{
+		case GLFW_KEY_W:
+			aUserState.inputMap[std::size_t(EInputState::forward)] = !isReleased;
+			break;
+		case GLFW_KEY_S:
+			aUserState.inputMap[std::size_t(EInputState::backward)] = !isReleased;
+			break;
+		case GLFW_KEY_A:
+			aUserState.inputMap[std::size_t(EInputState::leftward)] = !isReleased;
+			break;
+		case GLFW_KEY_D:
+			aUserState.inputMap[std::size_t(EInputState::rightward)] = !isReleased;
+			break;
+		case GLFW_KEY_E:
+			aUserState.inputMap[std::size_t(EInputState::upward)] = !isReleased;
+			break;
+		case GLFW_KEY_Q:
+			aUserState.inputMap[std::size_t(EInputState::downward)] = !isReleased;
+			break;
+		
+		case GLFW_KEY_LEFT_SHIFT: [[fallthrough]];
+		case GLFW_KEY_RIGHT_SHIFT:
+			aUserState.inputMap[std::size_t(EInputState::fast)] = !isReleased;
+			break;
+
+		case GLFW_KEY_LEFT_CONTROL: [[fallthrough]];
+		case GLFW_KEY_RIGHT_CONTROL:
+			aUserState.inputMap[std::size_t(EInputState::slow)] = !isReleased;
+			break;
+		}
+	} break;
+
+	case EInputEvent::button:
+		if (GLFW_MOUSE_BUTTON_RIGHT == aEvent.code && GLFW_PRESS == aEvent.action)
+		{
+			auto& flag = aUserState.inputMap[std::size_t(EInputState::mousing)];
+			flag = !flag;
+		}
+		break;
+
+	case EInputEvent::motion:
+		aUserState.mouseX = float(aEvent.x);
+		aUserState.mouseY = float(aEvent.y);
+		break;
+
+	case EInputEvent::resize:
+		// Handled by the frame loop
+		break;
+	}
 }
 }
 
@@ -612,492 +826,129 @@ void update_user_state(UserState& aUserState, float aElapsedTime)
 		camera = camera * glm::translate(glm::vec3(0.0f, -move, 0.0f));
 }
 
-void update_scene_uniforms( glsl::SceneUniform& aSceneUniforms, std::uint32_t aFramebufferWidth, std::uint32_t aFramebufferHeight, UserState const& aUserState )
+SimulationThread::SimulationThread( UserState const& aInitial, lut::RedrawScheduler& aRedraw )
+	: mState( aInitial )
+	, mRedraw( aRedraw )
+	, mOutput( SimSnapshot{ 0, Clock_::now(), Clock_::time_point{}, aInitial.camera2world, aInitial.camera2world } )
 {
-	float const aspect = aFramebufferWidth / float(aFramebufferHeight);
-
-	aSceneUniforms.projection = glm::perspectiveRH_ZO(
-		lut::Radians(cfg::kCameraFov).value(),
-		aspect,
-		cfg::kCameraNear, cfg::kCameraFar
-	);
-	aSceneUniforms.projection[1][1] *= -1.0f;
-
-	aSceneUniforms.camera = glm::translate(glm::vec3(0.0f, -0.3f, -1.0f));
-	aSceneUniforms.camera = glm::inverse(aUserState.camera2world);
-
-	aSceneUniforms.projCam = aSceneUniforms.projection * aSceneUniforms.camera;
-}
+	// Start the thread last, once all members are initialized.
+	mThread = std::thread( [this] { run_(); } );
 }
 
-namespace
+SimulationThread::~SimulationThread()
 {
-lut::RenderPass create_render_pass( lut::VulkanWindow const& aWindow )
-{
-	VkAttachmentDescription attachments[2]{}; {
-		attachments[0].format = aWindow.swapchainFormat;
-		attachments[0].samples = VK_SAMPLE_COUNT_1_BIT;
-		attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-		attachments[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-		attachments[0].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		attachments[0].finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-
-		attachments[1].format = cfg::kDepthFormat;
-		attachments[1].samples = VK_SAMPLE_COUNT_1_BIT;
-		attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-		attachments[1].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-		attachments[1].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		attachments[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-	}
-
-	VkAttachmentReference subpassAttachments[1]{}; {
-		subpassAttachments[0].attachment = 0;
-		subpassAttachments[0].layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-	}
-	VkAttachmentReference depthAttachment{}; {
-		depthAttachment.attachment = 1;
-		depthAttachment.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-	}
-	
-	VkSubpassDescription subpasses[1]{}; {
-		subpasses[0].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-
-		subpasses[0].colorAttachmentCount = 1;
-		subpasses[0].pColorAttachments = subpassAttachments;
-
-		subpasses[0].pDepthStencilAttachment = &depthAttachment;
-	}
-
-	VkRenderPassCreateInfo renderPassInfo{}; {
-		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-
-		renderPassInfo.attachmentCount = sizeof(attachments) / sizeof(attachments[0]);
-		renderPassInfo.pAttachments = attachments;
-
-		renderPassInfo.subpassCount = 1;
-		renderPassInfo.pSubpasses = subpasses;
-
-		renderPassInfo.dependencyCount = 0;
-		renderPassInfo.pDependencies = nullptr;
-	}
-
-	VkRenderPass renderPass = VK_NULL_HANDLE;
-	if (auto const res = vkCreateRenderPass(aWindow.device, &renderPassInfo, nullptr, &renderPass); res != VK_SUCCESS)
-	{
-		throw lut::Error("Unable to Create Render Pass\n"
-			"vkCreateRenderPass() returned %s", lut::to_string(res).c_str());
-	}
-
-	return lut::RenderPass(aWindow.device, renderPass);
+	mStop.store( true, std::memory_order_relaxed );
+	if( mThread.joinable() )
+		mThread.join();
 }
 
-lut::PipelineLayout create_pipeline_layout( lut::VulkanContext const& aContext, VkDescriptorSetLayout aSceneLayout, VkDescriptorSetLayout aObjectLayout )
+void SimulationThread::submit_input( UserState const& aUserState, Clock_::time_point aInputTime )
 {
-	VkDescriptorSetLayout descriptorSetLayouts[] = {
-		aSceneLayout,
-		aObjectLayout
-	};
-
-	VkPipelineLayoutCreateInfo pipelineLayoutInfo{}; {
-		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-
-		pipelineLayoutInfo.setLayoutCount = sizeof(descriptorSetLayouts) / sizeof(descriptorSetLayouts[0]);
-		pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts;
-
-		pipelineLayoutInfo.pushConstantRangeCount = 0;
-		pipelineLayoutInfo.pPushConstantRanges = nullptr;
-	}
+	auto& input = mInput.write_buffer();
+	std::memcpy( input.inputMap, aUserState.inputMap, sizeof(input.inputMap) );
+	input.mouseX = aUserState.mouseX;
+	input.mouseY = aUserState.mouseY;
+	input.time = aInputTime;
 
-	VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
-	if (auto const res = vkCreatePipelineLayout(aContext.device, &pipelineLayoutInfo, nullptr, &pipelineLayout); res != VK_SUCCESS)
-	{
-		throw lut::Error("Unable to Create Pipeline Layout\n"
-			"vkCreatePipelineLayout() returned %s", lut::to_string(res).c_str());
-	}
-
-	return lut::PipelineLayout(aContext.device, pipelineLayout);
+	mInput.publish();
 }
-lut::Pipeline create_pipeline( lut::VulkanWindow const& aWindow, VkRenderPass aRenderPass, VkPipelineLayout aPipelineLayout )
-{
-	lut::ShaderModule vertShader = lut::load_shader_module(aWindow, cfg::kVertShaderPath);
-	lut::ShaderModule fragShader = lut::load_shader_module(aWindow, cfg::kFragShaderPath);
-
-	VkPipelineShaderStageCreateInfo shaderStagesInfo[2]{}; {
-		shaderStagesInfo[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-		shaderStagesInfo[0].pName = "main";
-
-		shaderStagesInfo[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
-		shaderStagesInfo[0].module = vertShader.handle;
-
-		shaderStagesInfo[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-		shaderStagesInfo[1].pName = "main";
-
-		shaderStagesInfo[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-		shaderStagesInfo[1].module = fragShader.handle;
-	}
-
-	VkVertexInputBindingDescription vertexInputBindings[2]{}; {
-		vertexInputBindings[0].binding = 0;
-		vertexInputBindings[0].stride = sizeof(float) * 3;
-		vertexInputBindings[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-	
-		vertexInputBindings[1].binding = 1;
-		vertexInputBindings[1].stride = sizeof(float) * 2;
-		vertexInputBindings[1].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-	}
-
-	VkVertexInputAttributeDescription vertexInputAttributes[2]{}; {
-		vertexInputAttributes[0].binding = 0;
-		vertexInputAttributes[0].location = 0;
-		vertexInputAttributes[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-		vertexInputAttributes[0].offset = 0;
-
-		vertexInputAttributes[1].binding = 1;
-		vertexInputAttributes[1].location = 1;
-		vertexInputAttributes[1].format = VK_FORMAT_R32G32_SFLOAT;
-		vertexInputAttributes[1].offset = 0;
-	}
-
-	VkPipelineVertexInputStateCreateInfo vertexInputInfo{}; {
-		vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-	
-		vertexInputInfo.vertexBindingDescriptionCount = 2;
-		vertexInputInfo.pVertexBindingDescriptions = vertexInputBindings;
-
-		vertexInputInfo.vertexAttributeDescriptionCount = 2;
-		vertexInputInfo.pVertexAttributeDescriptions = vertexInputAttributes;
-	}
-	VkPipelineInputAssemblyStateCreateInfo assemblyStateInfo{}; {
-		assemblyStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-
-		assemblyStateInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-		assemblyStateInfo.primitiveRestartEnable = VK_FALSE;
-	}
-	
-	VkViewport viewport{}; {
-		viewport.x = 0.0f;
-		viewport.y = 0.0f;
-		
-		viewport.width = float(aWindow.swapchainExtent.width);
-		viewport.height = float(aWindow.swapchainExtent.height);
-
-		viewport.minDepth = 0.0f;
-		viewport.maxDepth = 1.0f;
-	}
-	VkRect2D scissor{}; {
-		scissor.offset = VkOffset2D{0, 0};
-		scissor.extent = aWindow.swapchainExtent;
-	}
-	VkPipelineViewportStateCreateInfo viewportStateInfo{}; {
-		viewportStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-
-		viewportStateInfo.viewportCount = 1;
-		viewportStateInfo.pViewports = &viewport;
-
-		viewportStateInfo.scissorCount = 1;
-		viewportStateInfo.pScissors = &scissor;
-	}
-	
-	VkPipelineRasterizationStateCreateInfo rasterizationStateInfo{}; {
-		rasterizationStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-
-		rasterizationStateInfo.depthClampEnable = VK_FALSE;
-		rasterizationStateInfo.rasterizerDiscardEnable = VK_FALSE;
-		rasterizationStateInfo.depthBiasEnable = VK_FALSE;
-
-		rasterizationStateInfo.polygonMode = VK_POLYGON_MODE_FILL;
-		rasterizationStateInfo.cullMode = VK_CULL_MODE_BACK_BIT;
-		rasterizationStateInfo.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
-
-		rasterizationStateInfo.lineWidth = 1.0f;
-	}
-	
-	VkPipelineMultisampleStateCreateInfo multisamplingStateInfo{}; {
-		multisamplingStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-
-		multisamplingStateInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-	}
-	
-	VkPipelineDepthStencilStateCreateInfo depthStencilStateInfo{}; {
-		depthStencilStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
 
-		depthStencilStateInfo.depthTestEnable = VK_TRUE;
-		depthStencilStateInfo.depthWriteEnable = VK_TRUE;
-		depthStencilStateInfo.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
-
-		depthStencilStateInfo.minDepthBounds = 0.0f;
-		depthStencilStateInfo.maxDepthBounds = 1.0f;
-	}
-
-	VkPipelineColorBlendAttachmentState colourBlendAttachmentStates[1]{}; {
-		colourBlendAttachmentStates[0].blendEnable = VK_FALSE;
-		colourBlendAttachmentStates[0].colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-	}
-	VkPipelineColorBlendStateCreateInfo colourBlendStateInfo{}; {
-		colourBlendStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-
-		colourBlendStateInfo.logicOpEnable = VK_FALSE;
-
-		colourBlendStateInfo.attachmentCount = 1;
-		colourBlendStateInfo.pAttachments = colourBlendAttachmentStates;
-	}
-	
-	VkGraphicsPipelineCreateInfo graphicsPipelineInfo{}; {
-		graphicsPipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-
-		graphicsPipelineInfo.stageCount = 2;
-		graphicsPipelineInfo.pStages = shaderStagesInfo;
-
-		graphicsPipelineInfo.pVertexInputState = &vertexInputInfo;
-		graphicsPipelineInfo.pInputAssemblyState = &assemblyStateInfo;
-		graphicsPipelineInfo.pTessellationState = nullptr;
-		graphicsPipelineInfo.pViewportState = &viewportStateInfo;
-		graphicsPipelineInfo.pRasterizationState = &rasterizationStateInfo;
-		graphicsPipelineInfo.pMultisampleState = &multisamplingStateInfo;
-		graphicsPipelineInfo.pDepthStencilState = &depthStencilStateInfo;
-		graphicsPipelineInfo.pColorBlendState = &colourBlendStateInfo;
-		graphicsPipelineInfo.pDynamicState = nullptr;
-
-		graphicsPipelineInfo.layout = aPipelineLayout;
-		graphicsPipelineInfo.renderPass = aRenderPass;
-		graphicsPipelineInfo.subpass = 0;
-	}
-	
-	VkPipeline graphicsPipeline = VK_NULL_HANDLE;
-	if (auto const res = vkCreateGraphicsPipelines(aWindow.device, VK_NULL_HANDLE, 1, &graphicsPipelineInfo, nullptr, &graphicsPipeline); res != VK_SUCCESS)
-	{
-		throw lut::Error("Unable to Create Graphics Pipeline\n"
-			"vkCreateGraphicsPipeline() returned %s", lut::to_string(res).c_str());
-	}
-	
-	return lut::Pipeline(aWindow.device, graphicsPipeline);
-}
-lut::Pipeline create_alpha_pipeline(lut::VulkanWindow const& aWindow, VkRenderPass aRenderPass, VkPipelineLayout aPipelineLayout)
+SimSnapshot const& SimulationThread::latest()
 {
-	lut::ShaderModule vertShader = lut::load_shader_module(aWindow, cfg::kVertShaderPath);
-	lut::ShaderModule fragShader = lut::load_shader_module(aWindow, cfg::kAlphaFragShaderPath);
-
-	VkPipelineShaderStageCreateInfo shaderStagesInfo[2]{}; {
-		shaderStagesInfo[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-		shaderStagesInfo[0].pName = "main";
-
-		shaderStagesInfo[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
-		shaderStagesInfo[0].module = vertShader.handle;
-
-		shaderStagesInfo[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-		shaderStagesInfo[1].pName = "main";
-
-		shaderStagesInfo[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-		shaderStagesInfo[1].module = fragShader.handle;
-	}
-
-	VkVertexInputBindingDescription vertexInputBindings[2]{}; {
-		vertexInputBindings[0].binding = 0;
-		vertexInputBindings[0].stride = sizeof(float) * 3;
-		vertexInputBindings[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-	
-		vertexInputBindings[1].binding = 1;
-		vertexInputBindings[1].stride = sizeof(float) * 2;
-		vertexInputBindings[1].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-	}
-
-	VkVertexInputAttributeDescription vertexInputAttributes[2]{}; {
-		vertexInputAttributes[0].binding = 0;
-		vertexInputAttributes[0].location = 0;
-		vertexInputAttributes[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-		vertexInputAttributes[0].offset = 0;
-
-		vertexInputAttributes[1].binding = 1;
-		vertexInputAttributes[1].location = 1;
-		vertexInputAttributes[1].format = VK_FORMAT_R32G32_SFLOAT;
-		vertexInputAttributes[1].offset = 0;
-	}
-
-	VkPipelineVertexInputStateCreateInfo vertexInputInfo{}; {
-		vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-	
-		vertexInputInfo.vertexBindingDescriptionCount = 2;
-		vertexInputInfo.pVertexBindingDescriptions = vertexInputBindings;
-
-		vertexInputInfo.vertexAttributeDescriptionCount = 2;
-		vertexInputInfo.pVertexAttributeDescriptions = vertexInputAttributes;
-	}
-	VkPipelineInputAssemblyStateCreateInfo assemblyStateInfo{}; {
-		assemblyStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-
-		assemblyStateInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-		assemblyStateInfo.primitiveRestartEnable = VK_FALSE;
-	}
-	
-	VkViewport viewport{}; {
-		viewport.x = 0.0f;
-		viewport.y = 0.0f;
-		
-		viewport.width = float(aWindow.swapchainExtent.width);
-		viewport.height = float(aWindow.swapchainExtent.height);
-
-		viewport.minDepth = 0.0f;
-		viewport.maxDepth = 1.0f;
-	}
-	VkRect2D scissor{}; {
-		scissor.offset = VkOffset2D{0, 0};
-		scissor.extent = aWindow.swapchainExtent;
-	}
-	VkPipelineViewportStateCreateInfo viewportStateInfo{}; {
-		viewportStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-
-		viewportStateInfo.viewportCount = 1;
-		viewportStateInfo.pViewports = &viewport;
+	mOutput.update();
+	return mOutput.read_buffer();
+}
 
-		viewportStateInfo.scissorCount = 1;
-		viewportStateInfo.pScissors = &scissor;
-	}
-	
-	VkPipelineRasterizationStateCreateInfo rasterizationStateInfo{}; {
-		rasterizationStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+void SimulationThread::run_()
+{
+	float const step = std::chrono::duration_cast<Secondsf_>(cfg::kSimulationStep).count();
 
-		rasterizationStateInfo.depthClampEnable = VK_FALSE;
-		rasterizationStateInfo.rasterizerDiscardEnable = VK_FALSE;
-		rasterizationStateInfo.depthBiasEnable = VK_FALSE;
+	std::uint64_t tick = 0;
+	auto next = Clock_::now();
 
-		rasterizationStateInfo.polygonMode = VK_POLYGON_MODE_FILL;
-		rasterizationStateInfo.cullMode = VK_CULL_MODE_BACK_BIT;
-		rasterizationStateInfo.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+	Clock_::time_point inputTime{};
 
-		rasterizationStateInfo.lineWidth = 1.0f;
-	}
-	
-	VkPipelineMultisampleStateCreateInfo multisamplingStateInfo{}; {
-		multisamplingStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+	while( !mStop.load( std::memory_order_relaxed ) )
+	{
+		if( mInput.update() )
+		{
+			auto const& input = mInput.read_buffer();
+			std::memcpy( mState.inputMap, input.inputMap, sizeof(mState.inputMap) );
+			mState.mouseX = input.mouseX;
+			mState.mouseY = input.mouseY;
 
-		multisamplingStateInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-	}
-	
-	VkPipelineDepthStencilStateCreateInfo depthStencilStateInfo{}; {
-		depthStencilStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+			if( Clock_::time_point{} != input.time )
+				inputTime = input.time;
+		}
 
-		depthStencilStateInfo.depthTestEnable = VK_TRUE;
-		depthStencilStateInfo.depthWriteEnable = VK_TRUE;
-		depthStencilStateInfo.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+		glm::mat4 const previous = mState.camera2world;
+		update_user_state( mState, step );
 
-		depthStencilStateInfo.minDepthBounds = 0.0f;
-		depthStencilStateInfo.maxDepthBounds = 1.0f;
-	}
+		auto& out = mOutput.write_buffer();
+		out.tick = ++tick;
+		out.time = Clock_::now();
+		out.inputTime = inputTime;
+		out.previousCamera2world = previous;
+		out.camera2world = mState.camera2world;
 
-	VkPipelineColorBlendAttachmentState colourBlendAttachmentStates[1]{}; {
-		colourBlendAttachmentStates[0].blendEnable = VK_TRUE;
+		mOutput.publish();
 
-		colourBlendAttachmentStates[0].colorBlendOp = VK_BLEND_OP_ADD;
+		if( previous != mState.camera2world )
+			mRedraw.invalidate();
 
-		colourBlendAttachmentStates[0].srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
-		colourBlendAttachmentStates[0].dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+		next += cfg::kSimulationStep;
 
-		colourBlendAttachmentStates[0].colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-	}
-	VkPipelineColorBlendStateCreateInfo colourBlendStateInfo{}; {
-		colourBlendStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-
-		colourBlendStateInfo.logicOpEnable = VK_FALSE;
+		auto const now = Clock_::now();
+		if( now > next + cfg::kSimulationMaxLag * cfg::kSimulationStep )
+			next = now;
 
-		colourBlendStateInfo.attachmentCount = 1;
-		colourBlendStateInfo.pAttachments = colourBlendAttachmentStates;
-	}
-	
-	VkGraphicsPipelineCreateInfo graphicsPipelineInfo{}; {
-		graphicsPipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-
-		graphicsPipelineInfo.stageCount = 2;
-		graphicsPipelineInfo.pStages = shaderStagesInfo;
-
-		graphicsPipelineInfo.pVertexInputState = &vertexInputInfo;
-		graphicsPipelineInfo.pInputAssemblyState = &assemblyStateInfo;
-		graphicsPipelineInfo.pTessellationState = nullptr;
-		graphicsPipelineInfo.pViewportState = &viewportStateInfo;
-		graphicsPipelineInfo.pRasterizationState = &rasterizationStateInfo;
-		graphicsPipelineInfo.pMultisampleState = &multisamplingStateInfo;
-		graphicsPipelineInfo.pDepthStencilState = &depthStencilStateInfo;
-		graphicsPipelineInfo.pColorBlendState = &colourBlendStateInfo;
-		graphicsPipelineInfo.pDynamicState = nullptr;
-
-		graphicsPipelineInfo.layout = aPipelineLayout;
-		graphicsPipelineInfo.renderPass = aRenderPass;
-		graphicsPipelineInfo.subpass = 0;
-	}
-	
-	VkPipeline graphicsPipeline = VK_NULL_HANDLE;
-	if (auto const res = vkCreateGraphicsPipelines(aWindow.device, VK_NULL_HANDLE, 1, &graphicsPipelineInfo, nullptr, &graphicsPipeline); res != VK_SUCCESS)
-	{
-		throw lut::Error("Unable to Create Graphics Pipeline\n"
-			"vkCreateGraphicsPipeline() returned %s", lut::to_string(res).c_str());
+		std::this_thread::sleep_until( next );
 	}
-	
-	return lut::Pipeline(aWindow.device, graphicsPipeline);
 }
 
-std::tuple<lut::Image, lut::ImageView> create_depth_buffer( lut::VulkanWindow const& aWindow, lut::Allocator const& aAllocator )
+glm::mat4 interpolate_camera( SimSnapshot const& aSnapshot, Clock_::time_point aNow )
 {
-	VkImageCreateInfo imageInfo{}; {
-		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-
-		imageInfo.imageType = VK_IMAGE_TYPE_2D;
-		imageInfo.format = cfg::kDepthFormat;
-
-		imageInfo.extent.width = aWindow.swapchainExtent.width;
-		imageInfo.extent.height = aWindow.swapchainExtent.height;
-		imageInfo.extent.depth = 1;
-
-		imageInfo.mipLevels = 1;
-		imageInfo.arrayLayers = 1;
-
-		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-		imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
-
-		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	}
-
-	VmaAllocationCreateInfo allocationInfo{}; {
-		allocationInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
-	}
-
-	VkImage image = VK_NULL_HANDLE;
-	VmaAllocation allocation = VK_NULL_HANDLE;
-	if (auto const res = vmaCreateImage(aAllocator.allocator, &imageInfo, &allocationInfo, &image, &allocation, nullptr);
-		res != VK_SUCCESS)
-	{
-		throw lut::Error("Unable to Allocate Depth Buffer Image\n"
-			"vmaCreateImage() Returned %s", lut::to_string(res).c_str());
-	}
+	// Rendering runs one tick behind the simulation: the snapshot's state
+	// is reached one step after it was published.
+	float const t = glm::clamp(
+		std::chrono::duration_cast<Secondsf_>(aNow - aSnapshot.time).count() / std::chrono::duration_cast<Secondsf_>(cfg::kSimulationStep).count(),
+		0.f, 1.f
+	);
 
-	lut::Image depthImage = lut::Image(aAllocator.allocator, image, allocation);
+	auto const& from = aSnapshot.previousCamera2world;
+	auto const& to = aSnapshot.camera2world;
 
-	VkImageViewCreateInfo imageViewInfo{}; {
-		imageViewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	// The camera transform is rigid; interpolate rotation and translation
+	// separately.
+	glm::mat4 ret = glm::mat4_cast( glm::slerp( glm::quat_cast( from ), glm::quat_cast( to ), t ) );
+	ret[3] = glm::mix( from[3], to[3], t );
+	return ret;
+}
 
-		imageViewInfo.image = depthImage.image;
-		imageViewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+void add_latency_sample( LatencyStats& aStats, Clock_::duration aLatency )
+{
+	double const ms = std::chrono::duration<double, std::milli>( aLatency ).count();
 
-		imageViewInfo.format = cfg::kDepthFormat;
-		imageViewInfo.components = VkComponentMapping{};
-		imageViewInfo.subresourceRange = VkImageSubresourceRange{
-			VK_IMAGE_ASPECT_DEPTH_BIT,
-			0, 1,
-			0, 1
-		};
-	}
+	++aStats.count;
+	aStats.totalMs += ms;
+	aStats.maxMs = std::max( aStats.maxMs, ms );
+}
 
-	VkImageView imageView = VK_NULL_HANDLE;
-	if (auto const res = vkCreateImageView(aWindow.device, &imageViewInfo, nullptr, &imageView);
-		res != VK_SUCCESS)
-	{
-		throw lut::Error("Unable to Create Image View\n"
-			"vkCreateImageView() Returned %s", lut::to_string(res).c_str());
-	}
+void print_latency_stats( LatencyStats const& aStats )
+{
+	if( 0 == aStats.count )
+		return;
 
-	return {std::move(depthImage), lut::ImageView(aWindow.device, imageView)};
+	std::printf( "Input latency: %llu samples, mean %.2f ms, max %.2f ms\n",
+		static_cast<unsigned long long>(aStats.count),
+		aStats.totalMs / aStats.count,
+		aStats.maxMs
+	);
+}
 }
 
+namespace
+{
 void create_swapchain_framebuffers( lut::VulkanWindow const& aWindow, VkRenderPass aRenderPass, std::vector<lut::Framebuffer>& aFramebuffers, VkImageView aDepthView )
 {
 	assert( aFramebuffers.empty() );
@@ -1136,170 +987,6 @@ void create_swapchain_framebuffers( lut::VulkanWindow const& aWindow, VkRenderPa
 	assert( aWindow.swapViews.size() == aFramebuffers.size() );
 }
 
-lut::DescriptorSetLayout create_scene_descriptor_layout( lut::VulkanWindow const& aWindow )
-{
-	VkDescriptorSetLayoutBinding descriptorSetLayoutBindings[1]{}; {
-		descriptorSetLayoutBindings[0].binding = 0;
-
-		descriptorSetLayoutBindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		descriptorSetLayoutBindings[0].descriptorCount = 1;
-		descriptorSetLayoutBindings[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
-	}
-	VkDescriptorSetLayoutCreateInfo descriptorSetLayoutInfo{}; {
-		descriptorSetLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-
-		descriptorSetLayoutInfo.bindingCount = sizeof(descriptorSetLayoutBindings) / sizeof(descriptorSetLayoutBindings[0]);
-		descriptorSetLayoutInfo.pBindings = descriptorSetLayoutBindings;
-	}
-
-	VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
-	if (auto const res = vkCreateDescriptorSetLayout(aWindow.device, &descriptorSetLayoutInfo, nullptr, &descriptorSetLayout);
-		res != VK_SUCCESS)
-	{
-		throw lut::Error("Unable to Create Descriptor Set Layout\n"
-			"vkCreateDescriptorSetLayout() Returned %s", lut::to_string(res).c_str());
-	}
-
-	return lut::DescriptorSetLayout(aWindow.device, descriptorSetLayout);
-}
-lut::DescriptorSetLayout create_object_descriptor_layout( lut::VulkanWindow const& aWindow )
-{
-	VkDescriptorSetLayoutBinding layoutBindings[1]{}; {
-		layoutBindings[0].binding = 0;
-
-		layoutBindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		layoutBindings[0].descriptorCount = 1;
-
-		layoutBindings[0].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
-	}
-	VkDescriptorSetLayoutCreateInfo layoutInfo{}; {
-		layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-
-		layoutInfo.bindingCount = sizeof(layoutBindings) / sizeof(layoutBindings[0]);
-		layoutInfo.pBindings = layoutBindings;
-	}
-
-	VkDescriptorSetLayout layout = VK_NULL_HANDLE;
-	if (auto const res = vkCreateDescriptorSetLayout(aWindow.device, &layoutInfo, nullptr, &layout);
-		res != VK_SUCCESS)
-	{
-		throw lut::Error("Unable to Create Descriptor Set Layout\n"
-			"vkCreateDescriptorSetLayout() Returned %s", lut::to_string(res).c_str());
-	}
-
-	return lut::DescriptorSetLayout(aWindow.device, layout);
-}
-
-void record_commands(
-	VkCommandBuffer aCmdBuff,
-	VkRenderPass aRenderPass,
-	VkFramebuffer aFramebuffer,
-	VkPipeline aGraphicsPipe,
-	VkExtent2D const& aImageExtent,
-	VkBuffer aPositionBuffer, VkBuffer aTextureCoordBuffer,
-	std::uint32_t aVertexCount,
-	VkBuffer aSceneUBO,
-	glsl::SceneUniform const& aSceneUniform,
-	VkPipelineLayout aGraphicsLayout,
-	VkDescriptorSet aSceneDescriptors,
-	VkDescriptorSet aObjectDescriptors,
-	VkBuffer aSpritePositionBuffer,
-	VkBuffer aSpriteTextureBuffer,
-	std::uint32_t aSpriteVertexCount,
-	VkDescriptorSet aSpriteObjDescriptors,
-	VkPipeline aAlphaPipeline)
-{
-	// Begin Recording Commands
-	VkCommandBufferBeginInfo commandBufferBeginInfo{}; {
-		commandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-
-		commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-		commandBufferBeginInfo.pInheritanceInfo = nullptr;
-	}
-
-	if (auto const res = vkBeginCommandBuffer(aCmdBuff, &commandBufferBeginInfo); res != VK_SUCCESS)
-	{
-		throw lut::Error("Unable to Begin Recording Command Buffer\n"
-			"vkBeginCommandBuffer() Returned %s", lut::to_string(res).c_str());
-	}
-
-	lut::buffer_barrier(
-		aCmdBuff,
-		aSceneUBO,
-		VK_ACCESS_UNIFORM_READ_BIT,
-		VK_ACCESS_TRANSFER_WRITE_BIT,
-		VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
-		VK_PIPELINE_STAGE_TRANSFER_BIT
-	);
-
-	vkCmdUpdateBuffer(aCmdBuff, aSceneUBO, 0, sizeof(glsl::SceneUniform), &aSceneUniform);
-
-	lut::buffer_barrier(
-		aCmdBuff,
-		aSceneUBO,
-		VK_ACCESS_TRANSFER_WRITE_BIT,
-		VK_ACCESS_UNIFORM_READ_BIT,
-		VK_PIPELINE_STAGE_TRANSFER_BIT,
-		VK_PIPELINE_STAGE_VERTEX_SHADER_BIT
-	);
-
-	// Begin the Render Pass
-	VkClearValue clearValues[2]{}; {
-		clearValues[0].color.float32[0] = 0.1f;
-		clearValues[0].color.float32[1] = 0.1f;
-		clearValues[0].color.float32[2] = 0.1f;
-		clearValues[0].color.float32[3] = 1.0f;
-
-		clearValues[1].depthStencil.depth = 1.0f;
-	}
-	
-	VkRenderPassBeginInfo renderPassInfo{}; {
-		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-
-		renderPassInfo.renderPass = aRenderPass;
-		renderPassInfo.framebuffer = aFramebuffer;
-
-		renderPassInfo.renderArea.offset = VkOffset2D{0, 0};
-		renderPassInfo.renderArea.extent = aImageExtent;
-
-		renderPassInfo.clearValueCount = sizeof(clearValues) / sizeof(clearValues[0]);
-		renderPassInfo.pClearValues = clearValues;
-	}
-
-	vkCmdBeginRenderPass(aCmdBuff, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-	// Begin Drawing with our Graphics Pipeline
-	vkCmdBindPipeline(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aGraphicsPipe);
-
-	vkCmdBindDescriptorSets(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aGraphicsLayout, 0, 1, &aSceneDescriptors, 0, nullptr);
-	vkCmdBindDescriptorSets(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aGraphicsLayout, 1, 1, &aObjectDescriptors, 0, nullptr);
-
-	VkBuffer buffers[2] = {aPositionBuffer, aTextureCoordBuffer};
-	VkDeviceSize offsets[2]{};
-
-	vkCmdBindVertexBuffers(aCmdBuff, 0, 2, buffers, offsets);
-	vkCmdDraw(aCmdBuff, aVertexCount, 1, 0, 0);
-
-	vkCmdBindPipeline(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aAlphaPipeline);
-
-	vkCmdBindDescriptorSets(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aGraphicsLayout, 1, 1, &aSpriteObjDescriptors, 0, nullptr);
-
-	VkBuffer spriteBuffers[2] = {aSpritePositionBuffer, aSpriteTextureBuffer};
-	VkDeviceSize spriteOffsets[2]{};
-
-	vkCmdBindVertexBuffers(aCmdBuff, 0, 2, spriteBuffers, spriteOffsets);
-	vkCmdDraw(aCmdBuff, aSpriteVertexCount, 1, 0, 0);
-
-	// End the Render Pass
-	vkCmdEndRenderPass(aCmdBuff);
-
-	// End Command Recording
-	if (auto const res = vkEndCommandBuffer(aCmdBuff); res != VK_SUCCESS)
-	{
-		throw lut::Error("Unable to End Recording Command Buffer\n"
-			"vkEndCommandBuffer() Returned %s", lut::to_string(res).c_str());
-	}
-}
 void submit_commands( lut::VulkanWindow const& aWindow, VkCommandBuffer aCmdBuff, VkFence aFence, VkSemaphore aWaitSemaphore, VkSemaphore aSignalSemaphore )
 {
 	VkPipelineStageFlags waitPipelineStages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
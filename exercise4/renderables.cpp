@@ -0,0 +1,185 @@
+#include "renderables.hpp"
+
+#include <algorithm>
+#include <functional>
+
+#include <cassert>
+
+namespace
+{
+	template< typename tType >
+	void gather_( std::vector<tType>& aValues, std::vector<std::uint32_t> const& aOrder, std::vector<tType>& aScratch )
+	{
+		aScratch.clear();
+		aScratch.reserve( aValues.size() );
+
+		for( auto const index : aOrder )
+			aScratch.emplace_back( aValues[index] );
+
+		aValues.swap( aScratch );
+	}
+}
+
+void RenderableStore::reserve( std::size_t aCount )
+{
+	mSparse.reserve( aCount );
+	mDense.reserve( aCount );
+	mMeshes.reserve( aCount );
+	mMaterials.reserve( aCount );
+	mTransforms.reserve( aCount );
+	mBounds.reserve( aCount );
+	mSequence.reserve( aCount );
+}
+
+Entity RenderableStore::create( MeshRef const& aMesh, Material const& aMaterial, SceneGraph::NodeId aTransform, Bounds const& aBounds )
+{
+	Entity entity = kNoEntity;
+	if( !mFreeEntities.empty() )
+	{
+		entity = mFreeEntities.back();
+		mFreeEntities.pop_back();
+	}
+	else
+	{
+		entity = Entity(mSparse.size());
+		mSparse.emplace_back( kNoEntity );
+	}
+
+	assert( kNoEntity == mSparse[entity] );
+	mSparse[entity] = std::uint32_t(mDense.size());
+
+	mDense.emplace_back( entity );
+	mMeshes.emplace_back( aMesh );
+	mMaterials.emplace_back( aMaterial );
+	mTransforms.emplace_back( aTransform );
+	mBounds.emplace_back( aBounds );
+	mSequence.emplace_back( mNextSequence++ );
+
+	mSorted = false;
+	return entity;
+}
+
+void RenderableStore::destroy( Entity aEntity )
+{
+	assert( contains( aEntity ) );
+
+	auto const index = mSparse[aEntity];
+	auto const last = std::uint32_t(mDense.size() - 1);
+
+	if( index != last )
+	{
+		auto const moved = mDense[last];
+
+		mDense[index] = moved;
+		mMeshes[index] = mMeshes[last];
+		mMaterials[index] = mMaterials[last];
+		mTransforms[index] = mTransforms[last];
+		mBounds[index] = mBounds[last];
+		mSequence[index] = mSequence[last];
+
+		mSparse[moved] = index;
+		mSorted = false;
+	}
+
+	mDense.pop_back();
+	mMeshes.pop_back();
+	mMaterials.pop_back();
+	mTransforms.pop_back();
+	mBounds.pop_back();
+	mSequence.pop_back();
+
+	mSparse[aEntity] = kNoEntity;
+	mFreeEntities.emplace_back( aEntity );
+}
+
+bool RenderableStore::contains( Entity aEntity ) const noexcept
+{
+	return aEntity < mSparse.size() && kNoEntity != mSparse[aEntity];
+}
+
+void RenderableStore::set_first_ordered_pipeline( std::uint32_t aPipeline ) noexcept
+{
+	if( aPipeline != mFirstOrderedPipeline )
+		mSorted = false;
+
+	mFirstOrderedPipeline = aPipeline;
+}
+
+void RenderableStore::sort_by_material()
+{
+	if( mSorted )
+		return;
+
+	// Sort compact keys rather than indices into the material array. The
+	// creation sequence number breaks ties; the dense index can't, as
+	// destroy() moves elements around.
+	struct SortKey_
+	{
+		std::uint32_t pipeline;
+		std::uint32_t index;
+		VkDescriptorSet descriptors;
+		std::uint64_t sequence;
+		std::uint32_t texture;
+	};
+
+	std::vector<SortKey_> keys;
+	keys.reserve( mDense.size() );
+	for( std::uint32_t i = 0; i < mDense.size(); ++i )
+		keys.emplace_back( SortKey_{ mMaterials[i].pipeline, i, mMaterials[i].descriptors, mSequence[i], mMaterials[i].texture } );
+
+	auto const firstOrdered = mFirstOrderedPipeline;
+	std::sort( keys.begin(), keys.end(), [firstOrdered] (SortKey_ const& aX, SortKey_ const& aY) {
+		if( aX.pipeline != aY.pipeline )
+			return aX.pipeline < aY.pipeline;
+		if( aX.pipeline >= firstOrdered )
+			return aX.sequence < aY.sequence;
+		if( aX.descriptors != aY.descriptors )
+			return std::less<VkDescriptorSet>()( aX.descriptors, aY.descriptors );
+		if( aX.texture != aY.texture )
+			return aX.texture < aY.texture;
+		return aX.sequence < aY.sequence;
+	} );
+
+	std::vector<std::uint32_t> order;
+	order.reserve( keys.size() );
+	for( auto const& key : keys )
+		order.emplace_back( key.index );
+
+	permute_( order );
+	mSorted = true;
+}
+
+void RenderableStore::permute_( std::vector<std::uint32_t> const& aOrder )
+{
+	assert( aOrder.size() == mDense.size() );
+
+	{
+		std::vector<Entity> scratch;
+		gather_( mDense, aOrder, scratch );
+	}
+	{
+		std::vector<MeshRef> scratch;
+		gather_( mMeshes, aOrder, scratch );
+	}
+	{
+		std::vector<Material> scratch;
+		gather_( mMaterials, aOrder, scratch );
+	}
+	{
+		std::vector<SceneGraph::NodeId> scratch;
+		gather_( mTransforms, aOrder, scratch );
+	}
+	{
+		std::vector<Bounds> scratch;
+		gather_( mBounds, aOrder, scratch );
+	}
+	{
+		std::vector<std::uint64_t> scratch;
+		gather_( mSequence, aOrder, scratch );
+	}
+
+	for( std::uint32_t i = 0; i < mDense.size(); ++i )
+		mSparse[mDense[i]] = i;
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <volk/volk.h>
+
+#include <vector>
+#include <cstdint>
+
+#if !defined(GLM_FORCE_RADIANS)
+#	define GLM_FORCE_RADIANS
+#endif
+#include <glm/glm.hpp>
+
+#include "scene_graph.hpp"
+
+/* Entity storage for renderable objects.
+ *
+ * A sparse set: entities are small integer IDs, the sparse array maps an
+ * entity to its index in the dense arrays, and each component type lives in
+ * its own tightly packed dense array. All dense arrays have the same order,
+ * so the renderer walks them linearly without ever touching the sparse
+ * array. Destroying an entity moves the last element into its slot, keeping
+ * the arrays packed.
+ *
+ * Entity IDs of destroyed entities are reused.
+ */
+using Entity = std::uint32_t;
+constexpr Entity kNoEntity = ~Entity(0);
+
+struct MeshRef
+{
+	VkBuffer positions;
+	VkBuffer textureCoords;
+
+	std::uint32_t vertexCount;
+
+	// Vertex pulling (shaderTexPulled.vert): device addresses of the first
+	// position (three floats) and texture coordinate (two floats), and the
+	// distance between consecutive vertices, in floats. Other layouts, e.g.,
+	// interleaved attributes, only differ in these values.
+	VkDeviceAddress positionAddress = 0;
+	VkDeviceAddress textureCoordAddress = 0;
+	std::uint32_t positionStride = 3;
+	std::uint32_t textureCoordStride = 2;
+};
+
+struct Material
+{
+	// Index into the renderer's pipeline table (pipelines are recreated
+	// along with the swapchain, so handles are not stored here). Lower
+	// indices are drawn first.
+	std::uint32_t pipeline;
+
+	// VK_NULL_HANDLE to use the descriptor set of `texture` for the frame
+	// slot (the TextureStreamer owns these, as it replaces images)
+	VkDescriptorSet descriptors;
+
+	// Streamed texture (a TextureStreamer id); its resident mip range is
+	// passed to the fragment shader.
+	std::uint32_t texture;
+};
+
+// Object space axis aligned bounding box
+struct Bounds
+{
+	glm::vec3 min;
+	glm::vec3 max;
+};
+
+class RenderableStore
+{
+	public:
+		void reserve( std::size_t );
+
+		Entity create( MeshRef const&, Material const&, SceneGraph::NodeId aTransform, Bounds const& );
+		void destroy( Entity );
+
+		bool contains( Entity ) const noexcept;
+		std::size_t size() const noexcept { return mDense.size(); }
+
+		// Dense index of an entity; valid until the next create(), destroy()
+		// or sort_by_material().
+		std::uint32_t index_of( Entity aEntity ) const noexcept { return mSparse[aEntity]; }
+
+		// Dense component arrays. Element i of each array belongs to
+		// entities()[i].
+		Entity const* entities() const noexcept { return mDense.data(); }
+
+		MeshRef const* meshes() const noexcept { return mMeshes.data(); }
+		Material const* materials() const noexcept { return mMaterials.data(); }
+		SceneGraph::NodeId const* transforms() const noexcept { return mTransforms.data(); }
+		Bounds const* bounds() const noexcept { return mBounds.data(); }
+
+		MeshRef& mesh( Entity aEntity ) noexcept { return mMeshes[index_of(aEntity)]; }
+		Material& material( Entity aEntity ) noexcept { mSorted = false; return mMaterials[index_of(aEntity)]; }
+		SceneGraph::NodeId& transform( Entity aEntity ) noexcept { return mTransforms[index_of(aEntity)]; }
+		Bounds& bounds( Entity aEntity ) noexcept { return mBounds[index_of(aEntity)]; }
+
+		// Pipelines from aPipeline on (e.g., blended ones) are drawn in
+		// creation order; see sort_by_material(). By default, no pipeline
+		// is.
+		void set_first_ordered_pipeline( std::uint32_t aPipeline ) noexcept;
+
+		// Orders the dense arrays by pipeline. Within a pipeline below the
+		// first ordered one, objects are ordered by descriptor set and
+		// texture, so that a linear walk changes state as rarely as
+		// possible, and objects with the same material stay in creation
+		// order. Within an ordered pipeline, objects are in creation order
+		// only (e.g., back-to-front order of blended objects), whatever
+		// their materials. Creation order is unaffected by earlier
+		// destroy()s. Does nothing if no materials changed since the last
+		// call.
+		void sort_by_material();
+
+	private:
+		void permute_( std::vector<std::uint32_t> const& );
+
+	private:
+		std::vector<std::uint32_t> mSparse; // entity -> dense index (or kNoEntity)
+		std::vector<Entity> mFreeEntities;
+
+		std::vector<Entity> mDense; // dense index -> entity
+		std::vector<MeshRef> mMeshes;
+		std::vector<Material> mMaterials;
+		std::vector<SceneGraph::NodeId> mTransforms;
+		std::vector<Bounds> mBounds;
+		std::vector<std::uint64_t> mSequence; // creation order; sort tie-breaker
+
+		std::uint64_t mNextSequence = 0;
+		std::uint32_t mFirstOrderedPipeline = ~std::uint32_t(0);
+		bool mSorted = true;
+};
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
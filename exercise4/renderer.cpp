@@ -0,0 +1,1005 @@
+#include "renderer.hpp"
+
+#include <limits>
+
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+
+#include <glm/gtx/transform.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "../labutils/to_string.hpp"
+
+#include "../labutils/angle.hpp"
+using namespace labutils::literals;
+
+#include "../labutils/error.hpp"
+#include "../labutils/vkutil.hpp"
+namespace lut = labutils;
+
+namespace
+{
+	namespace cfg
+	{
+		// Compiled shader code for the graphics pipeline
+		// See sources in exercise4/shaders/*. 
+#		define ASSETDIR_ "assets/exercise4/"
+		constexpr char const* kFloorTexture = ASSETDIR_ "asphalt.png";
+		constexpr char const* kSpriteTexture = ASSETDIR_ "explosion.png";
+
+#		define SHADERDIR_ ASSETDIR_ "shaders/"
+		constexpr char const* kVertShaderPath = SHADERDIR_ "shaderTexObject.vert.spv";
+
+		// With vertex pulling (buffer device addresses; no vertex input)
+		constexpr char const* kPulledVertShaderPath = SHADERDIR_ "shaderTexPulled.vert.spv";
+		constexpr char const* kFragShaderPath = SHADERDIR_ "shaderTexStreamed.frag.spv";
+
+		constexpr char const* kAlphaFragShaderPath = SHADERDIR_ "shaderTexStreamedAlpha.frag.spv";
+
+		// With texture feedback (see lut::TextureStreamer)
+		constexpr char const* kFeedbackFragShaderPath = SHADERDIR_ "shaderTexFeedback.frag.spv";
+		constexpr char const* kFeedbackAlphaFragShaderPath = SHADERDIR_ "shaderTexFeedbackAlpha.frag.spv";
+#		undef SHADERDIR_
+#		undef ASSETDIR_
+
+		// General rule: with a standard 24 bit or 32 bit float depth buffer,
+		// you can support a 1:1000 ratio between the near and far plane with
+		// minimal depth fighting. Larger ratios will introduce more depth
+		// fighting problems; smaller ratios will increase the depth buffer's
+		// resolution but will also limit the view distance.
+		constexpr float kCameraNear  = 0.1f;
+		constexpr float kCameraFar   = 100.f;
+
+		constexpr auto kCameraFov    = 60.0_degf;
+
+		constexpr VkFormat kDepthFormat = VK_FORMAT_D32_SFLOAT;
+	}
+
+	TransformUpload stage_transforms_(
+		lut::Allocator const&,
+		SceneGraph const&,
+		SceneGraph::DirtyRange const&,
+		lut::Buffer const& aStaging,
+		VkBuffer aTransforms
+	);
+}
+
+bool supports_texture_feedback( lut::VulkanContext const& aContext )
+{
+	return VK_TRUE == aContext.enabledFeatures.fragmentStoresAndAtomics;
+}
+
+Scene create_scene( lut::VulkanContext const& aContext, lut::Allocator const& aAllocator, lut::TextureStreamer& aTextures, VkDescriptorSetLayout aSceneLayout, std::uint32_t aFrameSlots )
+{
+	Scene ret;
+
+	ret.planeMesh = create_plane_mesh( aContext, aAllocator );
+	ret.spriteMesh = create_sprite_mesh( aContext, aAllocator );
+
+	ret.sceneUBO = lut::create_buffer(
+		aAllocator,
+		sizeof(glsl::SceneUniform),
+		VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VMA_MEMORY_USAGE_GPU_ONLY
+	);
+
+	// Scene hierarchy
+	SceneGraph::NodeId const rootNode = ret.graph.add_node( SceneGraph::kNoParent );
+	SceneGraph::NodeId const floorNode = ret.graph.add_node( rootNode );
+	SceneGraph::NodeId const spriteNode = ret.graph.add_node( rootNode );
+
+	VkDeviceSize const transformBytes = ret.graph.size() * sizeof(glm::mat4);
+
+	ret.transforms = lut::create_buffer(
+		aAllocator,
+		transformBytes,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VMA_MEMORY_USAGE_GPU_ONLY
+	);
+
+	for( std::uint32_t i = 0; i < aFrameSlots; ++i )
+	{
+		ret.transformStaging.emplace_back( lut::create_buffer(
+			aAllocator,
+			transformBytes,
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VMA_MEMORY_USAGE_CPU_TO_GPU
+		) );
+	}
+
+	ret.descriptorPool = lut::create_descriptor_pool( aContext );
+
+	ret.sceneDescriptors = lut::alloc_desc_set( aContext, ret.descriptorPool.handle, aSceneLayout );
+	{
+		VkDescriptorBufferInfo sceneUBOInfo{}; {
+			sceneUBOInfo.buffer = ret.sceneUBO.buffer;
+			sceneUBOInfo.range = VK_WHOLE_SIZE;
+		}
+		VkDescriptorBufferInfo transformInfo{}; {
+			transformInfo.buffer = ret.transforms.buffer;
+			transformInfo.range = VK_WHOLE_SIZE;
+		}
+
+		VkWriteDescriptorSet writeDescriptorSets[2]{}; {
+			writeDescriptorSets[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+
+			writeDescriptorSets[0].dstSet = ret.sceneDescriptors;
+			writeDescriptorSets[0].dstBinding = 0;
+
+			writeDescriptorSets[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+			writeDescriptorSets[0].descriptorCount = 1;
+			writeDescriptorSets[0].pBufferInfo = &sceneUBOInfo;
+
+			writeDescriptorSets[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+
+			writeDescriptorSets[1].dstSet = ret.sceneDescriptors;
+			writeDescriptorSets[1].dstBinding = 1;
+
+			writeDescriptorSets[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			writeDescriptorSets[1].descriptorCount = 1;
+			writeDescriptorSets[1].pBufferInfo = &transformInfo;
+		}
+
+		constexpr auto numDescriptorSets = sizeof(writeDescriptorSets) / sizeof(writeDescriptorSets[0]);
+		vkUpdateDescriptorSets( aContext.device, numDescriptorSets, writeDescriptorSets, 0, nullptr );
+	}
+
+	auto const floorTexture = aTextures.request( cfg::kFloorTexture );
+	auto const spriteTexture = aTextures.request( cfg::kSpriteTexture );
+
+	// Renderable objects. Blended objects are drawn in the order they are
+	// created in.
+	ret.renderables.set_first_ordered_pipeline( std::uint32_t(EPipeline::alpha) );
+
+	auto const& plane = ret.planeMesh;
+	ret.renderables.create(
+		MeshRef{ plane.positions.buffer, plane.textureCoords.buffer, plane.vertexCount, plane.positionAddress, plane.textureCoordAddress },
+		Material{ std::uint32_t(EPipeline::opaque), VK_NULL_HANDLE, floorTexture },
+		floorNode,
+		Bounds{ plane.boundsMin, plane.boundsMax }
+	);
+
+	auto const& sprite = ret.spriteMesh;
+	ret.renderables.create(
+		MeshRef{ sprite.positions.buffer, sprite.textureCoords.buffer, sprite.vertexCount, sprite.positionAddress, sprite.textureCoordAddress },
+		Material{ std::uint32_t(EPipeline::alpha), VK_NULL_HANDLE, spriteTexture },
+		spriteNode,
+		Bounds{ sprite.boundsMin, sprite.boundsMax }
+	);
+
+	return ret;
+}
+
+void update_scene_uniforms( glsl::SceneUniform& aSceneUniforms, std::uint32_t aFramebufferWidth, std::uint32_t aFramebufferHeight, glm::mat4 const& aCamera2World )
+{
+	float const aspect = aFramebufferWidth / float(aFramebufferHeight);
+
+	aSceneUniforms.projection = glm::perspectiveRH_ZO(
+		lut::Radians(cfg::kCameraFov).value(),
+		aspect,
+		cfg::kCameraNear, cfg::kCameraFar
+	);
+	aSceneUniforms.projection[1][1] *= -1.0f;
+
+	aSceneUniforms.camera = glm::inverse(aCamera2World);
+
+	aSceneUniforms.projCam = aSceneUniforms.projection * aSceneUniforms.camera;
+}
+
+TransformUpload prepare_scene( lut::Allocator const& aAllocator, Scene& aScene, std::uint32_t aFrameSlot )
+{
+	assert( aFrameSlot < aScene.transformStaging.size() );
+
+	auto const dirtyTransforms = aScene.graph.update();
+	auto const ret = stage_transforms_( aAllocator, aScene.graph, dirtyTransforms, aScene.transformStaging[aFrameSlot], aScene.transforms.buffer );
+
+	aScene.renderables.sort_by_material();
+
+	return ret;
+}
+
+lut::RenderPass create_render_pass( lut::VulkanContext const& aContext, VkFormat aColorFormat, VkImageLayout aColorFinalLayout )
+{
+	VkAttachmentDescription attachments[2]{}; {
+		attachments[0].format = aColorFormat;
+		attachments[0].samples = VK_SAMPLE_COUNT_1_BIT;
+		attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		attachments[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		attachments[0].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		attachments[0].finalLayout = aColorFinalLayout;
+
+		attachments[1].format = cfg::kDepthFormat;
+		attachments[1].samples = VK_SAMPLE_COUNT_1_BIT;
+		attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		attachments[1].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		attachments[1].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		attachments[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	}
+
+	VkAttachmentReference subpassAttachments[1]{}; {
+		subpassAttachments[0].attachment = 0;
+		subpassAttachments[0].layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	}
+	VkAttachmentReference depthAttachment{}; {
+		depthAttachment.attachment = 1;
+		depthAttachment.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	}
+	
+	VkSubpassDescription subpasses[1]{}; {
+		subpasses[0].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+
+		subpasses[0].colorAttachmentCount = 1;
+		subpasses[0].pColorAttachments = subpassAttachments;
+
+		subpasses[0].pDepthStencilAttachment = &depthAttachment;
+	}
+
+	// Successive frames render into the same depth attachment (and, when
+	// rendering offscreen, the same color attachment). Make sure that the
+	// previous frame's writes have finished before the next frame clears them.
+	VkSubpassDependency dependencies[1]{}; {
+		dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+		dependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+		dependencies[0].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+		dependencies[0].dstSubpass = 0;
+		dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+		dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	}
+
+	VkRenderPassCreateInfo renderPassInfo{}; {
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+
+		renderPassInfo.attachmentCount = sizeof(attachments) / sizeof(attachments[0]);
+		renderPassInfo.pAttachments = attachments;
+
+		renderPassInfo.subpassCount = 1;
+		renderPassInfo.pSubpasses = subpasses;
+
+		renderPassInfo.dependencyCount = sizeof(dependencies) / sizeof(dependencies[0]);
+		renderPassInfo.pDependencies = dependencies;
+	}
+
+	VkRenderPass renderPass = VK_NULL_HANDLE;
+	if (auto const res = vkCreateRenderPass(aContext.device, &renderPassInfo, nullptr, &renderPass); res != VK_SUCCESS)
+	{
+		throw lut::Error("Unable to Create Render Pass\n"
+			"vkCreateRenderPass() returned %s", lut::to_string(res).c_str());
+	}
+
+	return lut::RenderPass(aContext.device, renderPass);
+}
+
+
+lut::PipelineLayout create_pipeline_layout( lut::VulkanContext const& aContext, VkDescriptorSetLayout aSceneLayout, VkDescriptorSetLayout aObjectLayout )
+{
+	VkDescriptorSetLayout descriptorSetLayouts[] = {
+		aSceneLayout,
+		aObjectLayout
+	};
+
+	VkPushConstantRange pushConstantRange{}; {
+		pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+		pushConstantRange.offset = 0;
+		pushConstantRange.size = sizeof(glsl::ObjectPush);
+	}
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{}; {
+		pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+
+		pipelineLayoutInfo.setLayoutCount = sizeof(descriptorSetLayouts) / sizeof(descriptorSetLayouts[0]);
+		pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts;
+
+		pipelineLayoutInfo.pushConstantRangeCount = 1;
+		pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+	}
+
+	VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+	if (auto const res = vkCreatePipelineLayout(aContext.device, &pipelineLayoutInfo, nullptr, &pipelineLayout); res != VK_SUCCESS)
+	{
+		throw lut::Error("Unable to Create Pipeline Layout\n"
+			"vkCreatePipelineLayout() returned %s", lut::to_string(res).c_str());
+	}
+
+	return lut::PipelineLayout(aContext.device, pipelineLayout);
+}
+lut::Pipeline create_pipeline( lut::VulkanContext const& aContext, VkExtent2D aExtent, VkFormat aColorFormat, VkRenderPass aRenderPass, VkPipelineLayout aPipelineLayout, bool aTextureFeedback, bool aVertexPulling )
+{
+	lut::ShaderModule vertShader = lut::load_shader_module(aContext, aVertexPulling ? cfg::kPulledVertShaderPath : cfg::kVertShaderPath);
+	lut::ShaderModule fragShader = lut::load_shader_module(aContext, aTextureFeedback ? cfg::kFeedbackFragShaderPath : cfg::kFragShaderPath);
+
+	VkPipelineShaderStageCreateInfo shaderStagesInfo[2]{}; {
+		shaderStagesInfo[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		shaderStagesInfo[0].pName = "main";
+
+		shaderStagesInfo[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+		shaderStagesInfo[0].module = vertShader.handle;
+
+		shaderStagesInfo[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		shaderStagesInfo[1].pName = "main";
+
+		shaderStagesInfo[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+		shaderStagesInfo[1].module = fragShader.handle;
+	}
+
+	VkVertexInputBindingDescription vertexInputBindings[2]{}; {
+		vertexInputBindings[0].binding = 0;
+		vertexInputBindings[0].stride = sizeof(float) * 3;
+		vertexInputBindings[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+	
+		vertexInputBindings[1].binding = 1;
+		vertexInputBindings[1].stride = sizeof(float) * 2;
+		vertexInputBindings[1].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+	}
+
+	VkVertexInputAttributeDescription vertexInputAttributes[2]{}; {
+		vertexInputAttributes[0].binding = 0;
+		vertexInputAttributes[0].location = 0;
+		vertexInputAttributes[0].format = VK_FORMAT_R32G32B32_SFLOAT;
+		vertexInputAttributes[0].offset = 0;
+
+		vertexInputAttributes[1].binding = 1;
+		vertexInputAttributes[1].location = 1;
+		vertexInputAttributes[1].format = VK_FORMAT_R32G32_SFLOAT;
+		vertexInputAttributes[1].offset = 0;
+	}
+
+	// Vertex pulling: no vertex input at all
+	VkPipelineVertexInputStateCreateInfo vertexInputInfo{}; {
+		vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	
+		vertexInputInfo.vertexBindingDescriptionCount = aVertexPulling ? 0 : 2;
+		vertexInputInfo.pVertexBindingDescriptions = vertexInputBindings;
+
+		vertexInputInfo.vertexAttributeDescriptionCount = aVertexPulling ? 0 : 2;
+		vertexInputInfo.pVertexAttributeDescriptions = vertexInputAttributes;
+	}
+	VkPipelineInputAssemblyStateCreateInfo assemblyStateInfo{}; {
+		assemblyStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+
+		assemblyStateInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+		assemblyStateInfo.primitiveRestartEnable = VK_FALSE;
+	}
+	
+	VkViewport viewport{}; {
+		viewport.x = 0.0f;
+		viewport.y = 0.0f;
+		
+		viewport.width = float(aExtent.width);
+		viewport.height = float(aExtent.height);
+
+		viewport.minDepth = 0.0f;
+		viewport.maxDepth = 1.0f;
+	}
+	VkRect2D scissor{}; {
+		scissor.offset = VkOffset2D{0, 0};
+		scissor.extent = aExtent;
+	}
+	VkPipelineViewportStateCreateInfo viewportStateInfo{}; {
+		viewportStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+
+		viewportStateInfo.viewportCount = 1;
+		viewportStateInfo.pViewports = &viewport;
+
+		viewportStateInfo.scissorCount = 1;
+		viewportStateInfo.pScissors = &scissor;
+	}
+	
+	VkPipelineRasterizationStateCreateInfo rasterizationStateInfo{}; {
+		rasterizationStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+
+		rasterizationStateInfo.depthClampEnable = VK_FALSE;
+		rasterizationStateInfo.rasterizerDiscardEnable = VK_FALSE;
+		rasterizationStateInfo.depthBiasEnable = VK_FALSE;
+
+		rasterizationStateInfo.polygonMode = VK_POLYGON_MODE_FILL;
+		rasterizationStateInfo.cullMode = VK_CULL_MODE_BACK_BIT;
+		rasterizationStateInfo.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+
+		rasterizationStateInfo.lineWidth = 1.0f;
+	}
+	
+	VkPipelineMultisampleStateCreateInfo multisamplingStateInfo{}; {
+		multisamplingStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+
+		multisamplingStateInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+	}
+	
+	VkPipelineDepthStencilStateCreateInfo depthStencilStateInfo{}; {
+		depthStencilStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+
+		depthStencilStateInfo.depthTestEnable = VK_TRUE;
+		depthStencilStateInfo.depthWriteEnable = VK_TRUE;
+		depthStencilStateInfo.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+
+		depthStencilStateInfo.minDepthBounds = 0.0f;
+		depthStencilStateInfo.maxDepthBounds = 1.0f;
+	}
+
+	VkPipelineColorBlendAttachmentState colourBlendAttachmentStates[1]{}; {
+		colourBlendAttachmentStates[0].blendEnable = VK_FALSE;
+		colourBlendAttachmentStates[0].colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+	}
+	VkPipelineColorBlendStateCreateInfo colourBlendStateInfo{}; {
+		colourBlendStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+
+		colourBlendStateInfo.logicOpEnable = VK_FALSE;
+
+		colourBlendStateInfo.attachmentCount = 1;
+		colourBlendStateInfo.pAttachments = colourBlendAttachmentStates;
+	}
+	
+	VkGraphicsPipelineCreateInfo graphicsPipelineInfo{}; {
+		graphicsPipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+
+		graphicsPipelineInfo.stageCount = 2;
+		graphicsPipelineInfo.pStages = shaderStagesInfo;
+
+		graphicsPipelineInfo.pVertexInputState = &vertexInputInfo;
+		graphicsPipelineInfo.pInputAssemblyState = &assemblyStateInfo;
+		graphicsPipelineInfo.pTessellationState = nullptr;
+		graphicsPipelineInfo.pViewportState = &viewportStateInfo;
+		graphicsPipelineInfo.pRasterizationState = &rasterizationStateInfo;
+		graphicsPipelineInfo.pMultisampleState = &multisamplingStateInfo;
+		graphicsPipelineInfo.pDepthStencilState = &depthStencilStateInfo;
+		graphicsPipelineInfo.pColorBlendState = &colourBlendStateInfo;
+		graphicsPipelineInfo.pDynamicState = nullptr;
+
+		graphicsPipelineInfo.layout = aPipelineLayout;
+		graphicsPipelineInfo.renderPass = aRenderPass;
+		graphicsPipelineInfo.subpass = 0;
+	}
+
+	// Dynamic rendering (no render pass): specify attachment formats directly
+	VkPipelineRenderingCreateInfo renderingInfo{}; {
+		renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+
+		renderingInfo.colorAttachmentCount = 1;
+		renderingInfo.pColorAttachmentFormats = &aColorFormat;
+		renderingInfo.depthAttachmentFormat = cfg::kDepthFormat;
+	}
+
+	if (VK_NULL_HANDLE == aRenderPass)
+		graphicsPipelineInfo.pNext = &renderingInfo;
+	
+	VkPipeline graphicsPipeline = VK_NULL_HANDLE;
+	if (auto const res = vkCreateGraphicsPipelines(aContext.device, VK_NULL_HANDLE, 1, &graphicsPipelineInfo, nullptr, &graphicsPipeline); res != VK_SUCCESS)
+	{
+		throw lut::Error("Unable to Create Graphics Pipeline\n"
+			"vkCreateGraphicsPipeline() returned %s", lut::to_string(res).c_str());
+	}
+	
+	return lut::Pipeline(aContext.device, graphicsPipeline);
+}
+lut::Pipeline create_alpha_pipeline( lut::VulkanContext const& aContext, VkExtent2D aExtent, VkFormat aColorFormat, VkRenderPass aRenderPass, VkPipelineLayout aPipelineLayout, bool aTextureFeedback, bool aVertexPulling )
+{
+	lut::ShaderModule vertShader = lut::load_shader_module(aContext, aVertexPulling ? cfg::kPulledVertShaderPath : cfg::kVertShaderPath);
+	lut::ShaderModule fragShader = lut::load_shader_module(aContext, aTextureFeedback ? cfg::kFeedbackAlphaFragShaderPath : cfg::kAlphaFragShaderPath);
+
+	VkPipelineShaderStageCreateInfo shaderStagesInfo[2]{}; {
+		shaderStagesInfo[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		shaderStagesInfo[0].pName = "main";
+
+		shaderStagesInfo[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+		shaderStagesInfo[0].module = vertShader.handle;
+
+		shaderStagesInfo[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+		shaderStagesInfo[1].pName = "main";
+
+		shaderStagesInfo[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+		shaderStagesInfo[1].module = fragShader.handle;
+	}
+
+	VkVertexInputBindingDescription vertexInputBindings[2]{}; {
+		vertexInputBindings[0].binding = 0;
+		vertexInputBindings[0].stride = sizeof(float) * 3;
+		vertexInputBindings[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+	
+		vertexInputBindings[1].binding = 1;
+		vertexInputBindings[1].stride = sizeof(float) * 2;
+		vertexInputBindings[1].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+	}
+
+	VkVertexInputAttributeDescription vertexInputAttributes[2]{}; {
+		vertexInputAttributes[0].binding = 0;
+		vertexInputAttributes[0].location = 0;
+		vertexInputAttributes[0].format = VK_FORMAT_R32G32B32_SFLOAT;
+		vertexInputAttributes[0].offset = 0;
+
+		vertexInputAttributes[1].binding = 1;
+		vertexInputAttributes[1].location = 1;
+		vertexInputAttributes[1].format = VK_FORMAT_R32G32_SFLOAT;
+		vertexInputAttributes[1].offset = 0;
+	}
+
+	// Vertex pulling: no vertex input at all
+	VkPipelineVertexInputStateCreateInfo vertexInputInfo{}; {
+		vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	
+		vertexInputInfo.vertexBindingDescriptionCount = aVertexPulling ? 0 : 2;
+		vertexInputInfo.pVertexBindingDescriptions = vertexInputBindings;
+
+		vertexInputInfo.vertexAttributeDescriptionCount = aVertexPulling ? 0 : 2;
+		vertexInputInfo.pVertexAttributeDescriptions = vertexInputAttributes;
+	}
+	VkPipelineInputAssemblyStateCreateInfo assemblyStateInfo{}; {
+		assemblyStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+
+		assemblyStateInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+		assemblyStateInfo.primitiveRestartEnable = VK_FALSE;
+	}
+	
+	VkViewport viewport{}; {
+		viewport.x = 0.0f;
+		viewport.y = 0.0f;
+		
+		viewport.width = float(aExtent.width);
+		viewport.height = float(aExtent.height);
+
+		viewport.minDepth = 0.0f;
+		viewport.maxDepth = 1.0f;
+	}
+	VkRect2D scissor{}; {
+		scissor.offset = VkOffset2D{0, 0};
+		scissor.extent = aExtent;
+	}
+	VkPipelineViewportStateCreateInfo viewportStateInfo{}; {
+		viewportStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+
+		viewportStateInfo.viewportCount = 1;
+		viewportStateInfo.pViewports = &viewport;
+
+		viewportStateInfo.scissorCount = 1;
+		viewportStateInfo.pScissors = &scissor;
+	}
+	
+	VkPipelineRasterizationStateCreateInfo rasterizationStateInfo{}; {
+		rasterizationStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+
+		rasterizationStateInfo.depthClampEnable = VK_FALSE;
+		rasterizationStateInfo.rasterizerDiscardEnable = VK_FALSE;
+		rasterizationStateInfo.depthBiasEnable = VK_FALSE;
+
+		rasterizationStateInfo.polygonMode = VK_POLYGON_MODE_FILL;
+		rasterizationStateInfo.cullMode = VK_CULL_MODE_BACK_BIT;
+		rasterizationStateInfo.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+
+		rasterizationStateInfo.lineWidth = 1.0f;
+	}
+	
+	VkPipelineMultisampleStateCreateInfo multisamplingStateInfo{}; {
+		multisamplingStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+
+		multisamplingStateInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+	}
+	
+	VkPipelineDepthStencilStateCreateInfo depthStencilStateInfo{}; {
+		depthStencilStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+
+		depthStencilStateInfo.depthTestEnable = VK_TRUE;
+		depthStencilStateInfo.depthWriteEnable = VK_TRUE;
+		depthStencilStateInfo.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+
+		depthStencilStateInfo.minDepthBounds = 0.0f;
+		depthStencilStateInfo.maxDepthBounds = 1.0f;
+	}
+
+	VkPipelineColorBlendAttachmentState colourBlendAttachmentStates[1]{}; {
+		colourBlendAttachmentStates[0].blendEnable = VK_TRUE;
+
+		colourBlendAttachmentStates[0].colorBlendOp = VK_BLEND_OP_ADD;
+
+		colourBlendAttachmentStates[0].srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+		colourBlendAttachmentStates[0].dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+
+		colourBlendAttachmentStates[0].colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+	}
+	VkPipelineColorBlendStateCreateInfo colourBlendStateInfo{}; {
+		colourBlendStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+
+		colourBlendStateInfo.logicOpEnable = VK_FALSE;
+
+		colourBlendStateInfo.attachmentCount = 1;
+		colourBlendStateInfo.pAttachments = colourBlendAttachmentStates;
+	}
+	
+	VkGraphicsPipelineCreateInfo graphicsPipelineInfo{}; {
+		graphicsPipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+
+		graphicsPipelineInfo.stageCount = 2;
+		graphicsPipelineInfo.pStages = shaderStagesInfo;
+
+		graphicsPipelineInfo.pVertexInputState = &vertexInputInfo;
+		graphicsPipelineInfo.pInputAssemblyState = &assemblyStateInfo;
+		graphicsPipelineInfo.pTessellationState = nullptr;
+		graphicsPipelineInfo.pViewportState = &viewportStateInfo;
+		graphicsPipelineInfo.pRasterizationState = &rasterizationStateInfo;
+		graphicsPipelineInfo.pMultisampleState = &multisamplingStateInfo;
+		graphicsPipelineInfo.pDepthStencilState = &depthStencilStateInfo;
+		graphicsPipelineInfo.pColorBlendState = &colourBlendStateInfo;
+		graphicsPipelineInfo.pDynamicState = nullptr;
+
+		graphicsPipelineInfo.layout = aPipelineLayout;
+		graphicsPipelineInfo.renderPass = aRenderPass;
+		graphicsPipelineInfo.subpass = 0;
+	}
+
+	// Dynamic rendering (no render pass): specify attachment formats directly
+	VkPipelineRenderingCreateInfo renderingInfo{}; {
+		renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+
+		renderingInfo.colorAttachmentCount = 1;
+		renderingInfo.pColorAttachmentFormats = &aColorFormat;
+		renderingInfo.depthAttachmentFormat = cfg::kDepthFormat;
+	}
+
+	if (VK_NULL_HANDLE == aRenderPass)
+		graphicsPipelineInfo.pNext = &renderingInfo;
+	
+	VkPipeline graphicsPipeline = VK_NULL_HANDLE;
+	if (auto const res = vkCreateGraphicsPipelines(aContext.device, VK_NULL_HANDLE, 1, &graphicsPipelineInfo, nullptr, &graphicsPipeline); res != VK_SUCCESS)
+	{
+		throw lut::Error("Unable to Create Graphics Pipeline\n"
+			"vkCreateGraphicsPipeline() returned %s", lut::to_string(res).c_str());
+	}
+	
+	return lut::Pipeline(aContext.device, graphicsPipeline);
+}
+
+lut::TransientAttachments create_depth_buffer( lut::VulkanContext const& aContext, lut::Allocator const& aAllocator, VkExtent2D aExtent )
+{
+	// The depth buffer is only used during rendering (it is cleared on load
+	// and not stored), so it can be a transient attachment.
+	std::vector<lut::TransientAttachmentDesc> descs(1); {
+		descs[0].format = cfg::kDepthFormat;
+		descs[0].extent = aExtent;
+
+		descs[0].usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+		descs[0].aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+
+		descs[0].firstPass = 0;
+		descs[0].lastPass = 0;
+	}
+
+	auto ret = lut::create_transient_attachments(aContext, aAllocator, descs);
+	lut::print_transient_report(stderr, ret.report);
+
+	return ret;
+}
+
+lut::DescriptorSetLayout create_scene_descriptor_layout( lut::VulkanContext const& aContext )
+{
+	VkDescriptorSetLayoutBinding descriptorSetLayoutBindings[2]{}; {
+		descriptorSetLayoutBindings[0].binding = 0;
+
+		descriptorSetLayoutBindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		descriptorSetLayoutBindings[0].descriptorCount = 1;
+		descriptorSetLayoutBindings[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+
+		// Object world transforms
+		descriptorSetLayoutBindings[1].binding = 1;
+
+		descriptorSetLayoutBindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		descriptorSetLayoutBindings[1].descriptorCount = 1;
+		descriptorSetLayoutBindings[1].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	}
+	VkDescriptorSetLayoutCreateInfo descriptorSetLayoutInfo{}; {
+		descriptorSetLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+
+		descriptorSetLayoutInfo.bindingCount = sizeof(descriptorSetLayoutBindings) / sizeof(descriptorSetLayoutBindings[0]);
+		descriptorSetLayoutInfo.pBindings = descriptorSetLayoutBindings;
+	}
+
+	VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+	if (auto const res = vkCreateDescriptorSetLayout(aContext.device, &descriptorSetLayoutInfo, nullptr, &descriptorSetLayout);
+		res != VK_SUCCESS)
+	{
+		throw lut::Error("Unable to Create Descriptor Set Layout\n"
+			"vkCreateDescriptorSetLayout() Returned %s", lut::to_string(res).c_str());
+	}
+
+	return lut::DescriptorSetLayout(aContext.device, descriptorSetLayout);
+}
+
+DrawStats record_commands(
+	VkCommandBuffer aCmdBuff,
+	RenderTarget const& aTarget,
+	VkExtent2D const& aImageExtent,
+	Scene const& aScene,
+	glsl::SceneUniform const& aSceneUniform,
+	TransformUpload const& aTransformUpload,
+	lut::TextureStreamer& aTextures,
+	std::uint32_t aFrameSlot,
+	VkPipelineLayout aGraphicsLayout,
+	PipelineTable const& aPipelines,
+	bool aVertexPulling,
+	VkQueryPool aTimestamps,
+	std::uint32_t aFirstQuery)
+{
+	DrawStats stats{};
+
+	// Begin Recording Commands
+	VkCommandBufferBeginInfo commandBufferBeginInfo{}; {
+		commandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+
+		commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		commandBufferBeginInfo.pInheritanceInfo = nullptr;
+	}
+
+	if (auto const res = vkBeginCommandBuffer(aCmdBuff, &commandBufferBeginInfo); res != VK_SUCCESS)
+	{
+		throw lut::Error("Unable to Begin Recording Command Buffer\n"
+			"vkBeginCommandBuffer() Returned %s", lut::to_string(res).c_str());
+	}
+
+	if (VK_NULL_HANDLE != aTimestamps)
+	{
+		vkCmdResetQueryPool(aCmdBuff, aTimestamps, aFirstQuery, 2);
+		vkCmdWriteTimestamp(aCmdBuff, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, aTimestamps, aFirstQuery);
+	}
+
+	lut::buffer_barrier(
+		aCmdBuff,
+		aScene.sceneUBO.buffer,
+		VK_ACCESS_UNIFORM_READ_BIT,
+		VK_ACCESS_TRANSFER_WRITE_BIT,
+		VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT
+	);
+
+	vkCmdUpdateBuffer(aCmdBuff, aScene.sceneUBO.buffer, 0, sizeof(glsl::SceneUniform), &aSceneUniform);
+
+	lut::buffer_barrier(
+		aCmdBuff,
+		aScene.sceneUBO.buffer,
+		VK_ACCESS_TRANSFER_WRITE_BIT,
+		VK_ACCESS_UNIFORM_READ_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_PIPELINE_STAGE_VERTEX_SHADER_BIT
+	);
+
+	// Upload modified world transforms
+	if( aTransformUpload.size > 0 )
+	{
+		lut::buffer_barrier(
+			aCmdBuff,
+			aTransformUpload.transforms,
+			VK_ACCESS_SHADER_READ_BIT,
+			VK_ACCESS_TRANSFER_WRITE_BIT,
+			VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			aTransformUpload.size,
+			aTransformUpload.offset
+		);
+
+		VkBufferCopy copy{}; {
+			copy.srcOffset = aTransformUpload.offset;
+			copy.dstOffset = aTransformUpload.offset;
+			copy.size = aTransformUpload.size;
+		}
+
+		vkCmdCopyBuffer(aCmdBuff, aTransformUpload.staging, aTransformUpload.transforms, 1, &copy);
+
+		lut::buffer_barrier(
+			aCmdBuff,
+			aTransformUpload.transforms,
+			VK_ACCESS_TRANSFER_WRITE_BIT,
+			VK_ACCESS_SHADER_READ_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+			aTransformUpload.size,
+			aTransformUpload.offset
+		);
+	}
+
+	// Stream in texture mip levels and apply the texture feedback of the
+	// slot's previous frame. Draws below use the updated descriptor sets
+	// and resident ranges.
+	aTextures.record_uploads( aCmdBuff, aFrameSlot );
+
+	// Begin the Render Pass
+	VkClearValue clearValues[2]{}; {
+		clearValues[0].color.float32[0] = 0.1f;
+		clearValues[0].color.float32[1] = 0.1f;
+		clearValues[0].color.float32[2] = 0.1f;
+		clearValues[0].color.float32[3] = 1.0f;
+
+		clearValues[1].depthStencil.depth = 1.0f;
+	}
+
+	if (VK_NULL_HANDLE == aTarget.renderPass)
+	{
+		// Dynamic rendering: transition the attachments explicitly. Their
+		// previous contents are not needed.
+		lut::image_barrier(
+			aCmdBuff, aTarget.colorImage,
+			0, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+			VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
+		);
+		lut::image_barrier(
+			aCmdBuff, aTarget.depthImage,
+			VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+			VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+			VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+			VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+			VkImageSubresourceRange{ VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1 }
+		);
+
+		VkRenderingAttachmentInfo colorAttachment{}; {
+			colorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+
+			colorAttachment.imageView = aTarget.colorView;
+			colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+			colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+			colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+			colorAttachment.clearValue = clearValues[0];
+		}
+		VkRenderingAttachmentInfo depthAttachment{}; {
+			depthAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+
+			depthAttachment.imageView = aTarget.depthView;
+			depthAttachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+			depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+			depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			depthAttachment.clearValue = clearValues[1];
+		}
+
+		VkRenderingInfo renderingInfo{}; {
+			renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+
+			renderingInfo.renderArea.offset = VkOffset2D{0, 0};
+			renderingInfo.renderArea.extent = aImageExtent;
+			renderingInfo.layerCount = 1;
+
+			renderingInfo.colorAttachmentCount = 1;
+			renderingInfo.pColorAttachments = &colorAttachment;
+			renderingInfo.pDepthAttachment = &depthAttachment;
+		}
+
+		vkCmdBeginRendering(aCmdBuff, &renderingInfo);
+	}
+	else
+	{
+		VkRenderPassBeginInfo renderPassInfo{}; {
+			renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+
+			renderPassInfo.renderPass = aTarget.renderPass;
+			renderPassInfo.framebuffer = aTarget.framebuffer;
+
+			renderPassInfo.renderArea.offset = VkOffset2D{0, 0};
+			renderPassInfo.renderArea.extent = aImageExtent;
+
+			renderPassInfo.clearValueCount = sizeof(clearValues) / sizeof(clearValues[0]);
+			renderPassInfo.pClearValues = clearValues;
+		}
+
+		vkCmdBeginRenderPass(aCmdBuff, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+	}
+
+	// Draw renderables. The store is sorted by material, so state only
+	// changes between runs of objects with the same pipeline/descriptors.
+	// With vertex pulling, meshes are only referenced by the push constants.
+	vkCmdBindDescriptorSets(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aGraphicsLayout, 0, 1, &aScene.sceneDescriptors, 0, nullptr);
+	++stats.descriptorSetBinds;
+
+	auto const* meshes = aScene.renderables.meshes();
+	auto const* materials = aScene.renderables.materials();
+	auto const* transforms = aScene.renderables.transforms();
+
+	std::uint32_t boundPipeline = std::numeric_limits<std::uint32_t>::max();
+	VkDescriptorSet boundDescriptors = VK_NULL_HANDLE;
+
+	for (std::size_t i = 0; i < aScene.renderables.size(); ++i)
+	{
+		auto const& material = materials[i];
+		if (material.pipeline != boundPipeline)
+		{
+			assert(material.pipeline < std::size_t(EPipeline::max));
+			vkCmdBindPipeline(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aPipelines[material.pipeline]);
+			boundPipeline = material.pipeline;
+			++stats.pipelineBinds;
+		}
+
+		VkDescriptorSet const descriptors = VK_NULL_HANDLE != material.descriptors
+			? material.descriptors
+			: aTextures.descriptor_set(material.texture, aFrameSlot);
+
+		if (descriptors != boundDescriptors)
+		{
+			vkCmdBindDescriptorSets(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aGraphicsLayout, 1, 1, &descriptors, 0, nullptr);
+			boundDescriptors = descriptors;
+			++stats.descriptorSetBinds;
+		}
+
+		auto const& mesh = meshes[i];
+
+		if (!aVertexPulling)
+		{
+			VkBuffer buffers[2] = {mesh.positions, mesh.textureCoords};
+			VkDeviceSize offsets[2]{};
+
+			vkCmdBindVertexBuffers(aCmdBuff, 0, 2, buffers, offsets);
+			++stats.vertexBufferBinds;
+		}
+
+		glsl::ObjectPush const push{
+			transforms[i],
+			aTextures.min_lod(material.texture),
+			material.texture,
+			float(aTextures.base_level(material.texture)),
+			mesh.positionAddress,
+			mesh.textureCoordAddress,
+			mesh.positionStride,
+			mesh.textureCoordStride
+		};
+		vkCmdPushConstants(aCmdBuff, aGraphicsLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(push), &push);
+
+		vkCmdDraw(aCmdBuff, mesh.vertexCount, 1, 0, 0);
+		++stats.drawCalls;
+		stats.vertices += mesh.vertexCount;
+	}
+
+	// End the Render Pass
+	if (VK_NULL_HANDLE == aTarget.renderPass)
+	{
+		vkCmdEndRendering(aCmdBuff);
+
+		lut::image_barrier(
+			aCmdBuff, aTarget.colorImage,
+			VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, 0,
+			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, aTarget.colorFinalLayout,
+			VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT
+		);
+	}
+	else
+		vkCmdEndRenderPass(aCmdBuff);
+
+	aTextures.record_feedback_readback(aCmdBuff, aFrameSlot);
+
+	if (VK_NULL_HANDLE != aTimestamps)
+		vkCmdWriteTimestamp(aCmdBuff, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, aTimestamps, aFirstQuery+1);
+
+	// End Command Recording
+	if (auto const res = vkEndCommandBuffer(aCmdBuff); res != VK_SUCCESS)
+	{
+		throw lut::Error("Unable to End Recording Command Buffer\n"
+			"vkEndCommandBuffer() Returned %s", lut::to_string(res).c_str());
+	}
+
+	return stats;
+}
+
+namespace
+{
+TransformUpload stage_transforms_( lut::Allocator const& aAllocator, SceneGraph const& aGraph, SceneGraph::DirtyRange const& aRange, lut::Buffer const& aStaging, VkBuffer aTransforms )
+{
+	TransformUpload ret{}; {
+		ret.staging = aStaging.buffer;
+		ret.transforms = aTransforms;
+
+		ret.offset = VkDeviceSize(aRange.first) * sizeof(glm::mat4);
+		ret.size = VkDeviceSize(aRange.end - aRange.first) * sizeof(glm::mat4);
+	}
+
+	if( 0 == ret.size )
+		return ret;
+
+	void* ptr = nullptr;
+	if (auto const res = vmaMapMemory(aAllocator.allocator, aStaging.allocation, &ptr); res != VK_SUCCESS)
+	{
+		throw lut::Error("Mapping Memory for Writing\n"
+			"vmaMapMemory() Returned %s", lut::to_string(res).c_str());
+	}
+
+	std::memcpy(static_cast<std::byte*>(ptr) + ret.offset, aGraph.world_data() + aRange.first, ret.size);
+	vmaUnmapMemory(aAllocator.allocator, aStaging.allocation);
+
+	return ret;
+}
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
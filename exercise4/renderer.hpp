@@ -0,0 +1,203 @@
+#pragma once
+
+#include <volk/volk.h>
+
+#include <vector>
+#include <cstdint>
+
+#if !defined(GLM_FORCE_RADIANS)
+#	define GLM_FORCE_RADIANS
+#endif
+#include <glm/glm.hpp>
+
+#include "../labutils/vkobject.hpp"
+#include "../labutils/vkbuffer.hpp"
+#include "../labutils/allocator.hpp"
+#include "../labutils/vulkan_context.hpp"
+#include "../labutils/texture_streamer.hpp"
+#include "../labutils/transient_attachments.hpp"
+
+#include "vertex_data.hpp"
+#include "scene_graph.hpp"
+#include "renderables.hpp"
+
+/* The exercise4 scene and how it is rendered.
+ *
+ * Shared by exercise4 (which renders to the swap chain) and bench-exercise4
+ * (which renders offscreen). Neither the frame loop nor the render target
+ * are part of this: callers create the attachments, and pass them to
+ * record_commands() as a RenderTarget.
+ */
+
+// Graphics pipelines, indexed by Material::pipeline. Opaque geometry is
+// drawn before blended geometry.
+enum class EPipeline : std::uint32_t
+{
+	opaque,
+	alpha,
+	max
+};
+
+using PipelineTable = VkPipeline[std::size_t(EPipeline::max)];
+
+// Uniform data
+namespace glsl
+{
+	struct SceneUniform
+	{
+		glm::mat4 camera;
+		glm::mat4 projection;
+		glm::mat4 projCam;
+	};
+
+	static_assert(sizeof(SceneUniform) <= 65536,
+		"SceneUniform must be Less than 65536 Bytes for vkCmdUpdateBuffer()");
+	static_assert(sizeof(SceneUniform) % 4 == 0,
+		"SceneUniform Size must be a Multiple of 4 Bytes");
+
+	// Per-draw push constants: index of the object's world transform in the
+	// transform storage buffer (the object's SceneGraph node), the streamed
+	// texture's finest resident mip level, id (for feedback) and base level
+	// (see labutils::TextureStreamer), and, with vertex pulling, where the
+	// mesh's vertex data is (see MeshRef)
+	struct ObjectPush
+	{
+		std::uint32_t transformIndex;
+		float textureMinLod;
+		std::uint32_t textureId;
+		float textureBaseLevel;
+
+		VkDeviceAddress positions;
+		VkDeviceAddress textureCoords;
+		std::uint32_t positionStride;
+		std::uint32_t textureCoordStride;
+	};
+
+	static_assert(sizeof(ObjectPush) <= 128,
+		"ObjectPush must fit into the guaranteed 128 Bytes of push constants");
+}
+
+// Where a frame is rendered to. With dynamic rendering, `renderPass` and
+// `framebuffer` are VK_NULL_HANDLE, the image views are used directly, and
+// the color image is transitioned to `colorFinalLayout` at the end of the
+// frame. (With a render pass, the render pass's final layout applies.)
+struct RenderTarget
+{
+	VkRenderPass renderPass;
+	VkFramebuffer framebuffer;
+
+	VkImage colorImage;
+	VkImageView colorView;
+	VkImageLayout colorFinalLayout;
+
+	VkImage depthImage;
+	VkImageView depthView;
+};
+
+// World transforms modified since the previous frame. They are written
+// to `staging` (at the same offset) before recording, and copied into
+// `transforms` at the start of the frame.
+struct TransformUpload
+{
+	VkBuffer staging;
+	VkBuffer transforms;
+
+	VkDeviceSize offset;
+	VkDeviceSize size; // 0: nothing to upload
+};
+
+// Textured floor and alpha-blended sprite, each with its own scene graph
+// node. The meshes are authored in world space, so all nodes start out
+// with identity transforms.
+struct Scene
+{
+	TexturedMesh planeMesh;
+	TexturedMesh spriteMesh;
+
+	labutils::Buffer sceneUBO;
+
+	SceneGraph graph;
+
+	// World transforms of the scene graph nodes, and one staging buffer per
+	// frame slot. A staging buffer is only rewritten once the command
+	// buffer that last read it has completed.
+	labutils::Buffer transforms;
+	std::vector<labutils::Buffer> transformStaging;
+
+	labutils::DescriptorPool descriptorPool;
+	VkDescriptorSet sceneDescriptors = VK_NULL_HANDLE;
+
+	RenderableStore renderables;
+};
+
+// Draw counters of a recorded frame
+struct DrawStats
+{
+	std::uint32_t drawCalls = 0;
+	std::uint32_t vertices = 0;
+	std::uint32_t pipelineBinds = 0;
+	std::uint32_t descriptorSetBinds = 0;
+	std::uint32_t vertexBufferBinds = 0;
+};
+
+// Texture feedback requires fragment shaders that can write to storage
+// buffers (see labutils::TextureStreamer), i.e., the fragmentStoresAndAtomics
+// feature must be enabled on the device.
+bool supports_texture_feedback( labutils::VulkanContext const& );
+
+// Without dynamic rendering (see VulkanContext::haveDynamicRendering). The
+// color attachment ends up in aColorFinalLayout.
+labutils::RenderPass create_render_pass( labutils::VulkanContext const&, VkFormat aColorFormat, VkImageLayout aColorFinalLayout );
+
+labutils::DescriptorSetLayout create_scene_descriptor_layout( labutils::VulkanContext const& );
+labutils::PipelineLayout create_pipeline_layout( labutils::VulkanContext const&, VkDescriptorSetLayout aSceneLayout, VkDescriptorSetLayout aObjectLayout );
+
+// With vertex pulling, meshes are read through buffer device addresses
+// (see VulkanContext::haveBufferDeviceAddress) and the pipelines have no
+// vertex input. Pass a VK_NULL_HANDLE render pass for dynamic rendering.
+labutils::Pipeline create_pipeline( labutils::VulkanContext const&, VkExtent2D, VkFormat aColorFormat, VkRenderPass, VkPipelineLayout, bool aTextureFeedback, bool aVertexPulling );
+labutils::Pipeline create_alpha_pipeline( labutils::VulkanContext const&, VkExtent2D, VkFormat aColorFormat, VkRenderPass, VkPipelineLayout, bool aTextureFeedback, bool aVertexPulling );
+
+labutils::TransientAttachments create_depth_buffer( labutils::VulkanContext const&, labutils::Allocator const&, VkExtent2D );
+
+// Loads the meshes, requests the textures from aTextures, and creates the
+// scene's buffers and descriptors (for aSceneLayout).
+Scene create_scene(
+	labutils::VulkanContext const&,
+	labutils::Allocator const&,
+	labutils::TextureStreamer& aTextures,
+	VkDescriptorSetLayout aSceneLayout,
+	std::uint32_t aFrameSlots
+);
+
+void update_scene_uniforms(
+	glsl::SceneUniform&,
+	std::uint32_t aFramebufferWidth,
+	std::uint32_t aFramebufferHeight,
+	glm::mat4 const& aCamera2World
+);
+
+// Updates the scene graph, writes the modified world transforms to the
+// frame slot's staging buffer, and sorts the renderables by material.
+TransformUpload prepare_scene( labutils::Allocator const&, Scene&, std::uint32_t aFrameSlot );
+
+// Records the whole frame into aCmdBuff (including begin and end). If
+// aTimestamps is given, queries aFirstQuery and aFirstQuery+1 receive
+// timestamps at the start and the end of the frame.
+DrawStats record_commands(
+	VkCommandBuffer,
+	RenderTarget const&,
+	VkExtent2D const&,
+	Scene const&,
+	glsl::SceneUniform const&,
+	TransformUpload const&,
+	labutils::TextureStreamer&,
+	std::uint32_t aFrameSlot,
+	VkPipelineLayout aGraphicsLayout,
+	PipelineTable const& aPipelines,
+	bool aVertexPulling,
+	VkQueryPool aTimestamps = VK_NULL_HANDLE,
+	std::uint32_t aFirstQuery = 0
+);
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
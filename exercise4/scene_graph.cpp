@@ -0,0 +1,125 @@
+#include "scene_graph.hpp"
+
+#include <algorithm>
+
+#include <cassert>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	include <emmintrin.h>
+#	define SCENE_GRAPH_SSE2_ 1
+#endif
+
+namespace
+{
+	// aOut = aParent * aLocal
+	//
+	// glm only uses its SSE code paths with GLM_FORCE_INTRINSICS, which the
+	// project does not enable globally (it changes glm's type layouts). The
+	// kernel below is the same column-wise product as glm_mat4_mul(). It
+	// uses unaligned loads, as glm::mat4 is only 4-byte aligned.
+	inline
+	void concat_( glm::mat4 const& aParent, glm::mat4 const& aLocal, glm::mat4& aOut ) noexcept
+	{
+#		if SCENE_GRAPH_SSE2_
+		__m128 const p0 = _mm_loadu_ps( &aParent[0][0] );
+		__m128 const p1 = _mm_loadu_ps( &aParent[1][0] );
+		__m128 const p2 = _mm_loadu_ps( &aParent[2][0] );
+		__m128 const p3 = _mm_loadu_ps( &aParent[3][0] );
+
+		for( int i = 0; i < 4; ++i )
+		{
+			__m128 const c = _mm_loadu_ps( &aLocal[i][0] );
+
+			__m128 const e0 = _mm_shuffle_ps( c, c, _MM_SHUFFLE(0, 0, 0, 0) );
+			__m128 const e1 = _mm_shuffle_ps( c, c, _MM_SHUFFLE(1, 1, 1, 1) );
+			__m128 const e2 = _mm_shuffle_ps( c, c, _MM_SHUFFLE(2, 2, 2, 2) );
+			__m128 const e3 = _mm_shuffle_ps( c, c, _MM_SHUFFLE(3, 3, 3, 3) );
+
+			__m128 const a0 = _mm_add_ps( _mm_mul_ps( p0, e0 ), _mm_mul_ps( p1, e1 ) );
+			__m128 const a1 = _mm_add_ps( _mm_mul_ps( p2, e2 ), _mm_mul_ps( p3, e3 ) );
+
+			_mm_storeu_ps( &aOut[i][0], _mm_add_ps( a0, a1 ) );
+		}
+#		else
+		aOut = aParent * aLocal;
+#		endif
+	}
+}
+
+void SceneGraph::reserve( std::size_t aCount )
+{
+	mParent.reserve( aCount );
+	mLocal.reserve( aCount );
+	mWorld.reserve( aCount );
+	mDirty.reserve( aCount );
+}
+
+SceneGraph::NodeId SceneGraph::add_node( NodeId aParent, glm::mat4 const& aLocal )
+{
+	assert( kNoParent == aParent || aParent < mParent.size() );
+
+	auto const id = NodeId(mParent.size());
+	assert( kNoParent != id );
+
+	mParent.emplace_back( aParent );
+	mLocal.emplace_back( aLocal );
+	mWorld.emplace_back( aLocal );
+	mDirty.emplace_back( 1 );
+
+	mFirstDirty = std::min( mFirstDirty, id );
+	return id;
+}
+
+void SceneGraph::set_local( NodeId aNode, glm::mat4 const& aLocal )
+{
+	assert( aNode < mLocal.size() );
+
+	mLocal[aNode] = aLocal;
+	mDirty[aNode] = 1;
+
+	mFirstDirty = std::min( mFirstDirty, aNode );
+}
+
+SceneGraph::DirtyRange SceneGraph::update()
+{
+	mUpdateList.clear();
+
+	auto const count = NodeId(mParent.size());
+	if( mFirstDirty >= count )
+		return { 0, 0 };
+
+	// Pass 1: propagate dirty flags to descendants and collect the nodes to
+	// update. Parents precede their children, so a parent's flag is final by
+	// the time its children are visited. This pass only touches the (small)
+	// parent and flag arrays.
+	for( NodeId i = mFirstDirty; i < count; ++i )
+	{
+		auto const parent = mParent[i];
+		if( kNoParent != parent && parent >= mFirstDirty )
+			mDirty[i] |= mDirty[parent];
+
+		if( mDirty[i] )
+			mUpdateList.emplace_back( i );
+	}
+
+	// Pass 2: recompute world transforms, again in topological order.
+	for( auto const node : mUpdateList )
+	{
+		auto const parent = mParent[node];
+		if( kNoParent == parent )
+			mWorld[node] = mLocal[node];
+		else
+			concat_( mWorld[parent], mLocal[node], mWorld[node] );
+	}
+
+	for( auto const node : mUpdateList )
+		mDirty[node] = 0;
+
+	assert( !mUpdateList.empty() );
+	DirtyRange const range{ mUpdateList.front(), mUpdateList.back() + 1 };
+
+	mFirstDirty = kNoParent;
+	return range;
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
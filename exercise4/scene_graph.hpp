@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#if !defined(GLM_FORCE_RADIANS)
+#	define GLM_FORCE_RADIANS
+#endif
+#include <glm/glm.hpp>
+
+/* Transform hierarchy.
+ *
+ * Nodes are stored as structure-of-arrays: parent indices, local transforms,
+ * world transforms and dirty flags each live in their own contiguous array.
+ * A node's parent must already exist when the node is added, so the arrays
+ * are always in topological order (parents before children). update() can
+ * therefore resolve the hierarchy in a single forward sweep, and only visits
+ * nodes at or after the first node modified since the previous update.
+ *
+ * The world transforms are laid out exactly like a GLSL `mat4[]`, and can be
+ * copied directly into a per-object storage buffer. The node ID is the
+ * object's index into that buffer.
+ */
+class SceneGraph
+{
+	public:
+		using NodeId = std::uint32_t;
+		static constexpr NodeId kNoParent = ~NodeId(0);
+
+		// Range of world transforms modified by an update(), [first, end).
+		// Empty if first == end.
+		struct DirtyRange
+		{
+			NodeId first;
+			NodeId end;
+		};
+
+	public:
+		void reserve( std::size_t );
+
+		NodeId add_node( NodeId aParent, glm::mat4 const& aLocal = glm::mat4(1.f) );
+
+		void set_local( NodeId, glm::mat4 const& );
+
+		std::size_t size() const noexcept { return mParent.size(); }
+
+		NodeId parent( NodeId aNode ) const noexcept { return mParent[aNode]; }
+		glm::mat4 const& local( NodeId aNode ) const noexcept { return mLocal[aNode]; }
+
+		// World transforms are valid after update().
+		glm::mat4 const& world( NodeId aNode ) const noexcept { return mWorld[aNode]; }
+		glm::mat4 const* world_data() const noexcept { return mWorld.data(); }
+
+		// Recomputes world transforms of all modified nodes and their
+		// descendants. Returns the range of world transforms that changed.
+		DirtyRange update();
+
+		// Number of world transforms recomputed by the last update().
+		std::size_t last_update_count() const noexcept { return mUpdateList.size(); }
+
+	private:
+		std::vector<NodeId> mParent;
+		std::vector<glm::mat4> mLocal;
+		std::vector<glm::mat4> mWorld;
+		std::vector<std::uint8_t> mDirty;
+
+		// Nodes recomputed in the last update(), in topological order.
+		std::vector<NodeId> mUpdateList;
+
+		// Lowest dirty node; nothing before it needs to be visited.
+		NodeId mFirstDirty = kNoParent;
+};
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
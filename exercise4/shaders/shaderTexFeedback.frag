@@ -0,0 +1,51 @@
+#version 450
+
+// Only visible fragments report their mip level
+layout(early_fragment_tests) in;
+
+layout(location = 0) in vec2 v2fTextureCoord;
+
+layout(set = 1, binding = 0) uniform sampler2D uTextureColour;
+
+// Finest mip level requested per texture this frame, see
+// labutils::TextureStreamer. Cleared to ~0u before each frame.
+layout(set = 1, binding = 1, std430) buffer BFeedback
+{
+    uint requestedLevel[];
+} bFeedback;
+
+// Follows PObject::transformIndex (see shaderTexObject.vert). The texture's
+// image starts at level textureBaseLevel of its full mip chain;
+// textureMinLod is the finest resident level of the image.
+layout(push_constant) uniform PMaterial
+{
+    layout(offset = 4) float textureMinLod;
+    uint textureId;
+    float textureBaseLevel;
+} pMaterial;
+
+layout(location = 0) out vec4 oColour;
+
+// Fragments at one position of each kFeedbackTile^2 pixel tile write
+// feedback, which keeps the number of atomics low.
+const int kFeedbackTile = 8;
+
+void main()
+{
+    // Requested level of the full chain. Unlike textureQueryLod(), this is
+    // not clamped to the levels of the current image.
+    vec2 texels = v2fTextureCoord * vec2(textureSize(uTextureColour, 0));
+    vec2 dx = dFdx(texels);
+    vec2 dy = dFdy(texels);
+    float requested = 0.5f * log2(max(dot(dx, dx), dot(dy, dy))) + pMaterial.textureBaseLevel;
+
+    if (all(equal(ivec2(gl_FragCoord.xy) % kFeedbackTile, ivec2(0))))
+        atomicMin(bFeedback.requestedLevel[pMaterial.textureId], uint(max(floor(requested), 0.0f)));
+
+    // See shaderTexStreamed.frag
+    float lod = textureQueryLod(uTextureColour, v2fTextureCoord).y;
+    float scale = exp2(clamp(pMaterial.textureMinLod - lod, 0.0f, 16.0f));
+
+    vec3 colour = textureGrad(uTextureColour, v2fTextureCoord, dFdx(v2fTextureCoord) * scale, dFdy(v2fTextureCoord) * scale).rgb;
+    oColour = vec4(colour, 1.0f);
+}
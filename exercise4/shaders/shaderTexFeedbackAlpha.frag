@@ -0,0 +1,42 @@
+#version 450
+
+// Blended fragments are depth tested but don't write depth
+layout(early_fragment_tests) in;
+
+layout(location = 0) in vec2 v2fTextureCoord;
+
+layout(set = 1, binding = 0) uniform sampler2D uTextureColour;
+
+layout(set = 1, binding = 1, std430) buffer BFeedback
+{
+    uint requestedLevel[];
+} bFeedback;
+
+// See shaderTexFeedback.frag
+layout(push_constant) uniform PMaterial
+{
+    layout(offset = 4) float textureMinLod;
+    uint textureId;
+    float textureBaseLevel;
+} pMaterial;
+
+layout(location = 0) out vec4 oColour;
+
+const int kFeedbackTile = 8;
+
+void main()
+{
+    // See shaderTexFeedback.frag
+    vec2 texels = v2fTextureCoord * vec2(textureSize(uTextureColour, 0));
+    vec2 dx = dFdx(texels);
+    vec2 dy = dFdy(texels);
+    float requested = 0.5f * log2(max(dot(dx, dx), dot(dy, dy))) + pMaterial.textureBaseLevel;
+
+    if (all(equal(ivec2(gl_FragCoord.xy) % kFeedbackTile, ivec2(0))))
+        atomicMin(bFeedback.requestedLevel[pMaterial.textureId], uint(max(floor(requested), 0.0f)));
+
+    float lod = textureQueryLod(uTextureColour, v2fTextureCoord).y;
+    float scale = exp2(clamp(pMaterial.textureMinLod - lod, 0.0f, 16.0f));
+
+    oColour = textureGrad(uTextureColour, v2fTextureCoord, dFdx(v2fTextureCoord) * scale, dFdy(v2fTextureCoord) * scale);
+}
@@ -0,0 +1,32 @@
+#version 450
+
+layout(set = 0, binding = 0) uniform UScene
+{
+    mat4 camera;
+    mat4 projection;
+    mat4 projCam;
+} uScene;
+
+// World transforms of all scene nodes, see SceneGraph::world_data().
+layout(set = 0, binding = 1, std430) readonly buffer BTransforms
+{
+    mat4 model[];
+} bTransforms;
+
+layout(push_constant) uniform PObject
+{
+    uint transformIndex;
+} pObject;
+
+layout(location = 0) in vec3 iPosition;
+layout(location = 1) in vec2 iTextureCoord;
+
+layout(location = 0) out vec2 v2fTextureCoord;
+
+void main()
+{
+    vec4 worldPos = bTransforms.model[pObject.transformIndex] * vec4(iPosition, 1.0f);
+
+    gl_Position = uScene.projCam * worldPos;
+    v2fTextureCoord = iTextureCoord;
+}
@@ -0,0 +1,55 @@
+#version 450
+#extension GL_EXT_buffer_reference : require
+#extension GL_EXT_buffer_reference_uvec2 : require
+
+// Same as shaderTexObject.vert, but without vertex input attributes: the
+// vertex data is read from buffer device addresses passed in the push
+// constants, so meshes with any layout use the same pipeline, and no vertex
+// buffers are bound.
+
+layout(set = 0, binding = 0) uniform UScene
+{
+    mat4 camera;
+    mat4 projection;
+    mat4 projCam;
+} uScene;
+
+// World transforms of all scene nodes, see SceneGraph::world_data().
+layout(set = 0, binding = 1, std430) readonly buffer BTransforms
+{
+    mat4 model[];
+} bTransforms;
+
+layout(buffer_reference, std430, buffer_reference_align = 4) readonly buffer BFloats
+{
+    float v[];
+};
+
+// The fragment shader's PMaterial is at offsets 4-15. Vertex i's position
+// is the three floats at positions + 4 * i * positionStride; its texture
+// coordinate the two floats at textureCoords + 4 * i * textureCoordStride.
+layout(push_constant) uniform PObject
+{
+    uint transformIndex;
+    layout(offset = 16) uvec2 positions;
+    uvec2 textureCoords;
+    uint positionStride;
+    uint textureCoordStride;
+} pObject;
+
+layout(location = 0) out vec2 v2fTextureCoord;
+
+void main()
+{
+    BFloats positions = BFloats(pObject.positions);
+    BFloats textureCoords = BFloats(pObject.textureCoords);
+
+    uint p = uint(gl_VertexIndex) * pObject.positionStride;
+    uint t = uint(gl_VertexIndex) * pObject.textureCoordStride;
+
+    vec3 position = vec3(positions.v[p], positions.v[p+1], positions.v[p+2]);
+    vec4 worldPos = bTransforms.model[pObject.transformIndex] * vec4(position, 1.0f);
+
+    gl_Position = uScene.projCam * worldPos;
+    v2fTextureCoord = vec2(textureCoords.v[t], textureCoords.v[t+1]);
+}
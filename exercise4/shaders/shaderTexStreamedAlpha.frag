@@ -0,0 +1,23 @@
+#version 450
+
+layout(location = 0) in vec2 v2fTextureCoord;
+
+layout(set = 1, binding = 0) uniform sampler2D uTextureColour;
+
+// Finest resident mip level of the texture, see labutils::TextureStreamer.
+// Follows PObject::transformIndex (see shaderTexObject.vert).
+layout(push_constant) uniform PMaterial
+{
+    layout(offset = 4) float textureMinLod;
+} pMaterial;
+
+layout(location = 0) out vec4 oColour;
+
+void main()
+{
+    // See shaderTexStreamed.frag
+    float lod = textureQueryLod(uTextureColour, v2fTextureCoord).y;
+    float scale = exp2(clamp(pMaterial.textureMinLod - lod, 0.0f, 16.0f));
+
+    oColour = textureGrad(uTextureColour, v2fTextureCoord, dFdx(v2fTextureCoord) * scale, dFdy(v2fTextureCoord) * scale);
+}
@@ -9,7 +9,40 @@
 #include "../labutils/to_string.hpp"
 namespace lut = labutils;
 
+namespace
+{
+	void position_bounds_( float const* aPositions, std::size_t aFloatCount, glm::vec3& aMin, glm::vec3& aMax )
+	{
+		aMin = glm::vec3( std::numeric_limits<float>::max() );
+		aMax = glm::vec3( -std::numeric_limits<float>::max() );
+
+		for( std::size_t i = 0; i + 3 <= aFloatCount; i += 3 )
+		{
+			glm::vec3 const pos( aPositions[i+0], aPositions[i+1], aPositions[i+2] );
+			aMin = glm::min( aMin, pos );
+			aMax = glm::max( aMax, pos );
+		}
+	}
+
+	// Textured meshes may also be read by vertex pulling shaders
+	VkBufferUsageFlags textured_vertex_usage_( labutils::VulkanContext const& aContext )
+	{
+		VkBufferUsageFlags usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+		if( aContext.haveBufferDeviceAddress )
+			usage |= VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+
+		return usage;
+	}
+
+	void set_vertex_addresses_( labutils::VulkanContext const& aContext, TexturedMesh& aMesh )
+	{
+		if( !aContext.haveBufferDeviceAddress )
+			return;
 
+		aMesh.positionAddress = labutils::get_buffer_device_address( aContext, aMesh.positions.buffer );
+		aMesh.textureCoordAddress = labutils::get_buffer_device_address( aContext, aMesh.textureCoords.buffer );
+	}
+}
 
 ColorizedMesh create_triangle_mesh( labutils::VulkanContext const& aContext, labutils::Allocator const& aAllocator )
 {
@@ -180,13 +213,13 @@ TexturedMesh create_plane_mesh(labutils::VulkanContext const& aContext, labutils
 	lut::Buffer vertexPositionGPU = lut::create_buffer(
 		aAllocator,
 		sizeof(positions),
-		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		textured_vertex_usage_(aContext),
 		VMA_MEMORY_USAGE_GPU_ONLY
 	);
 	lut::Buffer vertexTextureCoordsGPU = lut::create_buffer(
 		aAllocator,
 		sizeof(textureCoords),
-		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		textured_vertex_usage_(aContext),
 		VMA_MEMORY_USAGE_GPU_ONLY
 	);
 
@@ -249,9 +282,9 @@ TexturedMesh create_plane_mesh(labutils::VulkanContext const& aContext, labutils
 		uploadCommand,
 		vertexPositionGPU.buffer,
 		VK_ACCESS_TRANSFER_WRITE_BIT,
-		VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
+		VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_SHADER_READ_BIT,
 		VK_PIPELINE_STAGE_TRANSFER_BIT,
-		VK_PIPELINE_STAGE_VERTEX_INPUT_BIT
+		VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT
 	);
 
 	VkBufferCopy textureCoordsCopy{}; {
@@ -264,9 +297,9 @@ TexturedMesh create_plane_mesh(labutils::VulkanContext const& aContext, labutils
 		uploadCommand,
 		vertexTextureCoordsGPU.buffer,
 		VK_ACCESS_TRANSFER_WRITE_BIT,
-		VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
+		VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_SHADER_READ_BIT,
 		VK_PIPELINE_STAGE_TRANSFER_BIT,
-		VK_PIPELINE_STAGE_VERTEX_INPUT_BIT
+		VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT
 	);
 
 	if (auto const res = vkEndCommandBuffer(uploadCommand); res != VK_SUCCESS)
@@ -294,11 +327,16 @@ TexturedMesh create_plane_mesh(labutils::VulkanContext const& aContext, labutils
 			"vkWaitForFences() Returned %s", lut::to_string(res).c_str());
 	}
 
-	return TexturedMesh{
+	TexturedMesh ret{
 		std::move(vertexPositionGPU),
 		std::move(vertexTextureCoordsGPU),
-		(sizeof(positions) / sizeof(float)) / 3
+		(sizeof(positions) / sizeof(float)) / 3,
+		glm::vec3(), glm::vec3(),
+		0, 0
 	};
+	position_bounds_( positions, sizeof(positions) / sizeof(float), ret.boundsMin, ret.boundsMax );
+	set_vertex_addresses_( aContext, ret );
+	return ret;
 }
 TexturedMesh create_sprite_mesh(labutils::VulkanContext const& aContext, labutils::Allocator const& aAllocator)
 {
@@ -326,13 +364,13 @@ TexturedMesh create_sprite_mesh(labutils::VulkanContext const& aContext, labutil
 	lut::Buffer vertexPositionGPU = lut::create_buffer(
 		aAllocator,
 		sizeof(positions),
-		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		textured_vertex_usage_(aContext),
 		VMA_MEMORY_USAGE_GPU_ONLY
 	);
 	lut::Buffer vertexTextureCoordsGPU = lut::create_buffer(
 		aAllocator,
 		sizeof(textureCoords),
-		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		textured_vertex_usage_(aContext),
 		VMA_MEMORY_USAGE_GPU_ONLY
 	);
 
@@ -395,9 +433,9 @@ TexturedMesh create_sprite_mesh(labutils::VulkanContext const& aContext, labutil
 		uploadCommand,
 		vertexPositionGPU.buffer,
 		VK_ACCESS_TRANSFER_WRITE_BIT,
-		VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
+		VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_SHADER_READ_BIT,
 		VK_PIPELINE_STAGE_TRANSFER_BIT,
-		VK_PIPELINE_STAGE_VERTEX_INPUT_BIT
+		VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT
 	);
 
 	VkBufferCopy textureCoordsCopy{}; {
@@ -410,9 +448,9 @@ TexturedMesh create_sprite_mesh(labutils::VulkanContext const& aContext, labutil
 		uploadCommand,
 		vertexTextureCoordsGPU.buffer,
 		VK_ACCESS_TRANSFER_WRITE_BIT,
-		VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
+		VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_SHADER_READ_BIT,
 		VK_PIPELINE_STAGE_TRANSFER_BIT,
-		VK_PIPELINE_STAGE_VERTEX_INPUT_BIT
+		VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT
 	);
 
 	if (auto const res = vkEndCommandBuffer(uploadCommand); res != VK_SUCCESS)
@@ -440,9 +478,14 @@ TexturedMesh create_sprite_mesh(labutils::VulkanContext const& aContext, labutil
 			"vkWaitForFences() Returned %s", lut::to_string(res).c_str());
 	}
 
-	return TexturedMesh{
+	TexturedMesh ret{
 		std::move(vertexPositionGPU),
 		std::move(vertexTextureCoordsGPU),
-		(sizeof(positions) / sizeof(float)) / 3
+		(sizeof(positions) / sizeof(float)) / 3,
+		glm::vec3(), glm::vec3(),
+		0, 0
 	};
+	position_bounds_( positions, sizeof(positions) / sizeof(float), ret.boundsMin, ret.boundsMax );
+	set_vertex_addresses_( aContext, ret );
+	return ret;
 }
\ No newline at end of file
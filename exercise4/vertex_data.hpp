@@ -2,6 +2,11 @@
 
 #include <cstdint>
 
+#if !defined(GLM_FORCE_RADIANS)
+#	define GLM_FORCE_RADIANS
+#endif
+#include <glm/glm.hpp>
+
 #include "../labutils/vulkan_context.hpp"
 
 #include "../labutils/vkbuffer.hpp"
@@ -23,6 +28,16 @@ struct TexturedMesh
 	labutils::Buffer textureCoords;
 
 	std::uint32_t vertexCount;
+
+	// Axis aligned bounding box of the positions
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
+
+	// Device addresses of the buffers, for vertex pulling; 0 unless the
+	// context has buffer device addresses. Positions are tightly packed
+	// vec3s, texture coordinates tightly packed vec2s.
+	VkDeviceAddress positionAddress = 0;
+	VkDeviceAddress textureCoordAddress = 0;
 };
 
 
@@ -50,6 +50,16 @@ namespace labutils
 		allocInfo.device            = aContext.device;
 		allocInfo.instance          = aContext.instance;
 		allocInfo.pVulkanFunctions  = &functions;
+
+		// Otherwise, VMA estimates budgets from the heap sizes and its own
+		// allocations.
+		if( aContext.haveMemoryBudget )
+			allocInfo.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+
+		// Memory of buffers created with SHADER_DEVICE_ADDRESS usage must be
+		// allocated with VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT.
+		if( aContext.haveBufferDeviceAddress )
+			allocInfo.flags |= VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT;
 		
 		VmaAllocator allocator = VK_NULL_HANDLE;
 		if( auto const res = vmaCreateAllocator( &allocInfo, &allocator ); VK_SUCCESS != res )
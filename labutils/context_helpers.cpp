@@ -1,11 +1,39 @@
 #include "context_helpers.hxx"
 
+#include <algorithm>
+
+#include <cstdlib>
+#include <cstring>
+
 #include "error.hpp"
 #include "to_string.hpp"
 namespace lut = labutils;
 
+namespace
+{
+	namespace cfg
+	{
+		// Opt-outs for optional device features (see env_flag()). These are
+		// mainly useful to exercise the fallback paths on devices that do
+		// support the features.
+		constexpr char const* kNoDynamicRenderingEnv = "LABUTILS_NO_DYNAMIC_RENDERING";
+		constexpr char const* kNoBufferDeviceAddressEnv = "LABUTILS_NO_BUFFER_DEVICE_ADDRESS";
+		constexpr char const* kNoHostImageCopyEnv = "LABUTILS_NO_HOST_IMAGE_COPY";
+
+		// Setting LABUTILS_NO_ASYNC_COMPUTE to a non-zero value keeps
+		// compute work on the graphics queue
+		constexpr char const* kNoAsyncComputeEnv = "LABUTILS_NO_ASYNC_COMPUTE";
+	}
+}
+
 namespace labutils::detail
 {
+	bool env_flag( char const* aName )
+	{
+		auto const* value = std::getenv( aName );
+		return value && *value && 0 != std::strcmp( value, "0" );
+	}
+
 	std::unordered_set<std::string> get_instance_layers()
 	{
 		std::uint32_t numLayers = 0;
@@ -167,4 +195,184 @@ namespace labutils::detail
 
 		return ret;
 	}
+
+	bool device_api_at_least( VkPhysicalDevice aPhysicalDev, std::uint32_t aMajor, std::uint32_t aMinor )
+	{
+		VkPhysicalDeviceProperties props;
+		vkGetPhysicalDeviceProperties( aPhysicalDev, &props );
+
+		auto const major = VK_API_VERSION_MAJOR( props.apiVersion );
+		auto const minor = VK_API_VERSION_MINOR( props.apiVersion );
+		return major > aMajor || (major == aMajor && minor >= aMinor);
+	}
+
+	bool supports_dynamic_rendering( VkPhysicalDevice aPhysicalDev )
+	{
+		if( env_flag( cfg::kNoDynamicRenderingEnv ) )
+			return false;
+
+		if( !device_api_at_least( aPhysicalDev, 1, 3 ) )
+			return false;
+
+		VkPhysicalDeviceVulkan13Features features13{};
+		features13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+
+		VkPhysicalDeviceFeatures2 features{};
+		features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		features.pNext = &features13;
+
+		vkGetPhysicalDeviceFeatures2( aPhysicalDev, &features );
+		return VK_TRUE == features13.dynamicRendering;
+	}
+
+	bool supports_buffer_device_address( VkPhysicalDevice aPhysicalDev )
+	{
+		if( env_flag( cfg::kNoBufferDeviceAddressEnv ) )
+			return false;
+
+		if( !device_api_at_least( aPhysicalDev, 1, 2 ) )
+			return false;
+
+		VkPhysicalDeviceVulkan12Features features12{};
+		features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+		VkPhysicalDeviceFeatures2 features{};
+		features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		features.pNext = &features12;
+
+		vkGetPhysicalDeviceFeatures2( aPhysicalDev, &features );
+		return VK_TRUE == features12.bufferDeviceAddress;
+	}
+}
+
+namespace
+{
+	// Device whose functions the global vk*() device functions currently
+	// point at (see load_device_functions()). volkGetLoadedDevice() can't be
+	// used for this, as volk never resets it.
+	VkDevice gGlobalDevice_ = VK_NULL_HANDLE;
+}
+
+namespace labutils::detail
+{
+	void load_device_functions( VkInstance aInstance, VkDevice aDevice, VolkDeviceTable& aTable )
+	{
+		// The per-device table is always valid, regardless of how many
+		// devices exist in the process.
+		volkLoadDeviceTable( &aTable, aDevice );
+
+		// volkLoadDevice() points the global vk*() device functions directly
+		// at the driver's implementation for aDevice. This skips the loader's
+		// dispatch trampoline on every call (which matters for vkCmd*() and
+		// vkQueue*() in the frame loop), but is only valid as long as a
+		// single VkDevice is in use. If a device was already loaded, we
+		// instead (re-)load the globals through the instance, which yields
+		// the device-agnostic trampolines. Code that wants the direct path
+		// with multiple devices should use VulkanContext::deviceTable.
+		if( VK_NULL_HANDLE == gGlobalDevice_ )
+		{
+			volkLoadDevice( aDevice );
+			gGlobalDevice_ = aDevice;
+		}
+		else
+		{
+			volkLoadInstance( aInstance );
+		}
+	}
+
+	void release_device_functions( VkInstance aInstance, VkDevice aDevice )
+	{
+		if( aDevice != gGlobalDevice_ )
+			return;
+
+		// Point the globals back at the loader's trampolines. These dispatch
+		// through the handle passed to them, so they remain valid for other
+		// devices once aInstance is destroyed. The next device that is
+		// created gets the direct path again.
+		volkLoadInstance( aInstance );
+		gGlobalDevice_ = VK_NULL_HANDLE;
+	}
+}
+
+namespace labutils::detail
+{
+	std::optional<std::uint32_t> find_async_compute_family( VkPhysicalDevice aPhysicalDev )
+	{
+		if( env_flag( cfg::kNoAsyncComputeEnv ) )
+			return {};
+
+		std::uint32_t numQueues = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties( aPhysicalDev, &numQueues, nullptr );
+
+		std::vector<VkQueueFamilyProperties> families( numQueues );
+		vkGetPhysicalDeviceQueueFamilyProperties( aPhysicalDev, &numQueues, families.data() );
+
+		for( std::uint32_t i = 0; i < numQueues; ++i )
+		{
+			auto const flags = families[i].queueFlags;
+			if( (VK_QUEUE_COMPUTE_BIT & flags) && !(VK_QUEUE_GRAPHICS_BIT & flags) )
+				return i;
+		}
+
+		return {};
+	}
+}
+
+namespace labutils::detail
+{
+	bool supports_host_image_copy( VkPhysicalDevice aPhysicalDev )
+	{
+		if( env_flag( cfg::kNoHostImageCopyEnv ) )
+			return false;
+
+		if( !device_api_at_least( aPhysicalDev, 1, 3 ) )
+			return false;
+
+		if( 0 == get_device_extensions( aPhysicalDev ).count( VK_EXT_HOST_IMAGE_COPY_EXTENSION_NAME ) )
+			return false;
+
+		VkPhysicalDeviceHostImageCopyFeaturesEXT hostCopyFeatures{};
+		hostCopyFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_IMAGE_COPY_FEATURES_EXT;
+
+		VkPhysicalDeviceFeatures2 features{};
+		features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		features.pNext = &hostCopyFeatures;
+
+		vkGetPhysicalDeviceFeatures2( aPhysicalDev, &features );
+		if( VK_TRUE != hostCopyFeatures.hostImageCopy )
+			return false;
+
+		// The layouts are returned like other enumerations: the first call
+		// gets the counts, the second fills in the arrays.
+		VkPhysicalDeviceHostImageCopyPropertiesEXT hostCopyProps{};
+		hostCopyProps.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_IMAGE_COPY_PROPERTIES_EXT;
+
+		VkPhysicalDeviceProperties2 props2{};
+		props2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+		props2.pNext = &hostCopyProps;
+
+		vkGetPhysicalDeviceProperties2( aPhysicalDev, &props2 );
+
+		std::vector<VkImageLayout> srcLayouts( hostCopyProps.copySrcLayoutCount );
+		std::vector<VkImageLayout> dstLayouts( hostCopyProps.copyDstLayoutCount );
+		hostCopyProps.pCopySrcLayouts = srcLayouts.data();
+		hostCopyProps.pCopyDstLayouts = dstLayouts.data();
+
+		vkGetPhysicalDeviceProperties2( aPhysicalDev, &props2 );
+
+		return std::find( dstLayouts.begin(), dstLayouts.end(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL ) != dstLayouts.end();
+	}
+
+	void load_host_image_copy_functions( VulkanContext& aContext )
+	{
+		aContext.copyMemoryToImage = reinterpret_cast<PFN_vkCopyMemoryToImageEXT>(
+			vkGetDeviceProcAddr( aContext.device, "vkCopyMemoryToImageEXT" )
+		);
+		aContext.transitionImageLayout = reinterpret_cast<PFN_vkTransitionImageLayoutEXT>(
+			vkGetDeviceProcAddr( aContext.device, "vkTransitionImageLayoutEXT" )
+		);
+
+		if( !aContext.copyMemoryToImage || !aContext.transitionImageLayout )
+			throw lut::Error( "VK_EXT_host_image_copy is enabled, but its entry points are missing" );
+	}
 }
@@ -9,12 +9,19 @@
 
 #include <string>
 #include <vector>
+#include <optional>
 #include <unordered_set>
 
+#include "vulkan_context.hpp"
+
 namespace labutils
 {
 	namespace detail
 	{
+		// True if the environment variable is set to a non-empty value
+		// other than "0"
+		bool env_flag( char const* aName );
+
 		std::unordered_set<std::string> get_instance_layers();
 		std::unordered_set<std::string> get_instance_extensions();
 
@@ -30,5 +37,43 @@ namespace labutils
 
 
 		std::unordered_set<std::string> get_device_extensions( VkPhysicalDevice );
+
+		// True if the device supports Vulkan aMajor.aMinor or later
+		bool device_api_at_least( VkPhysicalDevice, std::uint32_t aMajor, std::uint32_t aMinor );
+
+		// The dynamicRendering feature (Vulkan 1.3). Returns false if the
+		// LABUTILS_NO_DYNAMIC_RENDERING environment variable is set
+		// (non-zero), which forces the render pass + framebuffer path.
+		bool supports_dynamic_rendering( VkPhysicalDevice );
+
+		// The bufferDeviceAddress feature (Vulkan 1.2). Returns false if the
+		// LABUTILS_NO_BUFFER_DEVICE_ADDRESS environment variable is set
+		// (non-zero); applications then fall back to bound vertex buffers,
+		// for example.
+		bool supports_buffer_device_address( VkPhysicalDevice );
+
+		void load_device_functions( VkInstance, VkDevice, VolkDeviceTable& );
+
+		// Undoes load_device_functions() before the device is destroyed: if
+		// the global vk*() device functions point at the device, they are
+		// reset, so that they aren't left bound to a destroyed VkDevice.
+		void release_device_functions( VkInstance, VkDevice );
+
+		// Queue family with COMPUTE but without GRAPHICS, for asynchronous
+		// compute. Returns nothing if there is no such family, or if the
+		// LABUTILS_NO_ASYNC_COMPUTE environment variable is set to a value
+		// other than "0" (see env_flag()).
+		std::optional<std::uint32_t> find_async_compute_family( VkPhysicalDevice );
+
+		// VK_EXT_host_image_copy with the hostImageCopy feature, and
+		// VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL among the destination
+		// layouts of host copies. Requires Vulkan 1.3 (the extension depends
+		// on VK_KHR_copy_commands2 and VK_KHR_format_feature_flags2). Returns
+		// false if the LABUTILS_NO_HOST_IMAGE_COPY environment variable is
+		// set (non-zero).
+		bool supports_host_image_copy( VkPhysicalDevice );
+
+		// Loads the VK_EXT_host_image_copy entry points into the context
+		void load_host_image_copy_functions( VulkanContext& );
 	}
 }
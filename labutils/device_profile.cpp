@@ -0,0 +1,588 @@
+#include "device_profile.hpp"
+
+#include <cmath>
+#include <limits>
+#include <string>
+#include <vector>
+#include <cinttypes>
+#include <algorithm>
+
+#include <cstdio>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+
+#include "error.hpp"
+#include "to_string.hpp"
+#include "context_helpers.hxx"
+
+namespace
+{
+	namespace cfg
+	{
+		constexpr char const* kDeviceEnv = "LABUTILS_DEVICE";
+		constexpr char const* kBenchmarkEnv = "LABUTILS_DEVICE_BENCHMARK";
+		constexpr char const* kCacheEnv = "LABUTILS_DEVICE_CACHE";
+
+		constexpr char const* kDefaultCachePath = "labutils-devices.cache";
+
+		// Fill rate benchmark: a number of clears of a RGBA8 image
+		constexpr std::uint32_t kFillSize = 2048;
+		constexpr std::uint32_t kFillRepeats = 16;
+
+		// Bandwidth benchmark: a number of device-local buffer copies
+		constexpr VkDeviceSize kCopySize = 64 * 1024 * 1024;
+		constexpr std::uint32_t kCopyRepeats = 8;
+	}
+
+	struct CachedResult_
+	{
+		std::string key;
+		double fillGpixPerSecond;
+		double copyGiBPerSecond;
+	};
+
+	std::string cache_key_( labutils::DeviceProfile const& );
+	char const* cache_path_();
+
+	std::optional<CachedResult_> load_cached_( std::string const& aKey );
+	void store_cached_( CachedResult_ const& );
+
+	void query_profile_( VkPhysicalDevice, labutils::DeviceProfile& );
+	void run_benchmarks_( VkPhysicalDevice, labutils::DeviceProfile& );
+
+	bool has_optimal_features_( VkPhysicalDevice, VkFormat, VkFormatFeatureFlags );
+}
+
+namespace labutils
+{
+	DeviceProfile profile_device( VkPhysicalDevice aPhysicalDev, bool aRunBenchmarks )
+	{
+		DeviceProfile ret{};
+		query_profile_( aPhysicalDev, ret );
+
+		auto const key = cache_key_( ret );
+		if( auto const cached = load_cached_( key ) )
+		{
+			ret.benchmarked = true;
+			ret.fillGpixPerSecond = cached->fillGpixPerSecond;
+			ret.copyGiBPerSecond = cached->copyGiBPerSecond;
+			return ret;
+		}
+
+		if( aRunBenchmarks || detail::env_flag( cfg::kBenchmarkEnv ) )
+		{
+			try
+			{
+				run_benchmarks_( aPhysicalDev, ret );
+				store_cached_( CachedResult_{ key, ret.fillGpixPerSecond, ret.copyGiBPerSecond } );
+			}
+			catch( Error const& eErr )
+			{
+				std::fprintf( stderr, "Info: Unable to benchmark device '%s': %s\n", ret.name.c_str(), eErr.what() );
+				ret.benchmarked = false;
+			}
+		}
+
+		return ret;
+	}
+
+	float score_device_profile( DeviceProfile const& aProfile )
+	{
+		// Discrete GPU > Integrated GPU > others
+		float score = 0.f;
+
+		if( VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU == aProfile.type )
+			score += 500.f;
+		else if( VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU == aProfile.type )
+			score += 100.f;
+		else if( VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU == aProfile.type )
+			score += 50.f;
+
+		// More device-local memory is better (+10 per doubling, from 1 MiB)
+		double const localMiB = double(aProfile.deviceLocalBytes) / (1024.0 * 1024.0);
+		if( localMiB > 1.0 )
+			score += float(10.0 * std::log2( localMiB ));
+
+		// Asynchronous compute and transfer queues
+		if( aProfile.dedicatedComputeQueue ) score += 20.f;
+		if( aProfile.dedicatedTransferQueue ) score += 20.f;
+
+		// Formats used by the exercises
+		if( aProfile.depth32Attachment ) score += 25.f;
+		if( aProfile.srgbColorAttachment ) score += 25.f;
+		if( aProfile.srgbSampledLinear ) score += 25.f;
+
+		// Measured performance dominates if available. Each doubling of the
+		// fill rate or bandwidth is worth about as much as the difference
+		// between an integrated and a discrete GPU.
+		if( aProfile.benchmarked )
+		{
+			score += float(400.0 * std::log2( 1.0 + aProfile.fillGpixPerSecond ));
+			score += float(400.0 * std::log2( 1.0 + aProfile.copyGiBPerSecond / 10.0 ));
+		}
+
+		return score;
+	}
+
+	std::optional<std::size_t> find_device_override( std::vector<VkPhysicalDevice> const& aDevices )
+	{
+		char const* const env = std::getenv( cfg::kDeviceEnv );
+		if( !env || !*env )
+			return {};
+
+		// Index?
+		char* end = nullptr;
+		auto const index = std::strtoul( env, &end, 10 );
+		if( end && '\0' == *end )
+		{
+			if( index >= aDevices.size() )
+				throw Error( "%s=%s: there are only %zu devices", cfg::kDeviceEnv, env, aDevices.size() );
+
+			return std::size_t(index);
+		}
+
+		// Name substring
+		for( std::size_t i = 0; i < aDevices.size(); ++i )
+		{
+			VkPhysicalDeviceProperties props;
+			vkGetPhysicalDeviceProperties( aDevices[i], &props );
+
+			if( std::strstr( props.deviceName, env ) )
+				return i;
+		}
+
+		throw Error( "%s=%s: no matching device", cfg::kDeviceEnv, env );
+	}
+
+	void print_device_profile( std::FILE* aOut, DeviceProfile const& aProfile )
+	{
+		std::fprintf( aOut, "Device '%s': %s, %.0f MiB device-local (%.0f MiB host-visible), %u queue families%s%s\n",
+			aProfile.name.c_str(),
+			to_string( aProfile.type ).c_str(),
+			aProfile.deviceLocalBytes / (1024.0 * 1024.0),
+			aProfile.hostVisibleDeviceLocalBytes / (1024.0 * 1024.0),
+			aProfile.queueFamilyCount,
+			aProfile.dedicatedComputeQueue ? ", async compute" : "",
+			aProfile.dedicatedTransferQueue ? ", async transfer" : ""
+		);
+
+		if( aProfile.benchmarked )
+		{
+			std::fprintf( aOut, "  fill rate %.2f Gpix/s, copy bandwidth %.2f GiB/s\n",
+				aProfile.fillGpixPerSecond,
+				aProfile.copyGiBPerSecond
+			);
+		}
+	}
+}
+
+namespace
+{
+	void query_profile_( VkPhysicalDevice aPhysicalDev, labutils::DeviceProfile& aProfile )
+	{
+		VkPhysicalDeviceProperties props;
+		vkGetPhysicalDeviceProperties( aPhysicalDev, &props );
+
+		aProfile.name = props.deviceName;
+		std::memcpy( aProfile.uuid, props.pipelineCacheUUID, VK_UUID_SIZE );
+		aProfile.vendorID = props.vendorID;
+		aProfile.deviceID = props.deviceID;
+		aProfile.driverVersion = props.driverVersion;
+		aProfile.apiVersion = props.apiVersion;
+		aProfile.type = props.deviceType;
+
+		aProfile.maxImageDimension2D = props.limits.maxImageDimension2D;
+		aProfile.maxComputeSharedMemorySize = props.limits.maxComputeSharedMemorySize;
+		aProfile.timestampPeriod = props.limits.timestampPeriod;
+
+		// The deviceUUID (rather than the pipeline cache UUID) identifies the
+		// physical device. It requires Vulkan 1.1, which all candidate
+		// devices have.
+		if( VK_API_VERSION_MINOR( props.apiVersion ) >= 1 || VK_API_VERSION_MAJOR( props.apiVersion ) > 1 )
+		{
+			VkPhysicalDeviceIDProperties idProps{};
+			idProps.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+
+			VkPhysicalDeviceProperties2 props2{};
+			props2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+			props2.pNext = &idProps;
+
+			vkGetPhysicalDeviceProperties2( aPhysicalDev, &props2 );
+			std::memcpy( aProfile.uuid, idProps.deviceUUID, VK_UUID_SIZE );
+		}
+
+		// Memory heaps
+		VkPhysicalDeviceMemoryProperties memory;
+		vkGetPhysicalDeviceMemoryProperties( aPhysicalDev, &memory );
+
+		for( std::uint32_t i = 0; i < memory.memoryHeapCount; ++i )
+		{
+			auto const& heap = memory.memoryHeaps[i];
+			if( !(VK_MEMORY_HEAP_DEVICE_LOCAL_BIT & heap.flags) )
+				continue;
+
+			aProfile.deviceLocalBytes += heap.size;
+
+			bool hostVisible = false;
+			for( std::uint32_t j = 0; j < memory.memoryTypeCount; ++j )
+			{
+				auto const& type = memory.memoryTypes[j];
+				if( type.heapIndex == i && (VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT & type.propertyFlags) && (VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT & type.propertyFlags) )
+					hostVisible = true;
+			}
+
+			if( hostVisible )
+				aProfile.hostVisibleDeviceLocalBytes += heap.size;
+		}
+
+		// Queue families
+		std::uint32_t numQueues = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties( aPhysicalDev, &numQueues, nullptr );
+
+		std::vector<VkQueueFamilyProperties> families( numQueues );
+		vkGetPhysicalDeviceQueueFamilyProperties( aPhysicalDev, &numQueues, families.data() );
+
+		aProfile.queueFamilyCount = numQueues;
+		for( auto const& family : families )
+		{
+			auto const flags = family.queueFlags;
+			if( (VK_QUEUE_COMPUTE_BIT & flags) && !(VK_QUEUE_GRAPHICS_BIT & flags) )
+				aProfile.dedicatedComputeQueue = true;
+			if( (VK_QUEUE_TRANSFER_BIT & flags) && !((VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT) & flags) )
+				aProfile.dedicatedTransferQueue = true;
+		}
+
+		// Formats and features
+		aProfile.depth32Attachment = has_optimal_features_( aPhysicalDev, VK_FORMAT_D32_SFLOAT, VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT );
+		aProfile.srgbColorAttachment = has_optimal_features_( aPhysicalDev, VK_FORMAT_R8G8B8A8_SRGB, VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT );
+		aProfile.srgbSampledLinear = has_optimal_features_( aPhysicalDev, VK_FORMAT_R8G8B8A8_SRGB, VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT );
+
+		VkPhysicalDeviceFeatures features;
+		vkGetPhysicalDeviceFeatures( aPhysicalDev, &features );
+
+		aProfile.textureCompressionBC = VK_TRUE == features.textureCompressionBC;
+		aProfile.textureCompressionASTC = VK_TRUE == features.textureCompressionASTC_LDR;
+	}
+
+	bool has_optimal_features_( VkPhysicalDevice aPhysicalDev, VkFormat aFormat, VkFormatFeatureFlags aFeatures )
+	{
+		VkFormatProperties props;
+		vkGetPhysicalDeviceFormatProperties( aPhysicalDev, aFormat, &props );
+
+		return aFeatures == (aFeatures & props.optimalTilingFeatures);
+	}
+}
+
+namespace
+{
+	// Temporary device and resources for the microbenchmarks. Everything is
+	// destroyed through the device's own function table, so that the global
+	// (volk) device functions are left untouched.
+	struct BenchDevice_
+	{
+		VkDevice device = VK_NULL_HANDLE;
+		VolkDeviceTable vk{};
+
+		VkQueue queue = VK_NULL_HANDLE;
+
+		VkCommandPool pool = VK_NULL_HANDLE;
+		VkQueryPool queries = VK_NULL_HANDLE;
+		VkFence fence = VK_NULL_HANDLE;
+
+		VkImage image = VK_NULL_HANDLE;
+		VkBuffer src = VK_NULL_HANDLE, dst = VK_NULL_HANDLE;
+		std::vector<VkDeviceMemory> memory;
+
+		~BenchDevice_()
+		{
+			if( VK_NULL_HANDLE == device )
+				return;
+
+			vk.vkDeviceWaitIdle( device );
+
+			if( image ) vk.vkDestroyImage( device, image, nullptr );
+			if( src ) vk.vkDestroyBuffer( device, src, nullptr );
+			if( dst ) vk.vkDestroyBuffer( device, dst, nullptr );
+			for( auto const mem : memory )
+				vk.vkFreeMemory( device, mem, nullptr );
+
+			if( fence ) vk.vkDestroyFence( device, fence, nullptr );
+			if( queries ) vk.vkDestroyQueryPool( device, queries, nullptr );
+			if( pool ) vk.vkDestroyCommandPool( device, pool, nullptr );
+
+			vk.vkDestroyDevice( device, nullptr );
+		}
+	};
+
+	void check_( VkResult aResult, char const* aWhat )
+	{
+		if( VK_SUCCESS != aResult )
+			throw labutils::Error( "%s returned %s", aWhat, labutils::to_string(aResult).c_str() );
+	}
+
+	VkDeviceMemory bind_device_local_( VkPhysicalDevice aPhysicalDev, BenchDevice_& aBench, VkMemoryRequirements const& aReqs )
+	{
+		VkPhysicalDeviceMemoryProperties props;
+		vkGetPhysicalDeviceMemoryProperties( aPhysicalDev, &props );
+
+		for( std::uint32_t i = 0; i < props.memoryTypeCount; ++i )
+		{
+			if( !(aReqs.memoryTypeBits & (1u << i)) || !(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT & props.memoryTypes[i].propertyFlags) )
+				continue;
+
+			VkMemoryAllocateInfo allocInfo{};
+			allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+			allocInfo.allocationSize = aReqs.size;
+			allocInfo.memoryTypeIndex = i;
+
+			VkDeviceMemory memory = VK_NULL_HANDLE;
+			check_( aBench.vk.vkAllocateMemory( aBench.device, &allocInfo, nullptr, &memory ), "vkAllocateMemory()" );
+
+			aBench.memory.emplace_back( memory );
+			return memory;
+		}
+
+		throw labutils::Error( "no device-local memory type" );
+	}
+
+	void run_benchmarks_( VkPhysicalDevice aPhysicalDev, labutils::DeviceProfile& aProfile )
+	{
+		// Find a GRAPHICS queue with timestamp support
+		std::uint32_t numQueues = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties( aPhysicalDev, &numQueues, nullptr );
+
+		std::vector<VkQueueFamilyProperties> families( numQueues );
+		vkGetPhysicalDeviceQueueFamilyProperties( aPhysicalDev, &numQueues, families.data() );
+
+		std::uint32_t family = numQueues;
+		for( std::uint32_t i = 0; i < numQueues; ++i )
+		{
+			if( (VK_QUEUE_GRAPHICS_BIT & families[i].queueFlags) && families[i].timestampValidBits > 0 )
+			{
+				family = i;
+				break;
+			}
+		}
+
+		if( family == numQueues )
+			throw labutils::Error( "no graphics queue with timestamps" );
+
+		// Create a temporary device
+		BenchDevice_ bench;
+
+		float const priority = 1.f;
+
+		VkDeviceQueueCreateInfo queueInfo{};
+		queueInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+		queueInfo.queueFamilyIndex = family;
+		queueInfo.queueCount = 1;
+		queueInfo.pQueuePriorities = &priority;
+
+		VkDeviceCreateInfo deviceInfo{};
+		deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+		deviceInfo.queueCreateInfoCount = 1;
+		deviceInfo.pQueueCreateInfos = &queueInfo;
+
+		check_( vkCreateDevice( aPhysicalDev, &deviceInfo, nullptr, &bench.device ), "vkCreateDevice()" );
+		volkLoadDeviceTable( &bench.vk, bench.device );
+
+		auto const& vk = bench.vk;
+		vk.vkGetDeviceQueue( bench.device, family, 0, &bench.queue );
+
+		// Resources
+		VkImageCreateInfo imageInfo{};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+		imageInfo.extent = VkExtent3D{ cfg::kFillSize, cfg::kFillSize, 1 };
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		check_( vk.vkCreateImage( bench.device, &imageInfo, nullptr, &bench.image ), "vkCreateImage()" );
+
+		VkMemoryRequirements reqs;
+		vk.vkGetImageMemoryRequirements( bench.device, bench.image, &reqs );
+		check_( vk.vkBindImageMemory( bench.device, bench.image, bind_device_local_( aPhysicalDev, bench, reqs ), 0 ), "vkBindImageMemory()" );
+
+		VkBufferCreateInfo bufferInfo{};
+		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.size = cfg::kCopySize;
+		bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+		for( auto* buffer : { &bench.src, &bench.dst } )
+		{
+			check_( vk.vkCreateBuffer( bench.device, &bufferInfo, nullptr, buffer ), "vkCreateBuffer()" );
+
+			vk.vkGetBufferMemoryRequirements( bench.device, *buffer, &reqs );
+			check_( vk.vkBindBufferMemory( bench.device, *buffer, bind_device_local_( aPhysicalDev, bench, reqs ), 0 ), "vkBindBufferMemory()" );
+		}
+
+		VkCommandPoolCreateInfo poolInfo{};
+		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+		poolInfo.queueFamilyIndex = family;
+		check_( vk.vkCreateCommandPool( bench.device, &poolInfo, nullptr, &bench.pool ), "vkCreateCommandPool()" );
+
+		VkCommandBufferAllocateInfo cbufInfo{};
+		cbufInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		cbufInfo.commandPool = bench.pool;
+		cbufInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		cbufInfo.commandBufferCount = 1;
+
+		VkCommandBuffer cbuf = VK_NULL_HANDLE;
+		check_( vk.vkAllocateCommandBuffers( bench.device, &cbufInfo, &cbuf ), "vkAllocateCommandBuffers()" );
+
+		VkQueryPoolCreateInfo queryInfo{};
+		queryInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		queryInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		queryInfo.queryCount = 4;
+		check_( vk.vkCreateQueryPool( bench.device, &queryInfo, nullptr, &bench.queries ), "vkCreateQueryPool()" );
+
+		VkFenceCreateInfo fenceInfo{};
+		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		check_( vk.vkCreateFence( bench.device, &fenceInfo, nullptr, &bench.fence ), "vkCreateFence()" );
+
+		// Record. Barriers between the individual clears/copies prevent
+		// drivers from merging or skipping redundant work.
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		check_( vk.vkBeginCommandBuffer( cbuf, &beginInfo ), "vkBeginCommandBuffer()" );
+
+		vk.vkCmdResetQueryPool( cbuf, bench.queries, 0, 4 );
+
+		VkImageSubresourceRange const range{ VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+		VkImageMemoryBarrier imageBarrier{};
+		imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		imageBarrier.srcAccessMask = 0;
+		imageBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		imageBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		imageBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		imageBarrier.image = bench.image;
+		imageBarrier.subresourceRange = range;
+
+		vk.vkCmdPipelineBarrier( cbuf, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageBarrier );
+
+		VkMemoryBarrier transferBarrier{};
+		transferBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		transferBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		transferBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+
+		vk.vkCmdWriteTimestamp( cbuf, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, bench.queries, 0 );
+
+		for( std::uint32_t i = 0; i < cfg::kFillRepeats; ++i )
+		{
+			VkClearColorValue color{};
+			color.float32[0] = float(i) / cfg::kFillRepeats;
+
+			vk.vkCmdClearColorImage( cbuf, bench.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &color, 1, &range );
+			vk.vkCmdPipelineBarrier( cbuf, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &transferBarrier, 0, nullptr, 0, nullptr );
+		}
+
+		vk.vkCmdWriteTimestamp( cbuf, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, bench.queries, 1 );
+		vk.vkCmdWriteTimestamp( cbuf, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, bench.queries, 2 );
+
+		VkBufferCopy const copy{ 0, 0, cfg::kCopySize };
+		for( std::uint32_t i = 0; i < cfg::kCopyRepeats; ++i )
+		{
+			vk.vkCmdCopyBuffer( cbuf, bench.src, bench.dst, 1, &copy );
+			vk.vkCmdPipelineBarrier( cbuf, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &transferBarrier, 0, nullptr, 0, nullptr );
+		}
+
+		vk.vkCmdWriteTimestamp( cbuf, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, bench.queries, 3 );
+
+		check_( vk.vkEndCommandBuffer( cbuf ), "vkEndCommandBuffer()" );
+
+		// Run
+		VkSubmitInfo submitInfo{};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &cbuf;
+
+		check_( vk.vkQueueSubmit( bench.queue, 1, &submitInfo, bench.fence ), "vkQueueSubmit()" );
+		check_( vk.vkWaitForFences( bench.device, 1, &bench.fence, VK_TRUE, std::numeric_limits<std::uint64_t>::max() ), "vkWaitForFences()" );
+
+		std::uint64_t stamps[4]{};
+		check_( vk.vkGetQueryPoolResults( bench.device, bench.queries, 0, 4, sizeof(stamps), stamps, sizeof(std::uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT ), "vkGetQueryPoolResults()" );
+
+		double const fillSeconds = double(stamps[1] - stamps[0]) * aProfile.timestampPeriod * 1e-9;
+		double const copySeconds = double(stamps[3] - stamps[2]) * aProfile.timestampPeriod * 1e-9;
+
+		if( fillSeconds <= 0.0 || copySeconds <= 0.0 )
+			throw labutils::Error( "invalid timestamps" );
+
+		double const pixels = double(cfg::kFillSize) * cfg::kFillSize * cfg::kFillRepeats;
+		double const bytes = double(cfg::kCopySize) * cfg::kCopyRepeats;
+
+		aProfile.benchmarked = true;
+		aProfile.fillGpixPerSecond = pixels / fillSeconds * 1e-9;
+		aProfile.copyGiBPerSecond = bytes / copySeconds / (1024.0 * 1024.0 * 1024.0);
+	}
+}
+
+namespace
+{
+	std::string cache_key_( labutils::DeviceProfile const& aProfile )
+	{
+		char key[2*VK_UUID_SIZE + 1 + 8 + 1];
+
+		char* out = key;
+		for( std::size_t i = 0; i < VK_UUID_SIZE; ++i )
+			out += std::snprintf( out, 3, "%02x", aProfile.uuid[i] );
+
+		std::snprintf( out, sizeof(key) - (out-key), "-%08" PRIx32, aProfile.driverVersion );
+		return key;
+	}
+
+	char const* cache_path_()
+	{
+		char const* const env = std::getenv( cfg::kCacheEnv );
+		return env && *env ? env : cfg::kDefaultCachePath;
+	}
+
+	// The cache is a text file with one line per device:
+	//   <deviceUUID>-<driverVersion> <fill Gpix/s> <copy GiB/s>
+	// Later lines override earlier ones.
+	std::optional<CachedResult_> load_cached_( std::string const& aKey )
+	{
+		std::FILE* file = std::fopen( cache_path_(), "r" );
+		if( !file )
+			return {};
+
+		std::optional<CachedResult_> ret;
+
+		char key[64];
+		double fill, copy;
+		while( 3 == std::fscanf( file, "%63s %lf %lf", key, &fill, &copy ) )
+		{
+			if( aKey == key )
+				ret = CachedResult_{ key, fill, copy };
+		}
+
+		std::fclose( file );
+		return ret;
+	}
+
+	void store_cached_( CachedResult_ const& aResult )
+	{
+		std::FILE* file = std::fopen( cache_path_(), "a" );
+		if( !file )
+		{
+			std::fprintf( stderr, "Info: Unable to write device cache '%s'\n", cache_path_() );
+			return;
+		}
+
+		std::fprintf( file, "%s %.6f %.6f\n", aResult.key.c_str(), aResult.fillGpixPerSecond, aResult.copyGiBPerSecond );
+		std::fclose( file );
+	}
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
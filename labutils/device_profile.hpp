@@ -0,0 +1,86 @@
+#pragma once
+
+#include <volk/volk.h>
+
+#include <string>
+#include <vector>
+#include <optional>
+
+#include <cstdio>
+#include <cstdint>
+
+namespace labutils
+{
+	// Capabilities of a physical device, used to rank devices during device
+	// selection.
+	//
+	// Properties, memory heaps, queue families and format support are
+	// queried directly. Optionally, short microbenchmarks measure fill rate
+	// (vkCmdClearColorImage) and device-local copy bandwidth
+	// (vkCmdCopyBuffer). Benchmark results are cached on disk, keyed by
+	// deviceUUID and driverVersion, so that they only run once per device and
+	// driver.
+	//
+	// Environment variables:
+	//  - LABUTILS_DEVICE: force a device, either by index (as returned by
+	//    vkEnumeratePhysicalDevices) or by a substring of its name.
+	//  - LABUTILS_DEVICE_BENCHMARK: non-zero to run the microbenchmarks for
+	//    devices that are not in the cache yet.
+	//  - LABUTILS_DEVICE_CACHE: path of the cache file (default:
+	//    labutils-devices.cache in the working directory).
+	struct DeviceProfile
+	{
+		std::string name;
+
+		std::uint8_t uuid[VK_UUID_SIZE];
+		std::uint32_t vendorID, deviceID;
+		std::uint32_t driverVersion;
+		std::uint32_t apiVersion;
+
+		VkPhysicalDeviceType type;
+
+		// Memory
+		VkDeviceSize deviceLocalBytes;
+		VkDeviceSize hostVisibleDeviceLocalBytes; // e.g., resizable BAR
+
+		// Queues
+		std::uint32_t queueFamilyCount;
+		bool dedicatedComputeQueue; // COMPUTE without GRAPHICS
+		bool dedicatedTransferQueue; // TRANSFER without GRAPHICS/COMPUTE
+
+		// Selected limits
+		std::uint32_t maxImageDimension2D;
+		std::uint32_t maxComputeSharedMemorySize;
+		float timestampPeriod;
+
+		// Format support (optimal tiling)
+		bool depth32Attachment;
+		bool srgbColorAttachment;
+		bool srgbSampledLinear;
+		bool textureCompressionBC;
+		bool textureCompressionASTC;
+
+		// Microbenchmark results; zero if not measured
+		bool benchmarked;
+		double fillGpixPerSecond;
+		double copyGiBPerSecond;
+	};
+
+	// Returns the profile of the device. The microbenchmarks are run if
+	// aRunBenchmarks is set (or LABUTILS_DEVICE_BENCHMARK is) and there are
+	// no cached results. Failing benchmarks are reported but not fatal.
+	DeviceProfile profile_device( VkPhysicalDevice, bool aRunBenchmarks = false );
+
+	// Scores a profile (higher is better). This does not check application
+	// requirements such as the API version or queue support; callers should
+	// reject unsuitable devices first.
+	float score_device_profile( DeviceProfile const& );
+
+	// Index of the device selected via LABUTILS_DEVICE, if any. Throws
+	// labutils::Error if the variable is set but matches no device.
+	std::optional<std::size_t> find_device_override( std::vector<VkPhysicalDevice> const& );
+
+	void print_device_profile( std::FILE*, DeviceProfile const& );
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
@@ -0,0 +1,81 @@
+#pragma once
+
+/* Declarations for VK_EXT_host_image_copy.
+ *
+ * The bundled Vulkan headers (and volk) predate the extension, so the subset
+ * that labutils uses is declared here, with the names and values from the
+ * Vulkan registry. With newer headers, the official declarations are used
+ * instead. The entry points are not part of VolkDeviceTable; they are loaded
+ * with vkGetDeviceProcAddr() into the VulkanContext.
+ */
+
+#include <volk/volk.h>
+
+#if !defined(VK_EXT_host_image_copy)
+#	define VK_EXT_host_image_copy 1
+#	define VK_EXT_HOST_IMAGE_COPY_EXTENSION_NAME "VK_EXT_host_image_copy"
+
+constexpr VkStructureType VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_IMAGE_COPY_FEATURES_EXT = VkStructureType(1000270000);
+constexpr VkStructureType VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_IMAGE_COPY_PROPERTIES_EXT = VkStructureType(1000270001);
+constexpr VkStructureType VK_STRUCTURE_TYPE_MEMORY_TO_IMAGE_COPY_EXT = VkStructureType(1000270002);
+constexpr VkStructureType VK_STRUCTURE_TYPE_COPY_MEMORY_TO_IMAGE_INFO_EXT = VkStructureType(1000270005);
+constexpr VkStructureType VK_STRUCTURE_TYPE_HOST_IMAGE_LAYOUT_TRANSITION_INFO_EXT = VkStructureType(1000270006);
+
+constexpr VkImageUsageFlagBits VK_IMAGE_USAGE_HOST_TRANSFER_BIT_EXT = VkImageUsageFlagBits(0x00400000);
+constexpr VkFormatFeatureFlagBits2 VK_FORMAT_FEATURE_2_HOST_IMAGE_TRANSFER_BIT_EXT = 0x400000000000ULL;
+
+typedef VkFlags VkHostImageCopyFlagsEXT;
+
+typedef struct VkPhysicalDeviceHostImageCopyFeaturesEXT {
+	VkStructureType sType;
+	void* pNext;
+	VkBool32 hostImageCopy;
+} VkPhysicalDeviceHostImageCopyFeaturesEXT;
+
+typedef struct VkPhysicalDeviceHostImageCopyPropertiesEXT {
+	VkStructureType sType;
+	void* pNext;
+	uint32_t copySrcLayoutCount;
+	VkImageLayout* pCopySrcLayouts;
+	uint32_t copyDstLayoutCount;
+	VkImageLayout* pCopyDstLayouts;
+	uint8_t optimalTilingLayoutUUID[VK_UUID_SIZE];
+	VkBool32 identicalMemoryTypeRequirements;
+} VkPhysicalDeviceHostImageCopyPropertiesEXT;
+
+typedef struct VkMemoryToImageCopyEXT {
+	VkStructureType sType;
+	const void* pNext;
+	const void* pHostPointer;
+	uint32_t memoryRowLength;
+	uint32_t memoryImageHeight;
+	VkImageSubresourceLayers imageSubresource;
+	VkOffset3D imageOffset;
+	VkExtent3D imageExtent;
+} VkMemoryToImageCopyEXT;
+
+typedef struct VkCopyMemoryToImageInfoEXT {
+	VkStructureType sType;
+	const void* pNext;
+	VkHostImageCopyFlagsEXT flags;
+	VkImage dstImage;
+	VkImageLayout dstImageLayout;
+	uint32_t regionCount;
+	const VkMemoryToImageCopyEXT* pRegions;
+} VkCopyMemoryToImageInfoEXT;
+
+typedef struct VkHostImageLayoutTransitionInfoEXT {
+	VkStructureType sType;
+	const void* pNext;
+	VkImage image;
+	VkImageLayout oldLayout;
+	VkImageLayout newLayout;
+	VkImageSubresourceRange subresourceRange;
+} VkHostImageLayoutTransitionInfoEXT;
+
+typedef VkResult (VKAPI_PTR *PFN_vkCopyMemoryToImageEXT)( VkDevice, const VkCopyMemoryToImageInfoEXT* );
+typedef VkResult (VKAPI_PTR *PFN_vkTransitionImageLayoutEXT)( VkDevice, uint32_t, const VkHostImageLayoutTransitionInfoEXT* );
+
+#endif // ~ VK_EXT_host_image_copy
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
@@ -0,0 +1,850 @@
+#include "image_encode.hpp"
+
+#include <array>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <exception>
+
+#include <cstdio>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+
+#include "error.hpp"
+
+namespace
+{
+	// RAII wrapper for output files
+	class OutFile_
+	{
+		public:
+			explicit OutFile_( char const* aPath )
+				: mPath( aPath )
+				, mFile( std::fopen( aPath, "wb" ) )
+			{
+				if( !mFile )
+					throw labutils::Error( "Unable to open '%s' for writing", aPath );
+			}
+
+			~OutFile_()
+			{
+				if( mFile )
+					std::fclose( mFile );
+			}
+
+			OutFile_( OutFile_ const& ) = delete;
+			OutFile_& operator= (OutFile_ const&) = delete;
+
+		public:
+			void write( void const* aData, std::size_t aSize )
+			{
+				if( aSize != std::fwrite( aData, 1, aSize, mFile ) )
+					throw labutils::Error( "Unable to write %zu bytes to '%s'", aSize, mPath );
+			}
+
+			void close()
+			{
+				auto* file = mFile;
+				mFile = nullptr;
+
+				if( 0 != std::fclose( file ) )
+					throw labutils::Error( "Unable to finish writing '%s'", mPath );
+			}
+
+		private:
+			char const* mPath;
+			std::FILE* mFile;
+	};
+
+	void check_args_( char const*, std::uint32_t aWidth, std::uint32_t aHeight, std::uint32_t aChannels );
+
+	// PNG/zlib support
+	std::uint32_t crc32_update_( std::uint32_t aCrc, std::uint8_t const*, std::size_t );
+	std::uint32_t adler32_update_( std::uint32_t aAdler, std::uint8_t const*, std::size_t );
+	std::uint32_t adler32_combine_( std::uint32_t aAdler1, std::uint32_t aAdler2, std::size_t aLength2 );
+
+	void deflate_fixed_( std::uint8_t const*, std::size_t, bool aFinal, std::vector<std::uint8_t>& aOut );
+
+	void png_filter_rows_(
+		std::uint8_t const* aPixels, std::size_t aStride,
+		std::uint32_t aFirstRow, std::uint32_t aRowCount,
+		std::size_t aRowBytes, std::uint32_t aBytesPerPixel,
+		std::vector<std::uint8_t>& aOut
+	);
+
+	void write_png_chunk_( OutFile_&, char const aType[4], std::uint8_t const*, std::size_t );
+
+	void put_u32be_( std::uint8_t*, std::uint32_t );
+}
+
+namespace labutils
+{
+	void write_image( EImageFormat aFormat, char const* aPath, std::uint32_t aWidth, std::uint32_t aHeight, std::uint32_t aChannels, void const* aPixels, std::size_t aStride, std::uint32_t aThreads )
+	{
+		switch( aFormat )
+		{
+			case EImageFormat::raw: write_image_raw( aPath, aWidth, aHeight, aChannels, aPixels, aStride ); break;
+			case EImageFormat::ppm: write_image_ppm( aPath, aWidth, aHeight, aChannels, aPixels, aStride ); break;
+			case EImageFormat::pam: write_image_pam( aPath, aWidth, aHeight, aChannels, aPixels, aStride ); break;
+			case EImageFormat::qoi: write_image_qoi( aPath, aWidth, aHeight, aChannels, aPixels, aStride ); break;
+			case EImageFormat::png: write_image_png( aPath, aWidth, aHeight, aChannels, aPixels, aStride, aThreads ); break;
+		}
+	}
+
+	void write_image_raw( char const* aPath, std::uint32_t aWidth, std::uint32_t aHeight, std::uint32_t aChannels, void const* aPixels, std::size_t aStride )
+	{
+		check_args_( aPath, aWidth, aHeight, aChannels );
+
+		OutFile_ out( aPath );
+
+		auto const* src = static_cast<std::uint8_t const*>(aPixels);
+		std::size_t const rowBytes = std::size_t(aWidth) * aChannels;
+
+		if( rowBytes == aStride )
+			out.write( src, rowBytes * aHeight );
+		else
+		{
+			for( std::uint32_t y = 0; y < aHeight; ++y )
+				out.write( src + y * aStride, rowBytes );
+		}
+
+		out.close();
+	}
+
+	void write_image_ppm( char const* aPath, std::uint32_t aWidth, std::uint32_t aHeight, std::uint32_t aChannels, void const* aPixels, std::size_t aStride )
+	{
+		check_args_( aPath, aWidth, aHeight, aChannels );
+
+		OutFile_ out( aPath );
+
+		// Grey (+ alpha) is written as PGM, everything else as PPM.
+		std::uint32_t const outChannels = aChannels <= 2 ? 1 : 3;
+
+		char header[64];
+		int const headerLen = std::snprintf( header, sizeof(header), "P%c\n%u %u\n255\n", 1 == outChannels ? '5' : '6', aWidth, aHeight );
+		out.write( header, std::size_t(headerLen) );
+
+		auto const* src = static_cast<std::uint8_t const*>(aPixels);
+
+		// Without an alpha channel, rows can be written as-is.
+		if( aChannels == outChannels )
+		{
+			for( std::uint32_t y = 0; y < aHeight; ++y )
+				out.write( src + y * aStride, std::size_t(aWidth) * aChannels );
+		}
+		else
+		{
+			std::vector<std::uint8_t> row( std::size_t(aWidth) * outChannels );
+			for( std::uint32_t y = 0; y < aHeight; ++y )
+			{
+				auto const* in = src + y * aStride;
+				for( std::uint32_t x = 0; x < aWidth; ++x )
+				{
+					for( std::uint32_t c = 0; c < outChannels; ++c )
+						row[x*outChannels+c] = in[x*aChannels+c];
+				}
+
+				out.write( row.data(), row.size() );
+			}
+		}
+
+		out.close();
+	}
+
+	void write_image_pam( char const* aPath, std::uint32_t aWidth, std::uint32_t aHeight, std::uint32_t aChannels, void const* aPixels, std::size_t aStride )
+	{
+		check_args_( aPath, aWidth, aHeight, aChannels );
+
+		OutFile_ out( aPath );
+
+		static constexpr char const* kTupleTypes[] = { "GRAYSCALE", "GRAYSCALE_ALPHA", "RGB", "RGB_ALPHA" };
+
+		char header[128];
+		int const headerLen = std::snprintf( header, sizeof(header), "P7\nWIDTH %u\nHEIGHT %u\nDEPTH %u\nMAXVAL 255\nTUPLTYPE %s\nENDHDR\n", aWidth, aHeight, aChannels, kTupleTypes[aChannels-1] );
+		out.write( header, std::size_t(headerLen) );
+
+		auto const* src = static_cast<std::uint8_t const*>(aPixels);
+		std::size_t const rowBytes = std::size_t(aWidth) * aChannels;
+
+		if( rowBytes == aStride )
+			out.write( src, rowBytes * aHeight );
+		else
+		{
+			for( std::uint32_t y = 0; y < aHeight; ++y )
+				out.write( src + y * aStride, rowBytes );
+		}
+
+		out.close();
+	}
+
+	void write_image_qoi( char const* aPath, std::uint32_t aWidth, std::uint32_t aHeight, std::uint32_t aChannels, void const* aPixels, std::size_t aStride )
+	{
+		check_args_( aPath, aWidth, aHeight, aChannels );
+
+		OutFile_ out( aPath );
+
+		// QOI only supports RGB and RGBA. Grey (+ alpha) is expanded.
+		bool const hasAlpha = (2 == aChannels || 4 == aChannels);
+
+		std::uint8_t header[14] = { 'q', 'o', 'i', 'f' };
+		put_u32be_( header+4, aWidth );
+		put_u32be_( header+8, aHeight );
+		header[12] = hasAlpha ? 4 : 3;
+		header[13] = 0; // sRGB with linear alpha
+		out.write( header, sizeof(header) );
+
+		// Encoded data is collected in a small buffer, and flushed whenever
+		// it fills up. The largest operation is 5 bytes (QOI_OP_RGBA).
+		constexpr std::size_t kBufferSize = 64*1024;
+		std::vector<std::uint8_t> buffer( kBufferSize );
+		std::size_t used = 0;
+
+		struct Rgba_ { std::uint8_t r, g, b, a; };
+		auto const equal = [] (Rgba_ const& aX, Rgba_ const& aY) {
+			return aX.r == aY.r && aX.g == aY.g && aX.b == aY.b && aX.a == aY.a;
+		};
+
+		std::array<Rgba_, 64> index{};
+		Rgba_ prev{ 0, 0, 0, 255 };
+		std::uint32_t run = 0;
+
+		auto const* src = static_cast<std::uint8_t const*>(aPixels);
+		std::uint64_t const pixelCount = std::uint64_t(aWidth) * aHeight;
+		std::uint64_t pixelIndex = 0;
+
+		for( std::uint32_t y = 0; y < aHeight; ++y )
+		{
+			auto const* in = src + y * aStride;
+			for( std::uint32_t x = 0; x < aWidth; ++x, in += aChannels )
+			{
+				++pixelIndex;
+
+				Rgba_ px;
+				switch( aChannels )
+				{
+					case 1: px = Rgba_{ in[0], in[0], in[0], 255 }; break;
+					case 2: px = Rgba_{ in[0], in[0], in[0], in[1] }; break;
+					case 3: px = Rgba_{ in[0], in[1], in[2], 255 }; break;
+					default: px = Rgba_{ in[0], in[1], in[2], in[3] }; break;
+				}
+
+				if( used + 8 > kBufferSize )
+				{
+					out.write( buffer.data(), used );
+					used = 0;
+				}
+
+				if( equal( px, prev ) )
+				{
+					++run;
+					if( 62 == run || pixelCount == pixelIndex )
+					{
+						buffer[used++] = std::uint8_t(0xc0 | (run-1)); // QOI_OP_RUN
+						run = 0;
+					}
+					continue;
+				}
+
+				if( run > 0 )
+				{
+					buffer[used++] = std::uint8_t(0xc0 | (run-1)); // QOI_OP_RUN
+					run = 0;
+				}
+
+				auto const hash = (px.r*3 + px.g*5 + px.b*7 + px.a*11) % 64;
+				if( equal( index[hash], px ) )
+				{
+					buffer[used++] = std::uint8_t(hash); // QOI_OP_INDEX
+				}
+				else
+				{
+					index[hash] = px;
+
+					if( px.a == prev.a )
+					{
+						auto const vr = std::int8_t(px.r - prev.r);
+						auto const vg = std::int8_t(px.g - prev.g);
+						auto const vb = std::int8_t(px.b - prev.b);
+
+						auto const vgr = vr - vg;
+						auto const vgb = vb - vg;
+
+						if( vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2 )
+						{
+							buffer[used++] = std::uint8_t(0x40 | (vr+2) << 4 | (vg+2) << 2 | (vb+2)); // QOI_OP_DIFF
+						}
+						else if( vgr > -9 && vgr < 8 && vg > -33 && vg < 32 && vgb > -9 && vgb < 8 )
+						{
+							buffer[used++] = std::uint8_t(0x80 | (vg+32)); // QOI_OP_LUMA
+							buffer[used++] = std::uint8_t((vgr+8) << 4 | (vgb+8));
+						}
+						else
+						{
+							buffer[used++] = 0xfe; // QOI_OP_RGB
+							buffer[used++] = px.r;
+							buffer[used++] = px.g;
+							buffer[used++] = px.b;
+						}
+					}
+					else
+					{
+						buffer[used++] = 0xff; // QOI_OP_RGBA
+						buffer[used++] = px.r;
+						buffer[used++] = px.g;
+						buffer[used++] = px.b;
+						buffer[used++] = px.a;
+					}
+				}
+
+				prev = px;
+			}
+		}
+
+		static constexpr std::uint8_t kEndMarker[8] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+		out.write( buffer.data(), used );
+		out.write( kEndMarker, sizeof(kEndMarker) );
+
+		out.close();
+	}
+
+	void write_image_png( char const* aPath, std::uint32_t aWidth, std::uint32_t aHeight, std::uint32_t aChannels, void const* aPixels, std::size_t aStride, std::uint32_t aThreads )
+	{
+		check_args_( aPath, aWidth, aHeight, aChannels );
+
+		// Rows are split into groups, which are filtered and compressed
+		// independently (in parallel). Each group becomes a sequence of
+		// deflate blocks. All but the last group end with an empty stored
+		// block ("sync flush"), which byte-aligns the output, such that the
+		// groups can simply be concatenated into a single zlib stream. The
+		// zlib Adler-32 checksum is combined from the per-group checksums.
+		//
+		// Matches do not reach across groups, which costs a little bit of
+		// compression compared to a single stream.
+		constexpr std::uint32_t kMinRowsPerGroup = 16;
+		constexpr std::size_t kTargetGroupBytes = 256*1024;
+
+		if( 0 == aThreads )
+			aThreads = std::max( 1u, std::thread::hardware_concurrency() );
+
+		std::size_t const rowBytes = std::size_t(aWidth) * aChannels;
+
+		std::uint32_t rowsPerGroup = std::uint32_t(std::max<std::size_t>( kMinRowsPerGroup, kTargetGroupBytes / (rowBytes+1) ));
+		rowsPerGroup = std::min( rowsPerGroup, aHeight );
+
+		std::uint32_t const groupCount = (aHeight + rowsPerGroup - 1) / rowsPerGroup;
+
+		struct Group_
+		{
+			std::vector<std::uint8_t> compressed;
+			std::uint32_t adler;
+			std::size_t length;
+		};
+
+		std::vector<Group_> groups( groupCount );
+
+		std::atomic<std::uint32_t> nextGroup{ 0 };
+		std::exception_ptr error;
+		std::atomic<bool> failed{ false };
+
+		auto const compress_groups = [&] {
+			std::vector<std::uint8_t> filtered;
+
+			try
+			{
+				for( auto i = nextGroup++; i < groupCount && !failed; i = nextGroup++ )
+				{
+					auto const firstRow = i * rowsPerGroup;
+					auto const rowCount = std::min( rowsPerGroup, aHeight - firstRow );
+
+					png_filter_rows_( static_cast<std::uint8_t const*>(aPixels), aStride, firstRow, rowCount, rowBytes, aChannels, filtered );
+
+					auto& group = groups[i];
+					group.adler = adler32_update_( 1, filtered.data(), filtered.size() );
+					group.length = filtered.size();
+
+					deflate_fixed_( filtered.data(), filtered.size(), i+1 == groupCount, group.compressed );
+				}
+			}
+			catch( ... )
+			{
+				// Only the first thread to fail records its error.
+				if( !failed.exchange( true ) )
+					error = std::current_exception();
+			}
+		};
+
+		std::uint32_t const threadCount = std::min( aThreads, groupCount );
+
+		std::vector<std::thread> threads;
+		for( std::uint32_t i = 1; i < threadCount; ++i )
+			threads.emplace_back( compress_groups );
+
+		compress_groups();
+
+		for( auto& thread : threads )
+			thread.join();
+
+		if( error )
+			std::rethrow_exception( error );
+
+		// Write file
+		OutFile_ out( aPath );
+
+		static constexpr std::uint8_t kSignature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+		out.write( kSignature, sizeof(kSignature) );
+
+		static constexpr std::uint8_t kColorTypes[] = { 0 /*grey*/, 4 /*grey+alpha*/, 2 /*RGB*/, 6 /*RGBA*/ };
+
+		std::uint8_t ihdr[13]{};
+		put_u32be_( ihdr+0, aWidth );
+		put_u32be_( ihdr+4, aHeight );
+		ihdr[8] = 8; // bit depth
+		ihdr[9] = kColorTypes[aChannels-1];
+		ihdr[10] = 0; // compression: deflate
+		ihdr[11] = 0; // filter method: adaptive
+		ihdr[12] = 0; // no interlacing
+		write_png_chunk_( out, "IHDR", ihdr, sizeof(ihdr) );
+
+		// One IDAT chunk per group. The first one starts with the zlib
+		// header; the Adler-32 checksum is appended to the last one.
+		std::uint32_t adler = 1;
+		for( std::uint32_t i = 0; i < groupCount; ++i )
+		{
+			auto& data = groups[i].compressed;
+
+			adler = 0 == i ? groups[i].adler : adler32_combine_( adler, groups[i].adler, groups[i].length );
+
+			if( 0 == i )
+			{
+				// CMF: deflate with 32k window; FLG: fastest compression,
+				// with check bits such that (CMF*256 + FLG) % 31 == 0.
+				static constexpr std::uint8_t kZlibHeader[2] = { 0x78, 0x01 };
+				data.insert( data.begin(), kZlibHeader, kZlibHeader+2 );
+			}
+
+			if( i+1 == groupCount )
+			{
+				std::uint8_t trailer[4];
+				put_u32be_( trailer, adler );
+				data.insert( data.end(), trailer, trailer+4 );
+			}
+
+			write_png_chunk_( out, "IDAT", data.data(), data.size() );
+
+			// Release memory early
+			data = std::vector<std::uint8_t>();
+		}
+
+		write_png_chunk_( out, "IEND", nullptr, 0 );
+
+		out.close();
+	}
+
+	char const* image_format_name( EImageFormat aFormat )
+	{
+		switch( aFormat )
+		{
+			case EImageFormat::raw: return "raw";
+			case EImageFormat::ppm: return "ppm";
+			case EImageFormat::pam: return "pam";
+			case EImageFormat::qoi: return "qoi";
+			case EImageFormat::png: return "png";
+		}
+
+		return "EImageFormat(unknown)";
+	}
+
+	char const* file_extension( EImageFormat aFormat )
+	{
+		// Currently, the extensions match the format names.
+		return image_format_name( aFormat );
+	}
+
+	EImageFormat parse_image_format( char const* aName )
+	{
+		for( auto const format : { EImageFormat::raw, EImageFormat::ppm, EImageFormat::pam, EImageFormat::qoi, EImageFormat::png } )
+		{
+			if( 0 == std::strcmp( aName, image_format_name( format ) ) )
+				return format;
+		}
+
+		throw Error( "Unknown image format '%s' (expected one of raw, ppm, pam, qoi, png)", aName );
+	}
+}
+
+namespace
+{
+	void check_args_( char const* aPath, std::uint32_t aWidth, std::uint32_t aHeight, std::uint32_t aChannels )
+	{
+		if( 0 == aWidth || 0 == aHeight )
+			throw labutils::Error( "Unable to write '%s': empty image (%u x %u)", aPath, aWidth, aHeight );
+
+		if( aChannels < 1 || aChannels > 4 )
+			throw labutils::Error( "Unable to write '%s': unsupported number of channels (%u)", aPath, aChannels );
+	}
+
+	void put_u32be_( std::uint8_t* aOut, std::uint32_t aValue )
+	{
+		aOut[0] = std::uint8_t(aValue >> 24);
+		aOut[1] = std::uint8_t(aValue >> 16);
+		aOut[2] = std::uint8_t(aValue >> 8);
+		aOut[3] = std::uint8_t(aValue);
+	}
+}
+
+namespace
+{
+	std::uint32_t crc32_update_( std::uint32_t aCrc, std::uint8_t const* aData, std::size_t aSize )
+	{
+		static auto const table = [] {
+			std::array<std::uint32_t, 256> ret{};
+			for( std::uint32_t i = 0; i < 256; ++i )
+			{
+				std::uint32_t c = i;
+				for( int k = 0; k < 8; ++k )
+					c = (c & 1) ? 0xedb88320u ^ (c >> 1) : (c >> 1);
+
+				ret[i] = c;
+			}
+			return ret;
+		}();
+
+		std::uint32_t crc = ~aCrc;
+		for( std::size_t i = 0; i < aSize; ++i )
+			crc = table[(crc ^ aData[i]) & 0xff] ^ (crc >> 8);
+
+		return ~crc;
+	}
+
+	constexpr std::uint32_t kAdlerBase_ = 65521;
+
+	std::uint32_t adler32_update_( std::uint32_t aAdler, std::uint8_t const* aData, std::size_t aSize )
+	{
+		std::uint32_t a = aAdler & 0xffff, b = aAdler >> 16;
+
+		// 5552 is the largest n such that 255n(n+1)/2 + (n+1)(BASE-1) fits
+		// into 32 bits; the modulo can be deferred until then.
+		while( aSize > 0 )
+		{
+			auto const chunk = std::min<std::size_t>( aSize, 5552 );
+			for( std::size_t i = 0; i < chunk; ++i )
+			{
+				a += aData[i];
+				b += a;
+			}
+
+			a %= kAdlerBase_;
+			b %= kAdlerBase_;
+
+			aData += chunk;
+			aSize -= chunk;
+		}
+
+		return (b << 16) | a;
+	}
+
+	std::uint32_t adler32_combine_( std::uint32_t aAdler1, std::uint32_t aAdler2, std::size_t aLength2 )
+	{
+		// Same as zlib's adler32_combine()
+		std::uint32_t const rem = std::uint32_t(aLength2 % kAdlerBase_);
+
+		std::uint32_t sum1 = aAdler1 & 0xffff;
+		std::uint32_t sum2 = std::uint32_t((std::uint64_t(rem) * sum1) % kAdlerBase_);
+
+		sum1 += (aAdler2 & 0xffff) + kAdlerBase_ - 1;
+		sum2 += ((aAdler1 >> 16) & 0xffff) + ((aAdler2 >> 16) & 0xffff) + kAdlerBase_ - rem;
+
+		if( sum1 >= kAdlerBase_ ) sum1 -= kAdlerBase_;
+		if( sum1 >= kAdlerBase_ ) sum1 -= kAdlerBase_;
+		if( sum2 >= (kAdlerBase_ << 1) ) sum2 -= (kAdlerBase_ << 1);
+		if( sum2 >= kAdlerBase_ ) sum2 -= kAdlerBase_;
+
+		return sum1 | (sum2 << 16);
+	}
+
+	void write_png_chunk_( OutFile_& aOut, char const aType[4], std::uint8_t const* aData, std::size_t aSize )
+	{
+		assert( aSize < (1u << 31) );
+
+		std::uint8_t header[8];
+		put_u32be_( header, std::uint32_t(aSize) );
+		std::memcpy( header+4, aType, 4 );
+
+		std::uint32_t crc = crc32_update_( 0, header+4, 4 );
+		if( aSize )
+			crc = crc32_update_( crc, aData, aSize );
+
+		std::uint8_t trailer[4];
+		put_u32be_( trailer, crc );
+
+		aOut.write( header, sizeof(header) );
+		if( aSize )
+			aOut.write( aData, aSize );
+		aOut.write( trailer, sizeof(trailer) );
+	}
+
+	void png_filter_rows_( std::uint8_t const* aPixels, std::size_t aStride, std::uint32_t aFirstRow, std::uint32_t aRowCount, std::size_t aRowBytes, std::uint32_t aBpp, std::vector<std::uint8_t>& aOut )
+	{
+		// Each row is filtered with either the Sub or the Up filter,
+		// whichever results in the smaller sum of absolute (signed)
+		// residuals. This is the usual heuristic, restricted to the two
+		// cheapest filters.
+		aOut.resize( aRowCount * (aRowBytes+1) );
+
+		std::vector<std::uint8_t> up( aRowBytes );
+
+		for( std::uint32_t r = 0; r < aRowCount; ++r )
+		{
+			auto const y = aFirstRow + r;
+			auto const* row = aPixels + y * aStride;
+			auto const* prev = y > 0 ? aPixels + (y-1) * aStride : nullptr;
+
+			auto* out = aOut.data() + r * (aRowBytes+1);
+
+			// Sub filter (written directly into the output)
+			std::uint32_t subCost = 0;
+			for( std::size_t i = 0; i < aRowBytes; ++i )
+			{
+				auto const res = std::uint8_t(row[i] - (i >= aBpp ? row[i-aBpp] : 0));
+				out[1+i] = res;
+				subCost += res < 128 ? res : 256 - res;
+			}
+
+			out[0] = 1; // Sub
+
+			if( !prev )
+				continue;
+
+			// Up filter
+			std::uint32_t upCost = 0;
+			for( std::size_t i = 0; i < aRowBytes; ++i )
+			{
+				auto const res = std::uint8_t(row[i] - prev[i]);
+				up[i] = res;
+				upCost += res < 128 ? res : 256 - res;
+			}
+
+			if( upCost < subCost )
+			{
+				out[0] = 2; // Up
+				std::memcpy( out+1, up.data(), aRowBytes );
+			}
+		}
+	}
+}
+
+namespace
+{
+	// Deflate with the fixed Huffman codes (RFC 1951, section 3.2.6) and a
+	// greedy LZ77 matcher with a single candidate per hash.
+	class BitWriter_
+	{
+		public:
+			explicit BitWriter_( std::vector<std::uint8_t>& aOut )
+				: mOut( aOut )
+			{}
+
+		public:
+			void put( std::uint32_t aBits, std::uint32_t aCount )
+			{
+				assert( aCount <= 32 );
+				mBits |= std::uint64_t(aBits) << mCount;
+				mCount += aCount;
+
+				while( mCount >= 8 )
+				{
+					mOut.push_back( std::uint8_t(mBits) );
+					mBits >>= 8;
+					mCount -= 8;
+				}
+			}
+
+			void align()
+			{
+				if( mCount > 0 )
+					put( 0, 8 - mCount );
+			}
+
+		private:
+			std::vector<std::uint8_t>& mOut;
+
+			std::uint64_t mBits = 0;
+			std::uint32_t mCount = 0;
+	};
+
+	struct HuffCode_
+	{
+		std::uint16_t code; // bit-reversed, ready for BitWriter_::put()
+		std::uint8_t length;
+	};
+
+	std::uint32_t reverse_bits_( std::uint32_t aValue, std::uint32_t aCount )
+	{
+		std::uint32_t ret = 0;
+		for( std::uint32_t i = 0; i < aCount; ++i )
+			ret |= ((aValue >> i) & 1) << (aCount-1-i);
+		return ret;
+	}
+
+	constexpr std::uint16_t kLengthBase_[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	constexpr std::uint8_t kLengthExtra_[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+
+	constexpr std::uint16_t kDistBase_[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	constexpr std::uint8_t kDistExtra_[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+	constexpr std::size_t kWindowSize_ = 32768;
+	constexpr std::size_t kMinMatch_ = 3;
+	constexpr std::size_t kMaxMatch_ = 258;
+
+	constexpr std::uint32_t kHashBits_ = 15;
+
+	struct DeflateTables_
+	{
+		HuffCode_ litlen[288];
+		HuffCode_ dist[30];
+
+		std::uint8_t lengthSymbol[kMaxMatch_+1]; // length -> index into kLengthBase_
+		std::uint8_t distSymbol[kWindowSize_+1]; // distance -> index into kDistBase_
+	};
+
+	DeflateTables_ const& deflate_tables_()
+	{
+		static DeflateTables_ const tables = [] {
+			DeflateTables_ ret{};
+
+			for( std::uint32_t i = 0; i < 288; ++i )
+			{
+				std::uint32_t code, length;
+				if( i < 144 ) code = 0x30 + i, length = 8;
+				else if( i < 256 ) code = 0x190 + (i-144), length = 9;
+				else if( i < 280 ) code = i-256, length = 7;
+				else code = 0xc0 + (i-280), length = 8;
+
+				ret.litlen[i] = HuffCode_{ std::uint16_t(reverse_bits_( code, length )), std::uint8_t(length) };
+			}
+
+			for( std::uint32_t i = 0; i < 30; ++i )
+				ret.dist[i] = HuffCode_{ std::uint16_t(reverse_bits_( i, 5 )), 5 };
+
+			for( std::uint32_t sym = 0; sym < 29; ++sym )
+			{
+				std::uint32_t const end = sym+1 < 29 ? kLengthBase_[sym+1] : kMaxMatch_+1;
+				for( std::uint32_t len = kLengthBase_[sym]; len < end && len <= kMaxMatch_; ++len )
+					ret.lengthSymbol[len] = std::uint8_t(sym);
+			}
+			ret.lengthSymbol[kMaxMatch_] = 28; // 258 has its own code
+
+			for( std::uint32_t sym = 0; sym < 30; ++sym )
+			{
+				std::uint32_t const end = sym+1 < 30 ? kDistBase_[sym+1] : kWindowSize_+1;
+				for( std::uint32_t d = kDistBase_[sym]; d < end; ++d )
+					ret.distSymbol[d] = std::uint8_t(sym);
+			}
+
+			return ret;
+		}();
+
+		return tables;
+	}
+
+	inline
+	std::uint32_t hash3_( std::uint8_t const* aData )
+	{
+		std::uint32_t const v = aData[0] | (aData[1] << 8) | (aData[2] << 16);
+		return (v * 2654435761u) >> (32 - kHashBits_);
+	}
+
+	void deflate_fixed_( std::uint8_t const* aData, std::size_t aSize, bool aFinal, std::vector<std::uint8_t>& aOut )
+	{
+		auto const& tables = deflate_tables_();
+
+		aOut.clear();
+		aOut.reserve( aSize / 2 + 64 );
+
+		BitWriter_ bits( aOut );
+
+		// Block header: BFINAL, BTYPE = 01 (fixed Huffman codes)
+		bits.put( aFinal ? 1 : 0, 1 );
+		bits.put( 1, 2 );
+
+		auto const literal = [&] (std::uint8_t aByte) {
+			auto const& hc = tables.litlen[aByte];
+			bits.put( hc.code, hc.length );
+		};
+
+		std::vector<std::int32_t> head( std::size_t(1) << kHashBits_, -1 );
+
+		std::size_t i = 0;
+		while( i < aSize )
+		{
+			if( i + kMinMatch_ > aSize )
+			{
+				literal( aData[i++] );
+				continue;
+			}
+
+			auto const h = hash3_( aData + i );
+			auto const candidate = head[h];
+			head[h] = std::int32_t(i);
+
+			std::size_t matchLength = 0;
+			if( candidate >= 0 && i - std::size_t(candidate) <= kWindowSize_ )
+			{
+				auto const* a = aData + candidate;
+				auto const* b = aData + i;
+				auto const maxLength = std::min( kMaxMatch_, aSize - i );
+
+				while( matchLength < maxLength && a[matchLength] == b[matchLength] )
+					++matchLength;
+			}
+
+			if( matchLength < kMinMatch_ )
+			{
+				literal( aData[i++] );
+				continue;
+			}
+
+			auto const distance = i - std::size_t(candidate);
+
+			auto const lsym = tables.lengthSymbol[matchLength];
+			auto const& lhc = tables.litlen[257 + lsym];
+			bits.put( lhc.code, lhc.length );
+			bits.put( std::uint32_t(matchLength - kLengthBase_[lsym]), kLengthExtra_[lsym] );
+
+			auto const dsym = tables.distSymbol[distance];
+			auto const& dhc = tables.dist[dsym];
+			bits.put( dhc.code, dhc.length );
+			bits.put( std::uint32_t(distance - kDistBase_[dsym]), kDistExtra_[dsym] );
+
+			// Insert the positions covered by the match into the hash table
+			auto const end = std::min( i + matchLength, aSize - kMinMatch_ + 1 );
+			for( std::size_t j = i+1; j < end; ++j )
+				head[hash3_( aData + j )] = std::int32_t(j);
+
+			i += matchLength;
+		}
+
+		// End of block
+		auto const& eob = tables.litlen[256];
+		bits.put( eob.code, eob.length );
+
+		if( !aFinal )
+		{
+			// Sync flush: empty stored block, byte aligned
+			bits.put( 0, 1 ); // BFINAL = 0
+			bits.put( 0, 2 ); // BTYPE = 00 (stored)
+			bits.align();
+
+			static constexpr std::uint8_t kEmptyStored[4] = { 0x00, 0x00, 0xff, 0xff };
+			aOut.insert( aOut.end(), kEmptyStored, kEmptyStored+4 );
+		}
+		else
+		{
+			bits.align();
+		}
+	}
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace labutils
+{
+	// Output formats for 8-bit images with 1 to 4 interleaved channels.
+	//  - raw: pixel data only (rows are tightly packed, no header)
+	//  - ppm: binary PGM/PPM (P5 for one and two channels, P6 otherwise;
+	//         any alpha channel is dropped)
+	//  - pam: binary PAM (P7), keeps all channels
+	//  - qoi: "Quite OK Image" format, see https://qoiformat.org/
+	//  - png: PNG, with row groups compressed in parallel
+	enum class EImageFormat
+	{
+		raw,
+		ppm,
+		pam,
+		qoi,
+		png
+	};
+
+	// Writes an image to aPath. Pixels are read directly from aPixels, with
+	// rows aStride bytes apart. This may point into mapped device memory; the
+	// encoders only read each source row once or twice, sequentially.
+	//
+	// aThreads is only used by the PNG encoder (0 = one per hardware thread).
+	//
+	// Throws labutils::Error on failure.
+	void write_image(
+		EImageFormat,
+		char const* aPath,
+		std::uint32_t aWidth, std::uint32_t aHeight, std::uint32_t aChannels,
+		void const* aPixels, std::size_t aStride,
+		std::uint32_t aThreads = 1
+	);
+
+	void write_image_raw( char const* aPath, std::uint32_t aWidth, std::uint32_t aHeight, std::uint32_t aChannels, void const* aPixels, std::size_t aStride );
+	void write_image_ppm( char const* aPath, std::uint32_t aWidth, std::uint32_t aHeight, std::uint32_t aChannels, void const* aPixels, std::size_t aStride );
+	void write_image_pam( char const* aPath, std::uint32_t aWidth, std::uint32_t aHeight, std::uint32_t aChannels, void const* aPixels, std::size_t aStride );
+	void write_image_qoi( char const* aPath, std::uint32_t aWidth, std::uint32_t aHeight, std::uint32_t aChannels, void const* aPixels, std::size_t aStride );
+	void write_image_png( char const* aPath, std::uint32_t aWidth, std::uint32_t aHeight, std::uint32_t aChannels, void const* aPixels, std::size_t aStride, std::uint32_t aThreads = 0 );
+
+	// Format names ("raw", "ppm", ...) and default file extensions
+	char const* image_format_name( EImageFormat );
+	char const* file_extension( EImageFormat );
+
+	// Throws labutils::Error for unknown names
+	EImageFormat parse_image_format( char const* );
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
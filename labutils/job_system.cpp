@@ -0,0 +1,331 @@
+#include "job_system.hpp"
+
+#include <chrono>
+#include <utility>
+
+#include <cassert>
+#include <cstdlib>
+
+#include "work_stealing_deque.hpp"
+
+namespace
+{
+	namespace cfg
+	{
+		// Overrides the default number of worker threads
+		constexpr char const* kWorkersEnv = "LABUTILS_JOB_WORKERS";
+
+		// Jobs per worker deque. If a deque is full, the spawning thread
+		// runs the job itself.
+		constexpr std::size_t kDequeCapacity = 4096;
+
+		// Idle workers yield this many times before going to sleep. Waiting
+		// threads instead sleep for kWaitSleep between attempts.
+		constexpr std::uint32_t kIdleSpins = 64;
+		constexpr auto kWaitSleep = std::chrono::microseconds(50);
+
+		// See parallel_for_grain()
+		constexpr std::size_t kChunksPerThread = 4;
+	}
+
+	// Each thread belongs to at most one JobSystem.
+	thread_local labutils::JobSystem* tJobSystem = nullptr;
+	thread_local std::uint32_t tWorkerIndex = 0;
+
+	// Victim selection for stealing
+	thread_local std::uint32_t tRandomState = 0;
+
+	std::uint32_t next_random_() noexcept
+	{
+		// xorshift32; seeded from the thread's stack address
+		if( 0 == tRandomState )
+			tRandomState = std::uint32_t(reinterpret_cast<std::uintptr_t>(&tRandomState) >> 4) | 1u;
+
+		tRandomState ^= tRandomState << 13;
+		tRandomState ^= tRandomState >> 17;
+		tRandomState ^= tRandomState << 5;
+		return tRandomState;
+	}
+}
+
+namespace labutils
+{
+	struct Job_
+	{
+		std::function<void ()> func;
+		JobCounter* counter;
+	};
+
+	struct JobSystem::Worker_
+	{
+		WorkStealingDeque<Job_*, cfg::kDequeCapacity> deque;
+	};
+
+
+	JobCounter::~JobCounter()
+	{
+		assert( done() );
+		assert( mContinuations.empty() );
+	}
+
+
+	JobSystem::JobSystem( std::uint32_t aWorkerCount )
+		: mThreadCount( aWorkerCount + 1 )
+		, mWorkers( std::make_unique<Worker_[]>( aWorkerCount + 1 ) )
+	{
+		assert( !tJobSystem );
+		tJobSystem = this;
+		tWorkerIndex = 0;
+
+		mThreads.reserve( aWorkerCount );
+		for( std::uint32_t i = 1; i <= aWorkerCount; ++i )
+			mThreads.emplace_back( [this, i] { worker_main_( i ); } );
+	}
+
+	JobSystem::~JobSystem()
+	{
+		{
+			std::lock_guard<std::mutex> lock( mSleepMutex );
+			mStop.store( true );
+		}
+		mWake.notify_all();
+
+		for( auto& thread : mThreads )
+			thread.join();
+
+		if( this == tJobSystem )
+			tJobSystem = nullptr;
+
+		// Jobs that were never waited for
+		Job_* job = nullptr;
+		for( std::uint32_t i = 0; i < mThreadCount; ++i )
+		{
+			while( mWorkers[i].deque.steal( job ) )
+				delete job;
+		}
+		for( auto* injected : mInjected )
+			delete injected;
+	}
+
+	void JobSystem::run( JobCounter& aCounter, std::function<void ()> aFunc )
+	{
+		aCounter.mPending.fetch_add( 1, std::memory_order_relaxed );
+		schedule_( new Job_{ std::move(aFunc), &aCounter } );
+	}
+
+	void JobSystem::run_after( JobCounter& aDependency, JobCounter& aCounter, std::function<void ()> aFunc )
+	{
+		aCounter.mPending.fetch_add( 1, std::memory_order_relaxed );
+		auto* job = new Job_{ std::move(aFunc), &aCounter };
+
+		{
+			std::lock_guard<std::mutex> lock( aDependency.mMutex );
+			if( !aDependency.done() )
+			{
+				aDependency.mContinuations.emplace_back( job );
+				return;
+			}
+		}
+
+		schedule_( job );
+	}
+
+	void JobSystem::wait( JobCounter& aCounter )
+	{
+		std::uint32_t idle = 0;
+		while( !aCounter.done() )
+		{
+			if( auto* job = find_job_() )
+			{
+				execute_( job );
+				idle = 0;
+				continue;
+			}
+
+			// The remaining jobs are running on other threads
+			if( ++idle < cfg::kIdleSpins )
+				std::this_thread::yield();
+			else
+				std::this_thread::sleep_for( cfg::kWaitSleep );
+		}
+
+		// Taking the lock also waits for complete_() to let go of the
+		// counter, which the caller may destroy once we return.
+		std::exception_ptr error;
+		{
+			std::lock_guard<std::mutex> lock( aCounter.mMutex );
+			error = std::exchange( aCounter.mError, nullptr );
+		}
+
+		if( error )
+			std::rethrow_exception( error );
+	}
+
+	std::uint32_t JobSystem::default_worker_count()
+	{
+		if( auto const* value = std::getenv( cfg::kWorkersEnv ); value && *value )
+			return std::uint32_t(std::strtoul( value, nullptr, 10 ));
+
+		auto const hardware = std::thread::hardware_concurrency();
+		return hardware > 1 ? hardware - 1 : 0;
+	}
+
+	void JobSystem::worker_main_( std::uint32_t aIndex )
+	{
+		tJobSystem = this;
+		tWorkerIndex = aIndex;
+
+		std::uint32_t idle = 0;
+		while( !mStop.load( std::memory_order_relaxed ) )
+		{
+			// Read the epoch before looking for work: a job scheduled after
+			// the search changes it, and the worker then doesn't sleep.
+			auto const epoch = mEpoch.load();
+
+			if( auto* job = find_job_() )
+			{
+				execute_( job );
+				idle = 0;
+				continue;
+			}
+
+			if( ++idle < cfg::kIdleSpins )
+			{
+				std::this_thread::yield();
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock( mSleepMutex );
+			mSleeping.fetch_add( 1 );
+			mWake.wait( lock, [&] {
+				return mStop.load( std::memory_order_relaxed ) || mEpoch.load() != epoch;
+			} );
+			mSleeping.fetch_sub( 1 );
+
+			idle = 0;
+		}
+	}
+
+	void JobSystem::schedule_( Job_* aJob )
+	{
+		if( this == tJobSystem )
+		{
+			// The deque is full. Running the job right away is always
+			// correct, since nothing waits on a job that was just spawned.
+			if( !mWorkers[tWorkerIndex].deque.push( aJob ) )
+			{
+				execute_( aJob );
+				return;
+			}
+		}
+		else
+		{
+			std::lock_guard<std::mutex> lock( mInjectedMutex );
+			mInjected.emplace_back( aJob );
+			mInjectedCount.fetch_add( 1, std::memory_order_release );
+		}
+
+		// Pairs with the worker incrementing mSleeping before checking the
+		// epoch (both sequentially consistent): either the worker sees the
+		// new epoch, or we see it sleeping and wake it.
+		mEpoch.fetch_add( 1 );
+		if( mSleeping.load() )
+		{
+			std::lock_guard<std::mutex> lock( mSleepMutex );
+			mWake.notify_one();
+		}
+	}
+
+	Job_* JobSystem::find_job_()
+	{
+		Job_* job = nullptr;
+
+		bool const owner = this == tJobSystem;
+		if( owner && mWorkers[tWorkerIndex].deque.pop( job ) )
+			return job;
+
+		if( mInjectedCount.load( std::memory_order_acquire ) )
+		{
+			std::lock_guard<std::mutex> lock( mInjectedMutex );
+			if( !mInjected.empty() )
+			{
+				job = mInjected.back();
+				mInjected.pop_back();
+				mInjectedCount.fetch_sub( 1, std::memory_order_relaxed );
+				return job;
+			}
+		}
+
+		// Steal, starting at a random victim
+		auto const start = next_random_();
+		for( std::uint32_t i = 0; i < mThreadCount; ++i )
+		{
+			auto const victim = (start + i) % mThreadCount;
+			if( owner && victim == tWorkerIndex )
+				continue;
+
+			if( mWorkers[victim].deque.steal( job ) )
+				return job;
+		}
+
+		return nullptr;
+	}
+
+	void JobSystem::execute_( Job_* aJob )
+	{
+		auto& counter = *aJob->counter;
+
+		try
+		{
+			aJob->func();
+		}
+		catch( ... )
+		{
+			std::lock_guard<std::mutex> lock( counter.mMutex );
+			if( !counter.mError )
+				counter.mError = std::current_exception();
+		}
+
+		delete aJob;
+		complete_( counter );
+	}
+
+	void JobSystem::complete_( JobCounter& aCounter )
+	{
+		// Fast path: not the last job of the counter
+		auto pending = aCounter.mPending.load( std::memory_order_relaxed );
+		while( pending > 1 )
+		{
+			if( aCounter.mPending.compare_exchange_weak( pending, pending - 1, std::memory_order_acq_rel, std::memory_order_relaxed ) )
+				return;
+		}
+
+		// Possibly the last job. Only decrement to zero under the lock; see
+		// JobCounter.
+		std::vector<Job_*> ready;
+		{
+			std::lock_guard<std::mutex> lock( aCounter.mMutex );
+			if( 1 != aCounter.mPending.fetch_sub( 1, std::memory_order_acq_rel ) )
+				return;
+
+			ready.swap( aCounter.mContinuations );
+		}
+
+		// The counter may be gone now.
+		for( auto* job : ready )
+			schedule_( job );
+	}
+
+
+	std::size_t parallel_for_grain( JobSystem const& aJobs, std::size_t aCount )
+	{
+		// Without workers, splitting only adds overhead
+		if( 1 == aJobs.thread_count() )
+			return std::max<std::size_t>( 1, aCount );
+
+		auto const chunks = aJobs.thread_count() * cfg::kChunksPerThread;
+		return std::max<std::size_t>( 1, (aCount + chunks - 1) / chunks );
+	}
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <exception>
+#include <functional>
+#include <condition_variable>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace labutils
+{
+	// Work-stealing job system.
+	//
+	// Each worker thread owns a Chase-Lev deque (see WorkStealingDeque).
+	// Jobs spawned on a worker go to the bottom of its own deque, and idle
+	// workers steal from the top of other workers' deques. The thread that
+	// creates the JobSystem owns a deque as well, and runs jobs while it
+	// wait()s. A JobSystem without worker threads therefore still works; all
+	// jobs then run on the waiting thread. Jobs may also be submitted from
+	// other threads; these go to a shared, mutex-protected queue.
+	//
+	// Jobs report completion through a JobCounter. Dependencies are expressed
+	// with run_after(), which holds a job back until another counter reaches
+	// zero:
+	//
+	//   JobCounter decoded, uploaded;
+	//   jobs.run( decoded, [&] { a = decode( "a.png" ); } );
+	//   jobs.run( decoded, [&] { b = decode( "b.png" ); } );
+	//   jobs.run_after( decoded, uploaded, [&] { upload( a, b ); } );
+	//   jobs.wait( uploaded ); // runs jobs while waiting
+	//
+	// Exceptions thrown by a job are stored in its counter, and wait()
+	// rethrows the first one. Jobs started with run_after() run even if a job
+	// of the counter they depend on threw.
+	//
+	// Jobs should not block on anything other than wait(); a job waiting for
+	// a mutex or for I/O takes its thread out of the pool for that time.
+	class JobSystem;
+	struct Job_; // internal; see job_system.cpp
+
+	class JobCounter
+	{
+		public:
+			JobCounter() = default;
+			~JobCounter();
+
+			JobCounter( JobCounter const& ) = delete;
+			JobCounter& operator= (JobCounter const&) = delete;
+
+		public:
+			bool done() const noexcept
+			{
+				return 0 == mPending.load( std::memory_order_acquire );
+			}
+
+		private:
+			friend class JobSystem;
+
+			std::atomic<std::uint32_t> mPending{ 0 };
+
+			// The last job to finish decrements mPending to zero while holding
+			// mMutex. run_after() checks mPending under the same lock, so a
+			// continuation is either queued before, or sees zero after.
+			std::mutex mMutex;
+			std::vector<Job_*> mContinuations;
+			std::exception_ptr mError;
+	};
+
+	class JobSystem
+	{
+		public:
+			// Creates aWorkerCount threads in addition to the calling thread.
+			explicit JobSystem( std::uint32_t aWorkerCount = default_worker_count() );
+
+			// All jobs must have completed; wait() for them first.
+			~JobSystem();
+
+			JobSystem( JobSystem const& ) = delete;
+			JobSystem& operator= (JobSystem const&) = delete;
+
+		public:
+			// Number of threads executing jobs, including the thread that
+			// created the JobSystem.
+			std::uint32_t thread_count() const noexcept { return mThreadCount; }
+
+			void run( JobCounter&, std::function<void ()> );
+
+			// Starts the job once aDependency has reached zero. aCounter is
+			// incremented immediately.
+			void run_after( JobCounter& aDependency, JobCounter&, std::function<void ()> );
+
+			// Executes jobs until the counter reaches zero. Rethrows the first
+			// exception thrown by one of the counter's jobs.
+			void wait( JobCounter& );
+
+		public:
+			// LABUTILS_JOB_WORKERS if set, one less than the number of
+			// hardware threads otherwise.
+			static std::uint32_t default_worker_count();
+
+		private:
+			struct Worker_;
+
+			void worker_main_( std::uint32_t aIndex );
+
+			void schedule_( Job_* );
+			Job_* find_job_();
+			void execute_( Job_* );
+			void complete_( JobCounter& );
+
+		private:
+			std::uint32_t mThreadCount;
+
+			// mWorkers[0] belongs to the thread that created the JobSystem
+			std::unique_ptr<Worker_[]> mWorkers;
+			std::vector<std::thread> mThreads;
+
+			std::mutex mInjectedMutex;
+			std::vector<Job_*> mInjected; // jobs submitted by other threads
+			std::atomic<std::size_t> mInjectedCount{ 0 };
+
+			// Sleeping workers are woken up when mEpoch changes.
+			std::mutex mSleepMutex;
+			std::condition_variable mWake;
+			std::atomic<std::uint32_t> mSleeping{ 0 };
+			std::atomic<std::uint64_t> mEpoch{ 0 };
+			std::atomic<bool> mStop{ false };
+	};
+
+	// Grain size used by parallel_for() if none is given: the range is split
+	// into a few chunks per thread, so that stealing can balance uneven
+	// chunks.
+	std::size_t parallel_for_grain( JobSystem const&, std::size_t aCount );
+
+	// Calls aBody( first, last ) for consecutive ranges [first, last)
+	// covering [0, aCount), at most aGrain elements each, in parallel, and
+	// returns once all calls have completed. A zero aGrain selects one with
+	// parallel_for_grain().
+	template< typename tBody >
+	void parallel_for( JobSystem& aJobs, std::size_t aCount, tBody&& aBody, std::size_t aGrain = 0 )
+	{
+		if( 0 == aGrain )
+			aGrain = parallel_for_grain( aJobs, aCount );
+
+		if( aGrain >= aCount )
+		{
+			if( aCount )
+				aBody( std::size_t(0), aCount );
+			return;
+		}
+
+		JobCounter counter;
+		for( std::size_t first = 0; first < aCount; first += aGrain )
+		{
+			auto const last = std::min( first + aGrain, aCount );
+			aJobs.run( counter, [&aBody, first, last] { aBody( first, last ); } );
+		}
+
+		aJobs.wait( counter );
+	}
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
@@ -0,0 +1,152 @@
+#include "mipmap.hpp"
+
+#include <cmath>
+#include <algorithm>
+
+#include <cassert>
+#include <cstring>
+
+namespace
+{
+	constexpr std::size_t kTexelBytes_ = 4;
+
+	struct SrgbTables_
+	{
+		float toLinear[256];
+		std::uint8_t fromLinear[4096]; // indexed by linear value * 4095
+
+		SrgbTables_() noexcept
+		{
+			for( std::size_t i = 0; i < 256; ++i )
+			{
+				float const c = i / 255.f;
+				toLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow( (c + 0.055f) / 1.055f, 2.4f );
+			}
+
+			for( std::size_t i = 0; i < 4096; ++i )
+			{
+				float const l = i / 4095.f;
+				float const c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow( l, 1.f / 2.4f ) - 0.055f;
+				fromLinear[i] = std::uint8_t(c * 255.f + 0.5f);
+			}
+		}
+	};
+
+	SrgbTables_ const& srgb_tables_()
+	{
+		static SrgbTables_ const tables;
+		return tables;
+	}
+
+	// Source rows/columns averaged into destination row/column aDst: two,
+	// except along a source axis of one texel (one), and for the last
+	// destination texel along an odd source axis (three, so that the last
+	// source row/column isn't dropped).
+	struct Footprint_
+	{
+		std::size_t first;
+		std::size_t count;
+	};
+
+	Footprint_ footprint_( std::size_t aDst, std::uint32_t aSrcSize ) noexcept
+	{
+		if( 1 == aSrcSize )
+			return { 0, 1 };
+
+		if( (aSrcSize & 1) && 2*aDst + 3 == aSrcSize )
+			return { 2*aDst, 3 };
+
+		return { 2*aDst, 2 };
+	}
+}
+
+namespace labutils
+{
+	void downsample_rgba8_rows( std::uint8_t const* aSrc, std::uint32_t aSrcWidth, std::uint32_t aSrcHeight, std::uint8_t* aDst, std::uint32_t aDstWidth, std::size_t aFirstRow, std::size_t aLastRow, bool aSrgb )
+	{
+		auto const& tables = srgb_tables_();
+
+		for( std::size_t y = aFirstRow; y < aLastRow; ++y )
+		{
+			auto const fy = footprint_( y, aSrcHeight );
+
+			for( std::size_t x = 0; x < aDstWidth; ++x )
+			{
+				auto const fx = footprint_( x, aSrcWidth );
+
+				float linear[3] = {};
+				std::uint32_t sums[4] = {};
+				for( std::size_t sy = fy.first; sy < fy.first + fy.count; ++sy )
+				{
+					for( std::size_t sx = fx.first; sx < fx.first + fx.count; ++sx )
+					{
+						auto const* texel = aSrc + (sy * aSrcWidth + sx) * kTexelBytes_;
+						for( std::size_t c = 0; c < 3; ++c )
+						{
+							if( aSrgb )
+								linear[c] += tables.toLinear[texel[c]];
+							else
+								sums[c] += texel[c];
+						}
+
+						sums[3] += texel[3];
+					}
+				}
+
+				auto const count = std::uint32_t(fx.count * fy.count);
+
+				auto* out = aDst + (y * aDstWidth + x) * kTexelBytes_;
+				for( std::size_t c = 0; c < 3; ++c )
+				{
+					if( aSrgb )
+						out[c] = tables.fromLinear[std::size_t(linear[c] * (4095.f / count) + 0.5f)];
+					else
+						out[c] = std::uint8_t((sums[c] + count/2) / count);
+				}
+
+				out[3] = std::uint8_t((sums[3] + count/2) / count);
+			}
+		}
+	}
+
+	MipChain generate_mip_chain_rgba8( ImageData const& aData, bool aSrgb )
+	{
+		assert( aData.texels );
+
+		MipChain ret;
+		ret.width = aData.width;
+		ret.height = aData.height;
+
+		auto const levels = compute_mip_level_count( aData.width, aData.height );
+
+		std::size_t total = 0;
+		ret.levelOffsets.resize( levels );
+		for( std::uint32_t level = 0; level < levels; ++level )
+		{
+			ret.levelOffsets[level] = total;
+			total += std::size_t(std::max( 1u, aData.width >> level )) * std::max( 1u, aData.height >> level ) * kTexelBytes_;
+		}
+
+		ret.texels.resize( total );
+		std::memcpy( ret.texels.data(), aData.texels.get(), std::size_t(aData.width) * aData.height * kTexelBytes_ );
+
+		for( std::uint32_t level = 1; level < levels; ++level )
+		{
+			auto const srcWidth = std::max( 1u, aData.width >> (level-1) );
+			auto const srcHeight = std::max( 1u, aData.height >> (level-1) );
+			auto const dstWidth = std::max( 1u, aData.width >> level );
+			auto const dstHeight = std::max( 1u, aData.height >> level );
+
+			downsample_rgba8_rows(
+				ret.texels.data() + ret.levelOffsets[level-1], srcWidth, srcHeight,
+				ret.texels.data() + ret.levelOffsets[level], dstWidth,
+				0, dstHeight,
+				aSrgb
+			);
+		}
+
+		return ret;
+	}
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "vkimage.hpp"
+
+namespace labutils
+{
+	// Full mip chain of an RGBA8 image, generated on the CPU. Levels are
+	// tightly packed, level 0 first.
+	struct MipChain
+	{
+		std::uint32_t width = 0; // of level 0
+		std::uint32_t height = 0;
+
+		std::vector<std::size_t> levelOffsets; // in bytes, one per level
+		std::vector<std::uint8_t> texels;
+	};
+
+	// Box-filters rows [aFirstRow, aLastRow) of aDst from aSrc (aSrcWidth x
+	// aSrcHeight RGBA8). aDst is half the size of aSrc (rounded down, at least
+	// one). Along an odd dimension, the last destination texel averages three
+	// source texels rather than two. Colour channels of sRGB images are
+	// averaged in linear space. Rows are independent, so large levels may be
+	// split over several threads.
+	void downsample_rgba8_rows(
+		std::uint8_t const* aSrc, std::uint32_t aSrcWidth, std::uint32_t aSrcHeight,
+		std::uint8_t* aDst, std::uint32_t aDstWidth,
+		std::size_t aFirstRow, std::size_t aLastRow,
+		bool aSrgb
+	);
+
+	// Generates all compute_mip_level_count() levels on the calling thread
+	MipChain generate_mip_chain_rgba8( ImageData const&, bool aSrgb );
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
@@ -0,0 +1,305 @@
+#include "object_cache.hpp"
+
+#include <utility>
+
+#include <cassert>
+#include <cstring>
+
+#include "error.hpp"
+#include "vkutil.hpp"
+#include "to_string.hpp"
+
+namespace labutils
+{
+	namespace
+	{
+		void hash_combine_( std::size_t& aSeed, std::uint64_t aValue ) noexcept
+		{
+			aSeed ^= std::size_t(aValue) + 0x9e3779b97f4a7c15ull + (aSeed << 6) + (aSeed >> 2);
+		}
+		void hash_combine_( std::size_t& aSeed, float aValue ) noexcept
+		{
+			std::uint32_t bits;
+			std::memcpy( &bits, &aValue, sizeof(bits) );
+			hash_combine_( aSeed, std::uint64_t(bits) );
+		}
+		template< typename tHandle >
+		void hash_combine_handle_( std::size_t& aSeed, tHandle aHandle ) noexcept
+		{
+			// Non-dispatchable handles are pointers on 64-bit platforms and
+			// 64-bit integers elsewhere.
+			std::uint64_t bits = 0;
+			std::memcpy( &bits, &aHandle, sizeof(aHandle) );
+			hash_combine_( aSeed, bits );
+		}
+
+		bool operator== (VkComponentMapping const& aX, VkComponentMapping const& aY) noexcept
+		{
+			return aX.r == aY.r && aX.g == aY.g && aX.b == aY.b && aX.a == aY.a;
+		}
+		bool operator== (VkImageSubresourceRange const& aX, VkImageSubresourceRange const& aY) noexcept
+		{
+			return aX.aspectMask == aY.aspectMask
+				&& aX.baseMipLevel == aY.baseMipLevel && aX.levelCount == aY.levelCount
+				&& aX.baseArrayLayer == aY.baseArrayLayer && aX.layerCount == aY.layerCount
+			;
+		}
+	}
+}
+
+namespace labutils
+{
+	SamplerCache::SamplerCache( VulkanContext const& aContext )
+		: mContext( &aContext )
+	{}
+
+	SamplerCache::SamplerCache( SamplerCache&& ) noexcept = default;
+	SamplerCache& SamplerCache::operator= (SamplerCache&&) noexcept = default;
+
+	VkSampler SamplerCache::acquire( VkSamplerCreateInfo const& aInfo )
+	{
+		if( aInfo.pNext )
+			throw Error( "SamplerCache: VkSamplerCreateInfo::pNext must be null" );
+
+		++mRequests;
+
+		Key key{ aInfo };
+		key.info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+
+		if( auto it = mEntries.find( key ); mEntries.end() != it )
+		{
+			++it->second.uses;
+			return it->second.sampler.handle;
+		}
+
+		VkSampler sampler = VK_NULL_HANDLE;
+		if( auto const res = vkCreateSampler( mContext->device, &key.info, nullptr, &sampler ); VK_SUCCESS != res )
+		{
+			throw Error( "Unable to Create Sampler\n"
+				"vkCreateSampler() Returned %s", to_string(res).c_str() );
+		}
+
+		++mCreated;
+		mEntries.emplace( key, Entry{ Sampler( mContext->device, sampler ), 1 } );
+		mHandles.emplace( sampler, key );
+		return sampler;
+	}
+
+	VkSampler SamplerCache::acquire_default()
+	{
+		return acquire( default_sampler_info( *mContext ) );
+	}
+
+	void SamplerCache::release( VkSampler aSampler )
+	{
+		auto const it = mHandles.find( aSampler );
+		assert( mHandles.end() != it );
+
+		auto& entry = mEntries.at( it->second );
+		assert( entry.uses > 0 );
+		--entry.uses;
+	}
+
+	std::size_t SamplerCache::purge_unused()
+	{
+		std::size_t purged = 0;
+		for( auto it = mEntries.begin(); mEntries.end() != it; )
+		{
+			if( 0 == it->second.uses )
+			{
+				mHandles.erase( it->second.sampler.handle );
+				it = mEntries.erase( it );
+				++purged;
+			}
+			else
+				++it;
+		}
+
+		return purged;
+	}
+
+	std::uint32_t SamplerCache::use_count( VkSampler aSampler ) const
+	{
+		auto const it = mHandles.find( aSampler );
+		if( mHandles.end() == it )
+			return 0;
+
+		return mEntries.at( it->second ).uses;
+	}
+
+	ObjectCacheStats SamplerCache::stats() const
+	{
+		return ObjectCacheStats{ mEntries.size(), mRequests, mCreated };
+	}
+
+	bool SamplerCache::Key::operator== (Key const& aOther) const noexcept
+	{
+		auto const& x = info;
+		auto const& y = aOther.info;
+		return x.flags == y.flags
+			&& x.magFilter == y.magFilter && x.minFilter == y.minFilter
+			&& x.mipmapMode == y.mipmapMode
+			&& x.addressModeU == y.addressModeU && x.addressModeV == y.addressModeV && x.addressModeW == y.addressModeW
+			&& x.mipLodBias == y.mipLodBias
+			&& x.anisotropyEnable == y.anisotropyEnable && x.maxAnisotropy == y.maxAnisotropy
+			&& x.compareEnable == y.compareEnable && x.compareOp == y.compareOp
+			&& x.minLod == y.minLod && x.maxLod == y.maxLod
+			&& x.borderColor == y.borderColor
+			&& x.unnormalizedCoordinates == y.unnormalizedCoordinates
+		;
+	}
+
+	std::size_t SamplerCache::KeyHash::operator() (Key const& aKey) const noexcept
+	{
+		auto const& x = aKey.info;
+
+		std::size_t seed = 0;
+		hash_combine_( seed, std::uint64_t(x.flags) );
+		hash_combine_( seed, std::uint64_t(x.magFilter) << 32 | std::uint64_t(x.minFilter) );
+		hash_combine_( seed, std::uint64_t(x.mipmapMode) );
+		hash_combine_( seed, std::uint64_t(x.addressModeU) << 32 | std::uint64_t(x.addressModeV) );
+		hash_combine_( seed, std::uint64_t(x.addressModeW) );
+		hash_combine_( seed, x.mipLodBias );
+		hash_combine_( seed, std::uint64_t(x.anisotropyEnable) );
+		hash_combine_( seed, x.maxAnisotropy );
+		hash_combine_( seed, std::uint64_t(x.compareEnable) << 32 | std::uint64_t(x.compareOp) );
+		hash_combine_( seed, x.minLod );
+		hash_combine_( seed, x.maxLod );
+		hash_combine_( seed, std::uint64_t(x.borderColor) << 32 | std::uint64_t(x.unnormalizedCoordinates) );
+		return seed;
+	}
+}
+
+namespace labutils
+{
+	ImageViewCache::ImageViewCache( VulkanContext const& aContext )
+		: mContext( &aContext )
+	{}
+
+	ImageViewCache::ImageViewCache( ImageViewCache&& ) noexcept = default;
+	ImageViewCache& ImageViewCache::operator= (ImageViewCache&&) noexcept = default;
+
+	VkImageView ImageViewCache::acquire( VkImage aImage, VkFormat aFormat, VkImageSubresourceRange const& aRange, VkImageViewType aType, VkComponentMapping const& aComponents )
+	{
+		++mRequests;
+
+		Key const key{ aImage, aType, aFormat, aComponents, aRange };
+		if( auto it = mEntries.find( key ); mEntries.end() != it )
+		{
+			++it->second.uses;
+			return it->second.view.handle;
+		}
+
+		VkImageViewCreateInfo viewInfo{}; {
+			viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+
+			viewInfo.image = aImage;
+			viewInfo.viewType = aType;
+			viewInfo.format = aFormat;
+
+			viewInfo.components = aComponents;
+			viewInfo.subresourceRange = aRange;
+		}
+
+		VkImageView view = VK_NULL_HANDLE;
+		if( auto const res = vkCreateImageView( mContext->device, &viewInfo, nullptr, &view ); VK_SUCCESS != res )
+		{
+			throw Error( "Unable to Create Image View\n"
+				"vkCreateImageView() Returned %s", to_string(res).c_str() );
+		}
+
+		++mCreated;
+		mEntries.emplace( key, Entry{ ImageView( mContext->device, view ), 1 } );
+		mHandles.emplace( view, key );
+		return view;
+	}
+
+	VkImageView ImageViewCache::acquire_texture2d( VkImage aImage, VkFormat aFormat )
+	{
+		return acquire( aImage, aFormat, VkImageSubresourceRange{
+			VK_IMAGE_ASPECT_COLOR_BIT,
+			0, VK_REMAINING_MIP_LEVELS,
+			0, 1
+		} );
+	}
+
+	void ImageViewCache::release( VkImageView aView )
+	{
+		auto const it = mHandles.find( aView );
+		assert( mHandles.end() != it );
+
+		auto& entry = mEntries.at( it->second );
+		assert( entry.uses > 0 );
+		--entry.uses;
+	}
+
+	void ImageViewCache::evict( VkImage aImage )
+	{
+		for( auto it = mEntries.begin(); mEntries.end() != it; )
+		{
+			if( aImage == it->first.image )
+			{
+				mHandles.erase( it->second.view.handle );
+				it = mEntries.erase( it );
+			}
+			else
+				++it;
+		}
+	}
+
+	std::size_t ImageViewCache::purge_unused()
+	{
+		std::size_t purged = 0;
+		for( auto it = mEntries.begin(); mEntries.end() != it; )
+		{
+			if( 0 == it->second.uses )
+			{
+				mHandles.erase( it->second.view.handle );
+				it = mEntries.erase( it );
+				++purged;
+			}
+			else
+				++it;
+		}
+
+		return purged;
+	}
+
+	std::uint32_t ImageViewCache::use_count( VkImageView aView ) const
+	{
+		auto const it = mHandles.find( aView );
+		if( mHandles.end() == it )
+			return 0;
+
+		return mEntries.at( it->second ).uses;
+	}
+
+	ObjectCacheStats ImageViewCache::stats() const
+	{
+		return ObjectCacheStats{ mEntries.size(), mRequests, mCreated };
+	}
+
+	bool ImageViewCache::Key::operator== (Key const& aOther) const noexcept
+	{
+		return image == aOther.image
+			&& type == aOther.type
+			&& format == aOther.format
+			&& components == aOther.components
+			&& range == aOther.range
+		;
+	}
+
+	std::size_t ImageViewCache::KeyHash::operator() (Key const& aKey) const noexcept
+	{
+		std::size_t seed = 0;
+		hash_combine_handle_( seed, aKey.image );
+		hash_combine_( seed, std::uint64_t(aKey.type) << 32 | std::uint64_t(aKey.format) );
+		hash_combine_( seed, std::uint64_t(aKey.components.r) << 48 | std::uint64_t(aKey.components.g) << 32 | std::uint64_t(aKey.components.b) << 16 | std::uint64_t(aKey.components.a) );
+		hash_combine_( seed, std::uint64_t(aKey.range.aspectMask) );
+		hash_combine_( seed, std::uint64_t(aKey.range.baseMipLevel) << 32 | std::uint64_t(aKey.range.levelCount) );
+		hash_combine_( seed, std::uint64_t(aKey.range.baseArrayLayer) << 32 | std::uint64_t(aKey.range.layerCount) );
+		return seed;
+	}
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
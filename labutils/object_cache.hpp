@@ -0,0 +1,157 @@
+#pragma once
+
+#include <volk/volk.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+
+#include "vkobject.hpp"
+#include "vulkan_context.hpp"
+
+namespace labutils
+{
+	// Interning caches for samplers and image views. Requests with identical
+	// state return the same Vulkan handle, so a scene with many objects only
+	// creates one VkSampler/VkImageView per unique state.
+	//
+	// The caches own the Vulkan objects. Handles returned by acquire() are
+	// shared and remain valid until they are release()d by every user and
+	// purged with purge_unused(), or until the cache is destroyed. Each
+	// acquire() increments the entry's usage count; release() decrements it.
+	//
+	// The caches are not thread safe.
+
+	struct ObjectCacheStats
+	{
+		std::size_t objects;   // number of live Vulkan objects
+		std::size_t requests;  // total number of acquire() calls
+		std::size_t created;   // acquire() calls that created an object
+	};
+
+	class SamplerCache
+	{
+		public:
+			explicit SamplerCache( VulkanContext const& );
+
+			// Move-only
+			SamplerCache( SamplerCache const& ) = delete;
+			SamplerCache& operator= (SamplerCache const&) = delete;
+
+			SamplerCache( SamplerCache&& ) noexcept;
+			SamplerCache& operator= (SamplerCache&&) noexcept;
+
+		public:
+			// The key is the full VkSamplerCreateInfo. Extension structures
+			// (pNext) are not supported; acquire() throws labutils::Error
+			// if pNext is not null.
+			VkSampler acquire( VkSamplerCreateInfo const& );
+
+			// Sampler state of labutils::create_default_sampler()
+			VkSampler acquire_default();
+
+			void release( VkSampler );
+
+			// Destroys samplers that are no longer in use. Returns the number
+			// of destroyed samplers.
+			std::size_t purge_unused();
+
+			std::uint32_t use_count( VkSampler ) const;
+			ObjectCacheStats stats() const;
+
+		private:
+			struct Key
+			{
+				VkSamplerCreateInfo info;
+
+				bool operator== (Key const&) const noexcept;
+			};
+			struct KeyHash
+			{
+				std::size_t operator() (Key const&) const noexcept;
+			};
+
+			struct Entry
+			{
+				Sampler sampler;
+				std::uint32_t uses;
+			};
+
+			VulkanContext const* mContext;
+
+			std::unordered_map<Key, Entry, KeyHash> mEntries;
+			std::unordered_map<VkSampler, Key> mHandles;
+
+			std::size_t mRequests = 0, mCreated = 0;
+	};
+
+	class ImageViewCache
+	{
+		public:
+			explicit ImageViewCache( VulkanContext const& );
+
+			// Move-only
+			ImageViewCache( ImageViewCache const& ) = delete;
+			ImageViewCache& operator= (ImageViewCache const&) = delete;
+
+			ImageViewCache( ImageViewCache&& ) noexcept;
+			ImageViewCache& operator= (ImageViewCache&&) noexcept;
+
+		public:
+			// The key is the image, view type, format, component mapping and
+			// subresource range.
+			VkImageView acquire(
+				VkImage, VkFormat,
+				VkImageSubresourceRange const&,
+				VkImageViewType = VK_IMAGE_VIEW_TYPE_2D,
+				VkComponentMapping const& = VkComponentMapping{}
+			);
+
+			// Same view as labutils::create_image_view_texture2d()
+			VkImageView acquire_texture2d( VkImage, VkFormat );
+
+			void release( VkImageView );
+
+			// Destroys all views of the image, regardless of their usage
+			// counts. Call this before destroying the image itself.
+			void evict( VkImage );
+
+			// Destroys views that are no longer in use. Returns the number of
+			// destroyed views.
+			std::size_t purge_unused();
+
+			std::uint32_t use_count( VkImageView ) const;
+			ObjectCacheStats stats() const;
+
+		private:
+			struct Key
+			{
+				VkImage image;
+				VkImageViewType type;
+				VkFormat format;
+				VkComponentMapping components;
+				VkImageSubresourceRange range;
+
+				bool operator== (Key const&) const noexcept;
+			};
+			struct KeyHash
+			{
+				std::size_t operator() (Key const&) const noexcept;
+			};
+
+			struct Entry
+			{
+				ImageView view;
+				std::uint32_t uses;
+			};
+
+			VulkanContext const* mContext;
+
+			std::unordered_map<Key, Entry, KeyHash> mEntries;
+			std::unordered_map<VkImageView, Key> mHandles;
+
+			std::size_t mRequests = 0, mCreated = 0;
+	};
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
@@ -0,0 +1,177 @@
+#include "redraw_scheduler.hpp"
+
+#include <algorithm>
+
+#include <cstdio>
+
+#include "context_helpers.hxx"
+
+namespace
+{
+	namespace cfg
+	{
+		// Setting LABUTILS_ON_DEMAND to a non-zero value enables on-demand
+		// rendering.
+		constexpr char const* kOnDemandEnv = "LABUTILS_ON_DEMAND";
+
+		// Longest sleep in glfwWaitEventsTimeout(). Events and invalidate()
+		// wake the main thread earlier; the timeout only bounds how long
+		// the loop goes without checking window_should_close() etc.
+		constexpr double kMaxWaitSeconds = 0.5;
+	}
+}
+
+namespace labutils
+{
+	RedrawScheduler::RedrawScheduler( VulkanWindow const& aWindow, ERedrawEvents aEvents )
+		: mWindow( aWindow.window )
+		, mEvents( aEvents )
+	{
+		mOnDemand = detail::env_flag( cfg::kOnDemandEnv );
+
+		if( mWindow && ERedrawEvents::glfw == mEvents )
+			glfwGetFramebufferSize( mWindow, &mFramebufferWidth, &mFramebufferHeight );
+	}
+
+	void RedrawScheduler::set_on_demand( bool aOnDemand ) noexcept
+	{
+		mOnDemand = aOnDemand;
+	}
+
+	void RedrawScheduler::invalidate() noexcept
+	{
+		if( ERedrawEvents::external == mEvents )
+		{
+			// Increment under the lock, so that the wake-up cannot slip in
+			// between wait_external_()'s check and its wait.
+			{
+				std::lock_guard<std::mutex> lock( mWakeMutex );
+				mRequested.fetch_add( 1, std::memory_order_release );
+			}
+			mWake.notify_one();
+			return;
+		}
+
+		mRequested.fetch_add( 1, std::memory_order_release );
+
+		if( mWindow && mOnDemand )
+			glfwPostEmptyEvent();
+	}
+
+	void RedrawScheduler::set_minimized( bool aMinimized ) noexcept
+	{
+		mMinimized.store( aMinimized, std::memory_order_relaxed );
+
+		// Restoring the window needs a new frame.
+		if( !aMinimized )
+			invalidate();
+	}
+
+	void RedrawScheduler::animate_until( Clock::time_point aUntil ) noexcept
+	{
+		mAnimateUntil = std::max( mAnimateUntil, aUntil );
+	}
+
+	bool RedrawScheduler::wait_for_frame()
+	{
+		if( !mWindow )
+			return true;
+
+		if( ERedrawEvents::external == mEvents )
+			return wait_external_();
+
+		return wait_glfw_();
+	}
+
+	bool RedrawScheduler::pending_() noexcept
+	{
+		mObserved = mRequested.load( std::memory_order_acquire );
+		return mObserved != mCompleted || Clock::now() < mAnimateUntil;
+	}
+
+	bool RedrawScheduler::wait_glfw_()
+	{
+		if( !mOnDemand )
+		{
+			glfwPollEvents();
+			return true;
+		}
+
+		// Nothing is visible while minimized; sleep even if frames are
+		// pending.
+		bool const iconified = glfwGetWindowAttrib( mWindow, GLFW_ICONIFIED );
+
+		if( pending_() && !iconified )
+		{
+			// Don't sleep, but still process input.
+			glfwPollEvents();
+		}
+		else
+		{
+			glfwWaitEventsTimeout( cfg::kMaxWaitSeconds );
+		}
+
+		int width = 0, height = 0;
+		glfwGetFramebufferSize( mWindow, &width, &height );
+		if( width != mFramebufferWidth || height != mFramebufferHeight )
+		{
+			mFramebufferWidth = width;
+			mFramebufferHeight = height;
+			invalidate();
+		}
+
+		if( glfwGetWindowAttrib( mWindow, GLFW_ICONIFIED ) || !pending_() )
+		{
+			++mCounters.skipped;
+			return false;
+		}
+
+		return true;
+	}
+
+	bool RedrawScheduler::wait_external_()
+	{
+		bool const minimized = mMinimized.load( std::memory_order_relaxed );
+		if( !mOnDemand && !minimized )
+			return true;
+
+		bool const pending = pending_();
+		if( minimized || !pending )
+		{
+			std::unique_lock<std::mutex> lock( mWakeMutex );
+			mWake.wait_for( lock, std::chrono::duration<double>( cfg::kMaxWaitSeconds ), [this] {
+				return mRequested.load( std::memory_order_relaxed ) != mObserved;
+			} );
+		}
+
+		if( mMinimized.load( std::memory_order_relaxed ) || (mOnDemand && !pending_()) )
+		{
+			++mCounters.skipped;
+			return false;
+		}
+
+		return true;
+	}
+
+	void RedrawScheduler::frame_rendered() noexcept
+	{
+		// Requests that arrived while the frame was being rendered (after
+		// wait_for_frame() returned) still need another frame.
+		mCompleted = mObserved;
+		++mCounters.rendered;
+	}
+
+	void print_redraw_counters( RedrawScheduler const& aScheduler )
+	{
+		if( !aScheduler.on_demand() )
+			return;
+
+		auto const& counters = aScheduler.counters();
+		std::printf( "Frames rendered: %llu, skipped: %llu\n",
+			static_cast<unsigned long long>(counters.rendered),
+			static_cast<unsigned long long>(counters.skipped)
+		);
+	}
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
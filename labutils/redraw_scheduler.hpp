@@ -0,0 +1,125 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+
+#include <cstdint>
+
+#include "vulkan_window.hpp"
+
+namespace labutils
+{
+	// Decides when the main loop renders a frame.
+	//
+	// In continuous mode (the default), every loop iteration renders a frame
+	// and wait_for_frame() only polls events. In on-demand mode (enabled
+	// with LABUTILS_ON_DEMAND=1 or set_on_demand()), wait_for_frame() sleeps
+	// in glfwWaitEventsTimeout(), and only requests a frame if
+	//  - invalidate() was called since the last rendered frame,
+	//  - an animation is running (see animate_until()), or
+	//  - the window's framebuffer was resized.
+	// Input callbacks, animations and asynchronous loads must therefore
+	// call invalidate() when they change what is displayed. invalidate() may
+	// be called from any thread; it wakes up a waiting main thread.
+	//
+	// Typical use:
+	//
+	//   while( !window_should_close( window ) )
+	//   {
+	//       if( !scheduler.wait_for_frame() )
+	//           continue;
+	//       ... render and present ...
+	//       scheduler.frame_rendered();
+	//   }
+	//
+	// A frame that was requested but not rendered (e.g., because the swap
+	// chain had to be recreated first) is requested again by the next
+	// wait_for_frame().
+	//
+	// Headless windows have no events; there, every iteration renders.
+	//
+	// GLFW events can only be processed on the main thread. If the frame
+	// loop runs on a different thread, create the scheduler with
+	// ERedrawEvents::external: wait_for_frame() then never calls GLFW and
+	// instead sleeps until invalidate(). The thread processing events must
+	// forward resizes (as invalidate()) and minimization (set_minimized()).
+	enum class ERedrawEvents
+	{
+		glfw,
+		external
+	};
+
+	class RedrawScheduler
+	{
+		public:
+			using Clock = std::chrono::steady_clock;
+
+			struct Counters
+			{
+				std::uint64_t rendered = 0;
+				std::uint64_t skipped = 0; // wake-ups without a frame
+			};
+
+		public:
+			explicit RedrawScheduler( VulkanWindow const&, ERedrawEvents = ERedrawEvents::glfw );
+
+			RedrawScheduler( RedrawScheduler const& ) = delete;
+			RedrawScheduler& operator= (RedrawScheduler const&) = delete;
+
+		public:
+			void set_on_demand( bool ) noexcept;
+			bool on_demand() const noexcept { return mOnDemand; }
+
+			// Thread-safe
+			void invalidate() noexcept;
+
+			// Thread-safe. Only used with ERedrawEvents::external.
+			void set_minimized( bool ) noexcept;
+
+			// Frame loop thread only. Keeps rendering frames until the given
+			// time.
+			void animate_until( Clock::time_point ) noexcept;
+
+			// Frame loop thread only. Processes window events (waiting for
+			// them in on-demand mode), and returns true if a frame should be
+			// rendered.
+			bool wait_for_frame();
+
+			// Frame loop thread only. Call once the requested frame was
+			// presented.
+			void frame_rendered() noexcept;
+
+			Counters const& counters() const noexcept { return mCounters; }
+
+		private:
+			bool pending_() noexcept;
+			bool wait_glfw_();
+			bool wait_external_();
+
+		private:
+			GLFWwindow* mWindow = nullptr;
+			ERedrawEvents mEvents;
+			bool mOnDemand = false;
+
+			std::mutex mWakeMutex;
+			std::condition_variable mWake;
+			std::atomic<bool> mMinimized{ false };
+
+			std::atomic<std::uint64_t> mRequested{ 1 }; // first frame
+			std::uint64_t mObserved = 0; // value of mRequested seen by wait_for_frame()
+			std::uint64_t mCompleted = 0;
+
+			Clock::time_point mAnimateUntil{};
+
+			int mFramebufferWidth = 0, mFramebufferHeight = 0;
+
+			Counters mCounters;
+	};
+
+	// Prints the counters if the scheduler is in on-demand mode.
+	void print_redraw_counters( RedrawScheduler const& );
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
@@ -0,0 +1,249 @@
+#include "residency_manager.hpp"
+
+#include <limits>
+#include <utility>
+#include <algorithm>
+
+#include <cstdio>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+	namespace cfg
+	{
+		// Limits the budget of each heap (in MiB). Values that aren't a
+		// positive integer are ignored.
+		constexpr char const* kBudgetEnv = "LABUTILS_MEMORY_BUDGET_MB";
+
+		// Frames to wait after demoting or restoring resources before the
+		// budgets are looked at again
+		constexpr std::uint32_t kSettleFrames = 4;
+	}
+}
+
+namespace labutils
+{
+	ResidencyManager::ResidencyManager( Allocator const& aAllocator, float aHighWater, float aLowWater )
+		: mAllocator( &aAllocator )
+		, mHighWater( aHighWater )
+		, mLowWater( aLowWater )
+		, mBudgetLimit( std::numeric_limits<VkDeviceSize>::max() )
+	{
+		assert( aLowWater < aHighWater );
+
+		if( auto const* value = std::getenv( cfg::kBudgetEnv ); value && *value )
+		{
+			char* end = nullptr;
+			auto const megabytes = std::strtoull( value, &end, 10 );
+
+			// A limit of 0 would make enforce() skip every heap. (strtoull()
+			// accepts and negates a leading '-'.)
+			if( '\0' != *end || 0 == megabytes || std::strchr( value, '-' ) )
+				std::fprintf( stderr, "Info: Ignoring %s='%s' (expected a positive number of MiB)\n", cfg::kBudgetEnv, value );
+			else
+				mBudgetLimit = VkDeviceSize(megabytes) * 1024 * 1024;
+		}
+	}
+
+	ResidencyManager::ResourceId ResidencyManager::add( VmaAllocation aAllocation, VkDeviceSize aBytes, DemoteFn aDemote, RestoreFn aRestore )
+	{
+		assert( aDemote && aRestore );
+
+		Resource_ resource{}; {
+			resource.alive = true;
+			resource.heap = heap_of_( aAllocation );
+			resource.bytes = aBytes;
+
+			resource.lastUsed = mFrame;
+			resource.demotions = 0;
+
+			resource.demote = std::move(aDemote);
+			resource.restore = std::move(aRestore);
+		}
+
+		if( !mFreeIds.empty() )
+		{
+			auto const id = mFreeIds.back();
+			mFreeIds.pop_back();
+
+			mResources[id] = std::move(resource);
+			return id;
+		}
+
+		mResources.emplace_back( std::move(resource) );
+		return ResourceId(mResources.size() - 1);
+	}
+
+	void ResidencyManager::remove( ResourceId aId )
+	{
+		assert( aId < mResources.size() && mResources[aId].alive );
+
+		mResources[aId] = Resource_{};
+		mFreeIds.emplace_back( aId );
+	}
+
+	void ResidencyManager::update( ResourceId aId, VmaAllocation aAllocation, VkDeviceSize aBytes )
+	{
+		assert( aId < mResources.size() && mResources[aId].alive );
+
+		auto& resource = mResources[aId];
+		resource.heap = heap_of_( aAllocation );
+		resource.bytes = aBytes;
+	}
+
+	void ResidencyManager::touch( ResourceId aId ) noexcept
+	{
+		assert( aId < mResources.size() && mResources[aId].alive );
+		mResources[aId].lastUsed = mFrame;
+	}
+
+	void ResidencyManager::enforce()
+	{
+		++mFrame;
+
+		// VMA caches the budget, and refreshes it when the frame index
+		// changes
+		vmaSetCurrentFrameIndex( mAllocator->allocator, std::uint32_t(mFrame) );
+
+		VmaBudget budgets[VK_MAX_MEMORY_HEAPS];
+		vmaGetHeapBudgets( mAllocator->allocator, budgets );
+
+		VkPhysicalDeviceMemoryProperties const* memoryProps = nullptr;
+		vmaGetMemoryProperties( mAllocator->allocator, &memoryProps );
+
+		bool const settled = 0 == mWaitFrames;
+		if( !settled )
+			--mWaitFrames;
+
+		bool over = false, changed = false;
+		for( std::uint32_t heap = 0; heap < memoryProps->memoryHeapCount; ++heap )
+		{
+			auto const budget = std::min( budgets[heap].budget, mBudgetLimit );
+			auto const usage = budgets[heap].usage;
+			if( 0 == budget )
+				continue;
+
+			if( usage > mStats.peakUsage )
+			{
+				mStats.peakUsage = usage;
+				mStats.budget = budget;
+			}
+
+			auto const high = VkDeviceSize(double(budget) * mHighWater);
+			auto const low = VkDeviceSize(double(budget) * mLowWater);
+
+			if( usage > high )
+			{
+				over = true;
+				if( settled )
+					changed = demote_( heap, usage, low + (high - low) / 2 ) || changed;
+			}
+			else if( usage < low && settled )
+			{
+				changed = restore_( heap ) || changed;
+			}
+		}
+
+		if( over )
+			++mStats.framesOverBudget;
+
+		if( changed )
+			mWaitFrames = cfg::kSettleFrames;
+	}
+
+	ResidencyManager::Stats ResidencyManager::stats() const
+	{
+		return mStats;
+	}
+
+	std::uint32_t ResidencyManager::heap_of_( VmaAllocation aAllocation ) const
+	{
+		VmaAllocationInfo info{};
+		vmaGetAllocationInfo( mAllocator->allocator, aAllocation, &info );
+
+		VkPhysicalDeviceMemoryProperties const* memoryProps = nullptr;
+		vmaGetMemoryProperties( mAllocator->allocator, &memoryProps );
+
+		return memoryProps->memoryTypes[info.memoryType].heapIndex;
+	}
+
+	bool ResidencyManager::demote_( std::uint32_t aHeap, VkDeviceSize aUsage, VkDeviceSize aTarget )
+	{
+		// Least recently used first. The callbacks may add or remove
+		// resources, so ids are used rather than references.
+		std::vector<ResourceId> candidates;
+		for( ResourceId id = 0; id < mResources.size(); ++id )
+		{
+			auto const& resource = mResources[id];
+			if( resource.alive && aHeap == resource.heap && resource.bytes )
+				candidates.emplace_back( id );
+		}
+
+		std::stable_sort( candidates.begin(), candidates.end(), [this] (ResourceId aX, ResourceId aY) {
+			return mResources[aX].lastUsed < mResources[aY].lastUsed;
+		} );
+
+		VkDeviceSize freed = 0;
+		for( auto const id : candidates )
+		{
+			if( aUsage - freed <= aTarget )
+				break;
+
+			if( !mResources[id].alive )
+				continue;
+
+			auto const demote = mResources[id].demote;
+			if( auto const bytes = demote() )
+			{
+				freed += std::min( bytes, aUsage - freed );
+				++mResources[id].demotions;
+				++mStats.demotions;
+			}
+		}
+
+		return freed > 0;
+	}
+
+	bool ResidencyManager::restore_( std::uint32_t aHeap )
+	{
+		// Most recently used first; one resource at a time, since it is not
+		// known how much memory it will take up again.
+		ResourceId best = ResourceId(mResources.size());
+		for( ResourceId id = 0; id < mResources.size(); ++id )
+		{
+			auto const& resource = mResources[id];
+			if( !resource.alive || aHeap != resource.heap || 0 == resource.demotions )
+				continue;
+
+			if( best == mResources.size() || resource.lastUsed > mResources[best].lastUsed )
+				best = id;
+		}
+
+		if( best == mResources.size() )
+			return false;
+
+		--mResources[best].demotions;
+		++mStats.restorations;
+
+		auto const restore = mResources[best].restore;
+		restore();
+		return true;
+	}
+
+
+	void print_residency_stats( ResidencyManager const& aManager )
+	{
+		auto const stats = aManager.stats();
+		std::printf( "Residency: peak usage %.2f MiB of %.2f MiB budget, %llu frames over budget, %llu demotions, %llu restorations\n",
+			stats.peakUsage / (1024.0 * 1024.0),
+			stats.budget / (1024.0 * 1024.0),
+			static_cast<unsigned long long>(stats.framesOverBudget),
+			static_cast<unsigned long long>(stats.demotions),
+			static_cast<unsigned long long>(stats.restorations)
+		);
+	}
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
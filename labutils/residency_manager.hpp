@@ -0,0 +1,121 @@
+#pragma once
+
+#include <volk/volk.h>
+#include <vk_mem_alloc.h>
+
+#include <vector>
+#include <functional>
+
+#include <cstdint>
+
+#include "allocator.hpp"
+
+namespace labutils
+{
+	// Keeps device memory use within the heap budgets.
+	//
+	// Budgets come from VK_EXT_memory_budget through VMA (without the
+	// extension, VMA estimates them as 80% of the heap size). Setting
+	// LABUTILS_MEMORY_BUDGET_MB to a positive number of MiB further limits
+	// the budget of each heap, which is useful to test behaviour under
+	// memory pressure. Other values are ignored (with a message).
+	//
+	// Streamable resources register the allocation that backs them, their
+	// size and two callbacks. demote() frees some memory (e.g., drops a
+	// texture's finest mip level, or a mesh altogether) and returns the
+	// number of bytes that will be freed, or 0 if the resource can't shrink
+	// further. restore() undoes one demote(), allowing the resource to stream
+	// back in. Resources are marked as used with touch().
+	//
+	// enforce() is called once per frame. If the usage of a heap is above
+	// its high water mark, resources in that heap are demoted, least recently
+	// used first, until the expected usage is halfway between the high and
+	// low water marks. Below the low water mark, the most recently used
+	// demoted resource is restored. Memory is typically only freed a few
+	// frames after demote() (once in-flight frames no longer use it), so
+	// enforce() waits for a few frames after each change.
+	//
+	// Not thread safe. The callbacks are called from enforce().
+	class ResidencyManager
+	{
+		public:
+			using ResourceId = std::uint32_t;
+			using DemoteFn = std::function<VkDeviceSize ()>;
+			using RestoreFn = std::function<void ()>;
+
+			struct Stats
+			{
+				std::uint64_t demotions = 0;
+				std::uint64_t restorations = 0;
+				std::uint64_t framesOverBudget = 0; // frames with a heap above its high water mark
+
+				VkDeviceSize peakUsage = 0; // of the most used heap, in bytes
+				VkDeviceSize budget = 0; // of that heap, in bytes
+			};
+
+		public:
+			// Water marks are fractions of the heap budget
+			explicit ResidencyManager(
+				Allocator const&,
+				float aHighWater = kDefaultHighWater,
+				float aLowWater = kDefaultLowWater
+			);
+
+			ResidencyManager( ResidencyManager const& ) = delete;
+			ResidencyManager& operator= (ResidencyManager const&) = delete;
+
+		public:
+			ResourceId add( VmaAllocation, VkDeviceSize aBytes, DemoteFn, RestoreFn );
+			void remove( ResourceId );
+
+			// The resource's memory was replaced, e.g., after a demotion
+			void update( ResourceId, VmaAllocation, VkDeviceSize aBytes );
+
+			void touch( ResourceId ) noexcept;
+
+			void enforce();
+
+			Stats stats() const;
+
+		public:
+			static constexpr float kDefaultHighWater = 0.9f;
+			static constexpr float kDefaultLowWater = 0.75f;
+
+		private:
+			struct Resource_
+			{
+				bool alive;
+				std::uint32_t heap;
+				VkDeviceSize bytes;
+
+				std::uint64_t lastUsed;
+				std::uint32_t demotions; // not yet restored
+
+				DemoteFn demote;
+				RestoreFn restore;
+			};
+
+			std::uint32_t heap_of_( VmaAllocation ) const;
+
+			bool demote_( std::uint32_t aHeap, VkDeviceSize aUsage, VkDeviceSize aTarget );
+			bool restore_( std::uint32_t aHeap );
+
+		private:
+			Allocator const* mAllocator;
+
+			float mHighWater, mLowWater;
+			VkDeviceSize mBudgetLimit; // from LABUTILS_MEMORY_BUDGET_MB
+
+			std::uint64_t mFrame = 0;
+			std::uint32_t mWaitFrames = 0;
+
+			std::vector<Resource_> mResources;
+			std::vector<ResourceId> mFreeIds;
+
+			Stats mStats;
+	};
+
+	void print_residency_stats( ResidencyManager const& );
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
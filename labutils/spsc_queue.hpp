@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+namespace labutils
+{
+	/* Lock-free bounded single-producer single-consumer queue.
+	 *
+	 * A ring buffer of tCapacity slots (a power of two). The producer only
+	 * writes the tail index and the consumer only writes the head index, so
+	 * each side needs just an acquire load of the other's index. Both
+	 * try_push() and try_pop() fail instead of waiting if the queue is full
+	 * or empty.
+	 */
+	template< typename tType, std::size_t tCapacity >
+	class SpscQueue
+	{
+		static_assert( tCapacity > 0 && 0 == (tCapacity & (tCapacity-1)), "Capacity must be a power of two" );
+
+		public:
+			SpscQueue() = default;
+
+			SpscQueue( SpscQueue const& ) = delete;
+			SpscQueue& operator= (SpscQueue const&) = delete;
+
+		public:
+			// Producer only
+			bool try_push( tType const& aValue ) noexcept
+			{
+				auto const tail = mTail.load( std::memory_order_relaxed );
+				if( tail - mHead.load( std::memory_order_acquire ) == tCapacity )
+					return false;
+
+				mSlots[tail & (tCapacity-1)] = aValue;
+				mTail.store( tail + 1, std::memory_order_release );
+				return true;
+			}
+
+			// Consumer only
+			bool try_pop( tType& aValue ) noexcept
+			{
+				auto const head = mHead.load( std::memory_order_relaxed );
+				if( head == mTail.load( std::memory_order_acquire ) )
+					return false;
+
+				aValue = mSlots[head & (tCapacity-1)];
+				mHead.store( head + 1, std::memory_order_release );
+				return true;
+			}
+
+		private:
+			tType mSlots[tCapacity]{};
+
+			// Indices increase monotonically and wrap around; the difference
+			// is the number of queued elements.
+			alignas(64) std::atomic<std::size_t> mHead{ 0 };
+			alignas(64) std::atomic<std::size_t> mTail{ 0 };
+	};
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
@@ -0,0 +1,844 @@
+#include "texture_streamer.hpp"
+
+#include <limits>
+#include <utility>
+#include <algorithm>
+
+#include <cstdio>
+#include <cassert>
+#include <cstring>
+
+#include <stb_image.h>
+
+#include "error.hpp"
+#include "mipmap.hpp"
+#include "vkutil.hpp"
+#include "to_string.hpp"
+
+namespace
+{
+	namespace cfg
+	{
+		// Contents of the smallest mip level until real data is resident
+		// (linear RGBA)
+		constexpr VkClearColorValue kPlaceholderColour{ { 0.18f, 0.18f, 0.18f, 0.f } };
+
+		// Alignment of uploads within the staging buffer
+		// (optimalBufferCopyOffsetAlignment is at most this on common
+		// hardware)
+		constexpr VkDeviceSize kUploadAlignment = 16;
+
+		// Rows per mip generation job
+		constexpr std::size_t kMipRowsPerJob = 64;
+
+		// The finest level of a texture is evicted once it has not been
+		// requested for this many frames. Levels are evicted one at a time,
+		// so that a texture that moves away slowly doesn't go back and
+		// forth.
+		constexpr std::uint64_t kEvictDelayFrames = 120;
+
+		// Recreated images per record_uploads(); each copies its resident
+		// levels.
+		constexpr std::uint32_t kMaxReallocationsPerFrame = 4;
+	}
+
+	constexpr std::uint32_t kTexelBytes_ = 4;
+
+	// Written to the feedback buffer before each frame
+	constexpr std::uint32_t kNotRequested_ = std::numeric_limits<std::uint32_t>::max();
+
+	std::uint32_t level_size_( std::uint32_t aBase, std::uint32_t aLevel ) noexcept
+	{
+		return std::max( 1u, aBase >> aLevel );
+	}
+
+	// Bytes of levels [aFirstLevel, aLevels)
+	VkDeviceSize chain_bytes_( std::uint32_t aWidth, std::uint32_t aHeight, std::uint32_t aFirstLevel, std::uint32_t aLevels ) noexcept
+	{
+		VkDeviceSize ret = 0;
+		for( std::uint32_t level = aFirstLevel; level < aLevels; ++level )
+			ret += VkDeviceSize(level_size_( aWidth, level )) * level_size_( aHeight, level ) * kTexelBytes_;
+		return ret;
+	}
+
+	bool is_srgb_( VkFormat aFormat ) noexcept
+	{
+		return VK_FORMAT_R8G8B8A8_SRGB == aFormat;
+	}
+
+	labutils::DescriptorSetLayout create_texture_layout_( labutils::VulkanContext const& );
+}
+
+namespace labutils
+{
+	struct TextureStreamer::Texture_
+	{
+		std::string path;
+		VkFormat format;
+
+		// Of the full mip chain. Levels below are levels of the full chain
+		// unless noted otherwise.
+		std::uint32_t width, height;
+		std::uint32_t mipLevels;
+		std::uint32_t tailLevel; // levels [tailLevel, mipLevels) are never evicted
+
+		// Holds levels [baseLevel, mipLevels). `generation` changes
+		// whenever the image is replaced.
+		Image image;
+		ImageView view;
+		std::uint32_t baseLevel;
+		std::uint32_t generation = 0;
+
+		// Per frame slot, and the generation each set refers to
+		std::vector<VkDescriptorSet> descriptors;
+		std::vector<std::uint32_t> descriptorGenerations;
+
+		// Written by the decode job; read once `decoded` is done.
+		JobCounter decoded;
+		std::vector<std::uint8_t> texels; // all levels, largest first
+		std::vector<std::size_t> levelOffsets;
+
+		// Levels [residentLevel, mipLevels) hold image data. Rows
+		// [0, nextRow) of level residentLevel-1 have been uploaded.
+		std::uint32_t residentLevel;
+		std::uint32_t nextRow = 0;
+
+		// Finest level requested by the feedback, and the frame in which
+		// it was last requested
+		std::uint32_t requestedLevel;
+		std::uint64_t requestedFrame;
+
+		// Finest level allowed by the ResidencyManager, and the caps before
+		// each demotion that has not been restored
+		std::uint32_t capLevel = 0;
+		std::vector<std::uint32_t> previousCaps;
+		ResidencyManager::ResourceId residencyId = 0;
+
+		// Level that the image should start at
+		std::uint32_t target_level() const noexcept
+		{
+			return std::max( requestedLevel, capLevel );
+		}
+	};
+
+	struct TextureStreamer::Retired_
+	{
+		Image image;
+		ImageView view;
+		std::uint32_t pendingSlots; // bit per frame slot that may still use the image
+	};
+
+
+	TextureStreamer::TextureStreamer( VulkanContext const& aContext, Allocator const& aAllocator, JobSystem& aJobs, VkSampler aSampler, std::uint32_t aFrameSlots, bool aFeedback, ResidencyManager* aResidency, VkDeviceSize aFrameBudget, std::uint32_t aMaxTextures )
+		: mContext( &aContext )
+		, mAllocator( &aAllocator )
+		, mJobs( &aJobs )
+		, mResidency( aResidency )
+		, mSampler( aSampler )
+		, mSlotCount( aFrameSlots )
+		, mMaxTextures( aMaxTextures )
+		, mFrameBudget( aFrameBudget )
+		, mLayout( create_texture_layout_( aContext ) )
+		, mPool( create_descriptor_pool( aContext, aFrameSlots * aMaxTextures, aFrameSlots * aMaxTextures ) )
+		, mFeedback( aFeedback )
+		, mSlotRecorded( aFrameSlots, false )
+	{
+		assert( aFrameSlots > 0 && aFrameSlots <= 32 ); // see Retired_::pendingSlots
+
+		for( std::uint32_t i = 0; i < aFrameSlots; ++i )
+		{
+			mStaging.emplace_back( create_buffer(
+				aAllocator,
+				aFrameBudget,
+				VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+				VMA_MEMORY_USAGE_CPU_TO_GPU
+			) );
+		}
+
+		// Bound even without feedback; shaders then don't access it.
+		mFeedbackBuffer = create_buffer(
+			aAllocator,
+			VkDeviceSize(aFrameSlots) * aMaxTextures * sizeof(std::uint32_t),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VMA_MEMORY_USAGE_GPU_TO_CPU
+		);
+	}
+
+	TextureStreamer::~TextureStreamer()
+	{
+		// Decode jobs write into the textures
+		for( auto& texture : mTextures )
+		{
+			try
+			{
+				mJobs->wait( texture->decoded );
+			}
+			catch( ... )
+			{}
+
+			if( mResidency )
+				mResidency->remove( texture->residencyId );
+		}
+	}
+
+	TextureStreamer::TextureId TextureStreamer::request( char const* aPath, VkFormat aFormat )
+	{
+		assert( aPath );
+
+		if( VK_FORMAT_R8G8B8A8_SRGB != aFormat && VK_FORMAT_R8G8B8A8_UNORM != aFormat )
+			throw Error( "%s: TextureStreamer only supports RGBA8 formats (requested format %d)", aPath, int(aFormat) );
+
+		if( mTextures.size() >= mMaxTextures )
+			throw Error( "%s: TextureStreamer is limited to %u textures", aPath, mMaxTextures );
+
+		int width, height, channels;
+		if( !stbi_info( aPath, &width, &height, &channels ) )
+			throw Error( "%s: Unable to Read Image Header (%s)", aPath, stbi_failure_reason() );
+
+		auto texture = std::make_unique<Texture_>(); {
+			texture->path = aPath;
+			texture->format = aFormat;
+
+			texture->width = std::uint32_t(width);
+			texture->height = std::uint32_t(height);
+			texture->mipLevels = compute_mip_level_count( texture->width, texture->height );
+
+			texture->tailLevel = 0;
+			while( texture->tailLevel+1 < texture->mipLevels
+				&& std::max( level_size_( texture->width, texture->tailLevel ), level_size_( texture->height, texture->tailLevel ) ) > kTailSize )
+			{
+				++texture->tailLevel;
+			}
+
+			// With feedback, start out with the tail; the first feedback
+			// requests the levels that are actually needed.
+			texture->requestedLevel = mFeedback ? texture->tailLevel : 0;
+			texture->requestedFrame = mFrame;
+
+			texture->baseLevel = texture->requestedLevel;
+			texture->image = create_image_texture2d(
+				*mAllocator,
+				level_size_( texture->width, texture->baseLevel ), level_size_( texture->height, texture->baseLevel ),
+				aFormat,
+				VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT
+			);
+			texture->view = create_image_view_texture2d( *mContext, texture->image.image, aFormat );
+
+			texture->residentLevel = texture->mipLevels;
+
+			for( std::uint32_t i = 0; i < mSlotCount; ++i )
+				texture->descriptors.emplace_back( alloc_desc_set( *mContext, mPool.handle, mLayout.handle ) );
+
+			// Not written yet
+			texture->descriptorGenerations.assign( mSlotCount, texture->generation - 1 );
+		}
+
+		mStats.allocatedBytes += chain_bytes_( texture->width, texture->height, texture->baseLevel, texture->mipLevels );
+		mStats.peakAllocatedBytes = std::max( mStats.peakAllocatedBytes, mStats.allocatedBytes );
+		mStats.fullChainBytes += chain_bytes_( texture->width, texture->height, 0, texture->mipLevels );
+
+		// Decode and generate the mip chain in the background. Each level is
+		// generated from the previous one, with the rows of large levels
+		// split over several jobs.
+		mJobs->run( texture->decoded, [tex = texture.get(), jobs = mJobs] {
+			auto const data = decode_image_rgba8( tex->path.c_str() );
+			assert( data.width == tex->width && data.height == tex->height );
+
+			std::size_t total = 0;
+			tex->levelOffsets.resize( tex->mipLevels );
+			for( std::uint32_t level = 0; level < tex->mipLevels; ++level )
+			{
+				tex->levelOffsets[level] = total;
+				total += std::size_t(level_size_( tex->width, level )) * level_size_( tex->height, level ) * kTexelBytes_;
+			}
+
+			std::vector<std::uint8_t> texels( total );
+			std::memcpy( texels.data(), data.texels.get(), std::size_t(tex->width) * tex->height * kTexelBytes_ );
+
+			bool const srgb = is_srgb_( tex->format );
+			for( std::uint32_t level = 1; level < tex->mipLevels; ++level )
+			{
+				auto const* src = texels.data() + tex->levelOffsets[level-1];
+				auto* dst = texels.data() + tex->levelOffsets[level];
+
+				auto const srcWidth = level_size_( tex->width, level-1 );
+				auto const srcHeight = level_size_( tex->height, level-1 );
+				auto const dstWidth = level_size_( tex->width, level );
+				auto const dstHeight = level_size_( tex->height, level );
+
+				parallel_for( *jobs, dstHeight, [&] (std::size_t aFirst, std::size_t aLast) {
+					downsample_rgba8_rows( src, srcWidth, srcHeight, dst, dstWidth, aFirst, aLast, srgb );
+				}, cfg::kMipRowsPerJob );
+			}
+
+			tex->texels = std::move(texels);
+		} );
+
+		auto const id = TextureId(mTextures.size());
+
+		if( mResidency )
+		{
+			texture->residencyId = mResidency->add(
+				texture->image.allocation,
+				chain_bytes_( texture->width, texture->height, texture->baseLevel, texture->mipLevels ),
+				[this, id] { return demote_( id ); },
+				[this, id] { restore_( id ); }
+			);
+		}
+
+		mTextures.emplace_back( std::move(texture) );
+		mUninitialized.emplace_back( id );
+		return id;
+	}
+
+	VkDescriptorSet TextureStreamer::descriptor_set( TextureId aId, std::uint32_t aSlot )
+	{
+		assert( aId < mTextures.size() );
+		assert( aSlot < mSlotCount );
+
+		auto const& texture = *mTextures[aId];
+		if( mResidency )
+			mResidency->touch( texture.residencyId );
+
+		return texture.descriptors[aSlot];
+	}
+
+	std::uint32_t TextureStreamer::mip_levels( TextureId aId ) const
+	{
+		assert( aId < mTextures.size() );
+		return mTextures[aId]->mipLevels;
+	}
+
+	std::uint32_t TextureStreamer::base_level( TextureId aId ) const
+	{
+		assert( aId < mTextures.size() );
+		return mTextures[aId]->baseLevel;
+	}
+
+	float TextureStreamer::min_lod( TextureId aId ) const
+	{
+		assert( aId < mTextures.size() );
+		auto const& texture = *mTextures[aId];
+		return float(std::min( texture.residentLevel, texture.mipLevels-1 ) - texture.baseLevel);
+	}
+
+	void TextureStreamer::record_uploads( VkCommandBuffer aCmdBuff, std::uint32_t aSlot )
+	{
+		assert( aSlot < mSlotCount );
+		++mFrame;
+
+		// The slot's previous command buffer has completed
+		for( auto& retired : mRetired )
+			retired.pendingSlots &= ~(1u << aSlot);
+
+		mRetired.erase( std::remove_if( mRetired.begin(), mRetired.end(), [] (Retired_ const& aRetired) {
+			return 0 == aRetired.pendingSlots;
+		} ), mRetired.end() );
+
+		if( mFeedback && mSlotRecorded[aSlot] )
+			read_feedback_( aSlot );
+
+		for( auto const id : mUninitialized )
+			initialize_( aCmdBuff, *mTextures[id] );
+		mUninitialized.clear();
+
+		// Recreate images whose requested levels changed
+		std::uint32_t reallocations = 0;
+		for( auto& texture : mTextures )
+		{
+			if( texture->target_level() == texture->baseLevel )
+				continue;
+
+			if( reallocations++ == cfg::kMaxReallocationsPerFrame )
+				break;
+
+			reallocate_( aCmdBuff, *texture, texture->target_level() );
+		}
+
+		if( mFeedback )
+		{
+			auto const bytes = VkDeviceSize(mMaxTextures) * sizeof(std::uint32_t);
+
+			vkCmdFillBuffer( aCmdBuff, mFeedbackBuffer.buffer, aSlot * bytes, bytes, kNotRequested_ );
+			buffer_barrier( aCmdBuff, mFeedbackBuffer.buffer,
+				VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+				VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+				bytes, aSlot * bytes
+			);
+
+			mSlotRecorded[aSlot] = true;
+		}
+
+		// Rethrow decode errors before anything is mapped
+		for( auto& texture : mTextures )
+		{
+			if( texture->residentLevel > texture->baseLevel && texture->decoded.done() && texture->texels.empty() )
+				mJobs->wait( texture->decoded );
+		}
+
+		// Upload in rounds of at most one level per texture, so that the
+		// small levels of all textures go first.
+		auto const& staging = mStaging[aSlot];
+		std::byte* mapped = nullptr;
+
+		VkDeviceSize used = 0;
+		for( bool progress = true; progress; )
+		{
+			progress = false;
+			for( auto& texture : mTextures )
+			{
+				if( texture->residentLevel <= texture->baseLevel || !texture->decoded.done() || texture->texels.empty() )
+					continue;
+
+				used = (used + cfg::kUploadAlignment - 1) & ~(cfg::kUploadAlignment - 1);
+				if( used >= mFrameBudget )
+					break;
+
+				if( !mapped )
+				{
+					void* ptr = nullptr;
+					if( auto const res = vmaMapMemory( mAllocator->allocator, staging.allocation, &ptr ); VK_SUCCESS != res )
+					{
+						throw Error( "Mapping Memory for Writing\n"
+							"vmaMapMemory() Returned %s", to_string(res).c_str() );
+					}
+
+					mapped = static_cast<std::byte*>(ptr);
+				}
+
+				auto const bytes = upload_level_( aCmdBuff, *texture, mapped, staging.buffer, used, mFrameBudget - used );
+				if( bytes )
+				{
+					used += bytes;
+					mStats.bytesUploaded += bytes;
+					progress = true;
+				}
+			}
+		}
+
+		if( mapped )
+			vmaUnmapMemory( mAllocator->allocator, staging.allocation );
+
+		if( mapped )
+			++mStats.framesUploading;
+
+		// Levels are only evicted by feedback or by the residency manager
+		// (whose demotions are undone by restore_()). Without either, the
+		// CPU copies of fully resident textures are no longer needed.
+		if( !mFeedback && !mResidency )
+		{
+			for( auto& texture : mTextures )
+			{
+				if( 0 == texture->residentLevel )
+					std::vector<std::uint8_t>().swap( texture->texels );
+			}
+		}
+
+		update_descriptors_( aSlot );
+
+		mPending = 0;
+		for( auto const& texture : mTextures )
+		{
+			if( texture->residentLevel > texture->baseLevel || texture->target_level() != texture->baseLevel )
+				++mPending;
+		}
+	}
+
+	void TextureStreamer::record_feedback_readback( VkCommandBuffer aCmdBuff, std::uint32_t aSlot ) const
+	{
+		assert( aSlot < mSlotCount );
+
+		if( !mFeedback )
+			return;
+
+		auto const bytes = VkDeviceSize(mMaxTextures) * sizeof(std::uint32_t);
+		buffer_barrier( aCmdBuff, mFeedbackBuffer.buffer,
+			VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_HOST_READ_BIT,
+			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+			bytes, aSlot * bytes
+		);
+	}
+
+	bool TextureStreamer::streaming() const noexcept
+	{
+		return !mUninitialized.empty() || mPending > 0 || (mFeedback && mStableReads < mSlotCount);
+	}
+
+	TextureStreamer::Stats TextureStreamer::stats() const
+	{
+		auto ret = mStats;
+		ret.texturesStreaming = mPending;
+		return ret;
+	}
+
+	void TextureStreamer::read_feedback_( std::uint32_t aSlot )
+	{
+		auto const bytes = VkDeviceSize(mMaxTextures) * sizeof(std::uint32_t);
+
+		void* ptr = nullptr;
+		if( auto const res = vmaMapMemory( mAllocator->allocator, mFeedbackBuffer.allocation, &ptr ); VK_SUCCESS != res )
+		{
+			throw Error( "Mapping Memory for Reading\n"
+				"vmaMapMemory() Returned %s", to_string(res).c_str() );
+		}
+
+		// Read-back memory is not necessarily host coherent
+		if( auto const res = vmaInvalidateAllocation( mAllocator->allocator, mFeedbackBuffer.allocation, aSlot * bytes, bytes ); VK_SUCCESS != res )
+		{
+			vmaUnmapMemory( mAllocator->allocator, mFeedbackBuffer.allocation );
+			throw Error( "Invalidating Mapped Memory\n"
+				"vmaInvalidateAllocation() Returned %s", to_string(res).c_str() );
+		}
+
+		auto const* requested = reinterpret_cast<std::uint32_t const*>( static_cast<std::byte const*>(ptr) + aSlot * bytes );
+
+		bool changed = false;
+		for( std::size_t i = 0; i < mTextures.size(); ++i )
+		{
+			auto& texture = *mTextures[i];
+
+			// Textures that were not drawn (kNotRequested_) only keep their
+			// tail.
+			auto const level = std::min( requested[i], texture.tailLevel );
+			if( level <= texture.requestedLevel )
+			{
+				changed = changed || level != texture.requestedLevel;
+				texture.requestedLevel = level;
+				texture.requestedFrame = mFrame;
+			}
+			else if( mFrame - texture.requestedFrame >= cfg::kEvictDelayFrames )
+			{
+				++texture.requestedLevel;
+				texture.requestedFrame = mFrame;
+				changed = true;
+			}
+		}
+
+		vmaUnmapMemory( mAllocator->allocator, mFeedbackBuffer.allocation );
+
+		mStableReads = changed ? 0 : mStableReads + 1;
+	}
+
+	void TextureStreamer::initialize_( VkCommandBuffer aCmdBuff, Texture_& aTexture )
+	{
+		VkImageSubresourceRange const allLevels{
+			VK_IMAGE_ASPECT_COLOR_BIT,
+			0, aTexture.mipLevels - aTexture.baseLevel,
+			0, 1
+		};
+		VkImageSubresourceRange const smallestLevel{
+			VK_IMAGE_ASPECT_COLOR_BIT,
+			aTexture.mipLevels-1 - aTexture.baseLevel, 1,
+			0, 1
+		};
+
+		image_barrier( aCmdBuff, aTexture.image.image,
+			0, VK_ACCESS_TRANSFER_WRITE_BIT,
+			VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+			allLevels
+		);
+
+		vkCmdClearColorImage( aCmdBuff, aTexture.image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &cfg::kPlaceholderColour, 1, &smallestLevel );
+
+		// The other levels have undefined contents, but they are not sampled
+		// until they have been uploaded.
+		image_barrier( aCmdBuff, aTexture.image.image,
+			VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+			allLevels
+		);
+	}
+
+	void TextureStreamer::reallocate_( VkCommandBuffer aCmdBuff, Texture_& aTexture, std::uint32_t aBaseLevel )
+	{
+		assert( aBaseLevel <= aTexture.tailLevel );
+
+		auto image = create_image_texture2d(
+			*mAllocator,
+			level_size_( aTexture.width, aBaseLevel ), level_size_( aTexture.height, aBaseLevel ),
+			aTexture.format,
+			VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT
+		);
+		auto view = create_image_view_texture2d( *mContext, image.image, aTexture.format );
+
+		// Copy the levels that hold data (at least the placeholder) and
+		// exist in both images
+		auto const first = std::max( std::min( aTexture.residentLevel, aTexture.mipLevels-1 ), aBaseLevel );
+
+		VkImageSubresourceRange const srcLevels{
+			VK_IMAGE_ASPECT_COLOR_BIT,
+			first - aTexture.baseLevel, aTexture.mipLevels - first,
+			0, 1
+		};
+		VkImageSubresourceRange const dstLevels{
+			VK_IMAGE_ASPECT_COLOR_BIT,
+			0, aTexture.mipLevels - aBaseLevel,
+			0, 1
+		};
+
+		// Earlier frames must be done sampling the old image before its
+		// layout changes. It is not sampled again.
+		image_barrier( aCmdBuff, aTexture.image.image,
+			0, VK_ACCESS_TRANSFER_READ_BIT,
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+			srcLevels
+		);
+		image_barrier( aCmdBuff, image.image,
+			0, VK_ACCESS_TRANSFER_WRITE_BIT,
+			VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+			dstLevels
+		);
+
+		std::vector<VkImageCopy> copies;
+		for( std::uint32_t level = first; level < aTexture.mipLevels; ++level )
+		{
+			VkImageCopy copy{}; {
+				copy.srcSubresource = VkImageSubresourceLayers{
+					VK_IMAGE_ASPECT_COLOR_BIT,
+					level - aTexture.baseLevel,
+					0, 1
+				};
+				copy.dstSubresource = VkImageSubresourceLayers{
+					VK_IMAGE_ASPECT_COLOR_BIT,
+					level - aBaseLevel,
+					0, 1
+				};
+
+				copy.extent = VkExtent3D{ level_size_( aTexture.width, level ), level_size_( aTexture.height, level ), 1 };
+			}
+
+			copies.emplace_back( copy );
+		}
+
+		vkCmdCopyImage( aCmdBuff,
+			aTexture.image.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			std::uint32_t(copies.size()), copies.data()
+		);
+
+		// As in initialize_(), the levels that were not copied are not
+		// sampled until they have been uploaded.
+		image_barrier( aCmdBuff, image.image,
+			VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+			dstLevels
+		);
+
+		// Frames of every slot, including the one being recorded, may still
+		// use the old image.
+		mRetired.emplace_back( Retired_{ std::move(aTexture.image), std::move(aTexture.view), 0xffffffffu >> (32 - mSlotCount) } );
+
+		mStats.allocatedBytes -= chain_bytes_( aTexture.width, aTexture.height, aTexture.baseLevel, aTexture.mipLevels );
+		mStats.allocatedBytes += chain_bytes_( aTexture.width, aTexture.height, aBaseLevel, aTexture.mipLevels );
+		mStats.peakAllocatedBytes = std::max( mStats.peakAllocatedBytes, mStats.allocatedBytes );
+		++mStats.reallocations;
+
+		aTexture.image = std::move(image);
+		aTexture.view = std::move(view);
+		aTexture.baseLevel = aBaseLevel;
+		++aTexture.generation;
+
+		if( mResidency )
+			mResidency->update( aTexture.residencyId, aTexture.image.allocation, chain_bytes_( aTexture.width, aTexture.height, aBaseLevel, aTexture.mipLevels ) );
+
+		// Partially uploaded levels were not copied
+		aTexture.residentLevel = std::max( aTexture.residentLevel, aBaseLevel );
+		aTexture.nextRow = 0;
+	}
+
+	VkDeviceSize TextureStreamer::upload_level_( VkCommandBuffer aCmdBuff, Texture_& aTexture, std::byte* aStaging, VkBuffer aStagingBuffer, VkDeviceSize aOffset, VkDeviceSize aAvailable )
+	{
+		assert( aTexture.residentLevel > aTexture.baseLevel );
+
+		auto const level = aTexture.residentLevel - 1;
+		auto const width = level_size_( aTexture.width, level );
+		auto const height = level_size_( aTexture.height, level );
+
+		auto const rowBytes = VkDeviceSize(width) * kTexelBytes_;
+		auto const rows = std::uint32_t(std::min<VkDeviceSize>( height - aTexture.nextRow, aAvailable / rowBytes ));
+		if( 0 == rows )
+			return 0;
+
+		auto const bytes = rows * rowBytes;
+		std::memcpy( aStaging + aOffset, aTexture.texels.data() + aTexture.levelOffsets[level] + aTexture.nextRow * rowBytes, std::size_t(bytes) );
+
+		VkImageSubresourceRange const range{
+			VK_IMAGE_ASPECT_COLOR_BIT,
+			level - aTexture.baseLevel, 1,
+			0, 1
+		};
+
+		// Frames recorded earlier don't sample this level, but their
+		// fragment shaders must be done with the image before its layout
+		// changes.
+		image_barrier( aCmdBuff, aTexture.image.image,
+			0, VK_ACCESS_TRANSFER_WRITE_BIT,
+			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+			range
+		);
+
+		VkBufferImageCopy copy{}; {
+			copy.bufferOffset = aOffset;
+
+			copy.imageSubresource = VkImageSubresourceLayers{
+				VK_IMAGE_ASPECT_COLOR_BIT,
+				level - aTexture.baseLevel,
+				0, 1
+			};
+
+			copy.imageOffset = VkOffset3D{ 0, std::int32_t(aTexture.nextRow), 0 };
+			copy.imageExtent = VkExtent3D{ width, rows, 1 };
+		}
+
+		vkCmdCopyBufferToImage( aCmdBuff, aStagingBuffer, aTexture.image.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy );
+
+		image_barrier( aCmdBuff, aTexture.image.image,
+			VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+			range
+		);
+
+		aTexture.nextRow += rows;
+		if( height == aTexture.nextRow )
+		{
+			--aTexture.residentLevel;
+			aTexture.nextRow = 0;
+		}
+
+		return bytes;
+	}
+
+	void TextureStreamer::update_descriptors_( std::uint32_t aSlot )
+	{
+		auto const bytes = VkDeviceSize(mMaxTextures) * sizeof(std::uint32_t);
+
+		// Reserved up front: the writes point into these
+		std::vector<VkDescriptorImageInfo> imageInfos;
+		imageInfos.reserve( mTextures.size() );
+
+		VkDescriptorBufferInfo const feedbackInfo{ mFeedbackBuffer.buffer, aSlot * bytes, bytes };
+
+		std::vector<VkWriteDescriptorSet> writes;
+		for( auto& texture : mTextures )
+		{
+			if( texture->descriptorGenerations[aSlot] == texture->generation )
+				continue;
+
+			imageInfos.emplace_back( VkDescriptorImageInfo{
+				mSampler,
+				texture->view.handle,
+				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+			} );
+
+			VkWriteDescriptorSet write{}; {
+				write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+				write.dstSet = texture->descriptors[aSlot];
+				write.dstBinding = 0;
+				write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+				write.descriptorCount = 1;
+				write.pImageInfo = &imageInfos.back();
+			}
+			writes.emplace_back( write );
+
+			write.dstBinding = 1;
+			write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			write.pImageInfo = nullptr;
+			write.pBufferInfo = &feedbackInfo;
+			writes.emplace_back( write );
+
+			texture->descriptorGenerations[aSlot] = texture->generation;
+		}
+
+		if( !writes.empty() )
+			vkUpdateDescriptorSets( mContext->device, std::uint32_t(writes.size()), writes.data(), 0, nullptr );
+	}
+
+	VkDeviceSize TextureStreamer::demote_( TextureId aId )
+	{
+		auto& texture = *mTextures[aId];
+
+		// One level coarser than the image holds now, or will hold once a
+		// pending reallocation has happened
+		auto const current = std::max( texture.baseLevel, texture.target_level() );
+		if( current >= texture.tailLevel )
+			return 0;
+
+		texture.previousCaps.emplace_back( texture.capLevel );
+		texture.capLevel = current + 1;
+
+		// Freed once the image has been recreated
+		return chain_bytes_( texture.width, texture.height, texture.baseLevel, texture.mipLevels )
+			- chain_bytes_( texture.width, texture.height, std::max( texture.baseLevel, texture.capLevel ), texture.mipLevels );
+	}
+
+	void TextureStreamer::restore_( TextureId aId )
+	{
+		auto& texture = *mTextures[aId];
+
+		// The feedback then decides which levels are needed
+		if( !texture.previousCaps.empty() )
+		{
+			texture.capLevel = texture.previousCaps.back();
+			texture.previousCaps.pop_back();
+		}
+	}
+
+
+	void print_texture_stream_stats( TextureStreamer const& aStreamer )
+	{
+		auto const stats = aStreamer.stats();
+		std::printf( "Texture streaming: %.2f MiB uploaded over %llu frames, %u textures still streaming\n",
+			stats.bytesUploaded / (1024.0 * 1024.0),
+			static_cast<unsigned long long>(stats.framesUploading),
+			stats.texturesStreaming
+		);
+		std::printf( "Texture residency: %.2f MiB allocated (peak %.2f MiB) of %.2f MiB for full mip chains, %llu reallocations\n",
+			stats.allocatedBytes / (1024.0 * 1024.0),
+			stats.peakAllocatedBytes / (1024.0 * 1024.0),
+			stats.fullChainBytes / (1024.0 * 1024.0),
+			static_cast<unsigned long long>(stats.reallocations)
+		);
+	}
+}
+
+namespace
+{
+	labutils::DescriptorSetLayout create_texture_layout_( labutils::VulkanContext const& aContext )
+	{
+		VkDescriptorSetLayoutBinding bindings[2]{}; {
+			bindings[0].binding = 0;
+			bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+			bindings[0].descriptorCount = 1;
+			bindings[0].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+			bindings[1].binding = 1;
+			bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			bindings[1].descriptorCount = 1;
+			bindings[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+		}
+
+		VkDescriptorSetLayoutCreateInfo layoutInfo{}; {
+			layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+			layoutInfo.bindingCount = sizeof(bindings) / sizeof(bindings[0]);
+			layoutInfo.pBindings = bindings;
+		}
+
+		VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+		if( auto const res = vkCreateDescriptorSetLayout( aContext.device, &layoutInfo, nullptr, &layout ); VK_SUCCESS != res )
+		{
+			throw labutils::Error( "Unable to Create Descriptor Set Layout\n"
+				"vkCreateDescriptorSetLayout() Returned %s", labutils::to_string(res).c_str() );
+		}
+
+		return labutils::DescriptorSetLayout( aContext.device, layout );
+	}
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
@@ -0,0 +1,209 @@
+#pragma once
+
+#include <volk/volk.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "vkimage.hpp"
+#include "vkbuffer.hpp"
+#include "vkobject.hpp"
+#include "allocator.hpp"
+#include "job_system.hpp"
+#include "vulkan_context.hpp"
+#include "residency_manager.hpp"
+
+namespace labutils
+{
+	// Progressively streamed 2D textures with feedback-driven residency.
+	//
+	// request() only reads the image file's header, and decodes the file
+	// (and generates the mip chain) as a background job. record_uploads()
+	// then uploads the mip levels, smallest first, within a per-frame byte
+	// budget; large levels are uploaded a few rows at a time. Time to the
+	// first frame is therefore independent of the size of the textures.
+	//
+	// Residency: with feedback enabled, fragment shaders report the finest
+	// mip level they would sample from each texture (atomicMin() into the
+	// feedback buffer, binding 1 of descriptor_layout(); a value per texture
+	// and frame slot, see shaderTexFeedback.frag). record_uploads() reads
+	// the feedback of the previous frame that used the same slot. Images
+	// only hold the levels from the finest requested level down. If a finer
+	// level is requested, or if the finest levels have not been requested
+	// for a while, the image is recreated with the new number of levels and
+	// the resident levels are copied over on the GPU. Image memory therefore
+	// tracks what is visible. The smallest levels (up to kTailSize texels)
+	// are always kept. The CPU copy of the full mip chain is kept, so
+	// evicted levels are uploaded again without decoding the file.
+	// Without feedback, images hold their full mip chain (unless demoted,
+	// see below).
+	//
+	// With a ResidencyManager, each texture is registered as a resource. A
+	// demotion caps the texture one level coarser than it currently holds
+	// (never beyond the tail), regardless of the feedback; a restoration
+	// lifts the cap by a level. descriptor_set() marks textures as used.
+	// Demoted levels are uploaded again on restoration, so the CPU copy of
+	// the mip chain is kept in this case even without feedback.
+	//
+	// Since images are replaced, descriptor sets are owned by the streamer,
+	// one per texture and frame slot. The set of a slot is updated by
+	// record_uploads() for that slot, at which point the slot's previous
+	// frame no longer uses it; old images are destroyed once every slot has
+	// moved on.
+	//
+	// Non-resident levels must not be sampled. Shaders clamp the level of
+	// detail to min_lod() (relative to the current image), e.g., by scaling
+	// the derivatives passed to textureGrad(). Until the first level is
+	// resident, the smallest level holds a placeholder colour, and min_lod()
+	// points at it.
+	//
+	// All images are kept in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL outside
+	// of record_uploads(), and may only be sampled in the fragment shader.
+	// descriptor_set() is valid after the first record_uploads() for the
+	// slot that followed request().
+	//
+	// Only RGBA8 formats (UNORM and SRGB) are supported. The TextureStreamer
+	// is not thread safe; it must be used on the thread that created the
+	// JobSystem.
+	class TextureStreamer
+	{
+		public:
+			using TextureId = std::uint32_t;
+
+			struct Stats
+			{
+				std::uint64_t bytesUploaded = 0;
+				std::uint64_t framesUploading = 0; // record_uploads() calls that uploaded data
+				std::uint32_t texturesStreaming = 0; // not yet resident at the requested level
+
+				std::uint64_t reallocations = 0; // images recreated with a different number of levels
+
+				VkDeviceSize allocatedBytes = 0; // texel data held by the current images
+				VkDeviceSize peakAllocatedBytes = 0;
+				VkDeviceSize fullChainBytes = 0; // if all images held all levels
+			};
+
+		public:
+			// aFrameSlots staging buffers of aFrameBudget bytes each are
+			// created; see record_uploads(). aSampler is used for all
+			// textures and must outlive the streamer. aFeedback requires the
+			// fragmentStoresAndAtomics device feature to be enabled (see
+			// VulkanContext::enabledFeatures). aResidency is optional, and
+			// must outlive the streamer.
+			TextureStreamer(
+				VulkanContext const&,
+				Allocator const&,
+				JobSystem&,
+				VkSampler aSampler,
+				std::uint32_t aFrameSlots,
+				bool aFeedback,
+				ResidencyManager* aResidency = nullptr,
+				VkDeviceSize aFrameBudget = kDefaultFrameBudget,
+				std::uint32_t aMaxTextures = kDefaultMaxTextures
+			);
+			~TextureStreamer();
+
+			TextureStreamer( TextureStreamer const& ) = delete;
+			TextureStreamer& operator= (TextureStreamer const&) = delete;
+
+		public:
+			TextureId request( char const* aPath, VkFormat = VK_FORMAT_R8G8B8A8_SRGB );
+
+			// Binding 0: combined image sampler, binding 1: feedback storage
+			// buffer (a uint per TextureId); both fragment shader only.
+			VkDescriptorSetLayout descriptor_layout() const noexcept { return mLayout.handle; }
+			VkDescriptorSet descriptor_set( TextureId, std::uint32_t aSlot );
+
+			// Mip levels of the full chain
+			std::uint32_t mip_levels( TextureId ) const;
+
+			// Level of the full chain that is level 0 of the current image
+			std::uint32_t base_level( TextureId ) const;
+
+			// Finest level of the current image that holds image data (or
+			// the placeholder)
+			float min_lod( TextureId ) const;
+
+			// Reads the slot's feedback, and records commands that
+			// initialize newly requested images, recreate images whose
+			// requested levels changed, clear the slot's feedback and upload
+			// up to the frame budget of pending mip levels. Draws recorded
+			// after this into the same command buffer may use the updated
+			// descriptor_set() and min_lod(). The previous command buffer
+			// that used the same slot must have completed. Rethrows errors
+			// from decoding.
+			void record_uploads( VkCommandBuffer, std::uint32_t aSlot );
+
+			// Makes the slot's feedback available to the host. Record after
+			// the last draw of the frame.
+			void record_feedback_readback( VkCommandBuffer, std::uint32_t aSlot ) const;
+
+			// True while textures are not resident at their requested level,
+			// and for a few frames after the feedback last changed (feedback
+			// is read with a delay of one frame per slot).
+			bool streaming() const noexcept;
+
+			Stats stats() const;
+
+		public:
+			static constexpr VkDeviceSize kDefaultFrameBudget = 4 * 1024 * 1024;
+			static constexpr std::uint32_t kDefaultMaxTextures = 256;
+
+			// Levels up to this size are always resident
+			static constexpr std::uint32_t kTailSize = 64;
+
+		private:
+			struct Texture_;
+			struct Retired_;
+
+			void read_feedback_( std::uint32_t aSlot );
+
+			void initialize_( VkCommandBuffer, Texture_& );
+			void reallocate_( VkCommandBuffer, Texture_&, std::uint32_t aBaseLevel );
+			VkDeviceSize upload_level_( VkCommandBuffer, Texture_&, std::byte* aStaging, VkBuffer, VkDeviceSize aOffset, VkDeviceSize aAvailable );
+
+			void update_descriptors_( std::uint32_t aSlot );
+
+			VkDeviceSize demote_( TextureId );
+			void restore_( TextureId );
+
+		private:
+			VulkanContext const* mContext;
+			Allocator const* mAllocator;
+			JobSystem* mJobs;
+			ResidencyManager* mResidency;
+
+			VkSampler mSampler;
+			std::uint32_t mSlotCount;
+			std::uint32_t mMaxTextures;
+
+			VkDeviceSize mFrameBudget;
+			std::vector<Buffer> mStaging;
+
+			DescriptorSetLayout mLayout;
+			DescriptorPool mPool;
+
+			bool mFeedback;
+			Buffer mFeedbackBuffer; // mSlotCount regions of mMaxTextures uints
+			std::vector<bool> mSlotRecorded;
+
+			std::uint64_t mFrame = 0;
+			std::uint32_t mStableReads = 0; // feedback reads without residency changes
+			std::uint32_t mPending = 0; // textures not resident at their requested level
+
+			std::vector<std::unique_ptr<Texture_>> mTextures;
+			std::vector<TextureId> mUninitialized;
+			std::vector<Retired_> mRetired;
+
+			Stats mStats;
+	};
+
+	// Prints upload and residency statistics
+	void print_texture_stream_stats( TextureStreamer const& );
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
@@ -0,0 +1,325 @@
+#include "transient_attachments.hpp"
+
+#include <utility>
+#include <algorithm>
+
+#include <cassert>
+
+#include "error.hpp"
+#include "to_string.hpp"
+
+namespace
+{
+	constexpr VkImageUsageFlags kAttachmentUsage_ = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT
+		| VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT
+		| VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT
+	;
+
+	VkDeviceSize align_up_( VkDeviceSize aValue, VkDeviceSize aAlignment )
+	{
+		return (aValue + aAlignment - 1) / aAlignment * aAlignment;
+	}
+
+	bool lifetimes_overlap_( labutils::TransientAttachmentDesc const& aX, labutils::TransientAttachmentDesc const& aY )
+	{
+		return aX.firstPass <= aY.lastPass && aY.firstPass <= aX.lastPass;
+	}
+
+	double to_mib_( VkDeviceSize aBytes )
+	{
+		return aBytes / (1024.0 * 1024.0);
+	}
+}
+
+namespace labutils
+{
+	TransientAttachments::TransientAttachments() noexcept = default;
+
+	TransientAttachments::~TransientAttachments()
+	{
+		// Views must go before the images, and images before their memory.
+		views.clear();
+
+		for( auto const image : images )
+			vkDestroyImage( mDevice, image, nullptr );
+
+		for( auto const allocation : mAllocations )
+			vmaFreeMemory( mAllocator, allocation );
+	}
+
+	TransientAttachments::TransientAttachments( TransientAttachments&& aOther ) noexcept
+		: images( std::move(aOther.images) )
+		, views( std::move(aOther.views) )
+		, report( aOther.report )
+		, mDevice( std::exchange( aOther.mDevice, VK_NULL_HANDLE ) )
+		, mAllocator( std::exchange( aOther.mAllocator, VK_NULL_HANDLE ) )
+		, mAllocations( std::move(aOther.mAllocations) )
+	{
+		aOther.images.clear();
+		aOther.mAllocations.clear();
+	}
+	TransientAttachments& TransientAttachments::operator=( TransientAttachments&& aOther ) noexcept
+	{
+		std::swap( images, aOther.images );
+		std::swap( views, aOther.views );
+		std::swap( report, aOther.report );
+		std::swap( mDevice, aOther.mDevice );
+		std::swap( mAllocator, aOther.mAllocator );
+		std::swap( mAllocations, aOther.mAllocations );
+		return *this;
+	}
+}
+
+namespace labutils
+{
+	TransientAttachments create_transient_attachments( VulkanContext const& aContext, Allocator const& aAllocator, std::vector<TransientAttachmentDesc> const& aDescs, bool aAllowLazy )
+	{
+		TransientAttachments ret;
+		ret.mDevice = aContext.device;
+		ret.mAllocator = aAllocator.allocator;
+
+		ret.report.attachmentCount = std::uint32_t(aDescs.size());
+
+		// Create images
+		std::vector<VkMemoryRequirements> reqs( aDescs.size() );
+		std::vector<bool> transient( aDescs.size() );
+
+		for( std::size_t i = 0; i < aDescs.size(); ++i )
+		{
+			auto const& desc = aDescs[i];
+			assert( desc.firstPass <= desc.lastPass );
+
+			// TRANSIENT_ATTACHMENT is only valid in combination with the
+			// attachment usages.
+			transient[i] = 0 == (desc.usage & ~kAttachmentUsage_);
+
+			VkImageCreateInfo imageInfo{}; {
+				imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+
+				imageInfo.imageType = VK_IMAGE_TYPE_2D;
+				imageInfo.format = desc.format;
+
+				imageInfo.extent = VkExtent3D{ desc.extent.width, desc.extent.height, 1 };
+
+				imageInfo.mipLevels = 1;
+				imageInfo.arrayLayers = 1;
+
+				imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+				imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+				imageInfo.usage = desc.usage | (transient[i] ? VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT : 0);
+
+				imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+				imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			}
+
+			VkImage image = VK_NULL_HANDLE;
+			if( auto const res = vkCreateImage( aContext.device, &imageInfo, nullptr, &image ); VK_SUCCESS != res )
+			{
+				throw Error( "Unable to create transient attachment %zu\n"
+					"vkCreateImage() returned %s", i, to_string(res).c_str()
+				);
+			}
+
+			ret.images.emplace_back( image );
+
+			vkGetImageMemoryRequirements( aContext.device, image, &reqs[i] );
+			ret.report.requiredBytes += reqs[i].size;
+		}
+
+		// Place transient attachments in lazily allocated memory, if there
+		// is such memory.
+		std::vector<std::size_t> aliased;
+		for( std::size_t i = 0; i < aDescs.size(); ++i )
+		{
+			if( aAllowLazy && transient[i] )
+			{
+				VmaAllocationCreateInfo lazyInfo{};
+				lazyInfo.usage = VMA_MEMORY_USAGE_GPU_LAZILY_ALLOCATED;
+
+				std::uint32_t memoryType = 0;
+				if( VK_SUCCESS == vmaFindMemoryTypeIndex( aAllocator.allocator, reqs[i].memoryTypeBits, &lazyInfo, &memoryType ) )
+				{
+					VmaAllocation allocation = VK_NULL_HANDLE;
+					if( auto const res = vmaAllocateMemoryForImage( aAllocator.allocator, ret.images[i], &lazyInfo, &allocation, nullptr ); VK_SUCCESS != res )
+					{
+						throw Error( "Unable to allocate lazy memory for transient attachment %zu\n"
+							"vmaAllocateMemoryForImage() returned %s", i, to_string(res).c_str()
+						);
+					}
+
+					ret.mAllocations.emplace_back( allocation );
+
+					if( auto const res = vmaBindImageMemory( aAllocator.allocator, allocation, ret.images[i] ); VK_SUCCESS != res )
+					{
+						throw Error( "Unable to bind memory to transient attachment %zu\n"
+							"vmaBindImageMemory() returned %s", i, to_string(res).c_str()
+						);
+					}
+
+					++ret.report.lazyCount;
+					ret.report.lazyBytes += reqs[i].size;
+					continue;
+				}
+			}
+
+			aliased.emplace_back( i );
+		}
+
+		// Assign offsets in the shared block: largest attachments first, each
+		// at the lowest offset where it does not overlap with any already
+		// placed attachment with an overlapping lifetime.
+		std::sort( aliased.begin(), aliased.end(), [&] (std::size_t aX, std::size_t aY) {
+			return reqs[aX].size > reqs[aY].size;
+		} );
+
+		std::vector<VkDeviceSize> offsets( aDescs.size(), 0 );
+		std::vector<std::size_t> placed, separate;
+
+		VkDeviceSize blockSize = 0, blockAlignment = 1;
+		std::uint32_t blockTypeBits = ~0u;
+
+		for( auto const i : aliased )
+		{
+			// Attachments that can't share a memory type with the block get
+			// their own allocation.
+			if( 0 == (blockTypeBits & reqs[i].memoryTypeBits) )
+			{
+				separate.emplace_back( i );
+				continue;
+			}
+
+			std::vector<VkDeviceSize> candidates{ 0 };
+			for( auto const j : placed )
+			{
+				if( lifetimes_overlap_( aDescs[i], aDescs[j] ) )
+					candidates.emplace_back( align_up_( offsets[j] + reqs[j].size, reqs[i].alignment ) );
+			}
+
+			std::sort( candidates.begin(), candidates.end() );
+
+			VkDeviceSize offset = candidates.back();
+			for( auto const candidate : candidates )
+			{
+				bool const fits = std::none_of( placed.begin(), placed.end(), [&] (std::size_t aJ) {
+					return lifetimes_overlap_( aDescs[i], aDescs[aJ] )
+						&& candidate < offsets[aJ] + reqs[aJ].size
+						&& offsets[aJ] < candidate + reqs[i].size
+					;
+				} );
+
+				if( fits )
+				{
+					offset = candidate;
+					break;
+				}
+			}
+
+			offsets[i] = offset;
+			placed.emplace_back( i );
+
+			blockSize = std::max( blockSize, offset + reqs[i].size );
+			blockAlignment = std::max( blockAlignment, reqs[i].alignment );
+			blockTypeBits &= reqs[i].memoryTypeBits;
+		}
+
+		VmaAllocationCreateInfo allocInfo{};
+		allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+		if( !placed.empty() )
+		{
+			VkMemoryRequirements blockReqs{};
+			blockReqs.size = blockSize;
+			blockReqs.alignment = blockAlignment;
+			blockReqs.memoryTypeBits = blockTypeBits;
+
+			VmaAllocation block = VK_NULL_HANDLE;
+			if( auto const res = vmaAllocateMemory( aAllocator.allocator, &blockReqs, &allocInfo, &block, nullptr ); VK_SUCCESS != res )
+			{
+				throw Error( "Unable to allocate transient attachment memory (%llu bytes)\n"
+					"vmaAllocateMemory() returned %s", static_cast<unsigned long long>(blockSize), to_string(res).c_str()
+				);
+			}
+
+			ret.mAllocations.emplace_back( block );
+			ret.report.allocatedBytes += blockSize;
+
+			for( auto const i : placed )
+			{
+				if( auto const res = vmaBindImageMemory2( aAllocator.allocator, block, offsets[i], ret.images[i], nullptr ); VK_SUCCESS != res )
+				{
+					throw Error( "Unable to bind memory to transient attachment %zu\n"
+						"vmaBindImageMemory2() returned %s", i, to_string(res).c_str()
+					);
+				}
+			}
+		}
+
+		for( auto const i : separate )
+		{
+			VmaAllocation allocation = VK_NULL_HANDLE;
+			if( auto const res = vmaAllocateMemoryForImage( aAllocator.allocator, ret.images[i], &allocInfo, &allocation, nullptr ); VK_SUCCESS != res )
+			{
+				throw Error( "Unable to allocate memory for transient attachment %zu\n"
+					"vmaAllocateMemoryForImage() returned %s", i, to_string(res).c_str()
+				);
+			}
+
+			ret.mAllocations.emplace_back( allocation );
+			ret.report.allocatedBytes += reqs[i].size;
+
+			if( auto const res = vmaBindImageMemory( aAllocator.allocator, allocation, ret.images[i] ); VK_SUCCESS != res )
+			{
+				throw Error( "Unable to bind memory to transient attachment %zu\n"
+					"vmaBindImageMemory() returned %s", i, to_string(res).c_str()
+				);
+			}
+		}
+
+		// Create views (after the images have memory bound)
+		for( std::size_t i = 0; i < aDescs.size(); ++i )
+		{
+			VkImageViewCreateInfo viewInfo{}; {
+				viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+
+				viewInfo.image = ret.images[i];
+				viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+				viewInfo.format = aDescs[i].format;
+
+				viewInfo.components = VkComponentMapping{};
+				viewInfo.subresourceRange = VkImageSubresourceRange{
+					aDescs[i].aspect,
+					0, 1,
+					0, 1
+				};
+			}
+
+			VkImageView view = VK_NULL_HANDLE;
+			if( auto const res = vkCreateImageView( aContext.device, &viewInfo, nullptr, &view ); VK_SUCCESS != res )
+			{
+				throw Error( "Unable to create view for transient attachment %zu\n"
+					"vkCreateImageView() returned %s", i, to_string(res).c_str()
+				);
+			}
+
+			ret.views.emplace_back( ImageView( aContext.device, view ) );
+		}
+
+		return ret;
+	}
+
+	void print_transient_report( std::FILE* aOut, TransientMemoryReport const& aReport )
+	{
+		VkDeviceSize const saved = aReport.requiredBytes - aReport.allocatedBytes;
+
+		std::fprintf( aOut, "Transient attachments: %u (%u lazily allocated); %.2f MiB required, %.2f MiB allocated, %.2f MiB saved per frame (%.2f MiB lazy)\n",
+			aReport.attachmentCount,
+			aReport.lazyCount,
+			to_mib_( aReport.requiredBytes ),
+			to_mib_( aReport.allocatedBytes ),
+			to_mib_( saved ),
+			to_mib_( aReport.lazyBytes )
+		);
+	}
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <volk/volk.h>
+#include <vk_mem_alloc.h>
+
+#include <vector>
+
+#include <cstdio>
+#include <cstdint>
+
+#include "vkobject.hpp"
+#include "allocator.hpp"
+#include "vulkan_context.hpp"
+
+namespace labutils
+{
+	// Attachments that are only needed while rendering a frame, such as depth
+	// buffers and intermediate render targets.
+	//
+	// Attachments that are only ever used as attachments get the
+	// VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT. These are placed in
+	// LAZILY_ALLOCATED memory if the device has such memory (typically
+	// tile-based GPUs). There, memory is only committed if the contents ever
+	// leave the tile memory, which they do not with loadOp CLEAR/DONT_CARE
+	// and storeOp DONT_CARE.
+	//
+	// All other attachments share a single block of device memory. Two
+	// attachments may overlap in memory if their lifetimes (inclusive ranges
+	// of pass indices within the frame) do not overlap. The first use of an
+	// aliased attachment must therefore not depend on its previous contents
+	// (initial layout UNDEFINED), and must be ordered after the last use of
+	// any attachment it overlaps with (e.g., via a pipeline barrier or
+	// subpass dependency).
+	struct TransientAttachmentDesc
+	{
+		VkFormat format;
+		VkExtent2D extent;
+
+		VkImageUsageFlags usage;
+		VkImageAspectFlags aspect;
+
+		std::uint32_t firstPass = 0, lastPass = 0;
+	};
+
+	struct TransientMemoryReport
+	{
+		std::uint32_t attachmentCount = 0;
+		std::uint32_t lazyCount = 0;
+
+		// Sum of the memory requirements of all attachments, i.e., the memory
+		// used if each attachment had its own allocation.
+		VkDeviceSize requiredBytes = 0;
+
+		// Requirements of the attachments in lazily allocated memory. This is
+		// an upper bound; the memory may never be committed.
+		VkDeviceSize lazyBytes = 0;
+
+		// Memory actually allocated for the remaining attachments (shared
+		// block and any attachments that could not be aliased).
+		VkDeviceSize allocatedBytes = 0;
+	};
+
+	class TransientAttachments
+	{
+		public:
+			TransientAttachments() noexcept, ~TransientAttachments();
+
+			TransientAttachments( TransientAttachments const& ) = delete;
+			TransientAttachments& operator= (TransientAttachments const&) = delete;
+
+			TransientAttachments( TransientAttachments&& ) noexcept;
+			TransientAttachments& operator = (TransientAttachments&&) noexcept;
+
+		public:
+			// One entry per TransientAttachmentDesc, in the same order
+			std::vector<VkImage> images;
+			std::vector<ImageView> views;
+
+			TransientMemoryReport report;
+
+		private:
+			friend TransientAttachments create_transient_attachments( VulkanContext const&, Allocator const&, std::vector<TransientAttachmentDesc> const&, bool );
+
+			VkDevice mDevice = VK_NULL_HANDLE;
+			VmaAllocator mAllocator = VK_NULL_HANDLE;
+
+			std::vector<VmaAllocation> mAllocations;
+	};
+
+	// Throws labutils::Error on failure. Set aAllowLazy to false to never use
+	// lazily allocated memory.
+	TransientAttachments create_transient_attachments(
+		VulkanContext const&,
+		Allocator const&,
+		std::vector<TransientAttachmentDesc> const&,
+		bool aAllowLazy = true
+	);
+
+	// Prints a one-line summary of the memory used by (and saved with) the
+	// transient attachments.
+	void print_transient_report( std::FILE*, TransientMemoryReport const& );
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
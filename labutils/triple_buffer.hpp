@@ -0,0 +1,82 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace labutils
+{
+	/* Lock-free single-producer single-consumer triple buffer.
+	 *
+	 * The producer fills write_buffer() and calls publish(). The consumer
+	 * calls update() to pick up the most recently published value, and
+	 * then reads read_buffer(). Neither side ever waits for the other:
+	 * values published in between two update()s are skipped, and the
+	 * consumer keeps the previous value until something new was published.
+	 *
+	 * There are three slots: one owned by each side, and a "middle" slot
+	 * that the two sides swap with. After publish(), write_buffer() refers
+	 * to a different slot with stale contents, so the producer must
+	 * overwrite the complete value each time.
+	 */
+	template< typename tType >
+	class TripleBuffer
+	{
+		public:
+			TripleBuffer() = default;
+			explicit TripleBuffer( tType const& aInitial )
+			{
+				for( auto& slot : mSlots )
+					slot.value = aInitial;
+			}
+
+			TripleBuffer( TripleBuffer const& ) = delete;
+			TripleBuffer& operator= (TripleBuffer const&) = delete;
+
+		public: // producer
+			tType& write_buffer() noexcept
+			{
+				return mSlots[mWrite].value;
+			}
+
+			void publish() noexcept
+			{
+				mWrite = mMiddle.exchange( std::uint8_t(mWrite | kFresh_), std::memory_order_acq_rel ) & kIndexMask_;
+			}
+
+		public: // consumer
+			// Returns true if a new value was published since the last call.
+			bool update() noexcept
+			{
+				if( !(mMiddle.load( std::memory_order_relaxed ) & kFresh_) )
+					return false;
+
+				mRead = mMiddle.exchange( mRead, std::memory_order_acq_rel ) & kIndexMask_;
+				return true;
+			}
+
+			tType const& read_buffer() const noexcept
+			{
+				return mSlots[mRead].value;
+			}
+
+		private:
+			static constexpr std::uint8_t kIndexMask_ = 0x3;
+			static constexpr std::uint8_t kFresh_ = 0x4;
+
+			// Keep the slots on separate cache lines, so that the producer
+			// writing its slot does not contend with the consumer reading.
+			struct alignas(64) Slot_
+			{
+				tType value{};
+			};
+
+			Slot_ mSlots[3];
+
+			alignas(64) std::uint8_t mWrite = 0; // producer only
+			alignas(64) std::uint8_t mRead = 1; // consumer only
+
+			alignas(64) std::atomic<std::uint8_t> mMiddle{ 2 };
+	};
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
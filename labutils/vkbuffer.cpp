@@ -68,4 +68,16 @@ Buffer create_buffer( Allocator const& aAllocator, VkDeviceSize aSize, VkBufferU
 
 	return Buffer(aAllocator.allocator, buffer, allocation);
 }
+
+VkDeviceAddress get_buffer_device_address( VulkanContext const& aContext, VkBuffer aBuffer )
+{
+	assert( aContext.haveBufferDeviceAddress );
+
+	VkBufferDeviceAddressInfo addressInfo{}; {
+		addressInfo.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+		addressInfo.buffer = aBuffer;
+	}
+
+	return vkGetBufferDeviceAddress(aContext.device, &addressInfo);
+}
 }
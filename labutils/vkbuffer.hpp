@@ -33,4 +33,8 @@ namespace labutils
 	};
 
 	Buffer create_buffer( Allocator const&, VkDeviceSize, VkBufferUsageFlags, VmaMemoryUsage );
+
+	// Requires VulkanContext::haveBufferDeviceAddress, and a buffer created
+	// with VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT
+	VkDeviceAddress get_buffer_device_address( VulkanContext const&, VkBuffer );
 }
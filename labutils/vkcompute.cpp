@@ -0,0 +1,159 @@
+#include "vkcompute.hpp"
+
+#include <cassert>
+
+#include "error.hpp"
+#include "vkutil.hpp"
+#include "to_string.hpp"
+
+namespace labutils
+{
+	Pipeline create_compute_pipeline( VulkanContext const& aContext, VkPipelineLayout aLayout, VkShaderModule aShader, VkSpecializationInfo const* aSpecialization, char const* aEntryPoint, VkPipelineCache aCache )
+	{
+		assert( aEntryPoint );
+
+		VkComputePipelineCreateInfo pipelineInfo{}; {
+			pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+
+			pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+			pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+			pipelineInfo.stage.module = aShader;
+			pipelineInfo.stage.pName = aEntryPoint;
+			pipelineInfo.stage.pSpecializationInfo = aSpecialization;
+
+			pipelineInfo.layout = aLayout;
+		}
+
+		VkPipeline pipeline = VK_NULL_HANDLE;
+		if( auto const res = vkCreateComputePipelines( aContext.device, aCache, 1, &pipelineInfo, nullptr, &pipeline ); VK_SUCCESS != res )
+		{
+			throw Error( "Unable to create compute pipeline\n"
+				"vkCreateComputePipelines() returned %s", to_string(res).c_str()
+			);
+		}
+
+		return Pipeline( aContext.device, pipeline );
+	}
+
+	void dispatch_1d( VkCommandBuffer aCmdBuff, std::uint32_t aItems, std::uint32_t aGroupSize )
+	{
+		assert( aGroupSize > 0 );
+		vkCmdDispatch( aCmdBuff, group_count( aItems, aGroupSize ), 1, 1 );
+	}
+	void dispatch_2d( VkCommandBuffer aCmdBuff, VkExtent2D aItems, std::uint32_t aGroupSizeX, std::uint32_t aGroupSizeY )
+	{
+		assert( aGroupSizeX > 0 && aGroupSizeY > 0 );
+		vkCmdDispatch( aCmdBuff, group_count( aItems.width, aGroupSizeX ), group_count( aItems.height, aGroupSizeY ), 1 );
+	}
+}
+
+namespace labutils
+{
+	bool has_async_compute( VulkanContext const& aContext ) noexcept
+	{
+		return aContext.computeFamilyIndex != aContext.graphicsFamilyIndex;
+	}
+
+	void release_buffer( VkCommandBuffer aCmdBuff, VkBuffer aBuffer, QueueTransfer const& aTransfer )
+	{
+		if( aTransfer.srcFamily == aTransfer.dstFamily )
+		{
+			buffer_barrier( aCmdBuff, aBuffer,
+				aTransfer.srcAccess, aTransfer.dstAccess,
+				aTransfer.srcStages, aTransfer.dstStages
+			);
+			return;
+		}
+
+		// The release half of an ownership transfer ignores the destination
+		// access mask and stages.
+		buffer_barrier( aCmdBuff, aBuffer,
+			aTransfer.srcAccess, 0,
+			aTransfer.srcStages, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+			VK_WHOLE_SIZE, 0,
+			aTransfer.srcFamily, aTransfer.dstFamily
+		);
+	}
+	void acquire_buffer( VkCommandBuffer aCmdBuff, VkBuffer aBuffer, QueueTransfer const& aTransfer )
+	{
+		if( aTransfer.srcFamily == aTransfer.dstFamily )
+			return;
+
+		// ... and the acquire half ignores the source access mask and stages.
+		buffer_barrier( aCmdBuff, aBuffer,
+			0, aTransfer.dstAccess,
+			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, aTransfer.dstStages,
+			VK_WHOLE_SIZE, 0,
+			aTransfer.srcFamily, aTransfer.dstFamily
+		);
+	}
+
+	void release_image( VkCommandBuffer aCmdBuff, VkImage aImage, QueueTransfer const& aTransfer, VkImageLayout aOldLayout, VkImageLayout aNewLayout, VkImageSubresourceRange const& aRange )
+	{
+		if( aTransfer.srcFamily == aTransfer.dstFamily )
+		{
+			image_barrier( aCmdBuff, aImage,
+				aTransfer.srcAccess, aTransfer.dstAccess,
+				aOldLayout, aNewLayout,
+				aTransfer.srcStages, aTransfer.dstStages,
+				aRange
+			);
+			return;
+		}
+
+		image_barrier( aCmdBuff, aImage,
+			aTransfer.srcAccess, 0,
+			aOldLayout, aNewLayout,
+			aTransfer.srcStages, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+			aRange,
+			aTransfer.srcFamily, aTransfer.dstFamily
+		);
+	}
+	void acquire_image( VkCommandBuffer aCmdBuff, VkImage aImage, QueueTransfer const& aTransfer, VkImageLayout aOldLayout, VkImageLayout aNewLayout, VkImageSubresourceRange const& aRange )
+	{
+		if( aTransfer.srcFamily == aTransfer.dstFamily )
+			return;
+
+		image_barrier( aCmdBuff, aImage,
+			0, aTransfer.dstAccess,
+			aOldLayout, aNewLayout,
+			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, aTransfer.dstStages,
+			aRange,
+			aTransfer.srcFamily, aTransfer.dstFamily
+		);
+	}
+
+	void submit_commands( VkQueue aQueue, VkCommandBuffer aCmdBuff, std::vector<SemaphoreWait> const& aWait, std::vector<VkSemaphore> const& aSignal, VkFence aFence )
+	{
+		std::vector<VkSemaphore> waitSemaphores;
+		std::vector<VkPipelineStageFlags> waitStages;
+		for( auto const& wait : aWait )
+		{
+			waitSemaphores.emplace_back( wait.semaphore );
+			waitStages.emplace_back( wait.stages );
+		}
+
+		VkSubmitInfo submitInfo{}; {
+			submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+
+			submitInfo.commandBufferCount = 1;
+			submitInfo.pCommandBuffers = &aCmdBuff;
+
+			submitInfo.waitSemaphoreCount = std::uint32_t(waitSemaphores.size());
+			submitInfo.pWaitSemaphores = waitSemaphores.data();
+			submitInfo.pWaitDstStageMask = waitStages.data();
+
+			submitInfo.signalSemaphoreCount = std::uint32_t(aSignal.size());
+			submitInfo.pSignalSemaphores = aSignal.data();
+		}
+
+		if( auto const res = vkQueueSubmit( aQueue, 1, &submitInfo, aFence ); VK_SUCCESS != res )
+		{
+			throw Error( "Unable to submit command buffer\n"
+				"vkQueueSubmit() returned %s", to_string(res).c_str()
+			);
+		}
+	}
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
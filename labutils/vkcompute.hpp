@@ -0,0 +1,84 @@
+#pragma once
+
+#include <volk/volk.h>
+
+#include <vector>
+#include <cstdint>
+
+#include "vkobject.hpp"
+#include "vulkan_context.hpp"
+
+namespace labutils
+{
+	Pipeline create_compute_pipeline(
+		VulkanContext const&,
+		VkPipelineLayout,
+		VkShaderModule,
+		VkSpecializationInfo const* = nullptr,
+		char const* aEntryPoint = "main",
+		VkPipelineCache = VK_NULL_HANDLE
+	);
+
+	// Number of work groups of size aGroupSize needed to cover aItems items.
+	constexpr std::uint32_t group_count( std::uint32_t aItems, std::uint32_t aGroupSize ) noexcept
+	{
+		return (aItems + aGroupSize - 1) / aGroupSize;
+	}
+
+	// vkCmdDispatch() with enough groups to cover the given number of items
+	// (threads). The shader must check for out-of-range invocations.
+	void dispatch_1d( VkCommandBuffer, std::uint32_t aItems, std::uint32_t aGroupSize );
+	void dispatch_2d( VkCommandBuffer, VkExtent2D aItems, std::uint32_t aGroupSizeX, std::uint32_t aGroupSizeY );
+
+	// Asynchronous compute.
+	//
+	// VulkanContext::computeQueue may come from a different queue family than
+	// the graphics queue. Resources created with VK_SHARING_MODE_EXCLUSIVE
+	// must then be transferred between the families: the source queue
+	// records a release barrier, the destination queue a matching acquire
+	// barrier, and a semaphore orders the two submissions. The helpers below
+	// record the right barrier for either side. If both families are the
+	// same, the release is an ordinary barrier and the acquire is a no-op
+	// (the semaphore orders the submissions on its own).
+	bool has_async_compute( VulkanContext const& ) noexcept;
+
+	struct QueueTransfer
+	{
+		std::uint32_t srcFamily;
+		std::uint32_t dstFamily;
+
+		// Access and stages on the source queue (before the transfer)
+		VkAccessFlags srcAccess;
+		VkPipelineStageFlags srcStages;
+
+		// Access and stages on the destination queue (after the transfer)
+		VkAccessFlags dstAccess;
+		VkPipelineStageFlags dstStages;
+	};
+
+	void release_buffer( VkCommandBuffer, VkBuffer, QueueTransfer const& );
+	void acquire_buffer( VkCommandBuffer, VkBuffer, QueueTransfer const& );
+
+	// Images may change layout during the transfer. The same layouts must be
+	// given on both sides.
+	void release_image( VkCommandBuffer, VkImage, QueueTransfer const&, VkImageLayout aOldLayout, VkImageLayout aNewLayout, VkImageSubresourceRange const& );
+	void acquire_image( VkCommandBuffer, VkImage, QueueTransfer const&, VkImageLayout aOldLayout, VkImageLayout aNewLayout, VkImageSubresourceRange const& );
+
+	// Submits a single command buffer. Each wait semaphore comes with the
+	// stages that wait for it.
+	struct SemaphoreWait
+	{
+		VkSemaphore semaphore;
+		VkPipelineStageFlags stages;
+	};
+
+	void submit_commands(
+		VkQueue,
+		VkCommandBuffer,
+		std::vector<SemaphoreWait> const& aWait = {},
+		std::vector<VkSemaphore> const& aSignal = {},
+		VkFence = VK_NULL_HANDLE
+	);
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
@@ -13,6 +13,7 @@
 
 #include "error.hpp"
 #include "vkutil.hpp"
+#include "mipmap.hpp"
 #include "vkbuffer.hpp"
 #include "to_string.hpp"
 
@@ -83,18 +84,46 @@ namespace labutils
 {
 Image load_image_texture2d( char const* aPath, VulkanContext const& aContext, VkCommandPool aCmdPool, Allocator const& aAllocator )
 {
-	stbi_set_flip_vertically_on_load(true);
+	return upload_image_texture2d( decode_image_rgba8( aPath ), aContext, aCmdPool, aAllocator );
+}
+
+ImageData decode_image_rgba8( char const* aPath )
+{
+	// The flag (and stbi_failure_reason()) are per thread
+	stbi_set_flip_vertically_on_load_thread(true);
 
 	int inBaseWidth, inBaseHeight, inBaseChannels;
 	stbi_uc* imageData = stbi_load(aPath, &inBaseWidth, &inBaseHeight, &inBaseChannels, 4);
 	if (!imageData)
 	{
 		throw Error("%s: Unable to Load Texture Base Image (%s)",
-			aPath, 0, stbi_failure_reason());
+			aPath, stbi_failure_reason());
+	}
+
+	ImageData ret; {
+		ret.width = std::uint32_t(inBaseWidth);
+		ret.height = std::uint32_t(inBaseHeight);
+
+		ret.texels = decltype(ret.texels)( imageData, &stbi_image_free );
 	}
 
-	auto const baseWidth = std::uint32_t(inBaseWidth);
-	auto const baseHeight = std::uint32_t(inBaseHeight);
+	return ret;
+}
+
+Image upload_image_texture2d( ImageData const& aData, VulkanContext const& aContext, VkCommandPool aCmdPool, Allocator const& aAllocator )
+{
+	if( supports_host_image_upload( aContext ) )
+		return upload_image_texture2d_host( aData, aContext, aAllocator );
+
+	return upload_image_texture2d_staged( aData, aContext, aCmdPool, aAllocator );
+}
+
+Image upload_image_texture2d_staged( ImageData const& aData, VulkanContext const& aContext, VkCommandPool aCmdPool, Allocator const& aAllocator )
+{
+	assert( aData.texels );
+
+	auto const baseWidth = aData.width;
+	auto const baseHeight = aData.height;
 
 	auto const bytesSize = baseWidth * baseHeight * 4;
 
@@ -108,11 +137,9 @@ Image load_image_texture2d( char const* aPath, VulkanContext const& aContext, Vk
 			"vmaMapMemory() Returned %s", to_string(res).c_str());
 	}
 
-	std::memcpy(sptr, imageData, bytesSize);
+	std::memcpy(sptr, aData.texels.get(), bytesSize);
 	vmaUnmapMemory(aAllocator.allocator, staging.allocation);
 
-	stbi_image_free(imageData);
-
 	Image image = create_image_texture2d(
 		aAllocator, baseWidth, baseHeight,
 		VK_FORMAT_R8G8B8A8_SRGB,
@@ -279,6 +306,110 @@ Image load_image_texture2d( char const* aPath, VulkanContext const& aContext, Vk
 
 	throw Error( "Not yet implemented" ); //TODO- (Section 4) implement me!
 }
+
+Image upload_image_texture2d_host( ImageData const& aData, VulkanContext const& aContext, Allocator const& aAllocator )
+{
+	assert( aData.texels );
+
+	if( !supports_host_image_upload( aContext ) )
+		throw Error( "upload_image_texture2d_host(): host image copies are not supported" );
+
+	// There is no vkCmdBlitImage() on the host, so the mip chain is
+	// generated on the CPU.
+	auto const chain = generate_mip_chain_rgba8( aData, true );
+	auto const mipLevels = std::uint32_t(chain.levelOffsets.size());
+
+	Image image = create_image_texture2d(
+		aAllocator, aData.width, aData.height,
+		VK_FORMAT_R8G8B8A8_SRGB,
+		VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_HOST_TRANSFER_BIT_EXT
+	);
+
+	// The image goes straight to its final layout. Host copies can write to
+	// it in that layout (see VulkanContext::haveHostImageCopy).
+	VkHostImageLayoutTransitionInfoEXT transition{}; {
+		transition.sType = VK_STRUCTURE_TYPE_HOST_IMAGE_LAYOUT_TRANSITION_INFO_EXT;
+
+		transition.image = image.image;
+		transition.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		transition.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		transition.subresourceRange = VkImageSubresourceRange{
+			VK_IMAGE_ASPECT_COLOR_BIT,
+			0, mipLevels,
+			0, 1
+		};
+	}
+
+	if (auto const res = aContext.transitionImageLayout(aContext.device, 1, &transition);
+		res != VK_SUCCESS)
+	{
+		throw Error("Transitioning Image Layout on the Host\n"
+			"vkTransitionImageLayoutEXT() Returned %s", to_string(res).c_str());
+	}
+
+	std::vector<VkMemoryToImageCopyEXT> regions(mipLevels);
+	for (std::uint32_t level = 0; level < mipLevels; ++level)
+	{
+		auto& region = regions[level];
+		region.sType = VK_STRUCTURE_TYPE_MEMORY_TO_IMAGE_COPY_EXT;
+
+		region.pHostPointer = chain.texels.data() + chain.levelOffsets[level];
+
+		region.memoryRowLength = 0;
+		region.memoryImageHeight = 0;
+
+		region.imageSubresource = VkImageSubresourceLayers{
+			VK_IMAGE_ASPECT_COLOR_BIT,
+			level,
+			0, 1
+		};
+
+		region.imageOffset = VkOffset3D{0, 0, 0};
+		region.imageExtent = VkExtent3D{
+			std::max(1u, aData.width >> level),
+			std::max(1u, aData.height >> level),
+			1
+		};
+	}
+
+	VkCopyMemoryToImageInfoEXT copyInfo{}; {
+		copyInfo.sType = VK_STRUCTURE_TYPE_COPY_MEMORY_TO_IMAGE_INFO_EXT;
+
+		copyInfo.flags = 0;
+		copyInfo.dstImage = image.image;
+		copyInfo.dstImageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+		copyInfo.regionCount = mipLevels;
+		copyInfo.pRegions = regions.data();
+	}
+
+	if (auto const res = aContext.copyMemoryToImage(aContext.device, &copyInfo);
+		res != VK_SUCCESS)
+	{
+		throw Error("Copying Texels to Image on the Host\n"
+			"vkCopyMemoryToImageEXT() Returned %s", to_string(res).c_str());
+	}
+
+	return image;
+}
+
+bool supports_host_image_upload( VulkanContext const& aContext, VkFormat aFormat )
+{
+	if( !aContext.haveHostImageCopy )
+		return false;
+
+	VkFormatProperties3 props3{};
+	props3.sType = VK_STRUCTURE_TYPE_FORMAT_PROPERTIES_3;
+
+	VkFormatProperties2 props{};
+	props.sType = VK_STRUCTURE_TYPE_FORMAT_PROPERTIES_2;
+	props.pNext = &props3;
+
+	vkGetPhysicalDeviceFormatProperties2( aContext.physicalDevice, aFormat, &props );
+
+	auto const required = VK_FORMAT_FEATURE_2_HOST_IMAGE_TRANSFER_BIT_EXT | VK_FORMAT_FEATURE_2_SAMPLED_IMAGE_BIT;
+	return required == (props3.optimalTilingFeatures & required);
+}
 Image create_image_texture2d( Allocator const& aAllocator, std::uint32_t aWidth, std::uint32_t aHeight, VkFormat aFormat, VkImageUsageFlags aUsage )
 {
 	auto const mipLevels = compute_mip_level_count(aWidth, aHeight);
@@ -3,9 +3,11 @@
 #include <volk/volk.h>
 #include <vk_mem_alloc.h>
 
+#include <memory>
 #include <utility>
 
 #include <cassert>
+#include <cstdint>
 
 #include "allocator.hpp"
 
@@ -33,7 +35,44 @@ namespace labutils
 	};
 
 
+	// Decoded RGBA8 image, flipped vertically (as load_image_texture2d()
+	// expects)
+	struct ImageData
+	{
+		std::uint32_t width = 0;
+		std::uint32_t height = 0;
+
+		std::unique_ptr<std::uint8_t, void (*)(void*)> texels{ nullptr, nullptr };
+	};
+
+	// load_image_texture2d() is decode_image_rgba8() followed by
+	// upload_image_texture2d(). Decoding does not touch Vulkan and may run on
+	// any thread, so several images can be decoded in parallel (e.g., as
+	// JobSystem jobs). Uploading may submit to the context's graphics queue,
+	// and must not run concurrently with other uses of that queue.
+	//
+	// upload_image_texture2d() uses upload_image_texture2d_host() if
+	// supports_host_image_upload(), and upload_image_texture2d_staged()
+	// otherwise. The staged path copies the texels into a staging buffer,
+	// and records and submits vkCmdCopyBufferToImage() and vkCmdBlitImage()
+	// (for the mip levels), waiting for the submission to complete. The host
+	// path generates the mip chain on the CPU and writes it into the image
+	// with VK_EXT_host_image_copy, without staging memory, command buffers or
+	// queue submissions. It does not touch the queue (aCmdPool is unused).
+	// Either way, the image is in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL on
+	// return, and holds an R8G8B8A8_SRGB mip chain.
 	Image load_image_texture2d( char const* aPath, VulkanContext const&, VkCommandPool, Allocator const& );
+
+	ImageData decode_image_rgba8( char const* aPath );
+	Image upload_image_texture2d( ImageData const&, VulkanContext const&, VkCommandPool, Allocator const& );
+
+	Image upload_image_texture2d_staged( ImageData const&, VulkanContext const&, VkCommandPool, Allocator const& );
+	Image upload_image_texture2d_host( ImageData const&, VulkanContext const&, Allocator const& );
+
+	// VulkanContext::haveHostImageCopy, and the format supports host
+	// transfers and sampling with optimal tiling
+	bool supports_host_image_upload( VulkanContext const&, VkFormat = VK_FORMAT_R8G8B8A8_SRGB );
+
 	Image create_image_texture2d( Allocator const&, std::uint32_t aWidth, std::uint32_t aHeight, VkFormat, VkImageUsageFlags = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT );
 
 	std::uint32_t compute_mip_level_count( std::uint32_t aWidth, std::uint32_t aHeight );
@@ -61,12 +61,12 @@ ShaderModule load_shader_module( VulkanContext const& aContext, char const* aSpi
 	return ShaderModule(aContext.device, shaderModule);
 }
 
-CommandPool create_command_pool( VulkanContext const& aContext, VkCommandPoolCreateFlags aFlags )
+CommandPool create_command_pool( VulkanContext const& aContext, VkCommandPoolCreateFlags aFlags, std::uint32_t aQueueFamily )
 {
 	VkCommandPoolCreateInfo commandPoolInfo{}; {
 		commandPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
 
-		commandPoolInfo.queueFamilyIndex = aContext.graphicsFamilyIndex;
+		commandPoolInfo.queueFamilyIndex = VK_QUEUE_FAMILY_IGNORED == aQueueFamily ? aContext.graphicsFamilyIndex : aQueueFamily;
 		commandPoolInfo.flags = aFlags;
 	}
 
@@ -197,7 +197,8 @@ DescriptorPool create_descriptor_pool(
 {
 	VkDescriptorPoolSize const descriptorPoolSizes[] = {
 		{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, aMaxDescriptors},
-		{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, aMaxDescriptors}
+		{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, aMaxDescriptors},
+		{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, aMaxDescriptors}
 	};
 
 	VkDescriptorPoolCreateInfo descriptorPoolInfo{}; {
@@ -270,7 +271,7 @@ ImageView create_image_view_texture2d(VulkanContext const& aContext, VkImage aIm
 	return ImageView(aContext.device, imageView);
 }
 
-Sampler create_default_sampler(VulkanContext const& aContext)
+VkSamplerCreateInfo default_sampler_info(VulkanContext const& aContext)
 {
 	VkSamplerCreateInfo samplerInfo{}; {
 		samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
@@ -287,14 +288,18 @@ Sampler create_default_sampler(VulkanContext const& aContext)
 		samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
 		samplerInfo.mipLodBias = 0.0f;
 
-		// Check if Anisotropic Filtering is Supported
-		VkPhysicalDeviceFeatures deviceFeatures{};
-		vkGetPhysicalDeviceFeatures(aContext.physicalDevice, &deviceFeatures);
-		
-		samplerInfo.anisotropyEnable = deviceFeatures.samplerAnisotropy;
+		// Anisotropic filtering requires the samplerAnisotropy feature
+		samplerInfo.anisotropyEnable = aContext.enabledFeatures.samplerAnisotropy;
 		samplerInfo.maxAnisotropy = 8.0f;
 	}
 
+	return samplerInfo;
+}
+
+Sampler create_default_sampler(VulkanContext const& aContext)
+{
+	VkSamplerCreateInfo const samplerInfo = default_sampler_info(aContext);
+
 	VkSampler sampler = VK_NULL_HANDLE;
 	if (auto const res = vkCreateSampler(aContext.device, &samplerInfo, nullptr, &sampler);
 		res != VK_SUCCESS)
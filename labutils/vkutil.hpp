@@ -11,7 +11,9 @@ namespace labutils
 {
 	ShaderModule load_shader_module( VulkanContext const&, char const* aSpirvPath );
 
-	CommandPool create_command_pool( VulkanContext const&, VkCommandPoolCreateFlags = 0 );
+	// The pool is created for the graphics queue family, unless a different
+	// family is specified (e.g., VulkanContext::computeFamilyIndex).
+	CommandPool create_command_pool( VulkanContext const&, VkCommandPoolCreateFlags = 0, std::uint32_t aQueueFamily = VK_QUEUE_FAMILY_IGNORED );
 	VkCommandBuffer alloc_command_buffer( VulkanContext const&, VkCommandPool );
 
 	Fence create_fence( VulkanContext const&, VkFenceCreateFlags = 0 );
@@ -44,5 +46,8 @@ namespace labutils
 
 	ImageView create_image_view_texture2d(VulkanContext const&, VkImage, VkFormat);
 
+	// Linear filtering with repeat addressing and (if supported) 8x
+	// anisotropic filtering.
+	VkSamplerCreateInfo default_sampler_info(VulkanContext const&);
 	Sampler create_default_sampler(VulkanContext const&);
 }
@@ -9,6 +9,7 @@
 
 #include "error.hpp"
 #include "to_string.hpp"
+#include "device_profile.hpp"
 #include "context_helpers.hxx"
 namespace lut = labutils;
 
@@ -21,7 +22,10 @@ namespace
 
 	VkDevice create_device( 
 		VkPhysicalDevice,
-		std::uint32_t aQueueFamily
+		std::vector<std::uint32_t> const& aQueueFamilies,
+		VkPhysicalDeviceFeatures const& aEnabledFeatures,
+		std::vector<char const*> const& aEnabledDeviceExtensions = {},
+		void* aFeatureChain = nullptr
 	);
 }
 
@@ -34,7 +38,10 @@ namespace labutils
 	{
 		// Device-related objects
 		if( VK_NULL_HANDLE != device )
-			vkDestroyDevice( device, nullptr );
+		{
+			detail::release_device_functions( instance, device );
+			deviceTable.vkDestroyDevice( device, nullptr );
+		}
 
 		// Instance-related objects
 		if( VK_NULL_HANDLE != debugMessenger )
@@ -51,6 +58,16 @@ namespace labutils
 		, device( std::exchange( aOther.device, VK_NULL_HANDLE ) )
 		, graphicsFamilyIndex( aOther.graphicsFamilyIndex )
 		, graphicsQueue( std::exchange( aOther.graphicsQueue, VK_NULL_HANDLE ) )
+		, computeFamilyIndex( aOther.computeFamilyIndex )
+		, computeQueue( std::exchange( aOther.computeQueue, VK_NULL_HANDLE ) )
+		, deviceTable( std::exchange( aOther.deviceTable, VolkDeviceTable{} ) )
+		, enabledFeatures( std::exchange( aOther.enabledFeatures, VkPhysicalDeviceFeatures{} ) )
+		, haveDynamicRendering( std::exchange( aOther.haveDynamicRendering, false ) )
+		, haveMemoryBudget( std::exchange( aOther.haveMemoryBudget, false ) )
+		, haveBufferDeviceAddress( std::exchange( aOther.haveBufferDeviceAddress, false ) )
+		, haveHostImageCopy( std::exchange( aOther.haveHostImageCopy, false ) )
+		, copyMemoryToImage( std::exchange( aOther.copyMemoryToImage, nullptr ) )
+		, transitionImageLayout( std::exchange( aOther.transitionImageLayout, nullptr ) )
 		, debugMessenger( std::exchange( aOther.debugMessenger, VK_NULL_HANDLE ) )
 	{}
 
@@ -72,6 +89,16 @@ namespace labutils
 		std::swap( device, aOther.device );
 		std::swap( graphicsFamilyIndex, aOther.graphicsFamilyIndex );
 		std::swap( graphicsQueue, aOther.graphicsQueue );
+		std::swap( computeFamilyIndex, aOther.computeFamilyIndex );
+		std::swap( computeQueue, aOther.computeQueue );
+		std::swap( deviceTable, aOther.deviceTable );
+		std::swap( enabledFeatures, aOther.enabledFeatures );
+		std::swap( haveDynamicRendering, aOther.haveDynamicRendering );
+		std::swap( haveMemoryBudget, aOther.haveMemoryBudget );
+		std::swap( haveBufferDeviceAddress, aOther.haveBufferDeviceAddress );
+		std::swap( haveHostImageCopy, aOther.haveHostImageCopy );
+		std::swap( copyMemoryToImage, aOther.copyMemoryToImage );
+		std::swap( transitionImageLayout, aOther.transitionImageLayout );
 		std::swap( debugMessenger, aOther.debugMessenger );
 		return *this;
 	}
@@ -149,13 +176,102 @@ namespace labutils
 			throw lut::Error( "No queue family with GRAPHICS" );
 		}
 
-		ret.device = create_device( ret.physicalDevice, ret.graphicsFamilyIndex );
+		std::vector<std::uint32_t> queueFamilyIndices{ ret.graphicsFamilyIndex };
+
+		ret.computeFamilyIndex = ret.graphicsFamilyIndex;
+		if( auto const index = detail::find_async_compute_family( ret.physicalDevice ) )
+		{
+			ret.computeFamilyIndex = *index;
+			queueFamilyIndices.emplace_back( *index );
+		}
+
+		std::fprintf( stderr, "Async compute: %s\n", ret.computeFamilyIndex != ret.graphicsFamilyIndex ? "enabled" : "disabled" );
+
+		// Optional core features: anisotropic filtering (see
+		// default_sampler_info()) and stores/atomics in fragment shaders
+		// (e.g., texture feedback, see TextureStreamer)
+		{
+			VkPhysicalDeviceFeatures supported{};
+			vkGetPhysicalDeviceFeatures( ret.physicalDevice, &supported );
+
+			ret.enabledFeatures.samplerAnisotropy = supported.samplerAnisotropy;
+			ret.enabledFeatures.fragmentStoresAndAtomics = supported.fragmentStoresAndAtomics;
+		}
+
+		std::fprintf( stderr, "Anisotropic filtering: %s\n", ret.enabledFeatures.samplerAnisotropy ? "enabled" : "disabled" );
+		std::fprintf( stderr, "Fragment stores and atomics: %s\n", ret.enabledFeatures.fragmentStoresAndAtomics ? "enabled" : "disabled" );
+
+		// Optional: dynamic rendering (Vulkan 1.3) and buffer device
+		// addresses (Vulkan 1.2), as with make_vulkan_window()
+		VkPhysicalDeviceVulkan13Features features13{};
+		features13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+
+		if( detail::supports_dynamic_rendering( ret.physicalDevice ) )
+		{
+			features13.dynamicRendering = VK_TRUE;
+			ret.haveDynamicRendering = true;
+		}
+
+		std::fprintf( stderr, "Dynamic rendering: %s\n", ret.haveDynamicRendering ? "enabled" : "disabled" );
+
+		VkPhysicalDeviceVulkan12Features features12{};
+		features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+		if( detail::supports_buffer_device_address( ret.physicalDevice ) )
+		{
+			features12.bufferDeviceAddress = VK_TRUE;
+			ret.haveBufferDeviceAddress = true;
+		}
+
+		std::fprintf( stderr, "Buffer device address: %s\n", ret.haveBufferDeviceAddress ? "enabled" : "disabled" );
+
+		// Optional: host image copies (see upload_image_texture2d())
+		std::vector<char const*> enabledDevExtensions;
+
+		VkPhysicalDeviceHostImageCopyFeaturesEXT hostCopyFeatures{};
+		hostCopyFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_IMAGE_COPY_FEATURES_EXT;
+
+		if( detail::supports_host_image_copy( ret.physicalDevice ) )
+		{
+			enabledDevExtensions.emplace_back( VK_EXT_HOST_IMAGE_COPY_EXTENSION_NAME );
+			hostCopyFeatures.hostImageCopy = VK_TRUE;
+			ret.haveHostImageCopy = true;
+		}
+
+		std::fprintf( stderr, "Host image copy: %s\n", ret.haveHostImageCopy ? "enabled" : "disabled" );
+
+		void* featureChain = nullptr;
+		if( ret.haveBufferDeviceAddress )
+		{
+			features12.pNext = featureChain;
+			featureChain = &features12;
+		}
+		if( ret.haveDynamicRendering )
+		{
+			features13.pNext = featureChain;
+			featureChain = &features13;
+		}
+		if( ret.haveHostImageCopy )
+		{
+			hostCopyFeatures.pNext = featureChain;
+			featureChain = &hostCopyFeatures;
+		}
+
+		ret.device = create_device( ret.physicalDevice, queueFamilyIndices, ret.enabledFeatures, enabledDevExtensions, featureChain );
+
+		// Load device-level functions
+		detail::load_device_functions( ret.instance, ret.device, ret.deviceTable );
+
+		if( ret.haveHostImageCopy )
+			detail::load_host_image_copy_functions( ret );
 
 		// Retrieve VkQueue
 		vkGetDeviceQueue( ret.device, ret.graphicsFamilyIndex, 0, &ret.graphicsQueue );
 
 		assert( VK_NULL_HANDLE != ret.graphicsQueue );
 
+		vkGetDeviceQueue( ret.device, ret.computeFamilyIndex, 0, &ret.computeQueue );
+
 		// Done
 		return ret;
 	}
@@ -182,26 +298,31 @@ namespace
 		return {};
 	}
 
-	VkDevice create_device( VkPhysicalDevice aPhysicalDev, std::uint32_t aQueueFamily )
+	VkDevice create_device( VkPhysicalDevice aPhysicalDev, std::vector<std::uint32_t> const& aQueueFamilies, VkPhysicalDeviceFeatures const& aEnabledFeatures, std::vector<char const*> const& aEnabledExtensions, void* aFeatureChain )
 	{
 		float queuePriorities[1] = { 1.f };
 
-		VkDeviceQueueCreateInfo queueInfo{};
-		queueInfo.sType  = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-		queueInfo.queueFamilyIndex  = aQueueFamily;
-		queueInfo.queueCount        = 1;
-		queueInfo.pQueuePriorities  = queuePriorities;
+		std::vector<VkDeviceQueueCreateInfo> queueInfos( aQueueFamilies.size() );
+		for( std::size_t i = 0; i < aQueueFamilies.size(); ++i )
+		{
+			auto& queueInfo = queueInfos[i];
+			queueInfo.sType  = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+			queueInfo.queueFamilyIndex  = aQueueFamilies[i];
+			queueInfo.queueCount        = 1;
+			queueInfo.pQueuePriorities  = queuePriorities;
+		}
 
-		VkPhysicalDeviceFeatures deviceFeatures{};
-		// No extra features for now.
-		
 		VkDeviceCreateInfo deviceInfo{};
 		deviceInfo.sType  = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+		deviceInfo.pNext  = aFeatureChain;
 
-		deviceInfo.queueCreateInfoCount  = 1;
-		deviceInfo.pQueueCreateInfos     = &queueInfo;
+		deviceInfo.queueCreateInfoCount  = std::uint32_t(queueInfos.size());
+		deviceInfo.pQueueCreateInfos     = queueInfos.data();
 
-		deviceInfo.pEnabledFeatures      = &deviceFeatures;
+		deviceInfo.enabledExtensionCount    = std::uint32_t(aEnabledExtensions.size());
+		deviceInfo.ppEnabledExtensionNames  = aEnabledExtensions.data();
+
+		deviceInfo.pEnabledFeatures      = &aEnabledFeatures;
 
 		VkDevice device = VK_NULL_HANDLE;
 		if( auto const res = vkCreateDevice( aPhysicalDev, &deviceInfo, nullptr, &device ); VK_SUCCESS != res )
@@ -229,13 +350,12 @@ namespace
 		if( major < 1 || (major == 1 && minor < 2) )
 			return -1.f;
 
-		// Discrete GPU > Integrated GPU > others
-		float score = 0.f;
+		// Rank the remaining devices by their capabilities
+		auto const profile = lut::profile_device( aPhysicalDev );
+		auto const score = lut::score_device_profile( profile );
 
-		if( VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU == props.deviceType )
-			score += 500.f;
-		else if( VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU == props.deviceType )
-			score += 100.f;
+		lut::print_device_profile( stderr, profile );
+		std::fprintf( stderr, "Info: Device '%s' scores %.1f\n", props.deviceName, score );
 
 		return score;
 	}
@@ -258,6 +378,16 @@ namespace
 			);
 		}
 
+		// Explicitly selected device?
+		if( auto const index = lut::find_device_override( devices ) )
+		{
+			auto const device = devices[*index];
+			if( score_device( device ) < 0.f )
+				throw lut::Error( "Selected device %zu does not meet the requirements", *index );
+
+			return device;
+		}
+
 		float bestScore = -1.f;
 		VkPhysicalDevice bestDevice = VK_NULL_HANDLE;
 
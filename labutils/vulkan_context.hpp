@@ -4,6 +4,8 @@
 
 #include <cstdint>
 
+#include "host_image_copy.hpp"
+
 namespace labutils
 {
 	class VulkanContext
@@ -28,6 +30,47 @@ namespace labutils
 			std::uint32_t graphicsFamilyIndex = 0;
 			VkQueue graphicsQueue = VK_NULL_HANDLE;
 
+			// Queue for asynchronous compute work. This is a queue from a
+			// family with COMPUTE but without GRAPHICS, if the device has one
+			// (and LABUTILS_NO_ASYNC_COMPUTE is not set). Otherwise, it is the
+			// graphics queue; compare the family indices to find out.
+			std::uint32_t computeFamilyIndex = 0;
+			VkQueue computeQueue = VK_NULL_HANDLE;
+
+			// Device-level entry points for `device`. These call directly into
+			// the driver, without going through the loader's dispatch
+			// trampolines. Unlike the global vk*() functions, which volk can
+			// only point at a single VkDevice, each context has its own table.
+			VolkDeviceTable deviceTable{};
+
+			// Core features enabled on the device. Check these (rather than
+			// what the physical device supports) before relying on a feature,
+			// e.g., samplerAnisotropy or fragmentStoresAndAtomics.
+			VkPhysicalDeviceFeatures enabledFeatures{};
+
+			// VK_KHR_dynamic_rendering (core in Vulkan 1.3) is enabled on the
+			// device.
+			bool haveDynamicRendering = false;
+
+			// VK_EXT_memory_budget is enabled on the device; the allocator
+			// then reports the driver's heap budgets. Currently only set by
+			// make_vulkan_window().
+			bool haveMemoryBudget = false;
+
+			// The bufferDeviceAddress feature (VK_KHR_buffer_device_address,
+			// core in Vulkan 1.2) is enabled on the device, and the allocator
+			// can create buffers with VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT.
+			bool haveBufferDeviceAddress = false;
+
+			// VK_EXT_host_image_copy is enabled on the device, and host copies
+			// can write images in VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+			// (see upload_image_texture2d_host()). The entry points are not
+			// in deviceTable, as volk predates the extension. Setting
+			// LABUTILS_NO_HOST_IMAGE_COPY to a non-zero value disables it.
+			bool haveHostImageCopy = false;
+			PFN_vkCopyMemoryToImageEXT copyMemoryToImage = nullptr;
+			PFN_vkTransitionImageLayoutEXT transitionImageLayout = nullptr;
+
 			
 			//bool haveDebugUtils = false;
 			VkDebugUtilsMessengerEXT debugMessenger = VK_NULL_HANDLE;
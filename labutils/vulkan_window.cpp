@@ -10,16 +10,39 @@
 
 #include <cstdio>
 #include <cassert>
+#include <cstdlib>
+#include <cstring>
 #include <vulkan/vulkan_core.h>
 
 #include "error.hpp"
 #include "to_string.hpp"
+#include "device_profile.hpp"
 #include "context_helpers.hxx"
 namespace lut = labutils;
 
 
 namespace
 {
+	namespace cfg
+	{
+		// Initial window size. In headless mode, this is the size of the
+		// swap chain images (headless surfaces have no extent of their own).
+		constexpr std::uint32_t kWindowWidth = 1280;
+		constexpr std::uint32_t kWindowHeight = 720;
+
+		// Environment variables controlling headless mode. Setting
+		// LABUTILS_HEADLESS to a non-zero value forces a headless surface,
+		// even if a display is available. LABUTILS_HEADLESS_FRAMES limits the
+		// number of frames a headless application runs for.
+		constexpr char const* kHeadlessEnv = "LABUTILS_HEADLESS";
+		constexpr char const* kHeadlessFramesEnv = "LABUTILS_HEADLESS_FRAMES";
+
+		constexpr std::uint32_t kDefaultHeadlessFrames = 1000;
+	}
+
+	using labutils::detail::env_flag;
+	std::uint32_t env_uint( char const* aName, std::uint32_t aDefault );
+
 	// The device selection process has changed somewhat w.r.t. the one used 
 	// earlier (e.g., with VulkanContext.
 	VkPhysicalDevice select_device( VkInstance, VkSurfaceKHR );
@@ -27,10 +50,14 @@ namespace
 
 	std::optional<std::uint32_t> find_queue_family( VkPhysicalDevice, VkQueueFlags, VkSurfaceKHR = VK_NULL_HANDLE );
 
+	bool supports_memory_budget( VkPhysicalDevice );
+
 	VkDevice create_device( 
 		VkPhysicalDevice,
 		std::vector<std::uint32_t> const& aQueueFamilies,
-		std::vector<char const*> const& aEnabledDeviceExtensions = {}
+		VkPhysicalDeviceFeatures const& aEnabledFeatures,
+		std::vector<char const*> const& aEnabledDeviceExtensions = {},
+		void* aFeatureChain = nullptr
 	);
 
 	std::vector<VkSurfaceFormatKHR> get_surface_formats( VkPhysicalDevice, VkSurfaceKHR );
@@ -40,11 +67,15 @@ namespace
 		VkPhysicalDevice,
 		VkSurfaceKHR,
 		VkDevice,
-		GLFWwindow*,
+		VkExtent2D aFramebufferExtent, // used if the surface has no extent
 		std::vector<std::uint32_t> const& aQueueFamilyIndices = {},
 		VkSwapchainKHR aOldSwapchain = VK_NULL_HANDLE
 	);
 
+	// Size of the window's framebuffer, or the default size for headless
+	// windows. Main thread only.
+	VkExtent2D framebuffer_extent( GLFWwindow* );
+
 	void get_swapchain_images( VkDevice, VkSwapchainKHR, std::vector<VkImage>& );
 	void create_swapchain_image_views( VkDevice, VkFormat, std::vector<VkImage> const&, std::vector<VkImageView>& );
 }
@@ -92,6 +123,7 @@ namespace labutils
 		, swapViews( std::move( aOther.swapViews ) )
 		, swapchainFormat( aOther.swapchainFormat )
 		, swapchainExtent( aOther.swapchainExtent )
+		, headlessFramesLeft( aOther.headlessFramesLeft )
 	{}
 
 	VulkanWindow& VulkanWindow::operator=( VulkanWindow&& aOther ) noexcept
@@ -106,6 +138,7 @@ namespace labutils
 		std::swap( swapViews, aOther.swapViews );
 		std::swap( swapchainFormat, aOther.swapchainFormat );
 		std::swap( swapchainExtent, aOther.swapchainExtent );
+		std::swap( headlessFramesLeft, aOther.headlessFramesLeft );
 		return *this;
 	}
 
@@ -122,39 +155,61 @@ namespace labutils
 			);
 		}
 
+		// Check for instance layers and extensions
+		auto const supportedLayers = detail::get_instance_layers();
+		auto const supportedExtensions = detail::get_instance_extensions();
+
+		bool const headlessSupported = supportedExtensions.count( VK_KHR_SURFACE_EXTENSION_NAME ) 
+			&& supportedExtensions.count( VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME );
+
+		// Headless mode: either requested explicitly, or used as a fallback
+		// when GLFW cannot be initialized (e.g., no display is available).
+		bool headless = env_flag( cfg::kHeadlessEnv );
+		if( headless && !headlessSupported )
+			throw lut::Error( "Headless mode requested, but %s is not supported", VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME );
+
 		// Initialise GLFW
-		if (glfwInit() != GLFW_TRUE)
+		if( !headless && glfwInit() != GLFW_TRUE )
 		{
 			char const* errorMsg = nullptr;
 			glfwGetError(&errorMsg);
 
-			throw lut::Error("GLFW: Initialisation Failed: %s", errorMsg);
+			if( !headlessSupported )
+				throw lut::Error("GLFW: Initialisation Failed: %s", errorMsg);
+
+			std::fprintf( stderr, "GLFW: Initialisation Failed: %s\n", errorMsg );
+			std::fprintf( stderr, "Falling back to headless mode\n" );
+			headless = true;
 		}
 
-		if (!glfwVulkanSupported())
+		if (!headless && !glfwVulkanSupported())
 		{
 			throw lut::Error("GLFW: Vulkan not Supported");
 		}
 
-		// Check for instance layers and extensions
-		auto const supportedLayers = detail::get_instance_layers();
-		auto const supportedExtensions = detail::get_instance_extensions();
-
 		bool enableDebugUtils = false;
 
 		std::vector<char const*> enabledLayers, enabledExensions;
 
-		std::uint32_t requiredExtensionsCount = 0;
-		char const** requiredExtensions = glfwGetRequiredInstanceExtensions(&requiredExtensionsCount);
-
-		for (std::uint32_t i = 0; i < requiredExtensionsCount; i++)
+		if( headless )
+		{
+			enabledExensions.emplace_back( VK_KHR_SURFACE_EXTENSION_NAME );
+			enabledExensions.emplace_back( VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME );
+		}
+		else
 		{
-			if (!supportedExtensions.count(requiredExtensions[i]))
+			std::uint32_t requiredExtensionsCount = 0;
+			char const** requiredExtensions = glfwGetRequiredInstanceExtensions(&requiredExtensionsCount);
+
+			for (std::uint32_t i = 0; i < requiredExtensionsCount; i++)
 			{
-				throw lut::Error("GLFW/Vulkan: Required Instance Extension %s not Supported", requiredExtensions[i]);
-			}
+				if (!supportedExtensions.count(requiredExtensions[i]))
+				{
+					throw lut::Error("GLFW/Vulkan: Required Instance Extension %s not Supported", requiredExtensions[i]);
+				}
 
-			enabledExensions.emplace_back(requiredExtensions[i]);
+				enabledExensions.emplace_back(requiredExtensions[i]);
+			}
 		}
 
 		// Validation layers support.
@@ -187,22 +242,42 @@ namespace labutils
 		if( enableDebugUtils )
 			ret.debugMessenger = detail::create_debug_messenger( ret.instance );
 
-		glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-
-		ret.window = glfwCreateWindow(1280, 720, "Exercise 1.X", nullptr, nullptr);
-		if (!ret.window)
+		if( headless )
 		{
-			char const* errorMsg = nullptr;
-			glfwGetError(&errorMsg);
+			// No window; the surface is backed by nothing. Presentation
+			// still goes through the full swap chain machinery.
+			VkHeadlessSurfaceCreateInfoEXT surfaceInfo{}; {
+				surfaceInfo.sType = VK_STRUCTURE_TYPE_HEADLESS_SURFACE_CREATE_INFO_EXT;
+			}
 
-			throw lut::Error("Unable to Create GLFW Window\n"
-				"Last Error = %s", errorMsg);
-		}
+			if (auto const res = vkCreateHeadlessSurfaceEXT(ret.instance, &surfaceInfo, nullptr, &ret.surface); res != VK_SUCCESS)
+			{
+				throw lut::Error("Unable to Create VkSurfaceKHR\n"
+					"vkCreateHeadlessSurfaceEXT() Returned %s", lut::to_string(res).c_str());
+			}
 
-		if (auto const res = glfwCreateWindowSurface(ret.instance, ret.window, nullptr, &ret.surface); res != VK_SUCCESS)
+			ret.headlessFramesLeft = env_uint( cfg::kHeadlessFramesEnv, cfg::kDefaultHeadlessFrames );
+			std::fprintf( stderr, "Running headless for %u frames\n", ret.headlessFramesLeft );
+		}
+		else
 		{
-			throw lut::Error("Unable to Create VkSurfaceKHR\n"
-				"glfwCreateWindowSurface() Returned %s", lut::to_string(res).c_str());
+			glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+
+			ret.window = glfwCreateWindow(cfg::kWindowWidth, cfg::kWindowHeight, "Exercise 1.X", nullptr, nullptr);
+			if (!ret.window)
+			{
+				char const* errorMsg = nullptr;
+				glfwGetError(&errorMsg);
+
+				throw lut::Error("Unable to Create GLFW Window\n"
+					"Last Error = %s", errorMsg);
+			}
+
+			if (auto const res = glfwCreateWindowSurface(ret.instance, ret.window, nullptr, &ret.surface); res != VK_SUCCESS)
+			{
+				throw lut::Error("Unable to Create VkSurfaceKHR\n"
+					"glfwCreateWindowSurface() Returned %s", lut::to_string(res).c_str());
+			}
 		}
 
 		// Select appropriate Vulkan device
@@ -224,6 +299,24 @@ namespace labutils
 
 		enabledDevExensions.emplace_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
 
+		// Heap budgets for residency management (see ResidencyManager). The
+		// allocator queries them with vkGetPhysicalDeviceMemoryProperties2(),
+		// which is core in Vulkan 1.1.
+		if( supports_memory_budget( ret.physicalDevice ) )
+		{
+			enabledDevExensions.emplace_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+			ret.haveMemoryBudget = true;
+		}
+
+		// Host image copies let textures be uploaded without staging buffers
+		// or queue submissions (see upload_image_texture2d()). The feature is
+		// enabled below.
+		if( lut::detail::supports_host_image_copy( ret.physicalDevice ) )
+		{
+			enabledDevExensions.emplace_back(VK_EXT_HOST_IMAGE_COPY_EXTENSION_NAME);
+			ret.haveHostImageCopy = true;
+		}
+
 		for( auto const& ext : enabledDevExensions )
 			std::fprintf( stderr, "Enabling device extension: %s\n", ext );
 
@@ -246,20 +339,97 @@ namespace labutils
 			assert(graphics && present);
 
 			ret.graphicsFamilyIndex = *graphics;
-			ret.graphicsFamilyIndex = *present;
+			ret.presentFamilyIndex = *present;
 
 			queueFamilyIndices.emplace_back(*graphics);
 			queueFamilyIndices.emplace_back(*present);
 		}
 
-		ret.device = create_device( ret.physicalDevice, queueFamilyIndices, enabledDevExensions );
+		bool const presentSeparate = queueFamilyIndices.size() >= 2;
+
+		// Optional queue for asynchronous compute. The swapchain is never
+		// accessed from it, so it is only added to the device's queues.
+		std::vector<std::uint32_t> deviceQueueFamilies = queueFamilyIndices;
+
+		ret.computeFamilyIndex = ret.graphicsFamilyIndex;
+		if( auto const index = lut::detail::find_async_compute_family( ret.physicalDevice ) )
+		{
+			ret.computeFamilyIndex = *index;
+
+			if( std::find( deviceQueueFamilies.begin(), deviceQueueFamilies.end(), *index ) == deviceQueueFamilies.end() )
+				deviceQueueFamilies.emplace_back( *index );
+		}
+
+		std::fprintf( stderr, "Async compute: %s\n", ret.computeFamilyIndex != ret.graphicsFamilyIndex ? "enabled" : "disabled" );
+
+		// Enable dynamic rendering if the device supports it (Vulkan 1.3).
+		// Applications fall back to render passes and framebuffers otherwise.
+		VkPhysicalDeviceVulkan13Features features13{};
+		features13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+
+		if( lut::detail::supports_dynamic_rendering( ret.physicalDevice ) )
+		{
+			features13.dynamicRendering = VK_TRUE;
+			ret.haveDynamicRendering = true;
+		}
+
+		std::fprintf( stderr, "Dynamic rendering: %s\n", ret.haveDynamicRendering ? "enabled" : "disabled" );
+
+		// Buffer device addresses, e.g., for vertex pulling (Vulkan 1.2)
+		VkPhysicalDeviceVulkan12Features features12{};
+		features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+		if( lut::detail::supports_buffer_device_address( ret.physicalDevice ) )
+		{
+			features12.bufferDeviceAddress = VK_TRUE;
+			ret.haveBufferDeviceAddress = true;
+		}
+
+		std::fprintf( stderr, "Buffer device address: %s\n", ret.haveBufferDeviceAddress ? "enabled" : "disabled" );
+
+		// Host image copies (the extension was added above)
+		VkPhysicalDeviceHostImageCopyFeaturesEXT hostCopyFeatures{};
+		hostCopyFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_IMAGE_COPY_FEATURES_EXT;
+		hostCopyFeatures.hostImageCopy = ret.haveHostImageCopy ? VK_TRUE : VK_FALSE;
+
+		std::fprintf( stderr, "Host image copy: %s\n", ret.haveHostImageCopy ? "enabled" : "disabled" );
+
+		void* featureChain = nullptr;
+		if( ret.haveBufferDeviceAddress )
+		{
+			features12.pNext = featureChain;
+			featureChain = &features12;
+		}
+		if( ret.haveDynamicRendering )
+		{
+			features13.pNext = featureChain;
+			featureChain = &features13;
+		}
+		if( ret.haveHostImageCopy )
+		{
+			hostCopyFeatures.pNext = featureChain;
+			featureChain = &hostCopyFeatures;
+		}
+
+		// All core features that the device supports are enabled
+		vkGetPhysicalDeviceFeatures( ret.physicalDevice, &ret.enabledFeatures );
+
+		ret.device = create_device( ret.physicalDevice, deviceQueueFamilies, ret.enabledFeatures, enabledDevExensions, featureChain );
+
+		// Load device-level functions
+		detail::load_device_functions( ret.instance, ret.device, ret.deviceTable );
+
+		if( ret.haveHostImageCopy )
+			detail::load_host_image_copy_functions( ret );
 
 		// Retrieve VkQueues
 		vkGetDeviceQueue( ret.device, ret.graphicsFamilyIndex, 0, &ret.graphicsQueue );
 
 		assert( VK_NULL_HANDLE != ret.graphicsQueue );
 
-		if( queueFamilyIndices.size() >= 2 )
+		vkGetDeviceQueue( ret.device, ret.computeFamilyIndex, 0, &ret.computeQueue );
+
+		if( presentSeparate )
 			vkGetDeviceQueue( ret.device, ret.presentFamilyIndex, 0, &ret.presentQueue );
 		else
 		{
@@ -268,7 +438,7 @@ namespace labutils
 		}
 
 		// Create swap chain
-		std::tie(ret.swapchain, ret.swapchainFormat, ret.swapchainExtent) = create_swapchain( ret.physicalDevice, ret.surface, ret.device, ret.window, queueFamilyIndices );
+		std::tie(ret.swapchain, ret.swapchainFormat, ret.swapchainExtent) = create_swapchain( ret.physicalDevice, ret.surface, ret.device, framebuffer_extent( ret.window ), queueFamilyIndices );
 		
 		// Get swap chain images & create associated image views
 		get_swapchain_images( ret.device, ret.swapchain, ret.swapImages );
@@ -278,8 +448,11 @@ namespace labutils
 		return ret;
 	}
 
-SwapChanges recreate_swapchain( VulkanWindow& aWindow )
+SwapChanges recreate_swapchain( VulkanWindow& aWindow, VkExtent2D aFramebufferExtent )
 {
+	if( 0 == aFramebufferExtent.width || 0 == aFramebufferExtent.height )
+		aFramebufferExtent = framebuffer_extent( aWindow.window );
+
 	auto const oldFormat = aWindow.swapchainFormat;
 	auto const oldExtent = aWindow.swapchainExtent;
 
@@ -304,7 +477,7 @@ SwapChanges recreate_swapchain( VulkanWindow& aWindow )
 			aWindow.physicalDevice,
 			aWindow.surface,
 			aWindow.device,
-			aWindow.window,
+			aFramebufferExtent,
 			queueFamilyIndices,
 			oldSwapchain
 		);
@@ -329,10 +502,46 @@ SwapChanges recreate_swapchain( VulkanWindow& aWindow )
 	}
 	return ret;
 }
+
+bool window_should_close( VulkanWindow& aWindow )
+{
+	if( aWindow.window )
+		return glfwWindowShouldClose( aWindow.window );
+
+	if( 0 == aWindow.headlessFramesLeft )
+		return true;
+
+	--aWindow.headlessFramesLeft;
+	return false;
+}
+
+void poll_events( VulkanWindow const& aWindow )
+{
+	if( aWindow.window )
+		glfwPollEvents();
+}
 }
 
 namespace
 {
+VkExtent2D framebuffer_extent( GLFWwindow* aWindow )
+{
+	int width = int(cfg::kWindowWidth), height = int(cfg::kWindowHeight);
+	if( aWindow )
+		glfwGetFramebufferSize(aWindow, &width, &height);
+
+	return VkExtent2D{ std::uint32_t(width), std::uint32_t(height) };
+}
+
+std::uint32_t env_uint( char const* aName, std::uint32_t aDefault )
+{
+	auto const* value = std::getenv( aName );
+	if( !value || !*value )
+		return aDefault;
+
+	return std::uint32_t(std::strtoul( value, nullptr, 10 ));
+}
+
 std::vector<VkSurfaceFormatKHR> get_surface_formats( VkPhysicalDevice aPhysicalDev, VkSurfaceKHR aSurface )
 {
 	std::uint32_t numFormats = 0;
@@ -377,7 +586,7 @@ std::unordered_set<VkPresentModeKHR> get_present_modes( VkPhysicalDevice aPhysic
 	return returnSet;
 }
 
-std::tuple<VkSwapchainKHR,VkFormat,VkExtent2D> create_swapchain( VkPhysicalDevice aPhysicalDev, VkSurfaceKHR aSurface, VkDevice aDevice, GLFWwindow* aWindow, std::vector<std::uint32_t> const& aQueueFamilyIndices, VkSwapchainKHR aOldSwapchain )
+std::tuple<VkSwapchainKHR,VkFormat,VkExtent2D> create_swapchain( VkPhysicalDevice aPhysicalDev, VkSurfaceKHR aSurface, VkDevice aDevice, VkExtent2D aFramebufferExtent, std::vector<std::uint32_t> const& aQueueFamilyIndices, VkSwapchainKHR aOldSwapchain )
 {
 	auto const formats = get_surface_formats( aPhysicalDev, aSurface );
 	auto const modes = get_present_modes( aPhysicalDev, aSurface );
@@ -424,14 +633,13 @@ std::tuple<VkSwapchainKHR,VkFormat,VkExtent2D> create_swapchain( VkPhysicalDevic
 
 	if (std::numeric_limits<std::uint32_t>::max() == extent.width)
 	{
-		int width, height;
-		glfwGetFramebufferSize(aWindow, &width, &height);
-
+		// Headless surfaces (and some window systems) don't have a size;
+		// use the size of the window's framebuffer instead.
 		auto const& min = surfaceCapabilities.minImageExtent;
 		auto const& max = surfaceCapabilities.maxImageExtent;
 
-		extent.width = std::clamp(std::uint32_t(width), min.width, max.width);
-		extent.height = std::clamp(std::uint32_t(height), min.height, max.height);
+		extent.width = std::clamp(aFramebufferExtent.width, min.width, max.width);
+		extent.height = std::clamp(aFramebufferExtent.height, min.height, max.height);
 	}
 
 	// TODO: create swap chain
@@ -575,7 +783,15 @@ namespace
 		return {};
 	}
 
-	VkDevice create_device( VkPhysicalDevice aPhysicalDev, std::vector<std::uint32_t> const& aQueues, std::vector<char const*> const& aEnabledExtensions )
+	bool supports_memory_budget( VkPhysicalDevice aPhysicalDev )
+	{
+		if( !lut::detail::device_api_at_least( aPhysicalDev, 1, 1 ) )
+			return false;
+
+		return 0 != lut::detail::get_device_extensions( aPhysicalDev ).count( VK_EXT_MEMORY_BUDGET_EXTENSION_NAME );
+	}
+
+	VkDevice create_device( VkPhysicalDevice aPhysicalDev, std::vector<std::uint32_t> const& aQueues, VkPhysicalDeviceFeatures const& aEnabledFeatures, std::vector<char const*> const& aEnabledExtensions, void* aFeatureChain )
 	{
 		if( aQueues.empty() )
 			throw lut::Error( "create_device(): no queues requested" );
@@ -592,11 +808,9 @@ namespace
 			queueInfo.pQueuePriorities  = queuePriorities;
 		}
 
-		VkPhysicalDeviceFeatures deviceFeatures{};
-		vkGetPhysicalDeviceFeatures(aPhysicalDev, &deviceFeatures);
-		
 		VkDeviceCreateInfo deviceInfo{};
 		deviceInfo.sType  = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+		deviceInfo.pNext  = aFeatureChain;
 
 		deviceInfo.queueCreateInfoCount     = std::uint32_t(queueInfos.size());
 		deviceInfo.pQueueCreateInfos        = queueInfos.data();
@@ -604,7 +818,7 @@ namespace
 		deviceInfo.enabledExtensionCount    = std::uint32_t(aEnabledExtensions.size());
 		deviceInfo.ppEnabledExtensionNames  = aEnabledExtensions.data();
 
-		deviceInfo.pEnabledFeatures         = &deviceFeatures;
+		deviceInfo.pEnabledFeatures         = &aEnabledFeatures;
 
 		VkDevice device = VK_NULL_HANDLE;
 		if( auto const res = vkCreateDevice( aPhysicalDev, &deviceInfo, nullptr, &device ); VK_SUCCESS != res )
@@ -655,13 +869,12 @@ namespace
 			return -1.0f;
 		}
 
-		// Discrete GPU > Integrated GPU > others
-		float score = 0.f;
+		// Rank the remaining devices by their capabilities
+		auto const profile = lut::profile_device( aPhysicalDev );
+		auto const score = lut::score_device_profile( profile );
 
-		if( VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU == props.deviceType )
-			score += 500.f;
-		else if( VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU == props.deviceType )
-			score += 100.f;
+		lut::print_device_profile( stderr, profile );
+		std::fprintf( stderr, "Info: Device '%s' scores %.1f\n", props.deviceName, score );
 
 		return score;
 	}
@@ -684,6 +897,16 @@ namespace
 			);
 		}
 
+		// Explicitly selected device?
+		if( auto const index = lut::find_device_override( devices ) )
+		{
+			auto const device = devices[*index];
+			if( score_device( device, aSurface ) < 0.f )
+				throw lut::Error( "Selected device %zu does not meet the requirements", *index );
+
+			return device;
+		}
+
 		float bestScore = -1.f;
 		VkPhysicalDevice bestDevice = VK_NULL_HANDLE;
 
@@ -39,10 +39,23 @@ namespace labutils
 
 			VkFormat swapchainFormat;
 			VkExtent2D swapchainExtent;
+
+			// Headless mode (window == nullptr): remaining number of frames
+			// before window_should_close() returns true.
+			std::uint32_t headlessFramesLeft = 0;
 	};
 
+	// Creates a GLFW window and a surface for it. If LABUTILS_HEADLESS is set,
+	// or if GLFW cannot be initialized (e.g., no display), a surface is
+	// instead created with VK_EXT_headless_surface, and `window` is null. 
 	VulkanWindow make_vulkan_window();
 
+	// Wrappers around glfwWindowShouldClose() and glfwPollEvents() that also
+	// handle headless windows. A headless window "closes" after the number
+	// of frames given by LABUTILS_HEADLESS_FRAMES.
+	bool window_should_close( VulkanWindow& );
+	void poll_events( VulkanWindow const& );
+
 
 	struct SwapChanges
 	{
@@ -50,7 +63,10 @@ namespace labutils
 		bool changedFormat: 1;
 	};
 
-	SwapChanges recreate_swapchain( VulkanWindow& );
+	// The framebuffer extent is only used if the surface does not define the
+	// swap chain size. If it is zero, it is queried from GLFW, which must then
+	// happen on the main thread.
+	SwapChanges recreate_swapchain( VulkanWindow&, VkExtent2D aFramebufferExtent = VkExtent2D{ 0, 0 } );
 }
 
 //EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab: 
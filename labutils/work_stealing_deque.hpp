@@ -0,0 +1,112 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace labutils
+{
+	/* Lock-free bounded work-stealing deque (Chase-Lev).
+	 *
+	 * The owning thread pushes and pops at the bottom (LIFO, which keeps
+	 * recently spawned and likely cache-hot work local), while other threads
+	 * steal from the top (FIFO, which hands out the oldest and typically
+	 * largest pieces of work). Only the last element is contended; owner and
+	 * thieves then race for it with a CAS on the top index.
+	 *
+	 * Memory orderings follow Lê et al., "Correct and Efficient Work-Stealing
+	 * for Weak Memory Models" (PPoPP 2013). Unlike the original, the ring
+	 * buffer does not grow: push() fails if the deque is full, and the caller
+	 * must then run the work itself.
+	 *
+	 * tType must be trivially copyable; in practice it is a pointer.
+	 */
+	template< typename tType, std::size_t tCapacity >
+	class WorkStealingDeque
+	{
+		static_assert( tCapacity > 0 && 0 == (tCapacity & (tCapacity-1)), "Capacity must be a power of two" );
+
+		public:
+			WorkStealingDeque() = default;
+
+			WorkStealingDeque( WorkStealingDeque const& ) = delete;
+			WorkStealingDeque& operator= (WorkStealingDeque const&) = delete;
+
+		public:
+			// Owner only
+			bool push( tType aValue ) noexcept
+			{
+				auto const bottom = mBottom.load( std::memory_order_relaxed );
+				auto const top = mTop.load( std::memory_order_acquire );
+
+				if( bottom - top >= std::int64_t(tCapacity) )
+					return false;
+
+				mSlots[bottom & kMask_].store( aValue, std::memory_order_relaxed );
+				std::atomic_thread_fence( std::memory_order_release );
+				mBottom.store( bottom + 1, std::memory_order_relaxed );
+				return true;
+			}
+
+			// Owner only
+			bool pop( tType& aValue ) noexcept
+			{
+				auto const bottom = mBottom.load( std::memory_order_relaxed ) - 1;
+				mBottom.store( bottom, std::memory_order_relaxed );
+
+				// Orders the bottom store before the top load; pairs with
+				// the fence in steal().
+				std::atomic_thread_fence( std::memory_order_seq_cst );
+				auto top = mTop.load( std::memory_order_relaxed );
+
+				if( top > bottom )
+				{
+					// Empty
+					mBottom.store( bottom + 1, std::memory_order_relaxed );
+					return false;
+				}
+
+				aValue = mSlots[bottom & kMask_].load( std::memory_order_relaxed );
+				if( top < bottom )
+					return true;
+
+				// Last element: race against thieves.
+				bool const won = mTop.compare_exchange_strong( top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed );
+				mBottom.store( bottom + 1, std::memory_order_relaxed );
+				return won;
+			}
+
+			// Any thread. May fail spuriously if another thread wins a race
+			// for the same element.
+			bool steal( tType& aValue ) noexcept
+			{
+				auto top = mTop.load( std::memory_order_acquire );
+				std::atomic_thread_fence( std::memory_order_seq_cst );
+				auto const bottom = mBottom.load( std::memory_order_acquire );
+
+				if( top >= bottom )
+					return false;
+
+				aValue = mSlots[top & kMask_].load( std::memory_order_relaxed );
+				return mTop.compare_exchange_strong( top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed );
+			}
+
+			// Approximate unless called by the owner with no concurrent
+			// thieves.
+			bool empty() const noexcept
+			{
+				return mBottom.load( std::memory_order_relaxed ) <= mTop.load( std::memory_order_relaxed );
+			}
+
+		private:
+			static constexpr std::int64_t kMask_ = std::int64_t(tCapacity) - 1;
+
+			// Thieves only touch mTop; keep it away from the owner's mBottom.
+			alignas(64) std::atomic<std::int64_t> mTop{ 0 };
+			alignas(64) std::atomic<std::int64_t> mBottom{ 0 };
+
+			std::atomic<tType> mSlots[tCapacity]{};
+	};
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
@@ -98,7 +98,8 @@ project "exercise2"
 project "exercise2-shaders"
 	local shaders = { 
 		"exercise2/shaders/*.vert",
-		"exercise2/shaders/*.frag"
+		"exercise2/shaders/*.frag",
+		"exercise2/shaders/*.comp"
 	}
 
 	kind "Utility"
@@ -176,6 +177,204 @@ project "exercise4-shaders"
 
 	handle_glsl_files( "-O", "assets/exercise4/shaders", {} )
 
+project "bench-dispatch"
+	local sources = { 
+		"bench-dispatch/**.cpp",
+		"bench-dispatch/**.hpp",
+		"bench-dispatch/**.hxx"
+	}
+
+	kind "ConsoleApp"
+	location "bench-dispatch"
+
+	files( sources )
+
+	links "labutils"
+	links "x-volk"
+
+project "bench-exercise4"
+	local sources = { 
+		"bench-exercise4/**.cpp",
+		"bench-exercise4/**.hpp",
+		"bench-exercise4/**.hxx",
+
+		-- Renders the exercise4 scene with exercise4's renderer
+		"exercise4/renderer.cpp",
+		"exercise4/renderer.hpp",
+		"exercise4/renderables.cpp",
+		"exercise4/renderables.hpp",
+		"exercise4/scene_graph.cpp",
+		"exercise4/scene_graph.hpp",
+		"exercise4/vertex_data.cpp",
+		"exercise4/vertex_data.hpp"
+	}
+
+	kind "ConsoleApp"
+	location "bench-exercise4"
+
+	files( sources )
+
+	dependson "exercise4-shaders"
+
+	links "labutils"
+	links "x-volk"
+	links "x-stb"
+	links "x-vma"
+
+	dependson "x-glm" 
+
+project "bench-encode"
+	local sources = { 
+		"bench-encode/**.cpp",
+		"bench-encode/**.hpp",
+		"bench-encode/**.hxx"
+	}
+
+	kind "ConsoleApp"
+	location "bench-encode"
+
+	files( sources )
+
+	links "labutils"
+	links "x-stb"
+
+project "bench-async-compute"
+	local sources = { 
+		"bench-async-compute/**.cpp",
+		"bench-async-compute/**.hpp",
+		"bench-async-compute/**.hxx"
+	}
+
+	kind "ConsoleApp"
+	location "bench-async-compute"
+
+	files( sources )
+
+	dependson "bench-async-compute-shaders"
+
+	links "labutils"
+	links "x-volk"
+	links "x-vma"
+
+project "bench-async-compute-shaders"
+	local shaders = { 
+		"bench-async-compute/shaders/*.comp"
+	}
+
+	kind "Utility"
+	location "bench-async-compute/shaders"
+
+	files( shaders )
+
+	handle_glsl_files( "-O", "assets/bench-async-compute/shaders", {} )
+
+project "bench-transfer"
+	local sources = { 
+		"bench-transfer/**.cpp",
+		"bench-transfer/**.hpp",
+		"bench-transfer/**.hxx"
+	}
+
+	kind "ConsoleApp"
+	location "bench-transfer"
+
+	files( sources )
+
+	links "labutils"
+	links "x-volk"
+	links "x-vma"
+	links "x-stb"
+
+project "bench-create"
+	local sources = { 
+		"bench-create/**.cpp",
+		"bench-create/**.hpp",
+		"bench-create/**.hxx"
+	}
+
+	kind "ConsoleApp"
+	location "bench-create"
+
+	files( sources )
+
+	-- Reuses the shaders of exercise2 and bench-async-compute
+	dependson "exercise2-shaders"
+	dependson "bench-async-compute-shaders"
+
+	links "labutils"
+	links "x-volk"
+	links "x-stb"
+	links "x-vma"
+
+project "bench-scene"
+	local sources = { 
+		"bench-scene/**.cpp",
+		"bench-scene/**.hpp",
+		"bench-scene/**.hxx",
+
+		-- Benchmarks the exercise4 scene graph
+		"exercise4/scene_graph.cpp",
+		"exercise4/scene_graph.hpp"
+	}
+
+	kind "ConsoleApp"
+	location "bench-scene"
+
+	files( sources )
+
+	dependson "x-glm" 
+
+project "bench-entities"
+	local sources = { 
+		"bench-entities/**.cpp",
+		"bench-entities/**.hpp",
+		"bench-entities/**.hxx",
+
+		-- Benchmarks the exercise4 renderable store
+		"exercise4/renderables.cpp",
+		"exercise4/renderables.hpp"
+	}
+
+	kind "ConsoleApp"
+	location "bench-entities"
+
+	files( sources )
+
+	dependson "x-glm" 
+
+project "bench-jobs"
+	local sources = { 
+		"bench-jobs/**.cpp",
+		"bench-jobs/**.hpp",
+		"bench-jobs/**.hxx"
+	}
+
+	kind "ConsoleApp"
+	location "bench-jobs"
+
+	files( sources )
+
+	dependson "x-glm" 
+
+	links "labutils"
+
+project "bench-upload"
+	local sources = { 
+		"bench-upload/**.cpp",
+		"bench-upload/**.hpp",
+		"bench-upload/**.hxx"
+	}
+
+	kind "ConsoleApp"
+	location "bench-upload"
+
+	files( sources )
+
+	links "labutils"
+	links "x-volk"
+	links "x-vma"
+	links "x-stb"
+
 project "labutils"
 	local sources = { 
 		"labutils/**.cpp",